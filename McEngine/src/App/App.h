@@ -21,6 +21,7 @@ public:
 
 	virtual void draw(Graphics *g) {;}
 	virtual void update() {;}
+	virtual void onFixedUpdate() {;} // called at a constant rate of host_fixedupdate_rate, see engine->getFixedFrameTime() and engine->getFixedUpdateAlpha()
 
 	virtual void onKeyDown(KeyboardEvent &e) {;}
 	virtual void onKeyUp(KeyboardEvent &e) {;}
@@ -39,6 +39,10 @@ FrameworkTest::FrameworkTest()
 
 	m_testButton = new FrameworkTestButton(300, 600, 200, 25, "CBaseUIButton", "CBaseUIButton");
 
+	m_fFixedBlockPrevX = 0.0f;
+	m_fFixedBlockX = 0.0f;
+	m_fFixedBlockVelocity = 400.0f;
+
 	// load resource
 	engine->getResourceManager()->loadImage("block.png", "TESTIMAGE");
 }
@@ -59,6 +63,10 @@ void FrameworkTest::draw(Graphics *g)
 	int blockSize = 100;
 	g->fillRect(engine->getScreenWidth()/2 - blockSize/2 + std::sin(engine->getTime()*3)*100, engine->getScreenHeight()/2 - blockSize/2 + std::sin(engine->getTime()*3*1.5f)*100, blockSize, blockSize);
 
+	// test fixed update interpolation (should move perfectly smooth at any framerate)
+	g->setColor(0xff0000ff);
+	g->fillRect(lerp<float>(m_fFixedBlockPrevX, m_fFixedBlockX, (float)engine->getFixedUpdateAlpha()), engine->getScreenHeight() - 75, 50, 50);
+
 	// test font texture atlas
 	g->setColor(0xffffffff);
 	g->pushTransform();
@@ -109,6 +117,16 @@ void FrameworkTest::update()
 	m_testButton->update();
 }
 
+void FrameworkTest::onFixedUpdate()
+{
+	m_fFixedBlockPrevX = m_fFixedBlockX;
+	m_fFixedBlockX += m_fFixedBlockVelocity * (float)engine->getFixedFrameTime();
+
+	// bounce between the screen edges
+	if ((m_fFixedBlockX < 0.0f && m_fFixedBlockVelocity < 0.0f) || (m_fFixedBlockX > engine->getScreenWidth() - 50 && m_fFixedBlockVelocity > 0.0f))
+		m_fFixedBlockVelocity = -m_fFixedBlockVelocity;
+}
+
 void FrameworkTest::onResolutionChanged(Vector2 newResolution)
 {
 	debugLog("FrameworkTest::onResolutionChanged( (%f, %f) )\n", newResolution.x, newResolution.y);
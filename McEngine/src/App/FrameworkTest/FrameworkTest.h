@@ -22,6 +22,7 @@ public:
 
 	virtual void draw(Graphics *g);
 	virtual void update();
+	virtual void onFixedUpdate();
 
 	virtual void onResolutionChanged(Vector2 newResolution);
 
@@ -54,6 +55,11 @@ public:
 
 	// UI
 	CBaseUIButton *m_testButton;
+
+	// fixed update
+	float m_fFixedBlockPrevX;
+	float m_fFixedBlockX;
+	float m_fFixedBlockVelocity;
 };
 
 #endif
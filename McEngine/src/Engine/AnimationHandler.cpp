@@ -9,6 +9,7 @@
 
 #include "Engine.h"
 #include "ConVar.h"
+#include "Profiler.h"
 
 ConVar debug_anim("debug_anim", false);
 
@@ -27,6 +28,8 @@ AnimationHandler::~AnimationHandler()
 
 void AnimationHandler::update()
 {
+	VPROF("AnimationHandler::update");
+
 	for (int i=0; i<m_vAnimations.size(); i++)
 	{
 		// start animation
@@ -33,6 +33,7 @@ void ConVar::init()
 	m_fDefaultValue = 0.0f;
 
 	m_bHasValue = true;
+	m_args = ARGS::ARGS_REQUIRED;
 }
 
 void ConVar::init(UString name)
@@ -108,6 +109,13 @@ ConVar::ConVar(UString name, ConVarCallbackArgs callbackARGS)
 	addConVar(this);
 }
 
+ConVar::ConVar(UString name, ConVarCallbackArgs callbackARGS, ARGS args)
+{
+	init(name, callbackARGS);
+	m_args = args;
+	addConVar(this);
+}
+
 ConVar::ConVar(UString name, float fDefaultValue)
 {
 	init(name, fDefaultValue, "", NULL);
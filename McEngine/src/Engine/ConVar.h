@@ -23,10 +23,17 @@ public:
 	typedef fastdelegate::FastDelegate1<UString> NativeConVarCallbackArgs;
 	typedef fastdelegate::FastDelegate2<UString, UString> NativeConVarChangeCallback;
 
+	enum class ARGS
+	{
+		ARGS_REQUIRED,
+		ARGS_OPTIONAL	// the callback also runs (with empty args) if the command is entered without arguments
+	};
+
 	ConVar(UString name);
 
 	ConVar(UString name, ConVarCallback callback);
 	ConVar(UString name, ConVarCallbackArgs callbackARGS);
+	ConVar(UString name, ConVarCallbackArgs callbackARGS, ARGS args);
 
 	ConVar(UString name, float defaultValue);
 	ConVar(UString name, float defaultValue, ConVarChangeCallback callback);
@@ -78,6 +85,7 @@ public:
 	inline const UString getName() const {return m_sName;}
 
 	inline bool hasValue() const {return m_bHasValue.load();}
+	inline bool hasOptionalArgs() const {return (m_args == ARGS::ARGS_OPTIONAL);}
 	bool hasCallbackArgs();
 
 private:
@@ -89,6 +97,7 @@ private:
 	void init(UString name, UString defaultValue, UString helpString, ConVarChangeCallback callback);
 
 	std::atomic<bool> m_bHasValue;
+	ARGS m_args;
 
 	UString m_sName;
 	UString m_sHelpString;
@@ -9,6 +9,7 @@
 #include "Engine.h"
 
 #include <stdio.h>
+#include <time.h>
 
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
@@ -26,6 +27,7 @@
 #include "VulkanInterface.h"
 #include "SoundEngine.h"
 #include "ResourceManager.h"
+#include "JobSystem.h"
 #include "AnimationHandler.h"
 #include "XInputGamepad.h"
 #include "ContextMenu.h"
@@ -33,10 +35,16 @@
 #include "Keyboard.h"
 #include "Timer.h"
 #include "ConVar.h"
+#include "Profiler.h"
+#include "FrameTimeHistory.h"
+#include "Logger.h"
 
 #include "CBaseUIContainer.h"
 #include "Console.h"
 #include "ConsoleBox.h"
+#include "VisualProfiler.h"
+#include "FrameTimeGraph.h"
+#include "RenderStatsOverlay.h"
 
 
 
@@ -60,6 +68,16 @@ void _host_timescale_( UString oldValue, UString newValue )
 		host_timescale.setValue(1.0f);
 	}
 }
+ConVar host_fixedupdate_rate("host_fixedupdate_rate", 120.0f, "rate in Hz at which App::onFixedUpdate() is called, independent of the framerate (0 = disabled)");
+ConVar host_fixedupdate_max_steps("host_fixedupdate_max_steps", 8, "maximum number of fixed updates per frame, the rest is dropped if the engine can't keep up (instead of spiraling into ever longer frames)");
+ConVar host_framestep_dt("host_framestep_dt", 1.0f/60.0f, "fixed frametime in seconds which host_framestep steps the engine with (ignores the real clock and host_timescale)");
+void _frametime_history_size_( UString oldValue, UString newValue );
+ConVar frametime_history_size("frametime_history_size", 2048, "number of frames which are kept for frametime_stats and frametime_graph", _frametime_history_size_);
+void _frametime_history_size_( UString oldValue, UString newValue )
+{
+	if (engine != NULL && engine->getFrameTimeHistory() != NULL)
+		engine->getFrameTimeHistory()->setCapacity(newValue.toInt());
+}
 ConVar epilepsy("epilepsy", false);
 ConVar debug_engine("debug_engine", false);
 ConVar minimize_on_focus_lost_if_fullscreen("minimize_on_focus_lost_if_fullscreen", true);
@@ -83,13 +101,20 @@ Engine::Engine(Environment *environment, const char *args)
 	m_sArgs = UString(args);
 
 	m_graphics = NULL;
+	m_jobSystem = NULL;
 	m_guiContainer = NULL;
+	m_visualProfiler = NULL;
+	m_frameTimeGraph = NULL;
+	m_renderStatsOverlay = NULL;
 	m_app = NULL;
 
 	// disable output buffering (else we get multithreading issues due to blocking)
 	setvbuf(stdout, NULL, _IONBF, 0);
 	setvbuf(stderr, NULL, _IONBF, 0);
 
+	// start logging through the sink thread
+	Logger::start();
+
 	// print debug information
 	debugLog("-= Engine Startup =-\n");
 	_version();
@@ -101,6 +126,27 @@ Engine::Engine(Environment *environment, const char *args)
 	m_iFrameCount = 0;
 	m_dFrameTime = 0.016f;
 
+	// fixed updates
+	m_dFixedUpdateAccumulator = 0.0;
+	m_dFixedUpdateAlpha = 1.0;
+
+	// frame time telemetry
+	m_frameTimeHistory = new FrameTimeHistory(frametime_history_size.getInt());
+	m_dLastUpdateTime = 0.0;
+	m_dLastPaintTime = 0.0;
+	m_dLastFrameEndTime = -1.0;
+
+	// frame stepping
+	m_iFrameStepFrames = 0;
+	m_iFrameStepCounter = 0;
+	m_bFrameStepShutdown = false;
+	m_dFrameStepUpdateTime = 0.0;
+	m_dFrameStepPaintTime = 0.0;
+	m_dFrameStepUpdateTimeMax = 0.0;
+	m_dFrameStepPaintTimeMax = 0.0;
+	m_dFrameStepStartTime = 0.0;
+	m_dFrameStepStartCPUTime = 0.0;
+
 	// window
 	m_bBlackout = false;
 	m_bHasFocus = false;
@@ -137,6 +183,7 @@ Engine::Engine(Environment *environment, const char *args)
 	m_contextMenu = m_environment->createContextMenu();
 
 	// and the rest
+	m_jobSystem = new JobSystem(); // needs to be created before the ResourceManager
 	m_resourceManager = new ResourceManager();
 	m_sound = new SoundEngine();
 	m_animationHandler = new AnimationHandler();
@@ -169,9 +216,21 @@ Engine::~Engine()
 	debugLog("Engine: Freeing console box...\n");
 	SAFE_DELETE(m_consoleBox);
 
+	debugLog("Engine: Freeing visual profiler...\n");
+	SAFE_DELETE(m_visualProfiler);
+
+	debugLog("Engine: Freeing frametime graph...\n");
+	SAFE_DELETE(m_frameTimeGraph);
+
+	debugLog("Engine: Freeing render stats overlay...\n");
+	SAFE_DELETE(m_renderStatsOverlay);
+
 	debugLog("Engine: Freeing resource manager...\n");
 	SAFE_DELETE(m_resourceManager);
 
+	debugLog("Engine: Freeing job system...\n");
+	SAFE_DELETE(m_jobSystem);
+
 	debugLog("Engine: Freeing OpenCL...\n");
 	SAFE_DELETE(m_openCL);
 
@@ -208,6 +267,7 @@ Engine::~Engine()
 
 	debugLog("Engine: Freeing timer...\n");
 	SAFE_DELETE(m_timer);
+	SAFE_DELETE(m_frameTimeHistory);
 
 	debugLog("Engine: Freeing graphics...\n");
 	SAFE_DELETE(m_graphics);
@@ -215,6 +275,9 @@ Engine::~Engine()
 	debugLog("Engine: Freeing Vulkan...\n");
 	SAFE_DELETE(m_vulkan);
 
+	debugLog("Engine: Stopping logger...\n");
+	Logger::shutdown(); // (everything after this is written synchronously)
+
 	debugLog("Engine: Freeing environment...\n");
 	SAFE_DELETE(m_environment);
 
@@ -248,6 +311,12 @@ void Engine::loadApp()
 	m_guiContainer = new CBaseUIContainer(0, 0, engine->getScreenWidth(), engine->getScreenHeight(), "engine");
 	m_consoleBox = new ConsoleBox();
 	m_guiContainer->addBaseUIElement(m_consoleBox);
+	m_visualProfiler = new VisualProfiler();
+	m_guiContainer->addBaseUIElement(m_visualProfiler);
+	m_frameTimeGraph = new FrameTimeGraph();
+	m_guiContainer->addBaseUIElement(m_frameTimeGraph);
+	m_renderStatsOverlay = new RenderStatsOverlay();
+	m_guiContainer->addBaseUIElement(m_renderStatsOverlay);
 
 	debugLog("\nEngine: Loading app ...\n");
 
@@ -265,18 +334,37 @@ void Engine::loadApp()
 	// start listening to the default keyboard input (engine gui comes first)
 	m_keyboard->addListener(m_guiContainer, true);
 	m_keyboard->addListener(m_app);
+
+	// "-framestep <numFrames>" runs a deterministic benchmark right after startup, and quits afterwards
+	const int frameStepArgIndex = m_sArgs.find("-framestep");
+	if (frameStepArgIndex != -1)
+	{
+		const int numFrames = m_sArgs.substr(frameStepArgIndex + 10).trim().toInt();
+		if (numFrames > 0)
+			startFrameStepping(numFrames, true);
+		else
+			debugLog("Engine: Invalid -framestep value, usage: -framestep <numFrames>\n");
+	}
 }
 
 void Engine::onPaint()
 {
 	if (m_bBlackout || m_bIsMinimized) return;
 
+	VPROF("Engine::onPaint");
+
+	const bool isFrameStepMeasured = (isFrameStepping() && m_iFrameStepCounter > 0);
+	const double paintStartTime = getTimeReal();
+
 	m_bDrawing = true;
 
 	m_graphics->beginScene();
 
 		if (m_app != NULL)
+		{
+			VPROF("App::draw");
 			m_app->draw(m_graphics);
+		}
 
 		if (m_guiContainer != NULL)
 			m_guiContainer->draw(m_graphics);
@@ -293,22 +381,51 @@ void Engine::onPaint()
 			m_graphics->fillRect(0, 0, engine->getScreenWidth(), engine->getScreenHeight());
 		}
 
-	m_graphics->endScene();
+	{
+		VPROF("Graphics::endScene");
+		m_graphics->endScene();
+	}
 
 	m_bDrawing = false;
 
 	m_iFrameCount++;
+
+	// frame time telemetry (total is measured from frame end to frame end, so it contains everything, including the frame limiter)
+	const double paintEndTime = getTimeReal();
+	m_dLastPaintTime = paintEndTime - paintStartTime;
+	if (m_dLastFrameEndTime >= 0.0)
+		m_frameTimeHistory->add(m_dLastUpdateTime, m_dLastPaintTime, paintEndTime - m_dLastFrameEndTime);
+	m_dLastFrameEndTime = paintEndTime;
+
+	if (isFrameStepMeasured)
+	{
+		m_dFrameStepPaintTime += m_dLastPaintTime;
+		m_dFrameStepPaintTimeMax = std::max(m_dFrameStepPaintTimeMax, m_dLastPaintTime);
+
+		if (m_iFrameStepCounter >= m_iFrameStepFrames)
+			onFrameSteppingFinished();
+	}
 }
 
 void Engine::onUpdate()
 {
+	Profiler::beginFrame();
+
 	if (m_bBlackout || (m_bIsMinimized && !(m_networkHandler->isClient() || m_networkHandler->isServer())))
 		return;
 
+	VPROF("Engine::onUpdate");
+
+	// frames which are started while stepping are measured (the counter also stays 0 for the frame in which stepping was requested)
+	const bool isFrameStepMeasured = isFrameStepping();
+	if (isFrameStepMeasured)
+		m_iFrameStepCounter++;
+
 	// update time
 	m_timer->update();
 	m_dRunTime = m_timer->getElapsedTime();
-	m_dFrameTime *= (double)host_timescale.getFloat();
+	if (!isFrameStepMeasured)
+		m_dFrameTime *= (double)host_timescale.getFloat();
 	m_dTime += m_dFrameTime;
 
 	// handle resolution changes
@@ -328,6 +445,8 @@ void Engine::onUpdate()
 	m_animationHandler->update();
 	m_sound->update();
 	m_resourceManager->update();
+	m_jobSystem->update();
+	Logger::update();
 
 	// update gui
 	if (m_guiContainer != NULL)
@@ -347,12 +466,61 @@ void Engine::onUpdate()
 	// update networking
 	m_networkHandler->update();
 
+	// run fixed updates, as many as fit into the elapsed time
+	if (host_fixedupdate_rate.getFloat() > 0.0f)
+	{
+		const double fixedFrameTime = getFixedFrameTime();
+		const int maxSteps = std::max(host_fixedupdate_max_steps.getInt(), 1);
+
+		m_dFixedUpdateAccumulator += m_dFrameTime;
+
+		int numSteps = 0;
+		while (m_dFixedUpdateAccumulator >= fixedFrameTime && numSteps < maxSteps)
+		{
+			if (m_app != NULL)
+			{
+				VPROF("App::onFixedUpdate");
+				m_app->onFixedUpdate();
+			}
+
+			m_dFixedUpdateAccumulator -= fixedFrameTime;
+			numSteps++;
+		}
+
+		// can't keep up, drop the rest (but keep the fraction for interpolating)
+		if (m_dFixedUpdateAccumulator >= fixedFrameTime)
+		{
+			if (debug_engine.getBool())
+				debugLog("Engine: Dropping %i fixed updates\n", (int)(m_dFixedUpdateAccumulator / fixedFrameTime));
+
+			m_dFixedUpdateAccumulator = fmod(m_dFixedUpdateAccumulator, fixedFrameTime);
+		}
+
+		m_dFixedUpdateAlpha = m_dFixedUpdateAccumulator / fixedFrameTime;
+	}
+	else
+	{
+		m_dFixedUpdateAccumulator = 0.0;
+		m_dFixedUpdateAlpha = 1.0;
+	}
+
 	// update app
 	if (m_app != NULL)
+	{
+		VPROF("App::update");
 		m_app->update();
+	}
 
 	// update environment
 	m_environment->update();
+
+	m_dLastUpdateTime = getTimeReal() - m_dRunTime;
+
+	if (isFrameStepMeasured && m_iFrameStepCounter > 0) // (could have been restarted by a command during this update)
+	{
+		m_dFrameStepUpdateTime += m_dLastUpdateTime;
+		m_dFrameStepUpdateTimeMax = std::max(m_dFrameStepUpdateTimeMax, m_dLastUpdateTime);
+	}
 }
 
 void Engine::onFocusGained()
@@ -596,12 +764,14 @@ void Engine::showMessageWarning(UString title, UString message)
 void Engine::showMessageError(UString title, UString message)
 {
 	debugLog("ERROR: [%s] | %s\n", title.toUtf8(), message.toUtf8());
+	Logger::flush(); // (in case we don't come back)
 	m_environment->showMessageError(title, message);
 }
 
 void Engine::showMessageErrorFatal(UString title, UString message)
 {
 	debugLog("FATAL ERROR: [%s] | %s\n", title.toUtf8(), message.toUtf8());
+	Logger::flush(); // (in case we don't come back)
 	m_environment->showMessageErrorFatal(title, message);
 }
 
@@ -634,82 +804,81 @@ void Engine::removeGamepad(Gamepad *gamepad)
 	}
 }
 
-void Engine::setFrameTime(double delta)
+void Engine::startFrameStepping(int numFrames, bool shutdownWhenDone)
 {
-	// NOTE: clamp to between 10000 fps and 1 fps, very small/big timesteps could cause problems
-	m_dFrameTime = clamp<double>(delta, 0.0001, 1.0);
-}
+	if (numFrames < 1)
+	{
+		if (isFrameStepping())
+			debugLog("Engine: Frame stepping cancelled after %i/%i frames.\n", m_iFrameStepCounter, m_iFrameStepFrames);
 
-double const Engine::getTimeReal()
-{
-	m_timer->update();
-	return m_timer->getElapsedTime();
+		m_iFrameStepFrames = 0;
+		return;
+	}
+
+	debugLog("Engine: Stepping %i frames at dt = %f ...\n", numFrames, host_framestep_dt.getFloat());
+
+	m_iFrameStepFrames = numFrames;
+	m_iFrameStepCounter = 0;
+	m_bFrameStepShutdown = shutdownWhenDone;
+
+	m_dFrameStepUpdateTime = 0.0;
+	m_dFrameStepPaintTime = 0.0;
+	m_dFrameStepUpdateTimeMax = 0.0;
+	m_dFrameStepPaintTimeMax = 0.0;
+
+	m_dFrameStepStartTime = getTimeReal();
+	m_dFrameStepStartCPUTime = (double)clock() / (double)CLOCKS_PER_SEC;
 }
 
-void Engine::debugLog(const char *fmt, va_list args)
+void Engine::onFrameSteppingFinished()
 {
-	if (fmt == NULL) return;
+	const double wallTime = getTimeReal() - m_dFrameStepStartTime;
+	const double cpuTime = ((double)clock() / (double)CLOCKS_PER_SEC) - m_dFrameStepStartCPUTime; // NOTE: whole process, includes all other threads (e.g. resource loading)
+	const double numFrames = (double)m_iFrameStepCounter;
 
-	va_list ap2;
-	va_copy(ap2, args);
+	debugLog("Engine: Frame stepping finished, %i frames at dt = %f (%.3f s simulated)\n", m_iFrameStepCounter, host_framestep_dt.getFloat(), numFrames*(double)host_framestep_dt.getFloat());
+	debugLog("Engine:     onUpdate() total = %.3f ms, avg = %.4f ms/frame, max = %.4f ms\n", m_dFrameStepUpdateTime*1000.0, (m_dFrameStepUpdateTime / numFrames)*1000.0, m_dFrameStepUpdateTimeMax*1000.0);
+	debugLog("Engine:     onPaint()  total = %.3f ms, avg = %.4f ms/frame, max = %.4f ms\n", m_dFrameStepPaintTime*1000.0, (m_dFrameStepPaintTime / numFrames)*1000.0, m_dFrameStepPaintTimeMax*1000.0);
+	debugLog("Engine:     wall = %.3f ms (%.4f ms/frame), process cpu = %.3f ms (%.4f ms/frame)\n", wallTime*1000.0, (wallTime / numFrames)*1000.0, cpuTime*1000.0, (cpuTime / numFrames)*1000.0);
 
-	// write to console
-	int numChars = vprintf(fmt, args);
+	m_iFrameStepFrames = 0;
 
-	if (numChars < 1 || numChars > 65534)
-		goto cleanup;
+	if (m_bFrameStepShutdown)
+		shutdown();
+}
 
-	// write to engine console
+void Engine::setFrameTime(double delta)
+{
+	// NOTE: frame stepping always uses the fixed timestep, no matter how long the frame actually took
+	if (isFrameStepping())
 	{
-		char *buffer = new char[numChars+1]; // +1 for null termination later
-		vsnprintf(buffer, numChars+1, fmt, ap2); // "The generated string has a length of at most n-1, leaving space for the additional terminating null character."
-		buffer[numChars] = '\0'; // null terminate
-
-		UString actualBuffer = UString(buffer);
-		delete[] buffer;
-
-		// WARNING: these calls here are not threadsafe by default
-		if (m_consoleBox != NULL)
-			m_consoleBox->log(actualBuffer);
-		if (m_console != NULL)
-			m_console->log(actualBuffer);
+		m_dFrameTime = (double)host_framestep_dt.getFloat();
+		return;
 	}
 
-cleanup:
-	va_end(ap2);
+	// NOTE: clamp to between 10000 fps and 1 fps, very small/big timesteps could cause problems
+	m_dFrameTime = clamp<double>(delta, 0.0001, 1.0);
 }
 
-void Engine::debugLog(Color color, const char *fmt, va_list args)
+double Engine::getFixedFrameTime() const
 {
-	if (fmt == NULL) return;
-
-	va_list ap2;
-	va_copy(ap2, args);
-
-	// write to console
-	int numChars = vprintf(fmt, args);
+	return 1.0 / (double)std::max(host_fixedupdate_rate.getFloat(), 1.0f);
+}
 
-	if (numChars < 1 || numChars > 65534)
-		goto cleanup;
+double const Engine::getTimeReal()
+{
+	m_timer->update();
+	return m_timer->getElapsedTime();
+}
 
-	// write to engine console
-	{
-		char *buffer = new char[numChars+1]; // +1 for null termination later
-		vsnprintf(buffer, numChars+1, fmt, ap2); // "The generated string has a length of at most n-1, leaving space for the additional terminating null character."
-		buffer[numChars] = '\0'; // null terminate
-
-		UString actualBuffer = UString(buffer);
-		delete[] buffer;
-
-		// WARNING: these calls here are not threadsafe by default
-		if (m_consoleBox != NULL)
-			m_consoleBox->log(actualBuffer);
-		if (m_console != NULL)
-			m_console->log(actualBuffer, color);
-	}
+void Engine::debugLog(const char *fmt, va_list args)
+{
+	Logger::log(Logger::LEVEL::LEVEL_INFO, Logger::CATEGORY::CATEGORY_GENERAL, 0, fmt, args);
+}
 
-cleanup:
-	va_end(ap2);
+void Engine::debugLog(Color color, const char *fmt, va_list args)
+{
+	Logger::log(Logger::LEVEL::LEVEL_INFO, Logger::CATEGORY::CATEGORY_GENERAL, color, fmt, args);
 }
 
 void Engine::debugLog(const char *fmt, ...)
@@ -825,6 +994,17 @@ void _debugCorporeal(UString oldValue, UString args)
 	env->setWindowGhostCorporeal(corporeal);
 }
 
+void _host_framestep(UString args)
+{
+	if (args.length() < 1)
+	{
+		debugLog("Usage: host_framestep <numFrames> (0 cancels a running benchmark)\n");
+		return;
+	}
+
+	engine->startFrameStepping(args.toInt());
+}
+
 void _errortest(void)
 {
 	engine->showMessageError("Error Test", "This is an error message, fullscreen mode should be disabled and you should be able to read this");
@@ -849,5 +1029,6 @@ ConVar _focus_("focus", _focus);
 ConVar _center_("center", _center);
 ConVar _version_("version", _version);
 ConVar _corporeal_("debug_ghost", false, _debugCorporeal);
+ConVar _host_framestep_("host_framestep", _host_framestep, ConVar::ARGS::ARGS_OPTIONAL);
 ConVar _errortest_("errortest", _errortest);
 ConVar _crash_("crash", _crash);
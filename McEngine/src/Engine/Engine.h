@@ -24,6 +24,7 @@ class OpenCLInterface;
 class OpenVRInterface;
 class VulkanInterface;
 class ResourceManager;
+class JobSystem;
 class AnimationHandler;
 class SquirrelInterface;
 class SteamworksInterface;
@@ -32,6 +33,10 @@ class DiscordInterface;
 class CBaseUIContainer;
 class ConsoleBox;
 class Console;
+class VisualProfiler;
+class FrameTimeHistory;
+class FrameTimeGraph;
+class RenderStatsOverlay;
 
 class Engine
 {
@@ -95,11 +100,16 @@ public:
 	void addGamepad(Gamepad *gamepad);
 	void removeGamepad(Gamepad *gamepad);
 
+	// benchmarking
+	void startFrameStepping(int numFrames, bool shutdownWhenDone = false);
+	inline bool isFrameStepping() const {return m_iFrameStepFrames > 0;}
+
 	// interfaces
 	inline App *getApp() const {return m_app;}
 	inline Graphics *getGraphics() const {return m_graphics;}
 	inline SoundEngine *getSound() const {return m_sound;}
 	inline ResourceManager *getResourceManager() const {return m_resourceManager;}
+	inline JobSystem *getJobSystem() const {return m_jobSystem;}
 	inline Environment *getEnvironment() const {return m_environment;}
 	inline NetworkHandler *getNetworkHandler() const {return m_networkHandler;}
 
@@ -126,7 +136,10 @@ public:
 	double const getTimeReal();
 	inline double getTimeRunning() const {return m_dRunTime;}
 	inline double getFrameTime() const {return m_dFrameTime;}
+	double getFixedFrameTime() const;
+	inline double getFixedUpdateAlpha() const {return m_dFixedUpdateAlpha;} // [0, 1], how far the current frame is between the previous and the next fixed update, for interpolating in draw()
 	inline unsigned long getFrameCount() const {return m_iFrameCount;}
+	inline FrameTimeHistory *getFrameTimeHistory() const {return m_frameTimeHistory;}
 	UString getArgs() {return m_sArgs;}
 	inline bool hasFocus() const {return m_bHasFocus;}
 	inline bool isDrawing() const {return m_bDrawing;}
@@ -150,6 +163,7 @@ private:
 	Environment *m_environment;
 	NetworkHandler *m_networkHandler;
 	ResourceManager *m_resourceManager;
+	JobSystem *m_jobSystem;
 	AnimationHandler *m_animationHandler;
 	SquirrelInterface *m_squirrel;
 	SteamworksInterface *m_steam;
@@ -171,6 +185,28 @@ private:
 	unsigned long m_iFrameCount;
 	double m_dFrameTime;
 
+	// frame time telemetry
+	FrameTimeHistory *m_frameTimeHistory;
+	double m_dLastUpdateTime;
+	double m_dLastPaintTime;
+	double m_dLastFrameEndTime;
+
+	// fixed timestep updates
+	double m_dFixedUpdateAccumulator;
+	double m_dFixedUpdateAlpha;
+
+	// deterministic frame stepping
+	void onFrameSteppingFinished();
+	int m_iFrameStepFrames;
+	int m_iFrameStepCounter;
+	bool m_bFrameStepShutdown;
+	double m_dFrameStepUpdateTime;
+	double m_dFrameStepPaintTime;
+	double m_dFrameStepUpdateTimeMax;
+	double m_dFrameStepPaintTimeMax;
+	double m_dFrameStepStartTime;
+	double m_dFrameStepStartCPUTime;
+
 	// primary screen
 	Vector2 m_vScreenSize;
 	Vector2 m_vNewScreenSize;
@@ -184,6 +220,9 @@ private:
 	CBaseUIContainer *m_guiContainer;
 	static ConsoleBox *m_consoleBox;
 	static Console *m_console;
+	VisualProfiler *m_visualProfiler;
+	FrameTimeGraph *m_frameTimeGraph;
+	RenderStatsOverlay *m_renderStatsOverlay;
 
 	// engine
 	UString m_sArgs;
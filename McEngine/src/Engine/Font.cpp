@@ -11,6 +11,11 @@
 #include "VertexArrayObject.h"
 #include "Engine.h"
 #include "ConVar.h"
+#include "Shader.h"
+#include "JobSystem.h"
+#include "File.h"
+
+#include "MD5.h"
 
 #include <ft2build.h>
 #include <freetype.h>
@@ -19,14 +24,44 @@
 #include <ftoutln.h>
 #include <fttrigon.h>
 
+#define FONT_CACHE_FOLDER "cache/fonts/"
+#define FONT_CACHE_MAGIC 0x4346434D // "MCFC"
+#define FONT_CACHE_VERSION 1
+
 ConVar r_debug_drawstring_unbind("r_debug_drawstring_unbind", false);
+ConVar r_drawstring_batched("r_drawstring_batched", true, "draw every string with a single draw call (0 = one draw call per glyph, for debugging)");
+
+ConVar r_font_parallel_init("r_font_parallel_init", true, "rasterize the glyphs of a font on all job system workers while loading it (every thread opens its own freetype face)");
+ConVar r_font_cache("r_font_cache", true, "save the preloaded glyphs of every font to cache/fonts/, and load them from there instead of rasterizing them again (the cache file name is a hash of the font file, size, dpi, antialiasing and character set)");
+ConVar r_font_dynamic_max_pages("r_font_dynamic_max_pages", 4, "maximum number of additional atlas pages per font for glyphs which are loaded on first use, once all are full the least recently used glyphs are replaced");
+
+ConVar r_drawstring_cache("r_drawstring_cache", true, "keep the baked glyph quads of drawStringCached() strings around (labels, buttons, console)");
+ConVar r_drawstring_cache_max_kb("r_drawstring_cache_max_kb", 4096, "memory limit of the text layout cache in KB, least recently used strings are evicted first");
+
+ConVar r_font_sdf_shader("r_font_sdf_shader", true, "draw signed distance field fonts with a shader on renderers which support it (0 = resolve them on the cpu per scale, like on all other renderers)");
+ConVar r_font_sdf_max_resolved_pages("r_font_sdf_max_resolved_pages", 8, "maximum number of cpu resolved atlas pages per signed distance field font (one per page and scale step which is in use)");
+
+unsigned long g_iFontNumDrawCalls = 0; // for font_benchmark
 
 const wchar_t McFont::UNKNOWN_CHAR;
 
-void renderFTGlyphToTextureAtlas(FT_Library library, FT_Face face, wchar_t ch, TextureAtlas *textureAtlas, bool antialiasing, std::unordered_map<wchar_t, McFont::GLYPH_METRICS> *glyphMetrics);
+std::list<McFont::TEXT_LAYOUT*> McFont::s_textLayoutLRU;
+size_t McFont::s_iTextLayoutMemorySize = 0;
+unsigned long McFont::s_iNumTextLayoutHits = 0;
+unsigned long McFont::s_iNumTextLayoutMisses = 0;
+unsigned long McFont::s_iNumTextLayoutEvictions = 0;
+
+Shader *McFont::s_sdfShader = NULL;
+
+bool renderFTGlyph(FT_Face face, wchar_t ch, bool antialiasing, McFont::GLYPH_METRICS *metrics, std::vector<Color> *pixels, const char **error); // NOTE: threadsafe, errors are returned and not shown
+bool renderFTGlyphSDF(FT_Face face, wchar_t ch, McFont::GLYPH_METRICS *metrics, std::vector<Color> *pixels, const char **error);
+bool createFTFace(const char *filePath, int renderSize, int dpi, FT_Library *library, FT_Face *face);
+void appendFontCacheGlyph(std::string &cacheData, const McFont::GLYPH_METRICS &metrics, const std::vector<Color> &pixels);
+bool readFontCacheData(const char *&cur, const char *end, void *data, size_t size);
+void distanceTransform(std::vector<float> &grid, int width, int height);
 unsigned char *unpackMonoBitmap(FT_Bitmap bitmap);
 
-McFont::McFont(UString filepath, int fontSize, bool antialiasing, int fontDPI) : Resource(filepath)
+McFont::McFont(UString filepath, int fontSize, bool antialiasing, int fontDPI, bool signedDistanceField) : Resource(filepath)
 {
 	// the default set of wchar_t glyphs (ASCII table of non-whitespace glyphs, including cyrillics)
 	std::vector<wchar_t> characters;
@@ -35,15 +70,15 @@ McFont::McFont(UString filepath, int fontSize, bool antialiasing, int fontDPI) :
 		characters.push_back((wchar_t)i);
 	}
 
-	constructor(characters, fontSize, antialiasing, fontDPI);
+	constructor(characters, fontSize, antialiasing, fontDPI, signedDistanceField);
 }
 
-McFont::McFont(UString filepath, std::vector<wchar_t> characters, int fontSize, bool antialiasing, int fontDPI) : Resource(filepath)
+McFont::McFont(UString filepath, std::vector<wchar_t> characters, int fontSize, bool antialiasing, int fontDPI, bool signedDistanceField) : Resource(filepath)
 {
-	constructor(characters, fontSize, antialiasing, fontDPI);
+	constructor(characters, fontSize, antialiasing, fontDPI, signedDistanceField);
 }
 
-void McFont::constructor(std::vector<wchar_t> characters, int fontSize, bool antialiasing, int fontDPI)
+void McFont::constructor(std::vector<wchar_t> characters, int fontSize, bool antialiasing, int fontDPI, bool signedDistanceField)
 {
 	for (int i=0; i<characters.size(); i++)
 	{
@@ -53,12 +88,29 @@ void McFont::constructor(std::vector<wchar_t> characters, int fontSize, bool ant
 	m_iFontSize = fontSize;
 	m_bAntialiasing = antialiasing;
 	m_iFontDPI = fontDPI;
+	m_bSignedDistanceField = signedDistanceField;
 
 	m_textureAtlas = NULL;
+	m_flatGlyphMetrics.assign(NUM_FLAT_GLYPHS, NULL);
 
 	m_fHeight = 1.0f;
 
+	m_ftLibrary = NULL;
+	m_ftFace = NULL;
+	m_bFTFaceFailed = false;
+	m_iDynamicPageSize = 0;
+	m_iDynamicSlotWidth = 0;
+	m_iDynamicSlotHeight = 0;
+	m_iGlyphUseStamp = 0;
+	m_iNumGlyphEvictions = 0;
+
+	m_bSDFShaderActive = false;
+	m_iSDFScaleBucket = 0;
+	m_iSDFResolveStamp = 0;
+
 	m_errorGlyph.character = '?';
+	m_errorGlyph.atlasPage = 0;
+	m_errorGlyph.dynamicSlot = -1;
 	m_errorGlyph.advance_x = 10;
 	m_errorGlyph.sizePixelsX = 1;
 	m_errorGlyph.sizePixelsY = 1;
@@ -72,12 +124,53 @@ void McFont::init()
 {
 	debugLog("Resource Manager: Loading %s\n", m_sFilePath.toUtf8());
 
+	// if the preloaded glyphs are cached already, then freetype is only needed once a glyph has to be loaded dynamically
+	const UString cacheFilePath = (r_font_cache.getBool() ? getCacheFilePath() : UString(""));
+	if (cacheFilePath.length() < 1 || !loadCache(cacheFilePath))
+	{
+		std::string cacheData;
+		if (!initFreeType(cacheFilePath.length() > 0 ? &cacheData : NULL))
+			return;
+
+		if (cacheFilePath.length() > 0)
+			saveCache(cacheFilePath, cacheData);
+	}
+
+	// build atlas texture
+	engine->getResourceManager()->loadResource(m_textureAtlas);
+
+	if (m_bAntialiasing || m_bSignedDistanceField)
+		m_textureAtlas->getAtlasImage()->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_LINEAR);
+	else
+		m_textureAtlas->getAtlasImage()->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_NONE);
+
+	// calculate average ASCII glyph height
+	// NOTE: only over what is already loaded, to not load the rest of ASCII for fonts with a custom character set
+	m_fHeight = 0.0f;
+	for (int i=0; i<128; i++)
+	{
+		const wchar_t ch = (hasGlyph((wchar_t)i) ? (wchar_t)i : UNKNOWN_CHAR);
+		const int curHeight = getGlyphMetrics(ch).top - (m_bSignedDistanceField ? SDF_SPREAD : 0);
+		if (curHeight > m_fHeight)
+			m_fHeight = curHeight;
+	}
+
+	m_bReady = true;
+}
+
+void McFont::initAsync()
+{
+	m_bAsyncReady = true;
+}
+
+bool McFont::initFreeType(std::string *cacheData)
+{
 	// init freetype
 	FT_Library library;
 	if (FT_Init_FreeType(&library))
 	{
 		engine->showMessageError("Font Error", "FT_Init_FreeType() failed!");
-		return;
+		return false;
 	}
 
 	// load font file
@@ -86,64 +179,104 @@ void McFont::init()
 	{
 		engine->showMessageError("Font Error", "Couldn't load font file!\nFT_New_Face() failed.");
 		FT_Done_FreeType(library);
-		return;
+		return false;
 	}
 
 	if (FT_Select_Charmap(face, ft_encoding_unicode))
 	{
 		engine->showMessageError("Font Error", "FT_Select_Charmap() failed!");
-		return;
+		FT_Done_Face(face);
+		FT_Done_FreeType(library);
+		return false;
 	}
 
 	// set font height
 	// "The character width and heights are specified in 1/64th of points"
-	FT_Set_Char_Size(face, m_iFontSize*64, m_iFontSize*64, m_iFontDPI, m_iFontDPI);
+	// (sdf glyphs are rendered bigger, and then scaled down again while calculating the distances)
+	const int renderSize = m_iFontSize*(m_bSignedDistanceField ? SDF_SUPERSAMPLING : 1);
+	FT_Set_Char_Size(face, renderSize*64, renderSize*64, m_iFontDPI, m_iFontDPI);
 
 	// create texture atlas
-	const int atlasSize = (m_iFontDPI > 96 ? (m_iFontDPI > 2*96 ? 2048 : 1024) : 512); // HACKHACK: hardcoded max atlas size, and heuristic
-	engine->getResourceManager()->requestNextLoadUnmanaged();
-	m_textureAtlas = engine->getResourceManager()->createTextureAtlas(atlasSize, atlasSize);
-
-	// now render all glyphs into the atlas
-	for (int i=0; i<m_vGlyphs.size(); i++)
+	int atlasSize = (m_iFontDPI > 96 ? (m_iFontDPI > 2*96 ? 2048 : 1024) : 512); // HACKHACK: hardcoded max atlas size, and heuristic
 	{
-		renderFTGlyphToTextureAtlas(library, face, m_vGlyphs[i], m_textureAtlas, m_bAntialiasing, &m_vGlyphMetrics);
+		// big fonts (and sdf glyphs, which get the spread on every side) would not fit, so also estimate by size
+		const int glyphSize = m_iFontSize*m_iFontDPI/96 + (m_bSignedDistanceField ? 2*SDF_SPREAD : 0) + 1;
+		while (atlasSize < 2048 && glyphSize*glyphSize*(int)m_vGlyphs.size()*4 > atlasSize*atlasSize*3)
+		{
+			atlasSize *= 2;
+		}
 	}
+	engine->getResourceManager()->requestNextLoadUnmanaged();
+	m_textureAtlas = engine->getResourceManager()->createTextureAtlas(atlasSize, atlasSize, 1, m_bSignedDistanceField); // (sdf pages are also needed on the cpu, see getSDFResolvedPageImage())
 
-	// shutdown freetype
-	FT_Done_Face(face);
-	FT_Done_FreeType(library);
+	// now render all glyphs into the atlas
+	renderFTGlyphsToTextureAtlas(face, renderSize, cacheData);
 
-	// build atlas texture
-	engine->getResourceManager()->loadResource(m_textureAtlas);
+	// keep freetype around, everything which is not in the atlas yet is loaded on first use (see loadDynamicGlyph())
+	m_ftLibrary = library;
+	m_ftFace = face;
 
-	if (m_bAntialiasing)
-		m_textureAtlas->getAtlasImage()->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_LINEAR);
+	// every dynamic page is a grid of slots which fit the largest glyph of the face
+	m_iDynamicPageSize = std::min(atlasSize, 1024);
+	if (FT_IS_SCALABLE(face))
+	{
+		m_iDynamicSlotWidth = (int)(FT_MulFix(face->bbox.xMax - face->bbox.xMin, face->size->metrics.x_scale) >> 6) + 2;
+		m_iDynamicSlotHeight = (int)(FT_MulFix(face->bbox.yMax - face->bbox.yMin, face->size->metrics.y_scale) >> 6) + 2;
+	}
 	else
-		m_textureAtlas->getAtlasImage()->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_NONE);
-
-	// calculate average ASCII glyph height
-	m_fHeight = 0.0f;
-	for (int i=0; i<128; i++)
 	{
-		const int curHeight = getGlyphMetrics((wchar_t)i).top;
-		if (curHeight > m_fHeight)
-			m_fHeight = curHeight;
+		m_iDynamicSlotWidth = (int)(face->size->metrics.max_advance >> 6) + 2;
+		m_iDynamicSlotHeight = (int)(face->size->metrics.height >> 6) + 2;
 	}
+	if (m_bSignedDistanceField)
+	{
+		m_iDynamicSlotWidth = m_iDynamicSlotWidth/SDF_SUPERSAMPLING + 2*SDF_SPREAD + 2;
+		m_iDynamicSlotHeight = m_iDynamicSlotHeight/SDF_SUPERSAMPLING + 2*SDF_SPREAD + 2;
+	}
+	m_iDynamicSlotWidth = clamp<int>(m_iDynamicSlotWidth, 1, m_iDynamicPageSize/4); // (some faces have a ridiculous bbox)
+	m_iDynamicSlotHeight = clamp<int>(m_iDynamicSlotHeight, 1, m_iDynamicPageSize/4);
 
-	m_bReady = true;
-}
-
-void McFont::initAsync()
-{
-	m_bAsyncReady = true;
+	return true;
 }
 
 void McFont::destroy()
 {
+	clearTextLayouts();
+	clearSDFResolvedPages();
+
 	SAFE_DELETE(m_textureAtlas);
 
+	for (size_t i=0; i<m_dynamicPages.size(); i++)
+	{
+		delete m_dynamicPages[i];
+	}
+	m_dynamicPages.clear();
+	m_dynamicPagesDirty.clear();
+	m_dynamicSlots.clear();
+	m_freeDynamicSlots.clear();
+	m_dynamicSlotLRU.clear();
+	m_missingGlyphs.clear();
+
+	for (size_t i=0; i<m_pageVAOs.size(); i++)
+	{
+		delete m_pageVAOs[i];
+	}
+	m_pageVAOs.clear();
+
+	if (m_ftFace != NULL)
+	{
+		FT_Done_Face(m_ftFace);
+		m_ftFace = NULL;
+	}
+	if (m_ftLibrary != NULL)
+	{
+		FT_Done_FreeType(m_ftLibrary);
+		m_ftLibrary = NULL;
+	}
+	m_bFTFaceFailed = false;
+
 	m_vGlyphMetrics = std::unordered_map<wchar_t, GLYPH_METRICS>();
+	m_flatGlyphMetrics.assign(NUM_FLAT_GLYPHS, NULL);
 	m_fHeight = 1.0f;
 }
 
@@ -158,13 +291,317 @@ bool McFont::addGlyph(wchar_t ch)
 	return true;
 }
 
+void McFont::setGlyphMetrics(wchar_t ch, const GLYPH_METRICS &metrics)
+{
+	// NOTE: unordered_map never moves its elements, so the flat pointers stay valid until removeGlyphMetrics() or destroy()
+	GLYPH_METRICS &storedMetrics = m_vGlyphMetrics[ch];
+	storedMetrics = metrics;
+
+	if ((unsigned int)ch < NUM_FLAT_GLYPHS)
+		m_flatGlyphMetrics[ch] = &storedMetrics;
+}
+
+void McFont::removeGlyphMetrics(wchar_t ch)
+{
+	if ((unsigned int)ch < NUM_FLAT_GLYPHS)
+		m_flatGlyphMetrics[ch] = NULL;
+
+	m_vGlyphMetrics.erase(ch);
+}
+
+void McFont::renderFTGlyphsToTextureAtlas(FT_Face face, int renderSize, std::string *cacheData)
+{
+	const int numGlyphs = (int)m_vGlyphs.size();
+
+	// freetype faces must not be shared between threads, so every thread gets its own (the first one just uses the main face)
+	// NOTE: a bit of work per glyph is needed for this to be worth opening the font file again
+	int numThreads = 1;
+	JobSystem *jobSystem = engine->getJobSystem();
+	if (r_font_parallel_init.getBool() && jobSystem != NULL)
+		numThreads = clamp<int>(numGlyphs / 32, 1, jobSystem->getNumWorkers() + 1);
+
+	std::vector<FT_Library> threadLibraries(numThreads, NULL);
+	std::vector<FT_Face> threadFaces(numThreads, NULL);
+	std::vector<const char*> threadErrors(numThreads, NULL); // the first error of every thread, shown by this thread after each batch
+	threadFaces[0] = face;
+
+	// in batches, to not keep the pixels of huge character sets around all at once
+	const int batchSize = 1024;
+	std::vector<GLYPH_METRICS> batchMetrics(std::min(numGlyphs, batchSize));
+	std::vector<std::vector<Color>> batchPixels(batchMetrics.size());
+	std::vector<char> batchRendered(batchMetrics.size());
+	for (int batchStart=0; batchStart<numGlyphs; batchStart+=batchSize)
+	{
+		const int batchEnd = std::min(numGlyphs, batchStart + batchSize);
+
+		auto renderGlyphs = [&](size_t start, size_t end)
+		{
+			for (size_t t=start; t<end; t++)
+			{
+				if (threadFaces[t] == NULL && !createFTFace(m_sFilePath.toUtf8(), renderSize, m_iFontDPI, &threadLibraries[t], &threadFaces[t]))
+				{
+					threadFaces[t] = NULL;
+					threadLibraries[t] = NULL;
+				}
+
+				// interleaved, since glyph complexity is usually clustered by codepoint
+				for (int i=batchStart+(int)t; i<batchEnd; i+=numThreads)
+				{
+					const int b = i - batchStart;
+					if (threadFaces[t] != NULL)
+					{
+						const char *error = NULL;
+						batchRendered[b] = (m_bSignedDistanceField ? renderFTGlyphSDF(threadFaces[t], m_vGlyphs[i], &batchMetrics[b], &batchPixels[b], &error) : renderFTGlyph(threadFaces[t], m_vGlyphs[i], m_bAntialiasing, &batchMetrics[b], &batchPixels[b], &error));
+						if (error != NULL && threadErrors[t] == NULL)
+							threadErrors[t] = error;
+					}
+					else
+						batchRendered[b] = false; // will be loaded on first use instead (see loadDynamicGlyph())
+				}
+			}
+		};
+
+		if (numThreads > 1)
+			jobSystem->wait(jobSystem->parallelFor(0, numThreads, 1, renderGlyphs));
+		else
+			renderGlyphs(0, 1);
+
+		for (int t=0; t<numThreads; t++)
+		{
+			if (threadErrors[t] != NULL)
+			{
+				engine->showMessageError("Font Error", threadErrors[t]);
+				threadErrors[t] = NULL;
+			}
+		}
+
+		// add glyphs to atlas
+		for (int i=batchStart; i<batchEnd; i++)
+		{
+			const int b = i - batchStart;
+			if (!batchRendered[b]) continue;
+
+			GLYPH_METRICS &metrics = batchMetrics[b];
+			if (batchPixels[b].size() > 0)
+			{
+				const int id = m_textureAtlas->add(metrics.sizePixelsX, metrics.sizePixelsY, &batchPixels[b][0]);
+				if (id < 0)
+					continue; // full, will be loaded on first use instead (see loadDynamicGlyph())
+
+				metrics.uvPixelsX = (unsigned int)m_textureAtlas->getEntry(id).x;
+				metrics.uvPixelsY = (unsigned int)m_textureAtlas->getEntry(id).y;
+			}
+
+			setGlyphMetrics(m_vGlyphs[i], metrics);
+
+			if (cacheData != NULL)
+				appendFontCacheGlyph(*cacheData, metrics, batchPixels[b]);
+		}
+	}
+
+	for (int t=1; t<numThreads; t++)
+	{
+		if (threadFaces[t] != NULL)
+		{
+			FT_Done_Face(threadFaces[t]);
+			FT_Done_FreeType(threadLibraries[t]);
+		}
+	}
+}
+
+bool McFont::openFTFace()
+{
+	if (m_bFTFaceFailed) return false;
+
+	const int renderSize = m_iFontSize*(m_bSignedDistanceField ? SDF_SUPERSAMPLING : 1);
+	if (!createFTFace(m_sFilePath.toUtf8(), renderSize, m_iFontDPI, &m_ftLibrary, &m_ftFace))
+	{
+		debugLog("Font Error: Couldn't open %s for loading glyphs!\n", m_sFilePath.toUtf8());
+		m_ftLibrary = NULL;
+		m_ftFace = NULL;
+		m_bFTFaceFailed = true;
+		return false;
+	}
+
+	return true;
+}
+
+UString McFont::getCacheFilePath()
+{
+	File file(m_sFilePath);
+	const char *fontData = (file.canRead() ? file.readFile() : NULL);
+	if (fontData == NULL)
+		return "";
+
+	// everything which changes what ends up in the atlas is part of the key
+	MD5 hash;
+	hash.update(fontData, (MD5::size_type)file.getFileSize());
+	{
+		const UString key = UString::format("%i %i %i %i %i %i %i %i.%i.%i", FONT_CACHE_VERSION, m_iFontSize, m_iFontDPI, (int)m_bAntialiasing, (int)m_bSignedDistanceField, SDF_SUPERSAMPLING, SDF_SPREAD, FREETYPE_MAJOR, FREETYPE_MINOR, FREETYPE_PATCH);
+		hash.update(key.toUtf8(), (MD5::size_type)strlen(key.toUtf8()));
+	}
+	for (size_t i=0; i<m_vGlyphs.size(); i++)
+	{
+		const int ch = (int)m_vGlyphs[i];
+		hash.update((const char*)&ch, (MD5::size_type)sizeof(ch));
+	}
+	hash.finalize();
+
+	return UString::format(FONT_CACHE_FOLDER "%s.cache", hash.hexdigest().c_str());
+}
+
+// cache file layout (native endianness, int unless noted otherwise):
+// header: magic, version, font size, dpi, antialiasing, sdf, atlas size, dynamic page size, dynamic slot width, dynamic slot height
+// then one entry per preloaded glyph, in packing order: character, left, top, width, rows, sizePixelsX, sizePixelsY, advance_x (float), sizePixelsX*sizePixelsY alpha bytes
+// NOTE: all glyph pixels are white, so only the alpha is stored, and the atlas is rebuilt by packing the glyphs again in the same order (which gives the same layout)
+
+bool McFont::loadCache(const UString &cacheFilePath)
+{
+	if (!env->fileExists(cacheFilePath)) return false;
+
+	File file(cacheFilePath);
+	const char *data = (file.canRead() ? file.readFile() : NULL);
+	if (data == NULL) return false;
+
+	const char *cur = data;
+	const char *end = data + file.getFileSize();
+
+	int header[10];
+	if (!readFontCacheData(cur, end, header, sizeof(header))
+		|| header[0] != FONT_CACHE_MAGIC || header[1] != FONT_CACHE_VERSION
+		|| header[2] != m_iFontSize || header[3] != m_iFontDPI || header[4] != (int)m_bAntialiasing || header[5] != (int)m_bSignedDistanceField
+		|| header[6] < 1 || header[6] > 8192 || header[7] < 1 || header[8] < 1 || header[9] < 1)
+	{
+		debugLog("Font Warning: Ignoring invalid cache file %s\n", cacheFilePath.toUtf8());
+		return false;
+	}
+	const int atlasSize = header[6];
+
+	// everything is validated before touching the font, a broken file just means rasterizing everything again
+	struct CACHED_GLYPH
+	{
+		GLYPH_METRICS metrics;
+		const unsigned char *alpha;
+	};
+	std::vector<CACHED_GLYPH> cachedGlyphs;
+	while (cur < end)
+	{
+		int values[7];
+		float advance;
+		if (!readFontCacheData(cur, end, values, sizeof(values)) || !readFontCacheData(cur, end, &advance, sizeof(advance))
+			|| values[5] < 0 || values[5] > atlasSize || values[6] < 0 || values[6] > atlasSize || (size_t)(end - cur) < (size_t)values[5]*(size_t)values[6])
+		{
+			debugLog("Font Warning: Ignoring invalid cache file %s\n", cacheFilePath.toUtf8());
+			return false;
+		}
+
+		CACHED_GLYPH cachedGlyph;
+		cachedGlyph.metrics.character = (wchar_t)values[0];
+		cachedGlyph.metrics.atlasPage = 0;
+		cachedGlyph.metrics.dynamicSlot = -1;
+		cachedGlyph.metrics.uvPixelsX = 0;
+		cachedGlyph.metrics.uvPixelsY = 0;
+		cachedGlyph.metrics.left = values[1];
+		cachedGlyph.metrics.top = values[2];
+		cachedGlyph.metrics.width = values[3];
+		cachedGlyph.metrics.rows = values[4];
+		cachedGlyph.metrics.sizePixelsX = (unsigned int)values[5];
+		cachedGlyph.metrics.sizePixelsY = (unsigned int)values[6];
+		cachedGlyph.metrics.advance_x = advance;
+		cachedGlyph.alpha = (const unsigned char*)cur;
+		cachedGlyphs.push_back(cachedGlyph);
+
+		cur += (size_t)values[5]*(size_t)values[6];
+	}
+
+	engine->getResourceManager()->requestNextLoadUnmanaged();
+	m_textureAtlas = engine->getResourceManager()->createTextureAtlas(atlasSize, atlasSize, 1, m_bSignedDistanceField);
+
+	std::vector<Color> pixels;
+	for (size_t i=0; i<cachedGlyphs.size(); i++)
+	{
+		GLYPH_METRICS &metrics = cachedGlyphs[i].metrics;
+		const size_t numPixels = (size_t)metrics.sizePixelsX*(size_t)metrics.sizePixelsY;
+		if (numPixels > 0)
+		{
+			pixels.resize(numPixels);
+			for (size_t p=0; p<numPixels; p++)
+			{
+				pixels[p] = COLOR(cachedGlyphs[i].alpha[p], 255, 255, 255);
+			}
+
+			const int id = m_textureAtlas->add(metrics.sizePixelsX, metrics.sizePixelsY, &pixels[0]);
+			if (id < 0)
+				continue; // (can only happen if the packer changed, the glyph is then loaded on first use)
+
+			metrics.uvPixelsX = (unsigned int)m_textureAtlas->getEntry(id).x;
+			metrics.uvPixelsY = (unsigned int)m_textureAtlas->getEntry(id).y;
+		}
+
+		setGlyphMetrics(metrics.character, metrics);
+	}
+
+	m_iDynamicPageSize = header[7];
+	m_iDynamicSlotWidth = header[8];
+	m_iDynamicSlotHeight = header[9];
+
+	return true;
+}
+
+void McFont::saveCache(const UString &cacheFilePath, const std::string &glyphData)
+{
+	if (!env->directoryExists(FONT_CACHE_FOLDER))
+	{
+		if (!env->directoryExists("cache/"))
+			env->createDirectory("cache/");
+
+		env->createDirectory(FONT_CACHE_FOLDER);
+	}
+
+	const int header[10] = {FONT_CACHE_MAGIC, FONT_CACHE_VERSION, m_iFontSize, m_iFontDPI, (int)m_bAntialiasing, (int)m_bSignedDistanceField, m_textureAtlas->getWidth(), m_iDynamicPageSize, m_iDynamicSlotWidth, m_iDynamicSlotHeight};
+
+	File file(cacheFilePath, File::TYPE::WRITE);
+	if (!file.canWrite())
+	{
+		debugLog("Font Warning: Couldn't write cache file %s\n", cacheFilePath.toUtf8());
+		return;
+	}
+	file.write((const char*)header, sizeof(header));
+	file.write(glyphData.c_str(), glyphData.length());
+}
+
 void McFont::drawString(Graphics *g, UString text)
 {
 	if (!m_bReady) return;
 
 	// texture atlas rendering
-	m_textureAtlas->getAtlasImage()->bind();
+	if (r_drawstring_batched.getBool())
+	{
+		buildStringGeometry(text);
+		updateDynamicPages();
+
+		beginSDF(g);
+		{
+			// one draw per used atlas page (usually just one)
+			for (size_t p=0; p<m_pageVAOs.size(); p++)
+			{
+				if (m_pageVAOs[p]->getNumVertices() < 1) continue;
+
+				Image *pageImage = getDrawPageImage(p);
+				pageImage->bind();
+				{
+					g->drawVAO(m_pageVAOs[p]);
+					g_iFontNumDrawCalls++;
+				}
+				if (r_debug_drawstring_unbind.getBool())
+					pageImage->unbind();
+			}
+		}
+		endSDF();
+	}
+	else
 	{
+		beginSDF(g);
 		m_worldMatrixBackup = g->getWorldMatrix();
 		g->pushTransform();
 		{
@@ -174,24 +611,81 @@ void McFont::drawString(Graphics *g, UString text)
 			}
 		}
 		g->popTransform();
+		endSDF();
 	}
-	if (r_debug_drawstring_unbind.getBool())
-		m_textureAtlas->getAtlasImage()->unbind();
 }
 
-void McFont::drawAtlasGlyph(Graphics *g, wchar_t ch)
+float McFont::buildStringGeometry(const UString &text)
 {
-	// TODO: dynamic glyph loading, finish this
-	/*
-	if (m_vGlyphExistence.find(ch) == m_vGlyphExistence.end())
+	// glyphs used by this string can't be replaced while it is being built
+	m_iGlyphUseStamp++;
+
+	for (size_t p=0; p<m_pageVAOs.size(); p++)
+	{
+		m_pageVAOs[p]->empty();
+	}
+
+	// everything is relative to the current world matrix, so outside transforms still apply to the string as a whole
+	// the glyph bitmaps are stored flipped in the atlas, the quad corners below are what the old per-glyph (translate(left, top - rows), scale(1, -1)) matrices produced
+	float advanceX = 0.0f;
+	for (int i=0; i<text.length(); i++)
 	{
-		if (addGlyph(ch))
-			reload();
+		const GLYPH_METRICS &gm = getGlyphMetrics(text[i]);
+
+		if (gm.width > 0 && gm.rows > 0) // e.g. spaces only advance
+		{
+			const Image *pageImage = getAtlasPageImage(gm.atlasPage);
+			const float atlasWidth = (float)pageImage->getWidth();
+			const float atlasHeight = (float)pageImage->getHeight();
+
+			while (m_pageVAOs.size() <= gm.atlasPage)
+			{
+				m_pageVAOs.push_back(new VertexArrayObject(Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE::USAGE_DYNAMIC));
+			}
+			VertexArrayObject *vao = m_pageVAOs[gm.atlasPage];
+
+			const float x = (float)gm.uvPixelsX / atlasWidth;
+			const float y = (float)gm.uvPixelsY / atlasHeight;
+
+			const float sx = (float)gm.sizePixelsX / atlasWidth;
+			const float sy = (float)gm.sizePixelsY / atlasHeight;
+
+			const float left = advanceX + gm.left;
+			const float right = left + gm.width;
+			const float top = -gm.top;
+			const float bottom = gm.rows - gm.top;
+
+			// two triangles per glyph (top left, bottom left, bottom right) + (top left, bottom right, top right)
+			vao->addTexcoord(x, y);
+			vao->addVertex(left, top);
+			vao->addTexcoord(x, y + sy);
+			vao->addVertex(left, bottom);
+			vao->addTexcoord(x + sx, y + sy);
+			vao->addVertex(right, bottom);
+
+			vao->addTexcoord(x, y);
+			vao->addVertex(left, top);
+			vao->addTexcoord(x + sx, y + sy);
+			vao->addVertex(right, bottom);
+			vao->addTexcoord(x + sx, y);
+			vao->addVertex(right, top);
+		}
+
+		advanceX += gm.advance_x;
 	}
-	*/
 
+	return advanceX;
+}
+
+void McFont::drawAtlasGlyph(Graphics *g, wchar_t ch)
+{
 	const GLYPH_METRICS &gm = getGlyphMetrics(ch);
 
+	Image *pageImage = getAtlasPageImage(gm.atlasPage);
+	updateDynamicPages();
+	Image *drawPageImage = getDrawPageImage(gm.atlasPage);
+	drawPageImage->bind();
+
 	g->pushTransform();
 	{
 		// apply font offsets and flip horizontally
@@ -204,11 +698,11 @@ void McFont::drawAtlasGlyph(Graphics *g, wchar_t ch)
 		Matrix4 finalMat = m_worldMatrixBackup * glyphMatrix;
 		g->setWorldMatrix(finalMat);
 
-		const float x = (float)gm.uvPixelsX / (float)m_textureAtlas->getAtlasImage()->getWidth();
-		const float y = (float)gm.uvPixelsY / (float)m_textureAtlas->getAtlasImage()->getHeight();
+		const float x = (float)gm.uvPixelsX / (float)pageImage->getWidth();
+		const float y = (float)gm.uvPixelsY / (float)pageImage->getHeight();
 
-		const float sx = (float)gm.sizePixelsX / (float)m_textureAtlas->getAtlasImage()->getWidth();
-		const float sy = (float)gm.sizePixelsY / (float)m_textureAtlas->getAtlasImage()->getHeight();
+		const float sx = (float)gm.sizePixelsX / (float)pageImage->getWidth();
+		const float sy = (float)gm.sizePixelsY / (float)pageImage->getHeight();
 
 		// draw it
 		VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
@@ -226,9 +720,13 @@ void McFont::drawAtlasGlyph(Graphics *g, wchar_t ch)
 		vao.addVertex(gm.width,gm.rows);
 
 		g->drawVAO(&vao);
+		g_iFontNumDrawCalls++;
 	}
 	g->popTransform();
 
+	if (r_debug_drawstring_unbind.getBool())
+		drawPageImage->unbind();
+
 	// go to possible next glyph
 	Matrix4 translateWorld;
 	translateWorld.translate(gm.advance_x, 0, 0);
@@ -246,69 +744,598 @@ void McFont::drawTextureAtlas(Graphics *g)
 	g->popTransform();
 }
 
-float McFont::getStringWidth(UString text) const
+void McFont::drawStringCached(Graphics *g, const UString &text)
 {
-	if (!m_bReady) return 1.0f;
+	if (!m_bReady || text.length() < 1) return;
 
-	float width = 0;
-	for (int i=0; i<text.length(); i++)
+	// NOTE: called by the renderer (see Graphics::drawStringCached()), after its drawString() setup
+	if (!r_drawstring_cache.getBool() || !r_drawstring_batched.getBool())
 	{
-		width += getGlyphMetrics(text[i]).advance_x;
+		drawString(g, text);
+		return;
 	}
 
-	return width;
+	const TEXT_LAYOUT *layout = getTextLayout(text);
+	updateDynamicPages();
+
+	beginSDF(g);
+	{
+		for (size_t p=0; p<layout->pages.size(); p++)
+		{
+			Image *pageImage = getDrawPageImage(layout->pages[p].atlasPage);
+			pageImage->bind();
+			{
+				g->drawVAO(layout->pages[p].vao);
+				g_iFontNumDrawCalls++;
+			}
+			if (r_debug_drawstring_unbind.getBool())
+				pageImage->unbind();
+		}
+	}
+	endSDF();
 }
 
-float McFont::getStringHeight(UString text) const
+float McFont::getStringWidthCached(const UString &text)
 {
-	if (!m_bReady) return 1.0f;
+	if (!m_bReady || !r_drawstring_cache.getBool())
+		return getStringWidth(text);
 
-	float height = 0;
-	for (int i=0; i<text.length(); i++)
+	return getTextLayout(text)->width;
+}
+
+McFont::TEXT_LAYOUT *McFont::getTextLayout(const UString &text)
+{
+	const auto it = m_textLayouts.find(text);
+	if (it != m_textLayouts.end())
 	{
-		height += getGlyphMetrics(text[i]).top;
+		s_iNumTextLayoutHits++;
+
+		TEXT_LAYOUT *layout = it->second;
+		s_textLayoutLRU.splice(s_textLayoutLRU.begin(), s_textLayoutLRU, layout->lruIterator);
+		return layout;
 	}
 
-	return height;
-}
+	s_iNumTextLayoutMisses++;
 
-const McFont::GLYPH_METRICS &McFont::getGlyphMetrics(wchar_t ch) const
-{
-	if (m_vGlyphMetrics.find(ch) != m_vGlyphMetrics.end())
-		return m_vGlyphMetrics.at(ch);
-	else if (m_vGlyphMetrics.find(UNKNOWN_CHAR) != m_vGlyphMetrics.end())
-		return m_vGlyphMetrics.at(UNKNOWN_CHAR);
-	else
+	TEXT_LAYOUT *layout = new TEXT_LAYOUT();
+	layout->font = this;
+	layout->text = text;
+	layout->width = buildStringGeometry(text);
+
+	// copy the scratch geometry of every used page into its own vao
+	size_t numVertices = 0;
+	for (size_t p=0; p<m_pageVAOs.size(); p++)
 	{
-		debugLog("Font Error: Missing default backup glyph (UNKNOWN_CHAR)!\n");
-		return m_errorGlyph;
+		const std::vector<Vector3> &vertices = m_pageVAOs[p]->getVertices();
+		if (vertices.size() < 1) continue;
+
+		const std::vector<Vector2> &texcoords = m_pageVAOs[p]->getTexcoords()[0];
+
+		TEXT_LAYOUT_PAGE page;
+		page.atlasPage = p;
+		page.vao = engine->getGraphics()->createVertexArrayObject(Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE::USAGE_STATIC, false);
+		for (size_t v=0; v<vertices.size(); v++)
+		{
+			page.vao->addTexcoord(texcoords[v]);
+			page.vao->addVertex(vertices[v]);
+		}
+		page.vao->load(); // bake (the system memory copy is kept by renderers which don't support baking)
+
+		numVertices += vertices.size();
+		layout->pages.push_back(page);
 	}
-}
 
-const bool McFont::hasGlyph(wchar_t ch) const
-{
-	return (m_vGlyphMetrics.find(ch) != m_vGlyphMetrics.end());
-}
+	layout->memorySize = sizeof(TEXT_LAYOUT) + text.length()*(sizeof(wchar_t) + 1) + numVertices*(sizeof(Vector3) + sizeof(Vector2));
 
+	s_textLayoutLRU.push_front(layout);
+	layout->lruIterator = s_textLayoutLRU.begin();
+	s_iTextLayoutMemorySize += layout->memorySize;
+	m_textLayouts[text] = layout;
 
+	// NOTE: the new layout is at the front, so it's never evicted immediately (even if it alone is over the limit)
+	evictTextLayouts((size_t)std::max(r_drawstring_cache_max_kb.getInt(), 0) * 1024);
 
-// helper functions
+	return layout;
+}
 
-void renderFTGlyphToTextureAtlas(FT_Library library, FT_Face face, wchar_t ch, TextureAtlas *textureAtlas, bool antialiasing, std::unordered_map<wchar_t, McFont::GLYPH_METRICS> *glyphMetrics)
+void McFont::clearTextLayouts()
 {
-	// load current glyph
-	if (FT_Load_Glyph(face, FT_Get_Char_Index(face, ch), antialiasing ? FT_LOAD_TARGET_NORMAL : FT_LOAD_TARGET_MONO))
+	for (auto it = m_textLayouts.begin(); it != m_textLayouts.end(); ++it)
 	{
-		engine->showMessageError("Font Error", "FT_Load_Glyph() failed!");
-		return;
+		TEXT_LAYOUT *layout = it->second;
+
+		s_textLayoutLRU.erase(layout->lruIterator);
+		s_iTextLayoutMemorySize -= layout->memorySize;
+
+		for (size_t p=0; p<layout->pages.size(); p++)
+		{
+			delete layout->pages[p].vao;
+		}
+		delete layout;
+	}
+	m_textLayouts.clear();
+}
+
+void McFont::evictTextLayout(TEXT_LAYOUT *layout)
+{
+	s_iNumTextLayoutEvictions++;
+
+	layout->font->m_textLayouts.erase(layout->text);
+	s_textLayoutLRU.erase(layout->lruIterator);
+	s_iTextLayoutMemorySize -= layout->memorySize;
+
+	for (size_t p=0; p<layout->pages.size(); p++)
+	{
+		delete layout->pages[p].vao;
+	}
+	delete layout;
+}
+
+void McFont::evictTextLayouts(size_t maxMemorySize)
+{
+	while (s_iTextLayoutMemorySize > maxMemorySize && s_textLayoutLRU.size() > 1)
+	{
+		evictTextLayout(s_textLayoutLRU.back());
+	}
+}
+
+void McFont::printTextLayoutCacheStats()
+{
+	const unsigned long numLookups = s_iNumTextLayoutHits + s_iNumTextLayoutMisses;
+
+	debugLog("Font: Text layout cache: %i string(s), %.1f / %i KB, %lu hit(s), %lu miss(es) (%.1f %% hits), %lu eviction(s)\n", (int)s_textLayoutLRU.size(), s_iTextLayoutMemorySize / 1024.0f, r_drawstring_cache_max_kb.getInt(), s_iNumTextLayoutHits, s_iNumTextLayoutMisses, (numLookups > 0 ? ((float)s_iNumTextLayoutHits / (float)numLookups)*100.0f : 0.0f), s_iNumTextLayoutEvictions);
+}
+
+float McFont::getStringWidth(const UString &text)
+{
+	return getStringWidth(text.wc_str(), text.length());
+}
+
+float McFont::getStringHeight(const UString &text)
+{
+	return getStringHeight(text.wc_str(), text.length());
+}
+
+float McFont::getStringWidth(const wchar_t *text, int length)
+{
+	if (!m_bReady) return 1.0f;
+
+	float width = 0;
+	for (int i=0; i<length; i++)
+	{
+		width += getGlyphMetrics(text[i]).advance_x;
+	}
+
+	return width;
+}
+
+float McFont::getStringHeight(const wchar_t *text, int length)
+{
+	if (!m_bReady) return 1.0f;
+
+	const int topOffset = (m_bSignedDistanceField ? SDF_SPREAD : 0);
+
+	float height = 0;
+	for (int i=0; i<length; i++)
+	{
+		height += getGlyphMetrics(text[i]).top - topOffset;
+	}
+
+	return height;
+}
+
+const McFont::GLYPH_METRICS &McFont::getGlyphMetrics(wchar_t ch)
+{
+	// fast path, no hashing
+	if ((unsigned int)ch < NUM_FLAT_GLYPHS)
+	{
+		GLYPH_METRICS *metrics = m_flatGlyphMetrics[ch];
+		if (metrics != NULL)
+		{
+			if (metrics->dynamicSlot > -1)
+				touchDynamicSlot(metrics->dynamicSlot);
+
+			return *metrics;
+		}
+	}
+
+	auto it = m_vGlyphMetrics.find(ch);
+	if (it == m_vGlyphMetrics.end() && loadDynamicGlyph(ch))
+		it = m_vGlyphMetrics.find(ch);
+
+	if (it != m_vGlyphMetrics.end())
+	{
+		if (it->second.dynamicSlot > -1)
+			touchDynamicSlot(it->second.dynamicSlot);
+
+		return it->second;
+	}
+	else if (m_flatGlyphMetrics[UNKNOWN_CHAR] != NULL)
+		return *m_flatGlyphMetrics[UNKNOWN_CHAR];
+	else
+	{
+		debugLog("Font Error: Missing default backup glyph (UNKNOWN_CHAR)!\n");
+		return m_errorGlyph;
+	}
+}
+
+const bool McFont::hasGlyph(wchar_t ch) const
+{
+	if ((unsigned int)ch < NUM_FLAT_GLYPHS)
+		return (m_flatGlyphMetrics[ch] != NULL);
+
+	return (m_vGlyphMetrics.find(ch) != m_vGlyphMetrics.end());
+}
+
+
+
+bool McFont::loadDynamicGlyph(wchar_t ch)
+{
+	if (ch < 32 || r_font_dynamic_max_pages.getInt() < 1) return false;
+	if (m_missingGlyphs.find(ch) != m_missingGlyphs.end()) return false;
+	if (m_ftFace == NULL && !openFTFace()) return false;
+
+	// characters which the face doesn't have are drawn as UNKNOWN_CHAR
+	if (FT_Get_Char_Index(m_ftFace, ch) == 0)
+	{
+		m_missingGlyphs.insert(ch);
+		return false;
+	}
+
+	GLYPH_METRICS metrics;
+	std::vector<Color> pixels;
+	const char *error = NULL;
+	if (!(m_bSignedDistanceField ? renderFTGlyphSDF(m_ftFace, ch, &metrics, &pixels, &error) : renderFTGlyph(m_ftFace, ch, m_bAntialiasing, &metrics, &pixels, &error)))
+	{
+		if (error != NULL)
+			engine->showMessageError("Font Error", error);
+
+		m_missingGlyphs.insert(ch);
+		return false;
+	}
+
+	const int width = (int)metrics.sizePixelsX;
+	const int height = (int)metrics.sizePixelsY;
+
+	if (width > m_iDynamicSlotWidth - 2 || height > m_iDynamicSlotHeight - 2)
+	{
+		debugLog("Font Warning: Glyph %i (%ix%i) doesn't fit into a dynamic slot (%ix%i)!\n", (int)ch, width, height, m_iDynamicSlotWidth - 2, m_iDynamicSlotHeight - 2);
+		m_missingGlyphs.insert(ch);
+		return false;
+	}
+
+	metrics.atlasPage = 0;
+	metrics.dynamicSlot = -1;
+	metrics.uvPixelsX = 0;
+	metrics.uvPixelsY = 0;
+
+	if (width > 0 && height > 0) // (e.g. whitespace only has metrics)
+	{
+		const int slotIndex = allocateDynamicSlot();
+		if (slotIndex < 0)
+			return false; // everything is in use by the string which is currently being built, try again next time
+
+		DYNAMIC_SLOT &slot = m_dynamicSlots[slotIndex];
+		slot.character = ch;
+
+		Image *pageImage = m_dynamicPages[slot.atlasPage - 1];
+		for (int y=0; y<height; y++)
+		{
+			for (int x=0; x<width; x++)
+			{
+				pageImage->setPixel(slot.x + x, slot.y + y, pixels[y*width + x]);
+			}
+		}
+		m_dynamicPagesDirty[slot.atlasPage - 1] = true;
+
+		metrics.atlasPage = slot.atlasPage;
+		metrics.dynamicSlot = slotIndex;
+		metrics.uvPixelsX = (unsigned int)slot.x;
+		metrics.uvPixelsY = (unsigned int)slot.y;
+	}
+
+	setGlyphMetrics(ch, metrics);
+
+	return true;
+}
+
+int McFont::allocateDynamicSlot()
+{
+	if (m_freeDynamicSlots.size() < 1 && (int)m_dynamicPages.size() < r_font_dynamic_max_pages.getInt())
+		addDynamicPage();
+
+	int slotIndex = -1;
+	if (m_freeDynamicSlots.size() > 0)
+	{
+		slotIndex = m_freeDynamicSlots.back();
+		m_freeDynamicSlots.pop_back();
+	}
+	else
+	{
+		// all pages are full, replace the least recently used glyph
+		if (m_dynamicSlotLRU.size() < 1) return -1;
+
+		slotIndex = m_dynamicSlotLRU.back();
+		DYNAMIC_SLOT &slot = m_dynamicSlots[slotIndex];
+		if (slot.lastUse == m_iGlyphUseStamp)
+			return -1;
+
+		m_iNumGlyphEvictions++;
+
+		removeGlyphMetrics(slot.character);
+		m_dynamicSlotLRU.pop_back();
+
+		// cached layouts might still reference the old glyph
+		clearTextLayouts();
+
+		Image *pageImage = m_dynamicPages[slot.atlasPage - 1];
+		for (int y=0; y<m_iDynamicSlotHeight - 2; y++)
+		{
+			for (int x=0; x<m_iDynamicSlotWidth - 2; x++)
+			{
+				pageImage->setPixel(slot.x + x, slot.y + y, 0x00000000);
+			}
+		}
+	}
+
+	DYNAMIC_SLOT &slot = m_dynamicSlots[slotIndex];
+	m_dynamicSlotLRU.push_front(slotIndex);
+	slot.lruIterator = m_dynamicSlotLRU.begin();
+	slot.lastUse = m_iGlyphUseStamp;
+
+	return slotIndex;
+}
+
+void McFont::touchDynamicSlot(int slotIndex)
+{
+	DYNAMIC_SLOT &slot = m_dynamicSlots[slotIndex];
+
+	slot.lastUse = m_iGlyphUseStamp;
+	if (slot.lruIterator != m_dynamicSlotLRU.begin())
+		m_dynamicSlotLRU.splice(m_dynamicSlotLRU.begin(), m_dynamicSlotLRU, slot.lruIterator);
+}
+
+void McFont::addDynamicPage()
+{
+	// NOTE: kept in system memory, since it has to be uploaded again every time a glyph is added
+	engine->getResourceManager()->requestNextLoadUnmanaged();
+	Image *pageImage = engine->getResourceManager()->createImage(m_iDynamicPageSize, m_iDynamicPageSize, false, true);
+	engine->getResourceManager()->loadResource(pageImage);
+
+	if (m_bAntialiasing || m_bSignedDistanceField)
+		pageImage->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_LINEAR);
+	else
+		pageImage->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_NONE);
+
+	m_dynamicPages.push_back(pageImage);
+	m_dynamicPagesDirty.push_back(false);
+
+	const unsigned int atlasPage = m_dynamicPages.size(); // (page 0 is the preloaded atlas)
+
+	// slots include a 1 pixel border on every side (so that linear filtering doesn't bleed into the neighbours)
+	const int numColumns = m_iDynamicPageSize / m_iDynamicSlotWidth;
+	const int numRows = m_iDynamicPageSize / m_iDynamicSlotHeight;
+
+	// reversed, so that the free list hands them out in order
+	for (int r=numRows-1; r>=0; r--)
+	{
+		for (int c=numColumns-1; c>=0; c--)
+		{
+			DYNAMIC_SLOT slot;
+			slot.atlasPage = atlasPage;
+			slot.x = c*m_iDynamicSlotWidth + 1;
+			slot.y = r*m_iDynamicSlotHeight + 1;
+			slot.character = 0;
+			slot.lastUse = 0;
+			slot.lruIterator = m_dynamicSlotLRU.end();
+
+			m_freeDynamicSlots.push_back(m_dynamicSlots.size());
+			m_dynamicSlots.push_back(slot);
+		}
+	}
+}
+
+void McFont::updateDynamicPages()
+{
+	for (size_t i=0; i<m_dynamicPages.size(); i++)
+	{
+		if (m_dynamicPagesDirty[i])
+		{
+			m_dynamicPagesDirty[i] = false;
+			m_dynamicPages[i]->load(); // upload again
+
+			clearSDFResolvedPages(i + 1);
+		}
+	}
+}
+
+Image *McFont::getAtlasPageImage(unsigned int atlasPage) const
+{
+	if (atlasPage > 0 && atlasPage <= m_dynamicPages.size())
+		return m_dynamicPages[atlasPage - 1];
+
+	return m_textureAtlas->getAtlasImage();
+}
+
+void McFont::beginSDF(Graphics *g)
+{
+	m_bSDFShaderActive = false;
+	if (!m_bSignedDistanceField) return;
+
+	if (r_font_sdf_shader.getBool() && g->supportsCustomShaders())
+	{
+		if (s_sdfShader == NULL)
+		{
+			s_sdfShader = engine->getResourceManager()->createShader(
+
+					// vertex shader
+					"#version 110\n"
+					"varying vec2 texCoords;\n"
+					"void main()\n"
+					"{\n"
+					"	texCoords = gl_MultiTexCoord0.xy;\n"
+					"	gl_FrontColor = gl_Color;\n"
+					"	gl_Position = ftransform();\n"
+					"}\n",
+
+					// fragment shader (half a pixel of smoothing on each side of the outline, at whatever scale the text is drawn)
+					"#version 110\n"
+					"uniform sampler2D tex;\n"
+					"varying vec2 texCoords;\n"
+					"void main()\n"
+					"{\n"
+					"	float dist = texture2D(tex, texCoords).a;\n"
+					"	float smoothing = clamp(0.5*fwidth(dist), 0.001, 0.5);\n"
+					"	gl_FragColor = vec4(gl_Color.rgb, gl_Color.a*smoothstep(0.5 - smoothing, 0.5 + smoothing, dist));\n"
+					"}\n"
+			);
+		}
+
+		if (s_sdfShader->isReady())
+		{
+			s_sdfShader->enable();
+			m_bSDFShaderActive = true;
+			return;
+		}
+	}
+
+	// quantize the current scale into quarter octaves for the cpu path
+	// magnification doesn't get its own steps, since that is limited by the resolution of the atlas anyway
+	const Matrix4 worldMatrix = g->getWorldMatrix();
+	const float *m = worldMatrix.get();
+	const float scale = std::sqrt(m[0]*m[0] + m[1]*m[1]);
+	m_iSDFScaleBucket = (scale > 0.0f && scale < 1.0f ? clamp<int>((int)std::round(-std::log2(scale)*4.0f), 0, 16) : 0);
+	m_iSDFResolveStamp++;
+}
+
+void McFont::endSDF()
+{
+	if (m_bSDFShaderActive)
+		s_sdfShader->disable();
+
+	m_bSDFShaderActive = false;
+}
+
+Image *McFont::getDrawPageImage(unsigned int atlasPage)
+{
+	if (!m_bSignedDistanceField || m_bSDFShaderActive)
+		return getAtlasPageImage(atlasPage);
+
+	return getSDFResolvedPageImage(atlasPage, m_iSDFScaleBucket);
+}
+
+Image *McFont::getSDFResolvedPageImage(unsigned int atlasPage, int scaleBucket)
+{
+	for (size_t i=0; i<m_sdfResolvedPages.size(); i++)
+	{
+		if (m_sdfResolvedPages[i].atlasPage == atlasPage && m_sdfResolvedPages[i].scaleBucket == scaleBucket)
+		{
+			m_sdfResolvedPages[i].lastUse = m_iSDFResolveStamp;
+			return m_sdfResolvedPages[i].image;
+		}
+	}
+
+	Image *sdfImage = getAtlasPageImage(atlasPage);
+	std::vector<unsigned char> *sdfPixels = sdfImage->getRawImage();
+	const int width = sdfImage->getWidth();
+	const int height = sdfImage->getHeight();
+	if ((int)sdfPixels->size() < width*height*4)
+		return sdfImage; // not in system memory (should never happen)
+
+	// replace the least recently used one (but never one which is used by the string which is currently being drawn)
+	if ((int)m_sdfResolvedPages.size() >= std::max(r_font_sdf_max_resolved_pages.getInt(), 1))
+	{
+		size_t oldest = 0;
+		for (size_t i=1; i<m_sdfResolvedPages.size(); i++)
+		{
+			if (m_sdfResolvedPages[i].lastUse < m_sdfResolvedPages[oldest].lastUse)
+				oldest = i;
+		}
+
+		if (m_sdfResolvedPages[oldest].lastUse != m_iSDFResolveStamp)
+		{
+			delete m_sdfResolvedPages[oldest].image;
+			m_sdfResolvedPages.erase(m_sdfResolvedPages.begin() + oldest);
+		}
+	}
+
+	// same as the shader: smoothstep over half a (screen) pixel on each side of the outline
+	const float scale = std::pow(2.0f, -(float)scaleBucket/4.0f);
+	const float smoothing = std::min(1.0f/(4.0f*(float)SDF_SPREAD*scale), 0.5f);
+	unsigned char alphaTable[256];
+	for (int i=0; i<256; i++)
+	{
+		const float t = clamp<float>(((float)i/255.0f - (0.5f - smoothing)) / (2.0f*smoothing), 0.0f, 1.0f);
+		alphaTable[i] = (unsigned char)std::round(t*t*(3.0f - 2.0f*t)*255.0f);
+	}
+
+	engine->getResourceManager()->requestNextLoadUnmanaged();
+	Image *resolvedImage = engine->getResourceManager()->createImage(width, height);
+	{
+		std::vector<unsigned char> &resolvedPixels = *resolvedImage->getRawImage();
+		for (int i=0; i<width*height; i++)
+		{
+			resolvedPixels[4*i + 0] = 255;
+			resolvedPixels[4*i + 1] = 255;
+			resolvedPixels[4*i + 2] = 255;
+			resolvedPixels[4*i + 3] = alphaTable[(*sdfPixels)[4*i + 3]];
+		}
+	}
+	engine->getResourceManager()->loadResource(resolvedImage);
+	resolvedImage->setFilterMode(Graphics::FILTER_MODE::FILTER_MODE_LINEAR);
+
+	SDF_RESOLVED_PAGE resolvedPage;
+	resolvedPage.atlasPage = atlasPage;
+	resolvedPage.scaleBucket = scaleBucket;
+	resolvedPage.image = resolvedImage;
+	resolvedPage.lastUse = m_iSDFResolveStamp;
+	m_sdfResolvedPages.push_back(resolvedPage);
+
+	return resolvedImage;
+}
+
+void McFont::clearSDFResolvedPages(int atlasPage)
+{
+	for (size_t i=0; i<m_sdfResolvedPages.size(); )
+	{
+		if (atlasPage < 0 || (int)m_sdfResolvedPages[i].atlasPage == atlasPage)
+		{
+			delete m_sdfResolvedPages[i].image;
+			m_sdfResolvedPages.erase(m_sdfResolvedPages.begin() + i);
+		}
+		else
+			i++;
+	}
+}
+
+void McFont::printStats()
+{
+	debugLog("Font: %s (%i px, %i dpi): %i preloaded glyph(s), %i dynamic glyph(s) on %i/%i page(s) (%i slots of %ix%i), %lu replaced, %i missing\n",
+			m_sName.toUtf8(), m_iFontSize, m_iFontDPI, (int)m_vGlyphs.size(), (int)m_dynamicSlotLRU.size(), (int)m_dynamicPages.size(), r_font_dynamic_max_pages.getInt(),
+			(int)m_dynamicSlots.size(), m_iDynamicSlotWidth, m_iDynamicSlotHeight, m_iNumGlyphEvictions, (int)m_missingGlyphs.size());
+	if (m_bSignedDistanceField)
+		debugLog("Font: %s: signed distance field (%ix supersampling, %i px spread), %i cpu resolved page(s)\n", m_sName.toUtf8(), SDF_SUPERSAMPLING, SDF_SPREAD, (int)m_sdfResolvedPages.size());
+}
+
+
+
+// helper functions
+
+bool renderFTGlyph(FT_Face face, wchar_t ch, bool antialiasing, McFont::GLYPH_METRICS *metrics, std::vector<Color> *pixels, const char **error)
+{
+	// load current glyph
+	if (FT_Load_Glyph(face, FT_Get_Char_Index(face, ch), antialiasing ? FT_LOAD_TARGET_NORMAL : FT_LOAD_TARGET_MONO))
+	{
+		*error = "FT_Load_Glyph() failed!";
+		return false;
 	}
 
 	// create glyph object from face glyph
     FT_Glyph glyph;
     if (FT_Get_Glyph(face->glyph, &glyph))
     {
-    	engine->showMessageError("Font Error", "FT_Get_Glyph() failed!");
-    	return;
+    	*error = "FT_Get_Glyph() failed!";
+    	return false;
     }
 
 	// convert glyph to bitmap
@@ -320,65 +1347,255 @@ void renderFTGlyphToTextureAtlas(FT_Library library, FT_Face face, wchar_t ch, T
 	const int width = bitmap.width;
 	const int height = bitmap.rows;
 
-	// build texture
-	Vector2 atlasPos;
+	// expand bitmap (top row first)
+	pixels->clear();
 	if (width > 0 && height > 0)
 	{
-		// temp texture data memory
-		unsigned char *expandedData = new unsigned char[4 * width * height];
 		unsigned char *monoBitmapUnpacked = NULL;
 
 		if (!antialiasing)
 			monoBitmapUnpacked = unpackMonoBitmap(bitmap);
 
-		// expand bitmap
+		pixels->resize(width * height);
 		for (int j=0; j<height; j++)
 		{
 			for (int i=0; i<width; i++)
 			{
 				unsigned char alpha = 0;
 
-				if (i < bitmap.width && j < bitmap.rows)
-				{
-					if (antialiasing)
-						alpha = bitmap.buffer[i + bitmap.width*j];
-					else
-						alpha = monoBitmapUnpacked[i + bitmap.width*j] > 0 ? 255 : 0;
-				}
+				if (antialiasing)
+					alpha = bitmap.buffer[i + bitmap.width*j];
+				else
+					alpha = monoBitmapUnpacked[i + bitmap.width*j] > 0 ? 255 : 0;
 
-				expandedData[(4*i + (height - j - 1) * width * 4)    ] = 0xff;	// R
-				expandedData[(4*i + (height - j - 1) * width * 4) + 1] = 0xff;	// G
-				expandedData[(4*i + (height - j - 1) * width * 4) + 2] = 0xff;	// B
-				expandedData[(4*i + (height - j - 1) * width * 4) + 3] = alpha;	// A
+				(*pixels)[i + j*width] = COLOR(alpha, 255, 255, 255);
 			}
 		}
 
-		// add glyph to atlas
-		atlasPos = textureAtlas->put(width, height, false, true, (Color*)expandedData);
-
-		// free temp expanded textures
-		delete[] expandedData;
 		if (!antialiasing)
 			delete[] monoBitmapUnpacked;
 	}
 
-	// save glyph metrics
-	(*glyphMetrics)[ch].character = ch;
+	// save glyph metrics (the atlas position is up to the caller)
+	metrics->character = ch;
 
-	(*glyphMetrics)[ch].uvPixelsX = (unsigned int)atlasPos.x;
-	(*glyphMetrics)[ch].uvPixelsY = (unsigned int)atlasPos.y;
-	(*glyphMetrics)[ch].sizePixelsX = (unsigned int)width;
-	(*glyphMetrics)[ch].sizePixelsY = (unsigned int)height;
+	metrics->atlasPage = 0;
+	metrics->dynamicSlot = -1;
+	metrics->uvPixelsX = 0;
+	metrics->uvPixelsY = 0;
+	metrics->sizePixelsX = (unsigned int)width;
+	metrics->sizePixelsY = (unsigned int)height;
 
-	(*glyphMetrics)[ch].left = bitmapGlyph->left;
-	(*glyphMetrics)[ch].top = bitmapGlyph->top;
-	(*glyphMetrics)[ch].width = bitmap.width;
-	(*glyphMetrics)[ch].rows = bitmap.rows;
+	metrics->left = bitmapGlyph->left;
+	metrics->top = bitmapGlyph->top;
+	metrics->width = bitmap.width;
+	metrics->rows = bitmap.rows;
 
-	(*glyphMetrics)[ch].advance_x = (float)(face->glyph->advance.x >> 6);
+	metrics->advance_x = (float)(face->glyph->advance.x >> 6);
 
 	// release
 	FT_Done_Glyph(glyph);
+
+	return true;
+}
+
+bool renderFTGlyphSDF(FT_Face face, wchar_t ch, McFont::GLYPH_METRICS *metrics, std::vector<Color> *pixels, const char **error)
+{
+	// the face is set to the supersampled size, so this is the high resolution outline
+	McFont::GLYPH_METRICS hiresMetrics;
+	std::vector<Color> hiresPixels;
+	if (!renderFTGlyph(face, ch, true, &hiresMetrics, &hiresPixels, error))
+		return false;
+
+	const int ss = McFont::SDF_SUPERSAMPLING;
+	const int spread = McFont::SDF_SPREAD;
+
+	*metrics = hiresMetrics;
+	metrics->advance_x = hiresMetrics.advance_x / (float)ss;
+
+	pixels->clear();
+
+	const int hiresWidth = (int)hiresMetrics.sizePixelsX;
+	const int hiresHeight = (int)hiresMetrics.sizePixelsY;
+	if (hiresWidth < 1 || hiresHeight < 1)
+	{
+		metrics->sizePixelsX = metrics->sizePixelsY = 0;
+		metrics->left = metrics->top = metrics->width = metrics->rows = 0;
+		return true;
+	}
+
+	// the glyph grid (in font pixels) is aligned to the supersampled grid, and gets the spread on every side
+	const int left = (int)std::floor((float)hiresMetrics.left / (float)ss) - spread;
+	const int top = (int)std::ceil((float)hiresMetrics.top / (float)ss) + spread; // (y up, from the baseline)
+	const int width = (int)std::ceil((float)(hiresMetrics.left + hiresWidth) / (float)ss) + spread - left;
+	const int height = top - ((int)std::floor((float)(hiresMetrics.top - hiresHeight) / (float)ss) - spread);
+
+	const int gridWidth = width*ss;
+	const int gridHeight = height*ss;
+	const int offsetX = hiresMetrics.left - left*ss;
+	const int offsetY = top*ss - hiresMetrics.top;
+
+	// squared distances to the nearest pixel inside (for everything outside), and to the nearest pixel outside (for everything inside)
+	const float inf = 1e20f;
+	std::vector<bool> inside(gridWidth*gridHeight, false);
+	for (int y=0; y<hiresHeight; y++)
+	{
+		for (int x=0; x<hiresWidth; x++)
+		{
+			inside[(y + offsetY)*gridWidth + (x + offsetX)] = (COLOR_GET_Ai(hiresPixels[y*hiresWidth + x]) > 127);
+		}
+	}
+	std::vector<float> distOutside(gridWidth*gridHeight);
+	std::vector<float> distInside(gridWidth*gridHeight);
+	for (int i=0; i<gridWidth*gridHeight; i++)
+	{
+		distOutside[i] = (inside[i] ? 0.0f : inf);
+		distInside[i] = (inside[i] ? inf : 0.0f);
+	}
+	distanceTransform(distOutside, gridWidth, gridHeight);
+	distanceTransform(distInside, gridWidth, gridHeight);
+
+	// every output pixel is the average of the 2x2 supersampled pixels around its center, the outline is at 0.5
+	pixels->resize(width*height);
+	for (int y=0; y<height; y++)
+	{
+		for (int x=0; x<width; x++)
+		{
+			float dist = 0.0f;
+			for (int sy=0; sy<2; sy++)
+			{
+				for (int sx=0; sx<2; sx++)
+				{
+					const int i = (y*ss + ss/2 - 1 + sy)*gridWidth + (x*ss + ss/2 - 1 + sx);
+					dist += (inside[i] ? -(std::sqrt(distInside[i]) - 0.5f) : (std::sqrt(distOutside[i]) - 0.5f));
+				}
+			}
+			dist /= 4.0f;
+
+			const float value = clamp<float>(0.5f - dist / (float)(2*spread*ss), 0.0f, 1.0f);
+			(*pixels)[y*width + x] = COLOR((int)std::round(value*255.0f), 255, 255, 255);
+		}
+	}
+
+	metrics->sizePixelsX = (unsigned int)width;
+	metrics->sizePixelsY = (unsigned int)height;
+	metrics->left = left;
+	metrics->top = top;
+	metrics->width = width;
+	metrics->rows = height;
+
+	return true;
+}
+
+static void distanceTransform1D(const float *f, float *d, int *v, float *z, int n)
+{
+	// lower envelope of the parabolas rooted at every sample (Felzenszwalb & Huttenlocher)
+	int k = 0;
+	v[0] = 0;
+	z[0] = -1e20f;
+	z[1] = 1e20f;
+	for (int q=1; q<n; q++)
+	{
+		float s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (float)(2*q - 2*v[k]);
+		while (s <= z[k])
+		{
+			k--;
+			s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (float)(2*q - 2*v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = 1e20f;
+	}
+
+	k = 0;
+	for (int q=0; q<n; q++)
+	{
+		while (z[k+1] < q)
+		{
+			k++;
+		}
+		d[q] = (q - v[k])*(q - v[k]) + f[v[k]];
+	}
+}
+
+void distanceTransform(std::vector<float> &grid, int width, int height)
+{
+	const int n = std::max(width, height);
+	std::vector<float> f(n);
+	std::vector<float> d(n);
+	std::vector<int> v(n);
+	std::vector<float> z(n + 1);
+
+	// columns
+	for (int x=0; x<width; x++)
+	{
+		for (int y=0; y<height; y++)
+		{
+			f[y] = grid[y*width + x];
+		}
+		distanceTransform1D(&f[0], &d[0], &v[0], &z[0], height);
+		for (int y=0; y<height; y++)
+		{
+			grid[y*width + x] = d[y];
+		}
+	}
+
+	// rows
+	for (int y=0; y<height; y++)
+	{
+		distanceTransform1D(&grid[y*width], &d[0], &v[0], &z[0], width);
+		for (int x=0; x<width; x++)
+		{
+			grid[y*width + x] = d[x];
+		}
+	}
+}
+
+bool createFTFace(const char *filePath, int renderSize, int dpi, FT_Library *library, FT_Face *face)
+{
+	if (FT_Init_FreeType(library))
+		return false;
+
+	if (FT_New_Face(*library, filePath, 0, face))
+	{
+		FT_Done_FreeType(*library);
+		return false;
+	}
+
+	if (FT_Select_Charmap(*face, ft_encoding_unicode))
+	{
+		FT_Done_Face(*face);
+		FT_Done_FreeType(*library);
+		return false;
+	}
+
+	FT_Set_Char_Size(*face, renderSize*64, renderSize*64, dpi, dpi);
+
+	return true;
+}
+
+void appendFontCacheGlyph(std::string &cacheData, const McFont::GLYPH_METRICS &metrics, const std::vector<Color> &pixels)
+{
+	const int values[7] = {(int)metrics.character, metrics.left, metrics.top, metrics.width, metrics.rows, (int)metrics.sizePixelsX, (int)metrics.sizePixelsY};
+	cacheData.append((const char*)values, sizeof(values));
+	cacheData.append((const char*)&metrics.advance_x, sizeof(metrics.advance_x));
+
+	for (size_t i=0; i<pixels.size(); i++)
+	{
+		cacheData.push_back((char)COLOR_GET_Ai(pixels[i]));
+	}
+}
+
+bool readFontCacheData(const char *&cur, const char *end, void *data, size_t size)
+{
+	if ((size_t)(end - cur) < size)
+		return false;
+
+	memcpy(data, cur, size);
+	cur += size;
+
+	return true;
 }
 
 unsigned char *unpackMonoBitmap(FT_Bitmap bitmap)
@@ -412,3 +1629,265 @@ unsigned char *unpackMonoBitmap(FT_Bitmap bitmap)
 
 	return result;
 }
+
+
+
+//**************************//
+//	McFont ConCommands		//
+//**************************//
+
+void _font_benchmark(UString args)
+{
+	McFont *font = engine->getResourceManager()->getFont("FONT_CONSOLE");
+	Graphics *g = engine->getGraphics();
+	if (font == NULL || g == NULL || !font->isReady()) return;
+
+	int numStrings = args.toInt();
+	if (numStrings < 1)
+		numStrings = 100;
+
+	// a full console page worth of text
+	std::string chars;
+	for (int i=0; i<2000; i++)
+	{
+		chars += (char)(33 + (i % 94));
+	}
+	const UString text = UString(chars.c_str());
+
+	const bool wasBatched = r_drawstring_batched.getBool();
+	const bool wasCached = r_drawstring_cache.getBool();
+
+	debugLog("Font: Benchmarking %i x drawString() with %i characters on %s ...\n", numStrings, text.length(), g->getModel().toUtf8());
+
+	// NOTE: drawn outside of a frame, whatever ends up in the backbuffer is cleared by the next beginScene()
+	const char *modeNames[3] = {"per glyph", "batched", "cached"};
+	for (int m=0; m<3; m++)
+	{
+		r_drawstring_batched.setValue(m > 0 ? 1.0f : 0.0f);
+		r_drawstring_cache.setValue(m > 1 ? 1.0f : 0.0f);
+
+		g->pushTransform();
+		{
+			g->translate(0, font->getHeight());
+
+			const unsigned long numDrawCallsStart = g_iFontNumDrawCalls;
+			const double startTime = engine->getTimeReal();
+			for (int i=0; i<numStrings; i++)
+			{
+				if (m > 1)
+					g->drawStringCached(font, text);
+				else
+					g->drawString(font, text);
+			}
+			g->flush();
+			const double duration = engine->getTimeReal() - startTime;
+
+			const double drawCallsPerString = (double)(g_iFontNumDrawCalls - numDrawCallsStart) / (double)numStrings;
+			debugLog("Font: %s: %.1f draw call(s) per string, %.3f ms per string\n", modeNames[m], drawCallsPerString, (duration / (double)numStrings)*1000.0);
+		}
+		g->popTransform();
+	}
+
+	r_drawstring_batched.setValue(wasBatched ? 1.0f : 0.0f);
+	r_drawstring_cache.setValue(wasCached ? 1.0f : 0.0f);
+}
+
+void _font_cache_stats(void)
+{
+	McFont::printTextLayoutCacheStats();
+}
+
+void _font_stats(void)
+{
+	const std::vector<Resource*> resources = engine->getResourceManager()->getResources();
+	for (size_t i=0; i<resources.size(); i++)
+	{
+		if (resources[i]->getResType() == Resource::TYPE::TYPE_FONT)
+			((McFont*)resources[i])->printStats();
+	}
+}
+
+void _font_sdf_benchmark(void)
+{
+	McFont *defaultFont = engine->getResourceManager()->getFont("FONT_DEFAULT");
+	if (defaultFont == NULL) return;
+
+	// what an app which draws text at many scales needs: one font per size, or a single sdf font
+	const int sizes[] = {8, 12, 16, 20, 24, 32, 48, 64};
+	const int numSizes = sizeof(sizes)/sizeof(sizes[0]);
+
+	double bitmapTime = 0.0;
+	size_t bitmapMemory = 0;
+	for (int i=0; i<numSizes; i++)
+	{
+		McFont *font = new McFont(defaultFont->getFilePath(), sizes[i]);
+		const double startTime = engine->getTimeReal();
+		{
+			engine->getResourceManager()->requestNextLoadUnmanaged();
+			engine->getResourceManager()->loadResource(font);
+		}
+		bitmapTime += engine->getTimeReal() - startTime;
+		if (font->getTextureAtlas() != NULL)
+			bitmapMemory += (size_t)font->getTextureAtlas()->getWidth()*(size_t)font->getTextureAtlas()->getHeight()*4;
+		delete font;
+	}
+
+	McFont *sdfFont = new McFont(defaultFont->getFilePath(), 32, true, 96, true);
+	const double startTime = engine->getTimeReal();
+	{
+		engine->getResourceManager()->requestNextLoadUnmanaged();
+		engine->getResourceManager()->loadResource(sdfFont);
+	}
+	const double sdfTime = engine->getTimeReal() - startTime;
+	const size_t sdfMemory = (sdfFont->getTextureAtlas() != NULL ? (size_t)sdfFont->getTextureAtlas()->getWidth()*(size_t)sdfFont->getTextureAtlas()->getHeight()*4 : 0);
+	delete sdfFont;
+
+	debugLog("Font: %i bitmap fonts (%i - %i px): %.1f ms, %i KB atlas texture memory\n", numSizes, sizes[0], sizes[numSizes-1], bitmapTime*1000.0, (int)(bitmapMemory/1024));
+	debugLog("Font: 1 sdf font (32 px, drawn at any scale): %.1f ms, %i KB atlas texture memory\n", sdfTime*1000.0, (int)(sdfMemory/1024));
+}
+
+void _font_init_benchmark(void)
+{
+	McFont *defaultFont = engine->getResourceManager()->getFont("FONT_DEFAULT");
+	if (defaultFont == NULL) return;
+
+	const bool wasParallel = r_font_parallel_init.getBool();
+
+	debugLog("Font: Benchmarking font init with %i job system worker(s) ...\n", engine->getJobSystem() != NULL ? engine->getJobSystem()->getNumWorkers() : 0);
+
+	const int dpis[] = {96, 192};
+	for (int d=0; d<2; d++)
+	{
+		for (int sdf=0; sdf<2; sdf++)
+		{
+			double durations[2];
+			for (int parallel=0; parallel<2; parallel++)
+			{
+				r_font_parallel_init.setValue(parallel > 0 ? 1.0f : 0.0f);
+
+				// best of 3
+				durations[parallel] = 0.0;
+				for (int i=0; i<3; i++)
+				{
+					McFont *font = new McFont(defaultFont->getFilePath(), 32, true, dpis[d], sdf > 0);
+					const double startTime = engine->getTimeReal();
+					{
+						engine->getResourceManager()->requestNextLoadUnmanaged();
+						engine->getResourceManager()->loadResource(font);
+					}
+					const double duration = engine->getTimeReal() - startTime;
+					if (i == 0 || duration < durations[parallel])
+						durations[parallel] = duration;
+					delete font;
+				}
+			}
+
+			debugLog("Font: 32 px, %i dpi%s: serial %.1f ms, parallel %.1f ms (%.2fx)\n", dpis[d], sdf > 0 ? ", sdf" : "", durations[0]*1000.0, durations[1]*1000.0, durations[0] / std::max(durations[1], 0.000001));
+		}
+	}
+
+	r_font_parallel_init.setValue(wasParallel ? 1.0f : 0.0f);
+}
+
+void _font_measure_benchmark(void)
+{
+	McFont *font = engine->getResourceManager()->getFont("FONT_DEFAULT");
+	if (font == NULL || !font->isReady()) return;
+
+	// 1M characters of typical gui text (mostly ascii, some latin-1), measured in console line sized pieces
+	const int numChars = 1000000;
+	const int lineLength = 100;
+	std::wstring chars;
+	for (int i=0; i<lineLength; i++)
+	{
+		chars += (wchar_t)(i % 10 == 9 ? 0xE0 + (i % 16) : 33 + (i*7 % 94));
+	}
+	const UString line = UString(chars.c_str());
+	const int numLines = numChars / lineLength;
+
+	double startTime = engine->getTimeReal();
+	float width = 0.0f;
+	for (int i=0; i<numLines; i++)
+	{
+		width += font->getStringWidth(line);
+	}
+	const double stringDuration = engine->getTimeReal() - startTime;
+
+	startTime = engine->getTimeReal();
+	float height = 0.0f;
+	for (int i=0; i<numLines; i++)
+	{
+		height += font->getStringHeight(line);
+	}
+	const double heightDuration = engine->getTimeReal() - startTime;
+
+	startTime = engine->getTimeReal();
+	float spanWidth = 0.0f;
+	for (int i=0; i<numLines; i++)
+	{
+		spanWidth += font->getStringWidth(chars.c_str(), lineLength);
+	}
+	const double spanDuration = engine->getTimeReal() - startTime;
+
+	startTime = engine->getTimeReal();
+	float glyphWidth = 0.0f;
+	for (int i=0; i<numLines; i++)
+	{
+		for (int c=0; c<lineLength; c++)
+		{
+			glyphWidth += font->getGlyphMetrics(chars[c]).advance_x;
+		}
+	}
+	const double glyphDuration = engine->getTimeReal() - startTime;
+
+	debugLog("Font: Measuring %i characters (%i per string):\n", numLines*lineLength, lineLength);
+	debugLog("Font: getStringWidth(UString) %.2f ms, getStringWidth(span) %.2f ms, getStringHeight(UString) %.2f ms, getGlyphMetrics() %.2f ms\n", stringDuration*1000.0, spanDuration*1000.0, heightDuration*1000.0, glyphDuration*1000.0);
+	if (width != spanWidth || width != glyphWidth)
+		debugLog("Font Error: Width mismatch (%f, %f, %f, %f)!\n", width, spanWidth, glyphWidth, height);
+}
+
+void _font_cache_benchmark(void)
+{
+	McFont *defaultFont = engine->getResourceManager()->getFont("FONT_DEFAULT");
+	if (defaultFont == NULL) return;
+
+	const bool wasCached = r_font_cache.getBool();
+
+	// cold = no cache at all, first = cache miss (rasterize + write), warm = cache hit
+	const int dpis[] = {96, 192};
+	for (int d=0; d<2; d++)
+	{
+		for (int sdf=0; sdf<2; sdf++)
+		{
+			double durations[3];
+			for (int run=0; run<3; run++)
+			{
+				r_font_cache.setValue(run > 0 ? 1.0f : 0.0f);
+
+				McFont *font = new McFont(defaultFont->getFilePath(), 32, true, dpis[d], sdf > 0);
+				if (run == 1)
+					env->deleteFile(font->getCacheFilePath());
+
+				const double startTime = engine->getTimeReal();
+				{
+					engine->getResourceManager()->requestNextLoadUnmanaged();
+					engine->getResourceManager()->loadResource(font);
+				}
+				durations[run] = engine->getTimeReal() - startTime;
+				delete font;
+			}
+
+			debugLog("Font: 32 px, %i dpi%s: cold %.1f ms, first %.1f ms, warm %.1f ms (%.1fx)\n", dpis[d], sdf > 0 ? ", sdf" : "", durations[0]*1000.0, durations[1]*1000.0, durations[2]*1000.0, durations[0] / std::max(durations[2], 0.000001));
+		}
+	}
+
+	r_font_cache.setValue(wasCached ? 1.0f : 0.0f);
+}
+
+ConVar _font_benchmark_("font_benchmark", _font_benchmark, ConVar::ARGS::ARGS_OPTIONAL);
+ConVar _font_cache_stats_("font_cache_stats", _font_cache_stats);
+ConVar _font_stats_("font_stats", _font_stats);
+ConVar _font_sdf_benchmark_("font_sdf_benchmark", _font_sdf_benchmark);
+ConVar _font_init_benchmark_("font_init_benchmark", _font_init_benchmark);
+ConVar _font_measure_benchmark_("font_measure_benchmark", _font_measure_benchmark);
+ConVar _font_cache_benchmark_("font_cache_benchmark", _font_cache_benchmark);
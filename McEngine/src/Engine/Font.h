@@ -10,18 +10,36 @@
 
 #include "Resource.h"
 
+#include <list>
+
 class Image;
 class TextureAtlas;
+class VertexArrayObject;
+class Shader;
+
+struct FT_LibraryRec_;
+struct FT_FaceRec_;
 
 class McFont : public Resource
 {
 public:
 	static const wchar_t UNKNOWN_CHAR = 63; // ascii '?'
 
+	// signed distance field mode: glyphs are rendered at SDF_SUPERSAMPLING times the font size, and stored as distances (+-SDF_SPREAD pixels around the outline)
+	// this allows scaling the text (g->scale()) without blurring, so one font instance can be used for all sizes
+	static const int SDF_SUPERSAMPLING = 4;
+	static const int SDF_SPREAD = 4;
+
+	// glyphs below this are looked up in a flat array instead of the hash map (ascii, latin, greek, cyrillic)
+	static const int NUM_FLAT_GLYPHS = 0x500;
+
 	struct GLYPH_METRICS
 	{
 		wchar_t character;
 
+		unsigned int atlasPage; // 0 = preloaded glyphs, 1+ = glyphs which were loaded on first use
+		int dynamicSlot;		// -1 = preloaded
+
 		unsigned int uvPixelsX;
 		unsigned int uvPixelsY;
 		unsigned int sizePixelsX;
@@ -36,13 +54,24 @@ public:
 	};
 
 public:
-	McFont(UString filepath, int fontSize = 16, bool antialiasing = true, int fontDPI = 96);
-	McFont(UString filepath, std::vector<wchar_t> characters, int fontSize = 16, bool antialiasing = true, int fontDPI = 96);
+	McFont(UString filepath, int fontSize = 16, bool antialiasing = true, int fontDPI = 96, bool signedDistanceField = false);
+	McFont(UString filepath, std::vector<wchar_t> characters, int fontSize = 16, bool antialiasing = true, int fontDPI = 96, bool signedDistanceField = false);
 	virtual ~McFont() {destroy();}
 
-	void drawString(Graphics *g, UString text);
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_FONT;}
+
+	void drawString(Graphics *g, UString text); // builds all glyph quads into one vertex buffer, and submits that as a single draw
 	void drawTextureAtlas(Graphics *g);
 
+	// for text which is drawn every frame without changing (labels, buttons, console lines etc.)
+	// the glyph quads are baked once and kept in an LRU cache shared by all fonts (see r_drawstring_cache_max_kb)
+	void drawStringCached(Graphics *g, const UString &text); // NOTE: use Graphics::drawStringCached(), same as for drawString()
+	float getStringWidthCached(const UString &text);
+
+	static void printTextLayoutCacheStats();
+
+	void printStats();
+
 	void setSize(int fontSize) {m_iFontSize = fontSize;}
 	void setDPI(int dpi) {m_iFontDPI = dpi;}
 	void setHeight(float height) {m_fHeight = height;}
@@ -50,30 +79,106 @@ public:
 	inline int getSize() const {return m_iFontSize;}
 	inline int getDPI() const {return m_iFontDPI;}
 	inline float getHeight() const {return m_fHeight;} // precomputed average height (fast)
+	inline bool isSignedDistanceField() const {return m_bSignedDistanceField;}
 
-	float getStringWidth(UString text) const;
-	float getStringHeight(UString text) const;
+	float getStringWidth(const UString &text);
+	float getStringHeight(const UString &text);
+	float getStringWidth(const wchar_t *text, int length);
+	float getStringHeight(const wchar_t *text, int length);
 
-	const GLYPH_METRICS &getGlyphMetrics(wchar_t ch) const;
-	const bool hasGlyph(wchar_t ch) const;
+	const GLYPH_METRICS &getGlyphMetrics(wchar_t ch); // glyphs which are not in the atlas yet are loaded here
+	const bool hasGlyph(wchar_t ch) const; // (only checks already loaded glyphs)
+
+	UString getCacheFilePath(); // see r_font_cache, "" if the font file can't be read
 
 	// ILLEGAL:
 	inline TextureAtlas *getTextureAtlas() const {return m_textureAtlas;}
 
 protected:
-	void constructor(std::vector<wchar_t> characters, int fontSize, bool antialiasing, int fontDPI);
+	struct TEXT_LAYOUT_PAGE
+	{
+		unsigned int atlasPage;
+		VertexArrayObject *vao;
+	};
+
+	struct TEXT_LAYOUT
+	{
+		McFont *font;
+		UString text;
+		std::vector<TEXT_LAYOUT_PAGE> pages; // only the atlas pages which are actually used, empty if there is nothing visible (e.g. only spaces)
+		float width;
+		size_t memorySize;
+		std::list<TEXT_LAYOUT*>::iterator lruIterator;
+	};
+
+	static void evictTextLayout(TEXT_LAYOUT *layout);
+	static void evictTextLayouts(size_t maxMemorySize);
+
+	static std::list<TEXT_LAYOUT*> s_textLayoutLRU; // front = most recently used
+	static size_t s_iTextLayoutMemorySize;
+	static unsigned long s_iNumTextLayoutHits;
+	static unsigned long s_iNumTextLayoutMisses;
+	static unsigned long s_iNumTextLayoutEvictions;
+
+	struct DYNAMIC_SLOT
+	{
+		unsigned int atlasPage;
+		int x;
+		int y;
+		wchar_t character;				// 0 = free
+		unsigned long lastUse;			// m_iGlyphUseStamp
+		std::list<int>::iterator lruIterator;
+	};
+
+	struct SDF_RESOLVED_PAGE
+	{
+		unsigned int atlasPage;
+		int scaleBucket;
+		Image *image;
+		unsigned long lastUse;
+	};
+
+	void constructor(std::vector<wchar_t> characters, int fontSize, bool antialiasing, int fontDPI, bool signedDistanceField);
 
 	virtual void init();
 	virtual void initAsync();
 	virtual void destroy();
 
-	bool addGlyph(wchar_t ch);
+	bool initFreeType(std::string *cacheData); // rasterizes all preloaded glyphs into the atlas (and appends them to cacheData, if not NULL)
+	bool openFTFace(); // for glyphs which are loaded on first use, if the preloaded glyphs came from the cache
+	bool loadCache(const UString &cacheFilePath);
+	void saveCache(const UString &cacheFilePath, const std::string &glyphData);
 
-	void drawAtlasGlyph(Graphics *g, wchar_t ch);
+	bool addGlyph(wchar_t ch);
+	void setGlyphMetrics(wchar_t ch, const GLYPH_METRICS &metrics);
+	void removeGlyphMetrics(wchar_t ch);
+
+	// renders all m_vGlyphs on the job system (one freetype face per thread), packing happens afterwards in order, so the atlas always looks the same
+	void renderFTGlyphsToTextureAtlas(FT_FaceRec_ *face, int renderSize, std::string *cacheData);
+
+	bool loadDynamicGlyph(wchar_t ch);
+	int allocateDynamicSlot();
+	void touchDynamicSlot(int slot);
+	void addDynamicPage();
+	void updateDynamicPages();
+	Image *getAtlasPageImage(unsigned int atlasPage) const;
+
+	// sdf rendering: either through a shader, or by resolving the distances into plain alpha on the cpu for the current scale (renderers without custom shaders, e.g. the software renderer)
+	void beginSDF(Graphics *g);
+	void endSDF();
+	Image *getDrawPageImage(unsigned int atlasPage); // the image which has to be bound for drawing the glyphs of this page
+	Image *getSDFResolvedPageImage(unsigned int atlasPage, int scaleBucket);
+	void clearSDFResolvedPages(int atlasPage = -1); // -1 = all
+
+	float buildStringGeometry(const UString &text); // into m_pageVAOs, returns the width
+	TEXT_LAYOUT *getTextLayout(const UString &text);
+	void clearTextLayouts();
+	void drawAtlasGlyph(Graphics *g, wchar_t ch); // one draw per glyph, only used by r_drawstring_batched 0
 
 	int m_iFontSize;
 	bool m_bAntialiasing;
 	int m_iFontDPI;
+	bool m_bSignedDistanceField;
 
 	// glyphs
 	TextureAtlas *m_textureAtlas;
@@ -81,13 +186,39 @@ protected:
 	std::vector<wchar_t> m_vGlyphs;
 	std::unordered_map<wchar_t, bool> m_vGlyphExistence;
 	std::unordered_map<wchar_t, GLYPH_METRICS> m_vGlyphMetrics;
+	std::vector<GLYPH_METRICS*> m_flatGlyphMetrics; // NUM_FLAT_GLYPHS pointers into m_vGlyphMetrics (NULL = not loaded)
 
 	float m_fHeight;
 
+	// dynamic glyphs (the face is kept open after init() for these, or opened on first use if the preloaded glyphs came from the cache)
+	FT_LibraryRec_ *m_ftLibrary;
+	FT_FaceRec_ *m_ftFace;
+	bool m_bFTFaceFailed;
+
+	std::vector<Image*> m_dynamicPages; // atlas pages 1+, each one is a grid of equally sized slots
+	std::vector<bool> m_dynamicPagesDirty;
+	std::vector<DYNAMIC_SLOT> m_dynamicSlots;
+	std::vector<int> m_freeDynamicSlots;
+	std::list<int> m_dynamicSlotLRU; // front = most recently used
+	std::unordered_set<wchar_t> m_missingGlyphs;
+	int m_iDynamicPageSize;
+	int m_iDynamicSlotWidth;
+	int m_iDynamicSlotHeight;
+	unsigned long m_iGlyphUseStamp;
+	unsigned long m_iNumGlyphEvictions;
+
 	GLYPH_METRICS m_errorGlyph;
 
 	// rendering
+	std::vector<VertexArrayObject*> m_pageVAOs; // index = atlas page
 	Matrix4 m_worldMatrixBackup;
+
+	bool m_bSDFShaderActive;
+	int m_iSDFScaleBucket;
+	unsigned long m_iSDFResolveStamp;
+	std::vector<SDF_RESOLVED_PAGE> m_sdfResolvedPages;
+	static Shader *s_sdfShader;
+	std::unordered_map<UString, TEXT_LAYOUT*> m_textLayouts;
 };
 
 #endif
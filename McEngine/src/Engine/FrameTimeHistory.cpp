@@ -0,0 +1,144 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		ring buffer of per-frame update/paint/total times, with percentiles
+//
+// $NoKeywords: $frametime
+//===============================================================================//
+
+#include "FrameTimeHistory.h"
+#include "Engine.h"
+#include "ConVar.h"
+
+FrameTimeHistory::FrameTimeHistory(int capacity)
+{
+	m_iHead = 0;
+	m_iNumFrames = 0;
+
+	setCapacity(capacity);
+}
+
+void FrameTimeHistory::add(double update, double paint, double total)
+{
+	FRAME &frame = m_frames[m_iHead];
+	frame.update = (float)update;
+	frame.paint = (float)paint;
+	frame.total = (float)total;
+
+	m_iHead = (m_iHead + 1) % (int)m_frames.size();
+	m_iNumFrames = std::min(m_iNumFrames + 1, (int)m_frames.size());
+}
+
+void FrameTimeHistory::clear()
+{
+	m_iHead = 0;
+	m_iNumFrames = 0;
+}
+
+void FrameTimeHistory::setCapacity(int capacity)
+{
+	capacity = std::max(capacity, 1);
+	if (capacity == (int)m_frames.size()) return;
+
+	// keep as many of the most recent frames as possible
+	std::vector<FRAME> frames(capacity);
+	const int numFrames = std::min(m_iNumFrames, capacity);
+	for (int i=0; i<numFrames; i++)
+	{
+		frames[numFrames - 1 - i] = getFrame(i);
+	}
+
+	m_frames.swap(frames);
+	m_iNumFrames = numFrames;
+	m_iHead = numFrames % capacity;
+}
+
+const FrameTimeHistory::FRAME &FrameTimeHistory::getFrame(int age) const
+{
+	const int size = (int)m_frames.size();
+	return m_frames[(((m_iHead - 1 - age) % size) + size) % size];
+}
+
+FrameTimeHistory::PERCENTILES FrameTimeHistory::getPercentiles(TYPE type, int numFrames) const
+{
+	PERCENTILES percentiles;
+	percentiles.p50 = 0.0f;
+	percentiles.p95 = 0.0f;
+	percentiles.p99 = 0.0f;
+	percentiles.max = 0.0f;
+
+	if (numFrames < 0 || numFrames > m_iNumFrames)
+		numFrames = m_iNumFrames;
+	if (numFrames < 1)
+		return percentiles;
+
+	m_sortBuffer.resize(numFrames);
+	for (int i=0; i<numFrames; i++)
+	{
+		const FRAME &frame = getFrame(i);
+		switch (type)
+		{
+		case TYPE::UPDATE:
+			m_sortBuffer[i] = frame.update;
+			break;
+		case TYPE::PAINT:
+			m_sortBuffer[i] = frame.paint;
+			break;
+		case TYPE::TOTAL:
+			m_sortBuffer[i] = frame.total;
+			break;
+		}
+	}
+	std::sort(m_sortBuffer.begin(), m_sortBuffer.end());
+
+	// nearest rank
+	const auto rank = [numFrames](float percentile) -> int {
+		return clamp<int>((int)std::ceil(percentile * numFrames) - 1, 0, numFrames - 1);
+	};
+
+	percentiles.p50 = m_sortBuffer[rank(0.50f)];
+	percentiles.p95 = m_sortBuffer[rank(0.95f)];
+	percentiles.p99 = m_sortBuffer[rank(0.99f)];
+	percentiles.max = m_sortBuffer[numFrames - 1];
+
+	return percentiles;
+}
+
+
+
+//**********************************//
+//	FrameTimeHistory ConCommands	//
+//**********************************//
+
+void _frametime_stats(UString args)
+{
+	const FrameTimeHistory *history = engine->getFrameTimeHistory();
+
+	// all recorded frames by default (empty or invalid argument)
+	int numFrames = history->getNumFrames();
+	if (args.length() > 0 && args.toInt() > 0)
+		numFrames = std::min(args.toInt(), numFrames);
+
+	if (numFrames < 1)
+	{
+		debugLog("FrameTimeHistory: No frames recorded yet.\n");
+		return;
+	}
+
+	debugLog("FrameTimeHistory: Last %i frames (in ms):\n", numFrames);
+
+	const char *names[] = {"update", "paint", "total"};
+	const FrameTimeHistory::TYPE types[] = {FrameTimeHistory::TYPE::UPDATE, FrameTimeHistory::TYPE::PAINT, FrameTimeHistory::TYPE::TOTAL};
+	for (int i=0; i<3; i++)
+	{
+		const FrameTimeHistory::PERCENTILES p = history->getPercentiles(types[i], numFrames);
+		debugLog("    %-6s : p50 = %8.3f, p95 = %8.3f, p99 = %8.3f, max = %8.3f\n", names[i], p.p50*1000.0f, p.p95*1000.0f, p.p99*1000.0f, p.max*1000.0f);
+	}
+}
+
+void _frametime_reset(void)
+{
+	engine->getFrameTimeHistory()->clear();
+}
+
+ConVar _frametime_stats_("frametime_stats", _frametime_stats, ConVar::ARGS::ARGS_OPTIONAL);
+ConVar _frametime_reset_("frametime_reset", _frametime_reset);
@@ -0,0 +1,61 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		ring buffer of per-frame update/paint/total times, with percentiles
+//
+// $NoKeywords: $frametime
+//===============================================================================//
+
+#ifndef FRAMETIMEHISTORY_H
+#define FRAMETIMEHISTORY_H
+
+#include "cbase.h"
+
+class FrameTimeHistory
+{
+public:
+	enum class TYPE
+	{
+		UPDATE,
+		PAINT,
+		TOTAL
+	};
+
+	struct FRAME
+	{
+		float update;	// in seconds
+		float paint;	// in seconds
+		float total;	// in seconds, time between the end of the previous frame and the end of this one (includes the frame limiter)
+	};
+
+	struct PERCENTILES
+	{
+		float p50;
+		float p95;
+		float p99;
+		float max;
+	};
+
+public:
+	FrameTimeHistory(int capacity);
+
+	void add(double update, double paint, double total);
+	void clear();
+	void setCapacity(int capacity);
+
+	// 0 = most recent frame
+	const FRAME &getFrame(int age) const;
+	inline int getNumFrames() const {return m_iNumFrames;}
+	inline int getCapacity() const {return (int)m_frames.size();}
+
+	// over the most recent numFrames frames (-1 = all)
+	PERCENTILES getPercentiles(TYPE type, int numFrames = -1) const;
+
+private:
+	std::vector<FRAME> m_frames;
+	int m_iHead;
+	int m_iNumFrames;
+
+	mutable std::vector<float> m_sortBuffer;
+};
+
+#endif
@@ -10,6 +10,10 @@
 #include "Engine.h"
 #include "ConVar.h"
 #include "Camera.h"
+#include "Image.h"
+#include "SpriteBatch.h"
+#include "VertexArrayObject.h"
+#include "File.h"
 
 ConVar r_3dscene_zn("r_3dscene_zn", 5.0f);
 ConVar r_3dscene_zf("r_3dscene_zf", 5000.0f);
@@ -20,6 +24,8 @@ ConVar _r_debug_disable_cliprect("r_debug_disable_cliprect", false);
 ConVar _r_debug_disable_3dscene("r_debug_disable_3dscene", false);
 ConVar _r_debug_flush_drawstring("r_debug_flush_drawstring", false);
 ConVar _r_debug_drawimage("r_debug_drawimage", false);
+ConVar _r_batch_2d("r_batch_2d", true, "accumulate 2d primitives (fillRect(), drawImage(), etc.) into as few draw calls as possible, if the renderer supports it");
+ConVar _r_stats_history_size("r_stats_history_size", 2048, "number of frames which are kept for r_stats, r_stats_export and r_stats_overlay");
 
 ConVar *Graphics::r_globaloffset_x = &_r_globaloffset_x;
 ConVar *Graphics::r_globaloffset_y = &_r_globaloffset_y;
@@ -27,6 +33,8 @@ ConVar *Graphics::r_debug_disable_cliprect = &_r_debug_disable_cliprect;
 ConVar *Graphics::r_debug_disable_3dscene = &_r_debug_disable_3dscene;
 ConVar *Graphics::r_debug_flush_drawstring = &_r_debug_flush_drawstring;
 ConVar *Graphics::r_debug_drawimage = &_r_debug_drawimage;
+ConVar *Graphics::r_batch_2d = &_r_batch_2d;
+ConVar *Graphics::r_stats_history_size = &_r_stats_history_size;
 
 Graphics::Graphics()
 {
@@ -38,6 +46,26 @@ Graphics::Graphics()
 	// init 3d gui scene stack
 	m_bIs3dScene = false;
 	m_3dSceneStack.push(false);
+
+	// 2d batching is enabled by the renderer (if supported)
+	m_batch = NULL;
+	m_bFlushingBatch = false;
+
+	// statistics
+	m_frameStats = FRAME_STATS();
+	m_lastFrameStats = FRAME_STATS();
+	m_iFrameStatsHistoryHead = 0;
+	m_iNumFrameStatsHistory = 0;
+}
+
+Graphics::~Graphics()
+{
+	SAFE_DELETE(m_batch);
+}
+
+void Graphics::drawStringCached(McFont *font, const UString &text)
+{
+	drawString(font, text);
 }
 
 void Graphics::pushTransform()
@@ -224,22 +252,214 @@ void Graphics::updateTransform(bool force)
 {
 	if (!m_bTransformUpToDate || force)
 	{
-		Matrix4 worldMatrixTemp = m_worldTransformStack.top();
-		Matrix4 projectionMatrixTemp = m_projectionTransformStack.top();
-
-		// HACKHACK: 3d gui scenes
-		if (m_bIs3dScene)
-		{
-			worldMatrixTemp = m_3dSceneWorldMatrix * m_worldTransformStack.top();
-			projectionMatrixTemp = m_3dSceneProjectionMatrix;
-		}
+		Matrix4 worldMatrixTemp;
+		Matrix4 projectionMatrixTemp;
+		getTransform(projectionMatrixTemp, worldMatrixTemp);
 
 		onTransformUpdate(projectionMatrixTemp, worldMatrixTemp);
+		m_frameStats.numTransformUpdates++;
 
 		m_bTransformUpToDate = true;
 	}
 }
 
+void Graphics::getTransform(Matrix4 &projectionMatrix, Matrix4 &worldMatrix)
+{
+	// HACKHACK: 3d gui scenes
+	if (m_bIs3dScene)
+	{
+		worldMatrix = m_3dSceneWorldMatrix * m_worldTransformStack.top();
+		projectionMatrix = m_3dSceneProjectionMatrix;
+	}
+	else
+	{
+		worldMatrix = m_worldTransformStack.top();
+		projectionMatrix = m_projectionTransformStack.top();
+	}
+}
+
+void Graphics::flushBatch()
+{
+	if (m_batch == NULL || m_batch->isEmpty() || m_bFlushingBatch) return;
+
+	m_bFlushingBatch = true; // NOTE: binding images etc. while drawing the batch would otherwise flush again
+	{
+		// the vertices are already in world space, so only the projection matrix of the batch is applied
+		Matrix4 identity;
+		onTransformUpdate(m_batch->getProjectionMatrix(), identity);
+		m_frameStats.numTransformUpdates++;
+		m_bTransformUpToDate = true; // don't let drawVAO() apply the current world matrix again
+
+		drawBatch(m_batch->getVAO(), m_batch->getImage());
+
+		m_bTransformUpToDate = false;
+
+		m_frameStats.numBatchFlushes++;
+		m_batch->clear();
+	}
+	m_bFlushingBatch = false;
+}
+
+void Graphics::drawBatch(VertexArrayObject *vao, Image *image)
+{
+	if (image != NULL)
+		image->bind();
+
+	drawVAO(vao);
+
+	if (image != NULL)
+		image->unbind();
+}
+
+bool Graphics::isBatching() const
+{
+	return (m_batch != NULL && !m_bFlushingBatch && r_batch_2d->getBool());
+}
+
+bool Graphics::isBatchingRect()
+{
+	if (!isBatching() || m_bIs3dScene) return false;
+
+	// only translations keep the outline 1 pixel wide
+	const Matrix4 &worldMatrix = m_worldTransformStack.top();
+	return (worldMatrix[0] == 1.0f && worldMatrix[1] == 0.0f && worldMatrix[2] == 0.0f
+		 && worldMatrix[4] == 0.0f && worldMatrix[5] == 1.0f && worldMatrix[6] == 0.0f
+		 && worldMatrix[8] == 0.0f && worldMatrix[9] == 0.0f && worldMatrix[10] == 1.0f);
+}
+
+void Graphics::batchQuad(Image *image, const Vector2 *vertices, const Vector2 *texcoords, const Color *colors)
+{
+	Matrix4 projectionMatrix;
+	Matrix4 worldMatrix;
+	getTransform(projectionMatrix, worldMatrix);
+
+	const bool textured = (texcoords != NULL);
+	if (!m_batch->isCompatible(image, textured, projectionMatrix))
+	{
+		m_frameStats.numBatchTextureBreaks++;
+		flushBatch();
+	}
+	else if (m_batch->isFull())
+		flushBatch();
+
+	if (m_batch->isEmpty())
+		m_batch->begin(image, textured, projectionMatrix);
+
+	m_batch->addQuad(worldMatrix, vertices, texcoords, colors);
+	m_frameStats.numBatchedQuads++;
+}
+
+void Graphics::batchRect(int x, int y, int width, int height, const Color *colors)
+{
+	const Vector2 vertices[4] =
+	{
+		Vector2(x, y),
+		Vector2(x, y + height),
+		Vector2(x + width, y + height),
+		Vector2(x + width, y)
+	};
+	batchQuad(NULL, vertices, NULL, colors);
+}
+
+void Graphics::beginFrameStats()
+{
+	// anything drawn outside of beginScene()/endScene() (e.g. while loading) is not part of any frame
+	m_frameStats = FRAME_STATS();
+	m_frameStats.frame = engine->getFrameCount();
+}
+
+void Graphics::endFrameStats()
+{
+	m_lastFrameStats = m_frameStats;
+
+	const int capacity = std::max(r_stats_history_size->getInt(), 1);
+	if (capacity != (int)m_frameStatsHistory.size())
+	{
+		m_frameStatsHistory = std::vector<FRAME_STATS>(capacity);
+		m_iFrameStatsHistoryHead = 0;
+		m_iNumFrameStatsHistory = 0;
+	}
+
+	m_frameStatsHistory[m_iFrameStatsHistoryHead] = m_frameStats;
+	m_iFrameStatsHistoryHead = (m_iFrameStatsHistoryHead + 1) % capacity;
+	m_iNumFrameStatsHistory = std::min(m_iNumFrameStatsHistory + 1, capacity);
+}
+
+const char *Graphics::FRAME_STATS::getCounterName(int index)
+{
+	static const char *names[NUM_COUNTERS] = {"draw calls", "vertices", "texture binds", "shader changes", "rendertarget changes", "clip changes", "transform updates", "batched quads", "batch flushes", "batch texture breaks"};
+	return (index >= 0 && index < NUM_COUNTERS ? names[index] : "");
+}
+
+int Graphics::FRAME_STATS::getCounter(int index) const
+{
+	switch (index)
+	{
+	case 0:
+		return numDrawCalls;
+	case 1:
+		return numVertices;
+	case 2:
+		return numTextureBinds;
+	case 3:
+		return numShaderChanges;
+	case 4:
+		return numRenderTargetChanges;
+	case 5:
+		return numClipChanges;
+	case 6:
+		return numTransformUpdates;
+	case 7:
+		return numBatchedQuads;
+	case 8:
+		return numBatchFlushes;
+	case 9:
+		return numBatchTextureBreaks;
+	}
+
+	return 0;
+}
+
+const Graphics::FRAME_STATS &Graphics::getFrameStatsHistory(int age) const
+{
+	if (m_iNumFrameStatsHistory < 1) return m_lastFrameStats;
+
+	age = clamp<int>(age, 0, m_iNumFrameStatsHistory - 1);
+	const int size = (int)m_frameStatsHistory.size();
+	return m_frameStatsHistory[(((m_iFrameStatsHistoryHead - 1 - age) % size) + size) % size];
+}
+
+int Graphics::getFrameStatsSummary(int numFrames, FRAME_STATS &last, double *avg, int *max) const
+{
+	numFrames = std::min(numFrames, m_iNumFrameStatsHistory);
+
+	for (int c=0; c<FRAME_STATS::NUM_COUNTERS; c++)
+	{
+		avg[c] = 0.0;
+		max[c] = 0;
+	}
+
+	last = getFrameStatsHistory(0);
+	if (numFrames < 1) return 0;
+
+	for (int i=0; i<numFrames; i++)
+	{
+		const FRAME_STATS &stats = getFrameStatsHistory(i);
+		for (int c=0; c<FRAME_STATS::NUM_COUNTERS; c++)
+		{
+			avg[c] += stats.getCounter(c);
+			max[c] = std::max(max[c], stats.getCounter(c));
+		}
+	}
+
+	for (int c=0; c<FRAME_STATS::NUM_COUNTERS; c++)
+	{
+		avg[c] /= numFrames;
+	}
+
+	return numFrames;
+}
+
 void Graphics::checkStackLeaks()
 {
 	if (m_worldTransformStack.size() > 1)
@@ -283,5 +503,98 @@ void _mat_wireframe(UString oldValue, UString newValue)
 	engine->getGraphics()->setWireframe(newValue.toFloat() > 0.0f);
 }
 
+void _batch_stats(void)
+{
+	if (engine->getGraphics()->getBatch() == NULL)
+	{
+		debugLog("This renderer does not support 2d batching.\n");
+		return;
+	}
+
+	const Graphics::FRAME_STATS &stats = engine->getGraphics()->getLastFrameStats();
+	debugLog("Batch: last frame: %i quads in %i draw call(s) (%i saved), %i caused by texture changes, %i by state changes, non-batched draws or the end of the frame\n", stats.numBatchedQuads, stats.numBatchFlushes, stats.numBatchedQuads - stats.numBatchFlushes, stats.numBatchTextureBreaks, stats.numBatchFlushes - stats.numBatchTextureBreaks);
+	if (!_r_batch_2d.getBool())
+		debugLog("Batch: r_batch_2d is disabled, every quad is drawn separately\n");
+}
+
+void _r_stats(UString args)
+{
+	const Graphics *g = engine->getGraphics();
+
+	int numFrames = g->getNumFrameStatsHistory();
+	if (args.length() > 0 && args.toInt() > 0)
+		numFrames = args.toInt();
+
+	// last frame, plus average and max over the requested range
+	Graphics::FRAME_STATS last;
+	double avg[Graphics::FRAME_STATS::NUM_COUNTERS];
+	int max[Graphics::FRAME_STATS::NUM_COUNTERS];
+	numFrames = g->getFrameStatsSummary(numFrames, last, avg, max);
+
+	if (numFrames < 1)
+	{
+		debugLog("Graphics: No frames recorded yet.\n");
+		return;
+	}
+
+	debugLog("Graphics: Frame %lu, last %i frames:\n", last.frame, numFrames);
+	for (int c=0; c<Graphics::FRAME_STATS::NUM_COUNTERS; c++)
+	{
+		debugLog("    %-20s : last = %7i, avg = %9.1f, max = %7i\n", Graphics::FRAME_STATS::getCounterName(c), last.getCounter(c), avg[c], max[c]);
+	}
+}
+
+void _r_stats_export(UString args)
+{
+	const Graphics *g = engine->getGraphics();
+
+	if (g->getNumFrameStatsHistory() < 1)
+	{
+		debugLog("Graphics: No frames recorded yet.\n");
+		return;
+	}
+
+	UString filePath = args.trim();
+	if (filePath.length() < 1)
+		filePath = "r_stats.csv";
+
+	// header, counter names with underscores
+	std::string csv = "frame";
+	for (int c=0; c<Graphics::FRAME_STATS::NUM_COUNTERS; c++)
+	{
+		std::string name = Graphics::FRAME_STATS::getCounterName(c);
+		std::replace(name.begin(), name.end(), ' ', '_');
+		csv.append(",");
+		csv.append(name);
+	}
+	csv.append("\n");
+
+	// oldest frame first
+	for (int i=g->getNumFrameStatsHistory()-1; i>=0; i--)
+	{
+		const Graphics::FRAME_STATS &stats = g->getFrameStatsHistory(i);
+		csv.append(std::to_string(stats.frame));
+		for (int c=0; c<Graphics::FRAME_STATS::NUM_COUNTERS; c++)
+		{
+			csv.append(",");
+			csv.append(std::to_string(stats.getCounter(c)));
+		}
+		csv.append("\n");
+	}
+
+	File file(filePath, File::TYPE::WRITE);
+	if (!file.canWrite())
+	{
+		debugLog("Graphics: Couldn't write to file \"%s\"!\n", filePath.toUtf8());
+		return;
+	}
+	file.write(csv.c_str(), csv.length());
+
+	debugLog("Graphics: Exported %i frames to \"%s\"\n", g->getNumFrameStatsHistory(), filePath.toUtf8());
+}
+
 ConVar _mat_wireframe_("mat_wireframe", false, _mat_wireframe);
 ConVar _vsync_("vsync", false, _vsync);
+ConVar _batch_stats_("batch_stats", _batch_stats);
+ConVar _r_stats_("r_stats", _r_stats, ConVar::ARGS::ARGS_OPTIONAL);
+ConVar _r_stats_export_("r_stats_export", _r_stats_export, ConVar::ARGS::ARGS_OPTIONAL);
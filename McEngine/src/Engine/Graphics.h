@@ -24,6 +24,7 @@ class Shader;
 class RenderTarget;
 
 class VertexArrayObject;
+class SpriteBatch;
 
 typedef uint32_t Color;
 
@@ -75,9 +76,31 @@ public:
 		FILTER_MODE_MIPMAP
 	};
 
+	struct FRAME_STATS
+	{
+		unsigned long frame;		// engine frame count
+
+		int numDrawCalls;			// every draw submitted to the api, including flushed batches
+		int numVertices;
+		int numTextureBinds;		// images and rendertargets
+		int numShaderChanges;
+		int numRenderTargetChanges;
+		int numClipChanges;			// setClipRect()
+		int numTransformUpdates;	// matrices sent to the api
+
+		int numBatchedQuads;
+		int numBatchFlushes;
+		int numBatchTextureBreaks;	// flushes caused by a different texture (or projection matrix), the rest is caused by state changes and non-batched draws
+
+		// all counters by index, for printing/exporting
+		static const int NUM_COUNTERS = 10;
+		static const char *getCounterName(int index);
+		int getCounter(int index) const;
+	};
+
 public:
 	Graphics();
-	virtual ~Graphics() {}
+	virtual ~Graphics();
 
 	// scene
 	virtual void beginScene() = 0;
@@ -108,6 +131,7 @@ public:
 	// 2d resource drawing
 	virtual void drawImage(Image *image) = 0;
 	virtual void drawString(McFont *font, UString text) = 0;
+	virtual void drawStringCached(McFont *font, const UString &text); // baked text layouts (see McFont::drawStringCached()), renderers which can't draw baked vaos just use drawString()
 
 	// 3d type drawing
 	virtual void drawVAO(VertexArrayObject *vao) = 0;
@@ -142,6 +166,7 @@ public:
 	virtual UString getVersion() = 0;
 	virtual int getVRAMTotal() = 0;
 	virtual int getVRAMRemaining() = 0;
+	virtual bool supportsCustomShaders() const {return false;} // whether an enabled Shader replaces the builtin one for all following draw calls (e.g. for font effects)
 
 	// callbacks
 	virtual void onResolutionChange(Vector2 newResolution) = 0;
@@ -189,6 +214,22 @@ public:
 	void rotate3DScene(float rotx, float roty, float rotz);
 	void offset3DScene(float x, float y, float z = 0);
 
+	// 2d batching
+	void flushBatch(); // draws all queued 2d primitives, must be called before changing renderer state directly (i.e. not through Graphics/Image/Shader/RenderTarget)
+	inline SpriteBatch *getBatch() const {return m_batch;}
+
+	// statistics (counted by the renderer and its resources, see r_stats)
+	inline void countDrawCall(int numVertices) {m_frameStats.numDrawCalls++; m_frameStats.numVertices += numVertices;}
+	inline void countTextureBind() {m_frameStats.numTextureBinds++;}
+	inline void countShaderChange() {m_frameStats.numShaderChanges++;}
+	inline void countRenderTargetChange() {m_frameStats.numRenderTargetChanges++;}
+	inline void countClipChange() {m_frameStats.numClipChanges++;}
+
+	inline const FRAME_STATS &getLastFrameStats() const {return m_lastFrameStats;}
+	const FRAME_STATS &getFrameStatsHistory(int age) const; // 0 = last finished frame
+	inline int getNumFrameStatsHistory() const {return m_iNumFrameStatsHistory;}
+	int getFrameStatsSummary(int numFrames, FRAME_STATS &last, double *avg, int *max) const; // avg/max of every counter over the most recent numFrames (arrays of FRAME_STATS::NUM_COUNTERS), returns the actual number of frames
+
 protected:
 	static ConVar *r_globaloffset_x;
 	static ConVar *r_globaloffset_y;
@@ -196,15 +237,30 @@ protected:
 	static ConVar *r_debug_disable_3dscene;
 	static ConVar *r_debug_flush_drawstring;
 	static ConVar *r_debug_drawimage;
+	static ConVar *r_batch_2d;
+	static ConVar *r_stats_history_size;
 
 protected:
 	virtual void init() = 0; // must be called after the OS implementation constructor
 	virtual void onTransformUpdate(Matrix4 &projectionMatrix, Matrix4 &worldMatrix) = 0; // called if the matrices have changed and need to be applied
 
 	void updateTransform(bool force = false);
+	void getTransform(Matrix4 &projectionMatrix, Matrix4 &worldMatrix);
 
 	void checkStackLeaks();
 
+	// 2d batching (backends which support it create m_batch, and queue their quads instead of drawing them directly)
+	virtual void drawBatch(VertexArrayObject *vao, Image *image); // draws a flushed batch, the vertices are already in world space
+	bool isBatching() const; // whether batchQuad() may be used
+	bool isBatchingRect(); // drawRect() outlines are only batched as quads if they would cover the same pixels as lines
+	void batchQuad(Image *image, const Vector2 *vertices, const Vector2 *texcoords, const Color *colors); // texcoords NULL = untextured, image NULL = uses whatever is currently bound
+	void batchRect(int x, int y, int width, int height, Color color) {Color colors[4] = {color, color, color, color}; batchRect(x, y, width, height, colors);}
+	void batchRect(int x, int y, int width, int height, const Color *colors);
+
+	// statistics
+	void beginFrameStats(); // must be called by beginScene()
+	void endFrameStats(); // must be called by endScene(), after the last draw (i.e. after flushBatch())
+
 	friend class Engine;
 	friend class OpenVRInterface;
 
@@ -220,6 +276,17 @@ protected:
 	Vector3 m_v3dSceneOffset;
 	Matrix4 m_3dSceneWorldMatrix;
 	Matrix4 m_3dSceneProjectionMatrix;
+
+	// 2d batching
+	SpriteBatch *m_batch;
+	bool m_bFlushingBatch;
+
+	// statistics
+	FRAME_STATS m_frameStats;
+	FRAME_STATS m_lastFrameStats;
+	std::vector<FRAME_STATS> m_frameStatsHistory;
+	int m_iFrameStatsHistoryHead;
+	int m_iNumFrameStatsHistory;
 };
 
 #endif
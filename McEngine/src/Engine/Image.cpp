@@ -75,15 +75,9 @@ Image::Image(int width, int height, bool mipmapped, bool keepInSystemMemory) : R
 	m_bHasAlphaChannel = true;
 	m_bCreatedImage = true;
 
-	// reserve and fill with pink pixels
-	m_rawImage.resize(4*m_iWidth*m_iHeight);
-	for (int i=0; i<m_iWidth*m_iHeight; i++)
-	{
-		m_rawImage.push_back(255);
-		m_rawImage.push_back(0);
-		m_rawImage.push_back(255);
-		m_rawImage.push_back(255);
-	}
+	// transparent black
+	// NOTE: this used to push_back() pink pixels after the resize(), which doubled the buffer and only ever used the zeroed first half
+	m_rawImage.resize(4*m_iWidth*m_iHeight, 0);
 
 	m_bAsyncReady = true;
 }
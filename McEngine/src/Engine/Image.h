@@ -27,6 +27,8 @@ public:
 	Image(int width, int height, bool mipmapped = false, bool keepInSystemMemory = false);
 	virtual ~Image() {;}
 
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_IMAGE;}
+
 	virtual void bind(unsigned int textureUnit = 0) = 0;
 	virtual void unbind() = 0;
 
@@ -0,0 +1,747 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		work stealing thread pool (jobs, dependencies, parallel for, main thread continuations)
+//
+// $NoKeywords: $jobs
+//===============================================================================//
+
+#include "JobSystem.h"
+#include "Engine.h"
+#include "ConVar.h"
+#include "Profiler.h"
+#include "Logger.h"
+
+#include <deque>
+#include <math.h>
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+#include <mutex>
+#include <thread>
+#include "WinMinGW.Mutex.h"
+#include "Horizon.Mutex.h"
+
+#endif
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+#include <pthread.h>
+
+#endif
+
+void _job_workers_(UString oldValue, UString newValue);
+ConVar job_workers("job_workers", -1, "number of job system worker threads (-1 = number of cores - 1, 0 = run all jobs on the main thread)", _job_workers_);
+
+void _job_workers_(UString oldValue, UString newValue)
+{
+	if (engine != NULL && engine->getJobSystem() != NULL)
+		engine->getJobSystem()->setNumWorkers(newValue.toInt());
+}
+
+struct JobSystem::JOB
+{
+	JOB_FUNCTION function;
+	bool mainThread;
+
+	std::atomic<int> numPendingDependencies;
+	std::atomic<bool> finished;
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::mutex dependentsMutex;
+
+#endif
+
+	std::vector<std::shared_ptr<JOB>> dependents; // jobs which are waiting for this one
+};
+
+struct JobSystem::WORKER
+{
+	JobSystem *jobSystem;
+	int index;
+	unsigned int randomSeed;
+	std::atomic<bool> stop;
+
+	std::deque<std::shared_ptr<JOB>> queue; // the owner pushes/pops at the back, thieves pop at the front
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::mutex queueMutex;
+
+#endif
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	pthread_t thread;
+
+#endif
+};
+
+// the shared queue for all jobs which are not spawned by a worker, and the main thread queue
+std::deque<std::shared_ptr<JobSystem::JOB>> g_jobSystemSharedQueue;
+std::deque<std::shared_ptr<JobSystem::JOB>> g_jobSystemMainThreadQueue;
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+std::mutex g_jobSystemSharedQueueMutex;
+std::mutex g_jobSystemMainThreadQueueMutex;
+std::thread::id g_jobSystemMainThreadId;
+
+#endif
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+pthread_mutex_t g_jobSystemSleepMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_jobSystemSleepCond = PTHREAD_COND_INITIALIZER;
+
+void *_jobSystemWorkerThread(void *data);
+
+#endif
+
+static thread_local JobSystem::WORKER *t_jobSystemWorker = NULL;
+
+
+
+bool JobSystem::JobHandle::isFinished() const
+{
+	return (m_job.get() == NULL || m_job->finished.load());
+}
+
+int JobSystem::getDefaultNumWorkers()
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	const int numCores = (int)std::thread::hardware_concurrency(); // NOTE: can be 0 if unknown
+	return std::max(numCores - 1, 1);
+
+#else
+
+	return 0;
+
+#endif
+}
+
+JobSystem::JobSystem()
+{
+	m_iNumQueuedJobs = 0;
+	m_iNumSleepingWorkers = 0;
+	m_iNumExecutedJobs = 0;
+	m_iNumStolenJobs = 0;
+	m_iNumMainThreadJobs = 0;
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	g_jobSystemMainThreadId = std::this_thread::get_id();
+
+#endif
+
+	setNumWorkers(job_workers.getInt());
+}
+
+JobSystem::~JobSystem()
+{
+	stopWorkers();
+
+	// the owners of these are already gone at this point, so don't execute anything anymore
+	const size_t numDiscardedJobs = g_jobSystemSharedQueue.size() + g_jobSystemMainThreadQueue.size();
+	if (numDiscardedJobs > 0)
+		logWarning(JOBS, "JobSystem: Discarding %i unfinished job(s)\n", (int)numDiscardedJobs);
+
+	g_jobSystemSharedQueue.clear();
+	g_jobSystemMainThreadQueue.clear();
+}
+
+void JobSystem::update()
+{
+	VPROF("JobSystem::update");
+
+	// only run the jobs which are already queued, new continuations scheduled by these will run during the next frame
+	// (so that a job chain can't lock up the main thread)
+	size_t numMainThreadJobs = 0;
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemMainThreadQueueMutex);
+
+#endif
+
+		numMainThreadJobs = g_jobSystemMainThreadQueue.size();
+	}
+
+	for (size_t i=0; i<numMainThreadJobs; i++)
+	{
+		if (!runMainThreadJob())
+			break;
+	}
+
+	// without workers, everything has to be done here
+	if (m_workers.size() < 1)
+	{
+		while (m_iNumQueuedJobs.load() > 0)
+		{
+			std::shared_ptr<JOB> job = findJob(NULL);
+			if (job.get() == NULL)
+				break;
+
+			execute(job);
+		}
+	}
+}
+
+JobSystem::JobHandle JobSystem::add(JOB_FUNCTION func, const JobHandle &dependency)
+{
+	std::vector<JobHandle> dependencies;
+	if (dependency.isValid())
+		dependencies.push_back(dependency);
+
+	return addInt(func, dependencies, false);
+}
+
+JobSystem::JobHandle JobSystem::add(JOB_FUNCTION func, const std::vector<JobHandle> &dependencies)
+{
+	return addInt(func, dependencies, false);
+}
+
+JobSystem::JobHandle JobSystem::addMainThread(JOB_FUNCTION func, const JobHandle &dependency)
+{
+	std::vector<JobHandle> dependencies;
+	if (dependency.isValid())
+		dependencies.push_back(dependency);
+
+	return addInt(func, dependencies, true);
+}
+
+JobSystem::JobHandle JobSystem::addMainThread(JOB_FUNCTION func, const std::vector<JobHandle> &dependencies)
+{
+	return addInt(func, dependencies, true);
+}
+
+JobSystem::JobHandle JobSystem::parallelFor(size_t begin, size_t end, size_t grainSize, RANGE_FUNCTION func, const JobHandle &dependency)
+{
+	const size_t numElements = (end > begin ? end - begin : 0);
+
+	// aim for a few chunks per thread, so that stealing can even out an uneven workload
+	if (grainSize < 1)
+		grainSize = std::max(numElements / (size_t)((m_workers.size() + 1) * 4), (size_t)1);
+
+	// shared, so that potentially expensive captures aren't copied for every single chunk
+	std::shared_ptr<RANGE_FUNCTION> sharedFunc = std::make_shared<RANGE_FUNCTION>(func);
+
+	std::vector<JobHandle> chunks;
+	chunks.reserve(numElements / grainSize + 1);
+	for (size_t start=begin; start<end; start+=std::min(grainSize, end - start))
+	{
+		const size_t chunkEnd = start + std::min(grainSize, end - start);
+		chunks.push_back(add([sharedFunc, start, chunkEnd]{ (*sharedFunc)(start, chunkEnd); }, dependency));
+	}
+
+	if (chunks.size() < 1 && dependency.isValid())
+		chunks.push_back(dependency);
+
+	return add([]{}, chunks);
+}
+
+void JobSystem::wait(const JobHandle &handle)
+{
+	if (!handle.isValid()) return;
+
+	VPROF("JobSystem::wait");
+
+	const bool isMain = isMainThread();
+	while (!handle.isFinished())
+	{
+		std::shared_ptr<JOB> job = findJob(t_jobSystemWorker);
+		if (job.get() != NULL)
+			execute(job);
+		else if (!(isMain && runMainThreadJob()))
+		{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+			std::this_thread::yield();
+
+#endif
+		}
+	}
+}
+
+void JobSystem::wait(const std::vector<JobHandle> &handles)
+{
+	for (size_t i=0; i<handles.size(); i++)
+	{
+		wait(handles[i]);
+	}
+}
+
+void JobSystem::setNumWorkers(int numWorkers)
+{
+	if (numWorkers < 0)
+		numWorkers = getDefaultNumWorkers();
+
+#ifndef MCENGINE_FEATURE_PTHREADS
+
+	numWorkers = 0; // HACKHACK: until I get around to writing an std::thread wrapper implementation
+
+#endif
+
+	if (numWorkers == (int)m_workers.size()) return;
+
+	stopWorkers();
+	startWorkers(numWorkers);
+
+	logInfo(JOBS, "JobSystem: Using %i worker thread(s)\n", (int)m_workers.size());
+}
+
+void JobSystem::printStats()
+{
+	size_t numMainThreadJobsQueued = 0;
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemMainThreadQueueMutex);
+
+#endif
+
+		numMainThreadJobsQueued = g_jobSystemMainThreadQueue.size();
+	}
+
+	logInfo(JOBS, "JobSystem: %i worker(s), %i queued job(s), %i queued main thread job(s)\n", (int)m_workers.size(), m_iNumQueuedJobs.load(), (int)numMainThreadJobsQueued);
+	logInfo(JOBS, "JobSystem: %lu executed job(s), %lu stolen, %lu on the main thread\n", m_iNumExecutedJobs.load(), m_iNumStolenJobs.load(), m_iNumMainThreadJobs.load());
+}
+
+bool JobSystem::isMainThread() const
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	return (std::this_thread::get_id() == g_jobSystemMainThreadId);
+
+#else
+
+	return true;
+
+#endif
+}
+
+JobSystem::JobHandle JobSystem::addInt(JOB_FUNCTION &func, const std::vector<JobHandle> &dependencies, bool mainThread)
+{
+	std::shared_ptr<JOB> job = std::make_shared<JOB>();
+	job->function.swap(func);
+	job->mainThread = mainThread;
+	job->finished = false;
+	job->numPendingDependencies = 1; // guard, so that the job can't be scheduled while the dependencies are still being registered
+
+	for (size_t i=0; i<dependencies.size(); i++)
+	{
+		JOB *dependency = dependencies[i].m_job.get();
+		if (dependency == NULL) continue;
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(dependency->dependentsMutex);
+
+#endif
+
+		if (!dependency->finished.load())
+		{
+			job->numPendingDependencies++;
+			dependency->dependents.push_back(job);
+		}
+	}
+
+	if (--job->numPendingDependencies == 0)
+		schedule(job);
+
+	return JobHandle(job);
+}
+
+void JobSystem::schedule(const std::shared_ptr<JOB> &job)
+{
+	if (job->mainThread)
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemMainThreadQueueMutex);
+
+#endif
+
+		g_jobSystemMainThreadQueue.push_back(job);
+		return;
+	}
+
+	WORKER *worker = t_jobSystemWorker;
+	if (worker != NULL && worker->jobSystem == this)
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(worker->queueMutex);
+
+#endif
+
+		worker->queue.push_back(job);
+	}
+	else
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemSharedQueueMutex);
+
+#endif
+
+		g_jobSystemSharedQueue.push_back(job);
+	}
+
+	m_iNumQueuedJobs++;
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	// NOTE: the sleeping counter is incremented before a worker checks the queued counter, so at least one side always sees the other
+	if (m_iNumSleepingWorkers.load() > 0)
+	{
+		pthread_mutex_lock(&g_jobSystemSleepMutex);
+		pthread_cond_signal(&g_jobSystemSleepCond);
+		pthread_mutex_unlock(&g_jobSystemSleepMutex);
+	}
+
+#endif
+}
+
+void JobSystem::execute(const std::shared_ptr<JOB> &job)
+{
+	{
+		VPROF("JobSystem::job");
+		job->function();
+	}
+
+	job->function = nullptr; // release all captures as early as possible
+
+	m_iNumExecutedJobs++;
+	finish(job);
+}
+
+void JobSystem::finish(const std::shared_ptr<JOB> &job)
+{
+	std::vector<std::shared_ptr<JOB>> dependents;
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(job->dependentsMutex);
+
+#endif
+
+		job->finished = true;
+		dependents.swap(job->dependents);
+	}
+
+	for (size_t i=0; i<dependents.size(); i++)
+	{
+		if (--dependents[i]->numPendingDependencies == 0)
+			schedule(dependents[i]);
+	}
+}
+
+std::shared_ptr<JobSystem::JOB> JobSystem::findJob(WORKER *worker)
+{
+	if (m_iNumQueuedJobs.load() < 1)
+		return std::shared_ptr<JOB>();
+
+	// 1) own queue, newest first
+	if (worker != NULL)
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(worker->queueMutex);
+
+#endif
+
+		if (worker->queue.size() > 0)
+		{
+			std::shared_ptr<JOB> job = worker->queue.back();
+			worker->queue.pop_back();
+			m_iNumQueuedJobs--;
+			return job;
+		}
+	}
+
+	// 2) shared queue, oldest first
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemSharedQueueMutex);
+
+#endif
+
+		if (g_jobSystemSharedQueue.size() > 0)
+		{
+			std::shared_ptr<JOB> job = g_jobSystemSharedQueue.front();
+			g_jobSystemSharedQueue.pop_front();
+			m_iNumQueuedJobs--;
+			return job;
+		}
+	}
+
+	// 3) steal the oldest job of another worker, starting at a random victim so that thieves don't all fight over the same queue
+	const size_t numWorkers = m_workers.size();
+	if (numWorkers > 0)
+	{
+		size_t start = 0;
+		if (worker != NULL)
+		{
+			worker->randomSeed = worker->randomSeed * 1103515245 + 12345;
+			start = (worker->randomSeed >> 16) % numWorkers;
+		}
+
+		for (size_t i=0; i<numWorkers; i++)
+		{
+			WORKER *victim = m_workers[(start + i) % numWorkers];
+			if (victim == worker) continue;
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+			std::lock_guard<std::mutex> lk(victim->queueMutex);
+
+#endif
+
+			if (victim->queue.size() > 0)
+			{
+				std::shared_ptr<JOB> job = victim->queue.front();
+				victim->queue.pop_front();
+				m_iNumQueuedJobs--;
+				m_iNumStolenJobs++;
+				return job;
+			}
+		}
+	}
+
+	return std::shared_ptr<JOB>();
+}
+
+bool JobSystem::runMainThreadJob()
+{
+	std::shared_ptr<JOB> job;
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemMainThreadQueueMutex);
+
+#endif
+
+		if (g_jobSystemMainThreadQueue.size() < 1)
+			return false;
+
+		job = g_jobSystemMainThreadQueue.front();
+		g_jobSystemMainThreadQueue.pop_front();
+	}
+
+	m_iNumMainThreadJobs++;
+	execute(job);
+	return true;
+}
+
+void JobSystem::runWorker(WORKER *worker)
+{
+	t_jobSystemWorker = worker;
+	Profiler::setThreadName(UString::format("job worker %i", worker->index).toUtf8());
+
+	while (!worker->stop.load())
+	{
+		std::shared_ptr<JOB> job = findJob(worker);
+		if (job.get() != NULL)
+		{
+			execute(job);
+			continue;
+		}
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+		// nothing to do, sleep until something is scheduled
+		pthread_mutex_lock(&g_jobSystemSleepMutex);
+		{
+			m_iNumSleepingWorkers++;
+			while (m_iNumQueuedJobs.load() < 1 && !worker->stop.load())
+			{
+				pthread_cond_wait(&g_jobSystemSleepCond, &g_jobSystemSleepMutex);
+			}
+			m_iNumSleepingWorkers--;
+		}
+		pthread_mutex_unlock(&g_jobSystemSleepMutex);
+
+#endif
+	}
+
+	t_jobSystemWorker = NULL;
+}
+
+void JobSystem::startWorkers(int numWorkers)
+{
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	for (int i=0; i<numWorkers; i++)
+	{
+		WORKER *worker = new WORKER();
+		worker->jobSystem = this;
+		worker->index = i;
+		worker->randomSeed = (unsigned int)(i + 1) * 2654435761u;
+		worker->stop = false;
+
+		// NOTE: must be visible to all other workers before this one starts stealing
+		m_workers.push_back(worker);
+	}
+
+	for (size_t i=0; i<m_workers.size(); i++)
+	{
+		int ret = pthread_create(&m_workers[i]->thread, NULL, _jobSystemWorkerThread, (void*)m_workers[i]);
+		if (ret)
+		{
+			engine->showMessageError("JobSystem Error", UString::format("pthread_create() returned %i!", ret));
+
+			// run without the remaining workers
+			for (size_t w=i; w<m_workers.size(); w++)
+			{
+				delete m_workers[w];
+			}
+			m_workers.resize(i);
+			break;
+		}
+	}
+
+#endif
+}
+
+void JobSystem::stopWorkers()
+{
+	if (m_workers.size() < 1) return;
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	for (size_t i=0; i<m_workers.size(); i++)
+	{
+		m_workers[i]->stop = true;
+	}
+
+	pthread_mutex_lock(&g_jobSystemSleepMutex);
+	pthread_cond_broadcast(&g_jobSystemSleepCond);
+	pthread_mutex_unlock(&g_jobSystemSleepMutex);
+
+	for (size_t i=0; i<m_workers.size(); i++)
+	{
+		pthread_join(m_workers[i]->thread, NULL); // NOTE: workers finish their current job first
+	}
+
+#endif
+
+	// keep all remaining jobs around for the next set of workers (or for the main thread)
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_jobSystemSharedQueueMutex);
+
+#endif
+
+		for (size_t i=0; i<m_workers.size(); i++)
+		{
+			g_jobSystemSharedQueue.insert(g_jobSystemSharedQueue.end(), m_workers[i]->queue.begin(), m_workers[i]->queue.end());
+			delete m_workers[i];
+		}
+		m_workers.clear();
+	}
+}
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+void *_jobSystemWorkerThread(void *data)
+{
+	JobSystem::WORKER *worker = (JobSystem::WORKER*)data;
+	worker->jobSystem->runWorker(worker);
+	return NULL;
+}
+
+#endif
+
+
+
+//******************************//
+//	JobSystem ConCommands	//
+//******************************//
+
+void _job_stats(void)
+{
+	if (engine->getJobSystem() != NULL)
+		engine->getJobSystem()->printStats();
+}
+
+void _job_benchmark(UString args)
+{
+	JobSystem *jobSystem = engine->getJobSystem();
+	if (jobSystem == NULL) return;
+
+	int numJobs = args.toInt();
+	if (numJobs < 1)
+		numJobs = 100000;
+
+	logInfo(JOBS, "JobSystem: Benchmarking with %i worker(s) ...\n", jobSystem->getNumWorkers());
+
+	// 1) scheduling overhead of many tiny jobs
+	{
+		std::atomic<int> counter(0);
+		std::vector<JobSystem::JobHandle> handles;
+		handles.reserve(numJobs);
+
+		const double startTime = engine->getTimeReal();
+		for (int i=0; i<numJobs; i++)
+		{
+			handles.push_back(jobSystem->add([&counter]{ counter++; }));
+		}
+		jobSystem->wait(handles);
+		const double duration = engine->getTimeReal() - startTime;
+
+		logInfo(JOBS, "JobSystem: %i empty jobs took %.3f ms (%.3f us per job, counter = %i)\n", numJobs, duration*1000.0, (duration / (double)numJobs)*1000000.0, counter.load());
+	}
+
+	// 2) dependency chain, every job waits for the previous one
+	{
+		const int chainLength = std::max(numJobs / 10, 1);
+		int value = 0;
+
+		const double startTime = engine->getTimeReal();
+		JobSystem::JobHandle previous;
+		for (int i=0; i<chainLength; i++)
+		{
+			previous = jobSystem->add([&value]{ value++; }, previous);
+		}
+		// and hand the result back to the main thread
+		bool isMainThread = false;
+		jobSystem->wait(jobSystem->addMainThread([&isMainThread, jobSystem]{ isMainThread = jobSystem->isMainThread(); }, previous));
+		const double duration = engine->getTimeReal() - startTime;
+
+		logInfo(JOBS, "JobSystem: chain of %i dependent jobs + main thread continuation took %.3f ms (value = %i, continuation on main thread = %i)\n", chainLength, duration*1000.0, value, (int)isMainThread);
+	}
+
+	// 3) parallelFor vs. a plain loop
+	{
+		const size_t numElements = 1 << 22;
+		std::vector<float> data(numElements);
+
+		const double serialStartTime = engine->getTimeReal();
+		for (size_t i=0; i<numElements; i++)
+		{
+			data[i] = sqrtf((float)i) * sinf((float)i);
+		}
+		const double serialDuration = engine->getTimeReal() - serialStartTime;
+
+		const double parallelStartTime = engine->getTimeReal();
+		jobSystem->wait(jobSystem->parallelFor(0, numElements, 0, [&data](size_t start, size_t end)
+		{
+			for (size_t i=start; i<end; i++)
+			{
+				data[i] = sqrtf((float)i) * sinf((float)i);
+			}
+		}));
+		const double parallelDuration = engine->getTimeReal() - parallelStartTime;
+
+		logInfo(JOBS, "JobSystem: parallelFor over %i elements took %.3f ms, plain loop %.3f ms (%.2fx)\n", (int)numElements, parallelDuration*1000.0, serialDuration*1000.0, serialDuration / std::max(parallelDuration, 0.000001));
+	}
+
+	jobSystem->printStats();
+}
+
+ConVar _job_stats_("job_stats", _job_stats);
+ConVar _job_benchmark_("job_benchmark", _job_benchmark, ConVar::ARGS::ARGS_OPTIONAL);
@@ -0,0 +1,111 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		work stealing thread pool (jobs, dependencies, parallel for, main thread continuations)
+//
+// $NoKeywords: $jobs
+//===============================================================================//
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include "cbase.h"
+
+#include <functional>
+#include <memory>
+#include <atomic>
+
+// usage:
+// JobSystem::JobHandle decode = engine->getJobSystem()->add([=]{ decodeSomething(); });
+// engine->getJobSystem()->addMainThread([=]{ uploadSomething(); }, decode); // runs in Engine::onUpdate() once decode has finished
+//
+// every worker has its own queue, jobs spawned by a worker are pushed onto its own queue (LIFO, cache friendly),
+// jobs spawned by any other thread go into a shared queue, and idle workers steal from the other queues (FIFO)
+// without any workers (job_workers 0, or no thread support), everything is executed on the main thread in update() and wait()
+
+class JobSystem
+{
+public:
+	typedef std::function<void()> JOB_FUNCTION;
+	typedef std::function<void(size_t start, size_t end)> RANGE_FUNCTION;
+
+	struct JOB;
+	struct WORKER;
+
+	class JobHandle
+	{
+	public:
+		JobHandle() {;}
+
+		inline bool isValid() const {return m_job.get() != NULL;}
+		bool isFinished() const; // invalid handles count as finished
+
+	private:
+		friend class JobSystem;
+
+		JobHandle(const std::shared_ptr<JOB> &job) : m_job(job) {;}
+
+		std::shared_ptr<JOB> m_job;
+	};
+
+	static int getDefaultNumWorkers(); // number of cores - 1
+
+public:
+	JobSystem();
+	~JobSystem();
+
+	// main thread, runs all main thread jobs whose dependencies have finished (and all other jobs too, if there are no workers)
+	void update();
+
+	// runs func on any worker thread, after all dependencies have finished
+	JobHandle add(JOB_FUNCTION func, const JobHandle &dependency = JobHandle());
+	JobHandle add(JOB_FUNCTION func, const std::vector<JobHandle> &dependencies);
+
+	// runs func on the main thread during the next update(), after all dependencies have finished
+	JobHandle addMainThread(JOB_FUNCTION func, const JobHandle &dependency = JobHandle());
+	JobHandle addMainThread(JOB_FUNCTION func, const std::vector<JobHandle> &dependencies);
+
+	// splits [begin, end) into chunks of at most grainSize elements (0 = automatic), the returned handle finishes once all chunks are done
+	JobHandle parallelFor(size_t begin, size_t end, size_t grainSize, RANGE_FUNCTION func, const JobHandle &dependency = JobHandle());
+
+	// blocks until the job has finished, executes other queued jobs in the meantime (and main thread jobs, if called from the main thread)
+	void wait(const JobHandle &handle);
+	void wait(const std::vector<JobHandle> &handles);
+
+	// main thread only, stops and restarts all workers (queued jobs are kept)
+	// NOTE: no other thread must be adding/waiting while this is running
+	void setNumWorkers(int numWorkers);
+
+	void printStats();
+
+	inline int getNumWorkers() const {return (int)m_workers.size();}
+	inline int getNumQueuedJobs() const {return m_iNumQueuedJobs.load();}
+	bool isMainThread() const;
+
+	// internal
+	void runWorker(WORKER *worker);
+
+private:
+	JobHandle addInt(JOB_FUNCTION &func, const std::vector<JobHandle> &dependencies, bool mainThread);
+
+	void schedule(const std::shared_ptr<JOB> &job);
+	void execute(const std::shared_ptr<JOB> &job);
+	void finish(const std::shared_ptr<JOB> &job);
+
+	std::shared_ptr<JOB> findJob(WORKER *worker);
+	bool runMainThreadJob();
+
+	void startWorkers(int numWorkers);
+	void stopWorkers();
+
+	std::vector<WORKER*> m_workers;
+
+	std::atomic<int> m_iNumQueuedJobs; // excluding main thread jobs
+	std::atomic<int> m_iNumSleepingWorkers;
+
+	// stats
+	std::atomic<unsigned long> m_iNumExecutedJobs;
+	std::atomic<unsigned long> m_iNumStolenJobs;
+	std::atomic<unsigned long> m_iNumMainThreadJobs;
+};
+
+#endif
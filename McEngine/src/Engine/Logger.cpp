@@ -0,0 +1,519 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		thread safe logging (lock free message ring, sink thread, levels, categories)
+//
+// $NoKeywords: $log
+//===============================================================================//
+
+#include "Logger.h"
+#include "Engine.h"
+#include "ConVar.h"
+#include "Profiler.h"
+
+#include "Console.h"
+#include "ConsoleBox.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+#include <mutex>
+#include <thread>
+#include "WinMinGW.Mutex.h"
+#include "Horizon.Mutex.h"
+
+#endif
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+#include <pthread.h>
+
+#endif
+
+ConVar log_level("log_level", 1, "minimum severity which is logged (0 = debug, 1 = info, 2 = warning, 3 = error)");
+ConVar log_level_general("log_level_general", -1, "minimum severity for plain debugLog() messages (-1 = log_level)");
+ConVar log_level_engine("log_level_engine", -1, "minimum severity for engine messages (-1 = log_level)");
+ConVar log_level_resources("log_level_resources", -1, "minimum severity for resource messages (-1 = log_level)");
+ConVar log_level_graphics("log_level_graphics", -1, "minimum severity for graphics messages (-1 = log_level)");
+ConVar log_level_sound("log_level_sound", -1, "minimum severity for sound messages (-1 = log_level)");
+ConVar log_level_input("log_level_input", -1, "minimum severity for input messages (-1 = log_level)");
+ConVar log_level_network("log_level_network", -1, "minimum severity for network messages (-1 = log_level)");
+ConVar log_level_jobs("log_level_jobs", -1, "minimum severity for job system messages (-1 = log_level)");
+ConVar log_level_app("log_level_app", -1, "minimum severity for app messages (-1 = log_level)");
+ConVar log_sync("log_sync", false, "write every message immediately on the calling thread instead of going through the sink thread (slow, but nothing is lost on a crash)");
+
+// index = Logger::CATEGORY
+static ConVar *s_loggerCategoryLevels[Logger::NUM_CATEGORIES] =
+{
+	&log_level_general,
+	&log_level_engine,
+	&log_level_resources,
+	&log_level_graphics,
+	&log_level_sound,
+	&log_level_input,
+	&log_level_network,
+	&log_level_jobs,
+	&log_level_app
+};
+
+Logger::MESSAGE Logger::s_ring[Logger::RING_SIZE];
+std::atomic<size_t> Logger::s_iEnqueuePos(0);
+size_t Logger::s_iDequeuePos = 0;
+std::atomic<size_t> Logger::s_iNumProcessed(0);
+std::atomic<bool> Logger::s_bRunning(false);
+std::atomic<bool> Logger::s_bStopSink(false);
+std::atomic<bool> Logger::s_bSinkSleeping(false);
+std::atomic<unsigned long> Logger::s_iNumMessages(0);
+std::atomic<unsigned long> Logger::s_iNumLongMessages(0);
+std::atomic<unsigned long> Logger::s_iNumSyncFallbacks(0);
+std::atomic<unsigned long> Logger::s_iNumFilteredMessages(0);
+
+// everything which the sink has written out, but which the main thread still has to forward to the console(s)
+struct LOGGER_CONSOLE_MESSAGE
+{
+	std::string text;
+	Color color;
+};
+std::vector<LOGGER_CONSOLE_MESSAGE> g_loggerConsoleMessages;
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+std::mutex g_loggerConsoleMutex; // NOTE: only the sink and the main thread ever touch this (and producers if the ring is full)
+
+#endif
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+pthread_t g_loggerSinkThread;
+pthread_mutex_t g_loggerSinkSleepMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_loggerSinkSleepCond = PTHREAD_COND_INITIALIZER;
+
+void *_loggerSinkThread(void *data);
+
+#endif
+
+static void _loggerYield()
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::this_thread::yield();
+
+#endif
+}
+
+void Logger::start()
+{
+	if (s_bRunning.load()) return;
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	for (size_t i=0; i<RING_SIZE; i++)
+	{
+		s_ring[i].sequence.store(i, std::memory_order_relaxed);
+		s_ring[i].longText = NULL;
+	}
+	s_iEnqueuePos = 0;
+	s_iDequeuePos = 0;
+	s_iNumProcessed = 0;
+	s_bStopSink = false;
+
+	int ret = pthread_create(&g_loggerSinkThread, NULL, _loggerSinkThread, NULL);
+	if (ret)
+	{
+		printf("Logger: pthread_create() returned %i, logging synchronously!\n", ret);
+		return;
+	}
+
+	s_bRunning = true;
+
+#endif
+}
+
+void Logger::shutdown()
+{
+	if (!s_bRunning.load()) return;
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	// the sink drains the ring before exiting
+	s_bStopSink = true;
+	wakeSink();
+	pthread_join(g_loggerSinkThread, NULL);
+
+#endif
+
+	s_bRunning = false;
+
+	// forward the rest (to whatever still exists at this point)
+	update();
+}
+
+void Logger::update()
+{
+	std::vector<LOGGER_CONSOLE_MESSAGE> messages;
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_loggerConsoleMutex);
+
+#endif
+
+		if (g_loggerConsoleMessages.size() < 1) return;
+
+		messages.swap(g_loggerConsoleMessages);
+	}
+
+	if (engine == NULL) return;
+
+	for (size_t i=0; i<messages.size(); i++)
+	{
+		const UString text = UString(messages[i].text.c_str());
+
+		if (engine->getConsoleBox() != NULL)
+			engine->getConsoleBox()->log(text);
+		if (engine->getConsole() != NULL)
+			engine->getConsole()->log(text, messages[i].color);
+	}
+}
+
+void Logger::flush()
+{
+	if (!s_bRunning.load()) return;
+
+	const size_t target = s_iEnqueuePos.load();
+	while (s_iNumProcessed.load() < target && s_bRunning.load())
+	{
+		_loggerYield();
+	}
+}
+
+bool Logger::isEnabled(LEVEL level, CATEGORY category)
+{
+	int minLevel = s_loggerCategoryLevels[(int)category]->getInt();
+	if (minLevel < 0)
+		minLevel = log_level.getInt();
+
+	return ((int)level >= minLevel);
+}
+
+void Logger::log(LEVEL level, CATEGORY category, const char *fmt, ...)
+{
+	if (fmt == NULL) return;
+
+	va_list ap;
+	va_start(ap, fmt);
+
+	log(level, category, 0, fmt, ap);
+
+	va_end(ap);
+}
+
+void Logger::log(LEVEL level, CATEGORY category, Color color, const char *fmt, va_list args)
+{
+	if (fmt == NULL) return;
+
+	// filtered messages are never formatted
+	if (!isEnabled(level, category))
+	{
+		s_iNumFilteredMessages++;
+		return;
+	}
+
+	s_iNumMessages++;
+
+	if (s_bRunning.load())
+	{
+		if (!log_sync.getBool())
+		{
+			if (push(level, category, color, fmt, args))
+			{
+				wakeSink();
+				return;
+			}
+
+			s_iNumSyncFallbacks++;
+		}
+
+		flush(); // keep the order
+	}
+
+	// synchronous fallback (not started yet, log_sync, or the ring is full)
+	va_list ap;
+	va_copy(ap, args);
+
+	char buffer[1024];
+	const int numChars = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+	va_end(ap);
+
+	if (numChars < 0) return;
+
+	if (numChars >= (int)sizeof(buffer))
+	{
+		char *longBuffer = new char[numChars+1];
+
+		va_copy(ap, args);
+		vsnprintf(longBuffer, numChars+1, fmt, ap);
+		va_end(ap);
+
+		output(longBuffer, level, category, color, !s_bRunning.load());
+
+		delete[] longBuffer;
+	}
+	else
+		output(buffer, level, category, color, !s_bRunning.load());
+}
+
+bool Logger::push(LEVEL level, CATEGORY category, Color color, const char *fmt, va_list args)
+{
+	// bounded mpmc queue (D. Vyukov), used with a single consumer
+	// every slot carries a sequence number: == pos means free for the producer of pos, == pos+1 means ready for the consumer
+	MESSAGE *msg = NULL;
+	size_t pos = s_iEnqueuePos.load(std::memory_order_relaxed);
+	int numFullRetries = 0;
+	while (true)
+	{
+		msg = &s_ring[pos & (RING_SIZE - 1)];
+		const size_t sequence = msg->sequence.load(std::memory_order_acquire);
+		const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+		if (diff == 0)
+		{
+			if (s_iEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// full, give the sink a chance to catch up before falling back to writing synchronously
+			if (++numFullRetries > 64)
+				return false;
+
+			_loggerYield();
+			pos = s_iEnqueuePos.load(std::memory_order_relaxed);
+		}
+		else
+			pos = s_iEnqueuePos.load(std::memory_order_relaxed);
+	}
+
+	msg->level = level;
+	msg->category = category;
+	msg->color = color;
+	msg->longText = NULL;
+
+	va_list ap;
+	va_copy(ap, args);
+	const int numChars = vsnprintf(msg->text, INLINE_TEXT_SIZE, fmt, ap);
+	va_end(ap);
+
+	if (numChars < 0)
+		msg->text[0] = '\0';
+	else if (numChars >= INLINE_TEXT_SIZE)
+	{
+		s_iNumLongMessages++;
+
+		msg->longText = new char[numChars+1];
+
+		va_copy(ap, args);
+		vsnprintf(msg->longText, numChars+1, fmt, ap);
+		va_end(ap);
+	}
+
+	msg->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool Logger::pop()
+{
+	MESSAGE *msg = &s_ring[s_iDequeuePos & (RING_SIZE - 1)];
+	if (msg->sequence.load(std::memory_order_acquire) != s_iDequeuePos + 1)
+		return false; // empty (or the producer of this slot is still formatting)
+
+	output(msg->longText != NULL ? msg->longText : msg->text, msg->level, msg->category, msg->color, false);
+
+	if (msg->longText != NULL)
+	{
+		delete[] msg->longText;
+		msg->longText = NULL;
+	}
+
+	msg->sequence.store(s_iDequeuePos + RING_SIZE, std::memory_order_release);
+	s_iDequeuePos++;
+	s_iNumProcessed++;
+
+	return true;
+}
+
+void Logger::wakeSink()
+{
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	// NOTE: the sink sets the sleeping flag before checking the ring again, and producers publish their message before checking the flag, so at least one side always sees the other
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (s_bSinkSleeping.load())
+	{
+		pthread_mutex_lock(&g_loggerSinkSleepMutex);
+		pthread_cond_signal(&g_loggerSinkSleepCond);
+		pthread_mutex_unlock(&g_loggerSinkSleepMutex);
+	}
+
+#endif
+}
+
+void Logger::output(const char *text, LEVEL level, CATEGORY category, Color color, bool forwardToConsoleNow)
+{
+	const size_t numChars = strlen(text);
+	if (numChars < 1) return;
+
+	fwrite(text, 1, numChars, stdout);
+
+	if (numChars > 65534) return;
+
+	if (color == 0)
+	{
+		switch (level)
+		{
+		case LEVEL::LEVEL_DEBUG:
+			color = 0xffaaaaaa;
+			break;
+		case LEVEL::LEVEL_WARNING:
+			color = 0xffffcc44;
+			break;
+		case LEVEL::LEVEL_ERROR:
+			color = 0xffff4444;
+			break;
+		default:
+			color = 0xffffffff;
+			break;
+		}
+	}
+
+	if (forwardToConsoleNow)
+	{
+		// nothing is running in the background, so this is the old synchronous behavior
+		// WARNING: these calls here are not threadsafe by default
+		if (engine != NULL)
+		{
+			const UString actualBuffer = UString(text);
+
+			if (engine->getConsoleBox() != NULL)
+				engine->getConsoleBox()->log(actualBuffer);
+			if (engine->getConsole() != NULL)
+				engine->getConsole()->log(actualBuffer, color);
+		}
+	}
+	else
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_loggerConsoleMutex);
+
+#endif
+
+		LOGGER_CONSOLE_MESSAGE message;
+		message.text = text;
+		message.color = color;
+		g_loggerConsoleMessages.push_back(message);
+	}
+}
+
+void Logger::runSink()
+{
+	Profiler::setThreadName("log sink");
+
+	while (true)
+	{
+		const bool stop = s_bStopSink.load();
+
+		bool hasWork = false;
+		while (pop())
+		{
+			hasWork = true;
+		}
+
+		// NOTE: checked before draining, so that everything logged before shutdown() is still written out
+		if (stop) break;
+
+		if (!hasWork)
+		{
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+			// nothing to do, sleep until something is logged
+			pthread_mutex_lock(&g_loggerSinkSleepMutex);
+			{
+				s_bSinkSleeping = true;
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				while (s_ring[s_iDequeuePos & (RING_SIZE - 1)].sequence.load(std::memory_order_acquire) != s_iDequeuePos + 1 && !s_bStopSink.load())
+				{
+					pthread_cond_wait(&g_loggerSinkSleepCond, &g_loggerSinkSleepMutex);
+				}
+				s_bSinkSleeping = false;
+			}
+			pthread_mutex_unlock(&g_loggerSinkSleepMutex);
+
+#else
+
+			_loggerYield();
+
+#endif
+		}
+	}
+}
+
+void Logger::printStats()
+{
+	const size_t numQueued = s_iEnqueuePos.load() - s_iNumProcessed.load();
+
+	debugLog("Logger: %s, %i/%i slot(s) in use\n", (s_bRunning.load() ? (log_sync.getBool() ? "running (log_sync)" : "running") : "synchronous"), (int)numQueued, RING_SIZE);
+	debugLog("Logger: %lu message(s), %lu filtered, %lu long, %lu written synchronously because the ring was full\n", s_iNumMessages.load(), s_iNumFilteredMessages.load(), s_iNumLongMessages.load(), s_iNumSyncFallbacks.load());
+}
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+void *_loggerSinkThread(void *data)
+{
+	Logger::runSink();
+	return NULL;
+}
+
+#endif
+
+
+
+//**************************//
+//	Logger ConCommands	//
+//**************************//
+
+void _log_stats(void)
+{
+	Logger::printStats();
+}
+
+void _log_benchmark(UString args)
+{
+	int numMessages = args.toInt();
+	if (numMessages < 1)
+		numMessages = 100000;
+
+	// filtered messages, this is what e.g. a logDebug() in a hot loop costs by default
+	double startTime = engine->getTimeReal();
+	for (int i=0; i<numMessages; i++)
+	{
+		Logger::log(Logger::LEVEL::LEVEL_DEBUG, Logger::CATEGORY::CATEGORY_ENGINE, "log_benchmark %i %f\n", i, (float)i);
+	}
+	const double filteredDuration = engine->getTimeReal() - startTime;
+
+	// and what the caller pays for a message which is actually written (a few, to not flood the console)
+	const int numWrittenMessages = std::min(numMessages, 1000);
+	startTime = engine->getTimeReal();
+	for (int i=0; i<numWrittenMessages; i++)
+	{
+		Logger::log(Logger::LEVEL::LEVEL_ERROR, Logger::CATEGORY::CATEGORY_ENGINE, "log_benchmark %i %f\n", i, (float)i);
+	}
+	const double writtenDuration = engine->getTimeReal() - startTime;
+
+	Logger::flush();
+	debugLog("Logger: filtered = %.1f ns/message, written = %.1f ns/message (caller side)\n", (filteredDuration / (double)numMessages)*1000000000.0, (writtenDuration / (double)numWrittenMessages)*1000000000.0);
+}
+
+ConVar _log_stats_("log_stats", _log_stats);
+ConVar _log_benchmark_("log_benchmark", _log_benchmark, ConVar::ARGS::ARGS_OPTIONAL);
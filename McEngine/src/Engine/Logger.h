@@ -0,0 +1,108 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		thread safe logging (lock free message ring, sink thread, levels, categories)
+//
+// $NoKeywords: $log
+//===============================================================================//
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "cbase.h"
+
+#include <atomic>
+#include <stdarg.h>
+
+// usage:
+// logInfo(RESOURCES, "Loaded %s\n", name.toUtf8());
+// logDebug(JOBS, "Worker #%i is sleeping\n", index); // cheap if filtered out, nothing is formatted
+//
+// messages are formatted by the caller into a preallocated slot of a lock free ring (only very long messages allocate),
+// a sink thread then writes them to stdout, and the main thread forwards them to the console(s) during Engine::onUpdate()
+// log_sync 1 writes everything immediately instead (e.g. for debugging crashes, where the last messages would be lost)
+
+#define logDebug(category, format, ...) Logger::log(Logger::LEVEL::LEVEL_DEBUG, Logger::CATEGORY::CATEGORY_##category, format , ##__VA_ARGS__ )
+#define logInfo(category, format, ...) Logger::log(Logger::LEVEL::LEVEL_INFO, Logger::CATEGORY::CATEGORY_##category, format , ##__VA_ARGS__ )
+#define logWarning(category, format, ...) Logger::log(Logger::LEVEL::LEVEL_WARNING, Logger::CATEGORY::CATEGORY_##category, format , ##__VA_ARGS__ )
+#define logError(category, format, ...) Logger::log(Logger::LEVEL::LEVEL_ERROR, Logger::CATEGORY::CATEGORY_##category, format , ##__VA_ARGS__ )
+
+class Logger
+{
+public:
+	enum class LEVEL
+	{
+		LEVEL_DEBUG,
+		LEVEL_INFO,
+		LEVEL_WARNING,
+		LEVEL_ERROR
+	};
+
+	enum class CATEGORY
+	{
+		CATEGORY_GENERAL, // everything which goes through the plain debugLog()
+		CATEGORY_ENGINE,
+		CATEGORY_RESOURCES,
+		CATEGORY_GRAPHICS,
+		CATEGORY_SOUND,
+		CATEGORY_INPUT,
+		CATEGORY_NETWORK,
+		CATEGORY_JOBS,
+		CATEGORY_APP
+	};
+
+	static const int NUM_CATEGORIES = 9;
+
+	// main thread only
+	static void start();
+	static void shutdown();
+	static void update(); // forwards everything which the sink has processed to the console(s)
+
+	// blocks until everything which has been logged so far has been written out
+	static void flush();
+
+	static bool isEnabled(LEVEL level, CATEGORY category);
+
+	static void log(LEVEL level, CATEGORY category, const char *fmt, ...);
+	static void log(LEVEL level, CATEGORY category, Color color, const char *fmt, va_list args); // color 0 = default color of the level
+
+	static void printStats();
+
+	// internal
+	static void runSink();
+
+private:
+	static const int RING_SIZE = 2048; // must be a power of two
+	static const int INLINE_TEXT_SIZE = 248;
+
+	struct MESSAGE
+	{
+		std::atomic<size_t> sequence;
+		LEVEL level;
+		CATEGORY category;
+		Color color;
+		char *longText; // only for messages which don't fit into text, allocated by the producer and freed by the sink
+		char text[INLINE_TEXT_SIZE];
+	};
+
+	static bool push(LEVEL level, CATEGORY category, Color color, const char *fmt, va_list args);
+	static bool pop();
+	static void wakeSink();
+	static void output(const char *text, LEVEL level, CATEGORY category, Color color, bool forwardToConsoleNow);
+
+	static MESSAGE s_ring[RING_SIZE];
+	static std::atomic<size_t> s_iEnqueuePos;
+	static size_t s_iDequeuePos; // sink only
+	static std::atomic<size_t> s_iNumProcessed;
+
+	static std::atomic<bool> s_bRunning;
+	static std::atomic<bool> s_bStopSink;
+	static std::atomic<bool> s_bSinkSleeping;
+
+	// stats
+	static std::atomic<unsigned long> s_iNumMessages;
+	static std::atomic<unsigned long> s_iNumLongMessages;
+	static std::atomic<unsigned long> s_iNumSyncFallbacks;
+	static std::atomic<unsigned long> s_iNumFilteredMessages;
+};
+
+#endif
@@ -18,6 +18,11 @@
  */
 #define MCENGINE_FEATURE_PTHREADS
 
+/*
+ * VPROF scoped zone cpu profiler (toggled at runtime via vprof, costs a single branch per zone while disabled)
+ */
+#define MCENGINE_FEATURE_PROFILER
+
 /*
  * OpenGL graphics (Desktop, legacy + modern)
  */
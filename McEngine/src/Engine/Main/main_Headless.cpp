@@ -0,0 +1,109 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		headless entry point (no window, no display, no gpu)
+//
+// $NoKeywords: $main
+//===============================================================================//
+
+#ifdef __linux__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include "HeadlessEnvironment.h"
+#include "LinuxFramePacer.h"
+
+#define HEADLESS_WIDTH (1280)
+#define HEADLESS_HEIGHT (720)
+
+extern bool g_bRunning;
+
+volatile sig_atomic_t g_bHeadlessShutdownRequested = 0;
+
+ConVar headless_fps_max("headless_fps_max", 0.0f, "framerate limiter for headless mode, 0 = unlimited (run at full cpu speed)");
+
+void _headlessSignalHandler(int signal)
+{
+	// graceful shutdown on ctrl+c/kill, handled by the main loop after the current frame
+	g_bHeadlessShutdownRequested = 1;
+}
+
+int mainHeadless(int argc, char *argv[])
+{
+	// the engine only gets a single args string, so pass everything through
+	// renderer: "-sw" rasterizes everything into the software backbuffer, the default skips drawing entirely (NullGraphicsInterface)
+	UString args;
+	bool softwareRenderer = false;
+	for (int i=1; i<argc; i++)
+	{
+		if (i > 1)
+			args.append(" ");
+		args.append(argv[i]);
+
+		if (strcmp(argv[i], "-sw") == 0)
+			softwareRenderer = true;
+	}
+
+	signal(SIGINT, _headlessSignalHandler);
+	signal(SIGTERM, _headlessSignalHandler);
+
+	// create timers
+	LinuxFramePacer *framePacer = new LinuxFramePacer();
+
+	Timer *deltaTimer = new Timer();
+	deltaTimer->start();
+	deltaTimer->update();
+
+	// initialize engine
+	HeadlessEnvironment *environment = new HeadlessEnvironment(softwareRenderer, Vector2(HEADLESS_WIDTH, HEADLESS_HEIGHT));
+	Engine *headlessEngine = new Engine(environment, args.toUtf8());
+	headlessEngine->onFocusGained(); // there is no window manager, pretend we always have focus
+	headlessEngine->loadApp();
+
+	deltaTimer->update();
+
+	// main loop
+	while (g_bRunning)
+	{
+		if (g_bHeadlessShutdownRequested)
+		{
+			g_bHeadlessShutdownRequested = 0;
+			headlessEngine->onShutdown(); // NOTE: the app may refuse, same as closing a window
+			if (!g_bRunning)
+				break;
+		}
+
+		// update
+		{
+			deltaTimer->update();
+			headlessEngine->setFrameTime(deltaTimer->getDelta());
+			headlessEngine->onUpdate();
+		}
+
+		// draw
+		headlessEngine->onPaint();
+
+		// delay the next frame (only if requested, unlimited by default)
+		if (headless_fps_max.getFloat() > 0.0f && !headlessEngine->isFrameStepping())
+			framePacer->wait(1.0 / (double)headless_fps_max.getFloat());
+		else
+			framePacer->reset();
+	}
+
+	// release the timers
+	SAFE_DELETE(framePacer);
+	SAFE_DELETE(deltaTimer);
+
+	// release engine (also deletes the environment)
+	SAFE_DELETE(headlessEngine);
+
+	return 0;
+}
+
+#endif
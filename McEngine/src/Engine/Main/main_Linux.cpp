@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "Engine.h"
 #include "ConVar.h"
@@ -16,6 +17,7 @@
 
 #include "LinuxGLLegacyInterface.h"
 #include "LinuxEnvironment.h"
+#include "LinuxFramePacer.h"
 
 #define XLIB_ILLEGAL_ACCESS
 #include <X11/X.h>
@@ -63,7 +65,9 @@ XEvent                  xev;
 // input
 XIM im;
 XIC ic;
-int xi2opcode;
+int xi2opcode = -1;
+
+extern int mainHeadless(int argc, char *argv[]);
 
 
 
@@ -230,7 +234,7 @@ void WndProc(int type, int xcookieType, int xcookieExtension)
 	}
 
 	// XInput2
-	if (xcookieType == GenericEvent && xcookieExtension == xi2opcode)
+	if (xi2opcode != -1 && xcookieType == GenericEvent && xcookieExtension == xi2opcode)
 	{
 		if (XGetEventData(dpy, &xev.xcookie))
 		{
@@ -271,6 +275,13 @@ void WndProc(int type, int xcookieType, int xcookieExtension)
 
 int main(int argc, char *argv[])
 {
+	// headless mode (no X server required at all)
+	for (int i=1; i<argc; i++)
+	{
+		if (strcmp(argv[i], "-headless") == 0)
+			return mainHeadless(argc, argv);
+	}
+
 	dpy = XOpenDisplay(NULL);
 	if (dpy == NULL)
 	{
@@ -280,19 +291,25 @@ int main(int argc, char *argv[])
 
 
 	// before we do anything, check if XInput is available (for raw mouse input, smooth horizontal & vertical mouse wheel etc.)
+	// NOTE: raw input is optional, e.g. Xvfb or some remote X servers don't support XInput2
+	bool xi2available = true;
 	int xi2firstEvent, xi2error;
 	if (!XQueryExtension(dpy, "XInputExtension", &xi2opcode, &xi2firstEvent, &xi2error))
 	{
-		printf("FATAL ERROR: XQueryExtension() XInput extension not available!\n\n");
-		exit(1);
+		printf("WARNING: XQueryExtension() XInput extension not available, raw input disabled!\n\n");
+		xi2available = false;
+		xi2opcode = -1;
 	}
-
-	// want version 2 at least
-	int ximajor = 2, ximinor = 0;
-	if (XIQueryVersion(dpy, &ximajor, &ximinor) == BadRequest)
+	else
 	{
-		printf("FATAL ERROR: XIQueryVersion() XInput2 not available, server supports only %d.%d!\n\n", ximajor, ximinor);
-		exit(1);
+		// want version 2 at least
+		int ximajor = 2, ximinor = 0;
+		if (XIQueryVersion(dpy, &ximajor, &ximinor) == BadRequest)
+		{
+			printf("WARNING: XIQueryVersion() XInput2 not available, server supports only %d.%d, raw input disabled!\n\n", ximajor, ximinor);
+			xi2available = false;
+			xi2opcode = -1;
+		}
 	}
 
 
@@ -350,33 +367,34 @@ int main(int argc, char *argv[])
 
 
 	// set XInput event masks
-	XIEventMask masks[1];
-	unsigned char mask[(XI_LASTEVENT + 7)/8];
-	memset(mask, 0, sizeof(mask));
+	if (xi2available)
+	{
+		XIEventMask masks[1];
+		unsigned char mask[(XI_LASTEVENT + 7)/8];
+		memset(mask, 0, sizeof(mask));
 
-	XISetMask(mask, XI_RawMotion);
+		XISetMask(mask, XI_RawMotion);
 
-	// use client pointer for raw input, instead of XIAllMasterDevices.
-	// otherwise, the implicit grab on clicks will not give any more events as long as the button is being pressed
-	int pointerDevId;
-	XIGetClientPointer(dpy, None, &pointerDevId);
+		// use client pointer for raw input, instead of XIAllMasterDevices.
+		// otherwise, the implicit grab on clicks will not give any more events as long as the button is being pressed
+		int pointerDevId;
+		XIGetClientPointer(dpy, None, &pointerDevId);
 
-	masks[0].mask_len = sizeof(mask);
-	masks[0].mask = mask;
-	masks[0].deviceid = /*XIAllMasterDevices*/ pointerDevId;
+		masks[0].mask_len = sizeof(mask);
+		masks[0].mask = mask;
+		masks[0].deviceid = /*XIAllMasterDevices*/ pointerDevId;
 
-	// and select it on the window
-	XISelectEvents(dpy, DefaultRootWindow(dpy), masks, 1);
-	XFlush(dpy);
+		// and select it on the window
+		XISelectEvents(dpy, DefaultRootWindow(dpy), masks, 1);
+		XFlush(dpy);
+	}
 
 
 	// get keyboard focus
 	XSetICFocus(ic);
 
     // create timers
-    Timer *frameTimer = new Timer();
-    frameTimer->start();
-    frameTimer->update();
+    LinuxFramePacer *framePacer = new LinuxFramePacer();
 
     Timer *deltaTimer = new Timer();
     deltaTimer->start();
@@ -388,7 +406,6 @@ int main(int argc, char *argv[])
     g_engine = new Engine(environment, argc > 1 ? argv[1] : "");
     g_engine->loadApp();
 
-    frameTimer->update();
     deltaTimer->update();
 
     // main loop
@@ -425,36 +442,23 @@ int main(int argc, char *argv[])
 		}
 
 		// delay the next frame
-		frameTimer->update();
 		const bool inBackground = /*g_bMinimized ||*/ !g_bHasFocus;
-		if (!fps_unlimited.getBool() || inBackground)
+		if ((!fps_unlimited.getBool() || inBackground) && !g_engine->isFrameStepping()) // NOTE: host_framestep runs without any limiter
 		{
-			double delayStart = frameTimer->getElapsedTime();
-			double delayTime;
-			if (inBackground)
-				delayTime = (1.0 / (double)fps_max_background.getFloat()) - frameTimer->getDelta();
+			if (inBackground) // only sleep, precision doesn't matter here but background cpu utilization does
+				framePacer->wait(1.0 / (double)std::max(fps_max_background.getFloat(), 1.0f), false);
 			else
-				delayTime = (1.0 / (double)fps_max.getFloat()) - frameTimer->getDelta();
-
-			while (delayTime > 0.0)
-			{
-				if (inBackground) // real waiting (very inaccurate, but very good for little background cpu utilization)
-					usleep(1000 * (unsigned int)((1.0f / fps_max_background.getFloat())*1000.0f));
-				else // more or less "busy" waiting, but giving away the rest of the timeslice at least
-					usleep(0);
-
-				// decrease the delayTime by the time we spent in this loop
-				// if the loop is executed more than once, note how delayStart now gets the value of the previous iteration from getElapsedTime()
-				// this works because the elapsed time is only updated in update(). now we can easily calculate the time the Sleep() took and subtract it from the delayTime
-				delayStart = frameTimer->getElapsedTime();
-				frameTimer->update();
-				delayTime -= (frameTimer->getElapsedTime() - delayStart);
-			}
+				framePacer->wait(1.0 / (double)std::max(fps_max.getFloat(), 1.0f));
 		}
+		else
+			framePacer->reset();
     }
 
 	bool isRestartScheduled = environment->isRestartScheduled();
 
+	// release the frame limiter
+	SAFE_DELETE(framePacer);
+
 	// release the engine
 	SAFE_DELETE(g_engine);
 
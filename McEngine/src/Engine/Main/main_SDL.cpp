@@ -521,7 +521,7 @@ int mainSDL(int argc, char *argv[], SDLEnvironment *customSDLEnvironment)
 		// delay the next frame
 		frameTimer->update();
 		const bool inBackground = g_bMinimized || !g_bHasFocus;
-		if (!fps_unlimited.getBool() || inBackground)
+		if ((!fps_unlimited.getBool() || inBackground) && !g_engine->isFrameStepping()) // NOTE: host_framestep runs without any limiter
 		{
 			double delayStart = frameTimer->getElapsedTime();
 			double delayTime;
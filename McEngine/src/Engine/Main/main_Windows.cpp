@@ -1072,7 +1072,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		// delay the next frame
 		frameTimer->update();
 		const bool inBackground = g_bMinimized || !g_bHasFocus;
-		if (!fps_unlimited.getBool() || inBackground)
+		if ((!fps_unlimited.getBool() || inBackground) && !g_engine->isFrameStepping()) // NOTE: host_framestep runs without any limiter
 		{
 			double delayStart = frameTimer->getElapsedTime();
 			double delayTime;
@@ -9,6 +9,7 @@
 
 #include "Engine.h"
 #include "ConVar.h"
+#include "Profiler.h"
 
 #include <sstream>
 
@@ -417,6 +418,8 @@ void NetworkHandler::status()
 
 void NetworkHandler::update()
 {
+	VPROF("NetworkHandler::update");
+
 #ifdef MCENGINE_FEATURE_NETWORKING
 
 	if (!m_bReady) return;
@@ -0,0 +1,196 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		windowless environment with real file IO, for servers/benchmarks/CI
+//
+// $NoKeywords: $hlenv
+//===============================================================================//
+
+#ifdef __linux__
+
+#include "HeadlessEnvironment.h"
+#include "Engine.h"
+
+#include "HeadlessSWGraphicsInterface.h"
+#include "NullGraphicsInterface.h"
+
+#include <dirent.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <pwd.h>
+
+#include <string.h>
+#include <stdio.h>
+
+HeadlessEnvironment::HeadlessEnvironment(bool softwareRenderer, Vector2 windowSize) : NullEnvironment()
+{
+	m_bSoftwareRenderer = softwareRenderer;
+	m_vWindowSize = windowSize;
+}
+
+Graphics *HeadlessEnvironment::createRenderer()
+{
+	if (m_bSoftwareRenderer)
+		return new HeadlessSWGraphicsInterface();
+	else
+		return new NullGraphicsInterface();
+}
+
+void HeadlessEnvironment::sleep(unsigned int us)
+{
+	usleep(us);
+}
+
+UString HeadlessEnvironment::getExecutablePath()
+{
+	char buf[4096];
+	memset(buf, '\0', 4096);
+	if (readlink("/proc/self/exe", buf, 4095) != -1)
+		return UString(buf);
+	else
+		return UString("");
+}
+
+UString HeadlessEnvironment::getUsername()
+{
+	passwd *pwd = getpwuid(getuid());
+	if (pwd != NULL && pwd->pw_name != NULL)
+		return UString(pwd->pw_name);
+	else
+		return UString("");
+}
+
+UString HeadlessEnvironment::getUserDataPath()
+{
+	passwd *pwd = getpwuid(getuid());
+	if (pwd != NULL && pwd->pw_dir != NULL)
+		return UString(pwd->pw_dir);
+	else
+		return UString("");
+}
+
+bool HeadlessEnvironment::fileExists(UString filename)
+{
+	struct stat st;
+	return (stat(filename.toUtf8(), &st) == 0 && !S_ISDIR(st.st_mode));
+}
+
+bool HeadlessEnvironment::directoryExists(UString directoryName)
+{
+	struct stat st;
+	return (stat(directoryName.toUtf8(), &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+bool HeadlessEnvironment::createDirectory(UString directoryName)
+{
+	return mkdir(directoryName.toUtf8(), DEFFILEMODE | S_IXUSR | S_IXGRP | S_IXOTH) != -1; // (directories need the execute bit to be usable)
+}
+
+bool HeadlessEnvironment::renameFile(UString oldFileName, UString newFileName)
+{
+	return rename(oldFileName.toUtf8(), newFileName.toUtf8()) != -1;
+}
+
+bool HeadlessEnvironment::deleteFile(UString filePath)
+{
+	return remove(filePath.toUtf8()) == 0;
+}
+
+std::vector<UString> HeadlessEnvironment::getFilesInFolder(UString folder)
+{
+	std::vector<UString> files;
+
+	struct dirent **namelist;
+	int n = scandir(folder.toUtf8(), &namelist, NULL, alphasort);
+	if (n < 0)
+		return files;
+
+	while (n--)
+	{
+		UString uName = UString(namelist[n]->d_name);
+		UString fullName = folder;
+		fullName.append(uName);
+		free(namelist[n]);
+
+		struct stat stDirInfo;
+		if (lstat(fullName.toUtf8(), &stDirInfo) < 0)
+			continue;
+
+		if (!S_ISDIR(stDirInfo.st_mode))
+			files.push_back(uName);
+	}
+	free(namelist);
+
+	return files;
+}
+
+std::vector<UString> HeadlessEnvironment::getFoldersInFolder(UString folder)
+{
+	std::vector<UString> folders;
+
+	struct dirent **namelist;
+	int n = scandir(folder.toUtf8(), &namelist, NULL, alphasort);
+	if (n < 0)
+		return folders;
+
+	while (n--)
+	{
+		UString uName = UString(namelist[n]->d_name);
+		UString fullName = folder;
+		fullName.append(uName);
+		free(namelist[n]);
+
+		struct stat stDirInfo;
+		if (lstat(fullName.toUtf8(), &stDirInfo) < 0)
+			continue;
+
+		if (S_ISDIR(stDirInfo.st_mode))
+			folders.push_back(uName);
+	}
+	free(namelist);
+
+	return folders;
+}
+
+std::vector<UString> HeadlessEnvironment::getLogicalDrives()
+{
+	std::vector<UString> drives;
+	drives.push_back(UString("/"));
+	return drives;
+}
+
+UString HeadlessEnvironment::getFolderFromFilePath(UString filepath)
+{
+	if (directoryExists(filepath)) // indirect check if this is already a valid directory (and not a file)
+		return filepath;
+	else
+		return UString(dirname((char*)filepath.toUtf8()));
+}
+
+UString HeadlessEnvironment::getFileExtensionFromFilePath(UString filepath, bool includeDot)
+{
+	const int idx = filepath.findLast(".");
+	if (idx != -1)
+		return filepath.substr(includeDot ? idx : idx+1);
+	else
+		return UString("");
+}
+
+void HeadlessEnvironment::setWindowSize(int width, int height)
+{
+	m_vWindowSize = Vector2(width, height);
+
+	// there is no window manager to tell us about the new size, so forward it directly
+	if (engine != NULL)
+		engine->requestResolutionChange(m_vWindowSize);
+}
+
+std::vector<McRect> HeadlessEnvironment::getMonitors()
+{
+	std::vector<McRect> monitors;
+	monitors.push_back(getDesktopRect());
+	return monitors;
+}
+
+#endif
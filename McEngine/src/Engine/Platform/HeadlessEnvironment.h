@@ -0,0 +1,73 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		windowless environment with real file IO, for servers/benchmarks/CI
+//
+// $NoKeywords: $hlenv
+//===============================================================================//
+
+#ifdef __linux__
+
+#ifndef HEADLESSENVIRONMENT_H
+#define HEADLESSENVIRONMENT_H
+
+#include "NullEnvironment.h"
+
+class HeadlessEnvironment : public NullEnvironment
+{
+public:
+	HeadlessEnvironment(bool softwareRenderer = false, Vector2 windowSize = Vector2(1280, 720));
+	virtual ~HeadlessEnvironment() {;}
+
+	// engine/factory
+	Graphics *createRenderer();
+
+	// system
+	OS getOS() {return Environment::OS::OS_LINUX;}
+	void sleep(unsigned int us);
+	UString getExecutablePath();
+
+	// user
+	UString getUsername();
+	UString getUserDataPath();
+
+	// file IO
+	bool fileExists(UString filename);
+	bool directoryExists(UString directoryName);
+	bool createDirectory(UString directoryName);
+	bool renameFile(UString oldFileName, UString newFileName);
+	bool deleteFile(UString filePath);
+	std::vector<UString> getFilesInFolder(UString folder);
+	std::vector<UString> getFoldersInFolder(UString folder);
+	std::vector<UString> getLogicalDrives();
+	UString getFolderFromFilePath(UString filepath);
+	UString getFileExtensionFromFilePath(UString filepath, bool includeDot = false);
+
+	// clipboard
+	UString getClipBoardText() {return m_sClipboardText;}
+	void setClipBoardText(UString text) {m_sClipboardText = text;}
+
+	// window
+	void setWindowSize(int width, int height);
+	Vector2 getWindowSize() {return m_vWindowSize;}
+	std::vector<McRect> getMonitors();
+	Vector2 getNativeScreenSize() {return m_vWindowSize;}
+	McRect getVirtualScreenRect() {return McRect(0, 0, m_vWindowSize.x, m_vWindowSize.y);}
+	McRect getDesktopRect() {return McRect(0, 0, m_vWindowSize.x, m_vWindowSize.y);}
+	bool isWindowResizable() {return false;}
+
+	// mouse
+	bool isCursorInWindow() {return false;}
+	bool isCursorVisible() {return false;}
+
+	// ILLEGAL:
+	inline bool isSoftwareRenderer() const {return m_bSoftwareRenderer;}
+
+private:
+	bool m_bSoftwareRenderer;
+	Vector2 m_vWindowSize;
+	UString m_sClipboardText;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		windowless software rasterizer graphics interface
+//
+// $NoKeywords: $hlswi
+//===============================================================================//
+
+#ifndef HEADLESSSWGRAPHICSINTERFACE_H
+#define HEADLESSSWGRAPHICSINTERFACE_H
+
+#include "SWGraphicsInterface.h"
+
+class HeadlessSWGraphicsInterface : public SWGraphicsInterface
+{
+public:
+	HeadlessSWGraphicsInterface() : SWGraphicsInterface() {;}
+	virtual ~HeadlessSWGraphicsInterface() {;}
+
+	// device settings
+	void setVSync(bool vsync) {;} // there is nothing to present to, the backbuffer just stays in memory
+};
+
+#endif
@@ -219,7 +219,7 @@ bool LinuxEnvironment::directoryExists(UString directoryName)
 
 bool LinuxEnvironment::createDirectory(UString directoryName)
 {
-	return mkdir(directoryName.toUtf8(), DEFFILEMODE) != -1;
+	return mkdir(directoryName.toUtf8(), DEFFILEMODE | S_IXUSR | S_IXGRP | S_IXOTH) != -1; // (directories need the execute bit to be usable)
 }
 
 bool LinuxEnvironment::renameFile(UString oldFileName, UString newFileName)
@@ -0,0 +1,208 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		hybrid sleep/spin frame limiter with pacing statistics
+//
+// $NoKeywords: $linuxpacer
+//===============================================================================//
+
+#ifdef __linux__
+
+#include "LinuxFramePacer.h"
+#include "Engine.h"
+#include "ConVar.h"
+
+#include <time.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+ConVar fps_pacer_slack_us("fps_pacer_slack_us", 1000.0f, "the frame limiter sleeps until this many microseconds before the deadline, and then spins for the rest (higher = more precise but more cpu usage, 0 = never spin)");
+
+const long LinuxFramePacer::s_iHistogramBucketLimitsUS[LinuxFramePacer::NUM_HISTOGRAM_BUCKETS] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, -1};
+
+LinuxFramePacer *LinuxFramePacer::s_activeFramePacer = NULL;
+
+static double _getMonotonicTime()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (double)t.tv_sec + (double)t.tv_nsec / 1000000000.0;
+}
+
+static void _sleepUntil(double monotonicTime)
+{
+	timespec t;
+	t.tv_sec = (time_t)monotonicTime;
+	t.tv_nsec = (long)((monotonicTime - (double)t.tv_sec) * 1000000000.0);
+	if (t.tv_nsec > 999999999)
+		t.tv_nsec = 999999999;
+
+	// NOTE: absolute deadline, so restarting after a signal interruption doesn't accumulate any error
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR)
+	{
+		// continue sleeping
+	}
+}
+
+LinuxFramePacer::LinuxFramePacer()
+{
+	m_bHasDeadline = false;
+	m_dNextDeadline = 0.0;
+	m_dLastFrameTime = 0.0;
+	m_dLastTargetFrameTime = 0.0;
+
+	s_activeFramePacer = this;
+	resetHistogram();
+}
+
+LinuxFramePacer::~LinuxFramePacer()
+{
+	if (s_activeFramePacer == this)
+		s_activeFramePacer = NULL;
+}
+
+void LinuxFramePacer::wait(double targetFrameTime, bool allowSpin)
+{
+	const double now = _getMonotonicTime();
+
+	// start a new sequence if necessary, the first frame has no previous frame to be measured against
+	bool isFirstFrame = false;
+	if (!m_bHasDeadline || targetFrameTime != m_dLastTargetFrameTime)
+	{
+		isFirstFrame = true;
+		m_bHasDeadline = true;
+		m_dLastTargetFrameTime = targetFrameTime;
+		m_dNextDeadline = now + targetFrameTime;
+	}
+	else
+	{
+		m_dNextDeadline += targetFrameTime;
+
+		// if we are behind by more than a full frame, then don't try to catch up with a burst of unlimited frames
+		if (m_dNextDeadline < now - targetFrameTime)
+			m_dNextDeadline = now;
+	}
+
+	const bool isLate = (now > m_dNextDeadline);
+
+	// sleep for the bulk of the interval
+	const double slack = (allowSpin ? (double)std::max(fps_pacer_slack_us.getFloat(), 0.0f) / 1000000.0 : 0.0);
+	if (m_dNextDeadline - slack > now)
+		_sleepUntil(m_dNextDeadline - slack);
+
+	const double sleepEnd = _getMonotonicTime();
+
+	// and spin for the remaining slice, since the kernel wakeup latency is too unpredictable for that
+	double frameTime = sleepEnd;
+	if (allowSpin)
+	{
+		while (frameTime < m_dNextDeadline)
+		{
+			frameTime = _getMonotonicTime();
+		}
+	}
+
+	if (!isFirstFrame)
+		record(fabs((frameTime - m_dLastFrameTime) - targetFrameTime), frameTime - m_dNextDeadline, sleepEnd - now, frameTime - sleepEnd, isLate);
+
+	m_dLastFrameTime = frameTime;
+}
+
+void LinuxFramePacer::record(double intervalError, double wakeupError, double sleepTime, double spinTime, bool late)
+{
+	const long intervalErrorUS = (long)(intervalError * 1000000.0);
+	for (int i=0; i<NUM_HISTOGRAM_BUCKETS; i++)
+	{
+		if (intervalErrorUS < s_iHistogramBucketLimitsUS[i] || s_iHistogramBucketLimitsUS[i] < 0)
+		{
+			m_iHistogram[i]++;
+			break;
+		}
+	}
+
+	m_iNumFrames++;
+	if (late)
+		m_iNumLateFrames++;
+
+	m_dIntervalErrorSum += intervalError;
+	m_dIntervalErrorMax = std::max(m_dIntervalErrorMax, intervalError);
+
+	// late frames didn't wait at all, so they don't say anything about the wakeup precision
+	if (!late)
+	{
+		m_dWakeupErrorSum += wakeupError;
+		m_dWakeupErrorMax = std::max(m_dWakeupErrorMax, wakeupError);
+	}
+
+	m_dSleepTime += sleepTime;
+	m_dSpinTime += spinTime;
+}
+
+void LinuxFramePacer::printHistogram()
+{
+	LinuxFramePacer *pacer = s_activeFramePacer;
+	if (pacer == NULL)
+	{
+		debugLog("LinuxFramePacer: Not active.\n");
+		return;
+	}
+
+	if (pacer->m_iNumFrames < 1)
+	{
+		debugLog("LinuxFramePacer: No frames recorded yet (is fps_unlimited enabled?)\n");
+		return;
+	}
+
+	const double numFrames = (double)pacer->m_iNumFrames;
+	const unsigned long numOnTimeFrames = pacer->m_iNumFrames - pacer->m_iNumLateFrames;
+
+	debugLog("LinuxFramePacer: %lu frames (%lu late), target = %.3f ms, slack = %i us\n", pacer->m_iNumFrames, pacer->m_iNumLateFrames, pacer->m_dLastTargetFrameTime*1000.0, (int)fps_pacer_slack_us.getFloat());
+	debugLog("LinuxFramePacer: frame interval error:\n");
+
+	long prevLimit = 0;
+	for (int i=0; i<NUM_HISTOGRAM_BUCKETS; i++)
+	{
+		const double percent = ((double)pacer->m_iHistogram[i] / numFrames) * 100.0;
+
+		char bar[51];
+		const int barLength = (int)(percent / 2.0);
+		memset(bar, '#', barLength);
+		bar[barLength] = '\0';
+
+		if (s_iHistogramBucketLimitsUS[i] < 0)
+			debugLog("    >= %5li us : %8lu (%6.2f %%) %s\n", prevLimit, pacer->m_iHistogram[i], percent, bar);
+		else
+			debugLog("    <  %5li us : %8lu (%6.2f %%) %s\n", s_iHistogramBucketLimitsUS[i], pacer->m_iHistogram[i], percent, bar);
+
+		prevLimit = s_iHistogramBucketLimitsUS[i];
+	}
+
+	debugLog("LinuxFramePacer: interval error avg = %.2f us, max = %.2f us\n", (pacer->m_dIntervalErrorSum / numFrames)*1000000.0, pacer->m_dIntervalErrorMax*1000000.0);
+	if (numOnTimeFrames > 0)
+		debugLog("LinuxFramePacer: wakeup error avg = %.2f us, max = %.2f us\n", (pacer->m_dWakeupErrorSum / (double)numOnTimeFrames)*1000000.0, pacer->m_dWakeupErrorMax*1000000.0);
+	debugLog("LinuxFramePacer: waited %.3f s sleeping and %.3f s spinning (%.2f %% busy)\n", pacer->m_dSleepTime, pacer->m_dSpinTime, (pacer->m_dSpinTime / std::max(pacer->m_dSleepTime + pacer->m_dSpinTime, 0.000001))*100.0);
+}
+
+void LinuxFramePacer::resetHistogram()
+{
+	LinuxFramePacer *pacer = s_activeFramePacer;
+	if (pacer == NULL) return;
+
+	for (int i=0; i<NUM_HISTOGRAM_BUCKETS; i++)
+	{
+		pacer->m_iHistogram[i] = 0;
+	}
+	pacer->m_iNumFrames = 0;
+	pacer->m_iNumLateFrames = 0;
+	pacer->m_dIntervalErrorSum = 0.0;
+	pacer->m_dIntervalErrorMax = 0.0;
+	pacer->m_dWakeupErrorSum = 0.0;
+	pacer->m_dWakeupErrorMax = 0.0;
+	pacer->m_dSleepTime = 0.0;
+	pacer->m_dSpinTime = 0.0;
+}
+
+ConVar fps_pacer_histogram("fps_pacer_histogram", LinuxFramePacer::printHistogram);
+ConVar fps_pacer_histogram_reset("fps_pacer_histogram_reset", LinuxFramePacer::resetHistogram);
+
+#endif
@@ -0,0 +1,57 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		hybrid sleep/spin frame limiter with pacing statistics
+//
+// $NoKeywords: $linuxpacer
+//===============================================================================//
+
+#ifdef __linux__
+
+#ifndef LINUXFRAMEPACER_H
+#define LINUXFRAMEPACER_H
+
+class LinuxFramePacer
+{
+public:
+	static void printHistogram();
+	static void resetHistogram();
+
+public:
+	LinuxFramePacer();
+	~LinuxFramePacer();
+
+	// blocks until the next frame deadline (absolute, so the time spent in update/draw is automatically accounted for)
+	// sleeps in the kernel until (deadline - slack), then spins for the rest if allowSpin is set
+	void wait(double targetFrameTime, bool allowSpin = true);
+
+	// forget the current deadline (e.g. while running unlimited), the next wait() starts a new pacing sequence
+	void reset() {m_bHasDeadline = false;}
+
+private:
+	static const int NUM_HISTOGRAM_BUCKETS = 10;
+	static const long s_iHistogramBucketLimitsUS[NUM_HISTOGRAM_BUCKETS];
+
+	static LinuxFramePacer *s_activeFramePacer;
+
+	void record(double intervalError, double wakeupError, double sleepTime, double spinTime, bool late);
+
+	bool m_bHasDeadline;
+	double m_dNextDeadline;
+	double m_dLastFrameTime;
+	double m_dLastTargetFrameTime;
+
+	// stats
+	unsigned long m_iHistogram[NUM_HISTOGRAM_BUCKETS];
+	unsigned long m_iNumFrames;
+	unsigned long m_iNumLateFrames;
+	double m_dIntervalErrorSum;
+	double m_dIntervalErrorMax;
+	double m_dWakeupErrorSum;
+	double m_dWakeupErrorMax;
+	double m_dSleepTime;
+	double m_dSpinTime;
+};
+
+#endif
+
+#endif
@@ -156,7 +156,7 @@ bool MacOSEnvironment::directoryExists(UString directoryName)
 
 bool MacOSEnvironment::createDirectory(UString directoryName)
 {
-	return mkdir(directoryName.toUtf8(), DEFFILEMODE) != -1;
+	return mkdir(directoryName.toUtf8(), DEFFILEMODE | S_IXUSR | S_IXGRP | S_IXOTH) != -1; // (directories need the execute bit to be usable)
 }
 
 bool MacOSEnvironment::renameFile(UString oldFileName, UString newFileName)
@@ -0,0 +1,329 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		hierarchical scoped zone cpu profiler (VPROF)
+//
+// $NoKeywords: $vprof
+//===============================================================================//
+
+#include "Profiler.h"
+#include "Engine.h"
+#include "ConVar.h"
+#include "File.h"
+
+#include <chrono>
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+#include <mutex>
+#include <thread>
+#include "WinMinGW.Mutex.h"
+#include "Horizon.Mutex.h"
+
+#endif
+
+ConVar vprof("vprof", false, "enables the VPROF zone profiler (takes effect at the start of the next frame)");
+ConVar vprof_trace_max_zones("vprof_trace_max_zones", 100000, "size of the zone ring buffer which vprof_export writes out (changes are applied when vprof is enabled)");
+
+std::atomic<bool> Profiler::s_bEnabled(false);
+int Profiler::s_iDepth = 0;
+std::vector<Profiler::ZONE> Profiler::s_currentFrameZones;
+std::vector<Profiler::ZONE> Profiler::s_lastFrameZones;
+std::vector<Profiler::ZONE> Profiler::s_traceZones;
+size_t Profiler::s_iTraceHead = 0;
+bool Profiler::s_bTraceWrapped = false;
+std::vector<std::string> Profiler::s_threadNames;
+
+static const std::chrono::steady_clock::time_point g_profilerStartTime = std::chrono::steady_clock::now();
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+std::mutex g_profilerMutex; // protects the trace ring buffer and the thread list
+std::vector<std::thread::id> g_profilerThreadIds; // index = Profiler::ZONE::threadIndex
+std::thread::id g_profilerMainThreadId;
+bool g_bProfilerHasMainThreadId = false;
+
+#endif
+
+double Profiler::getTime()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - g_profilerStartTime).count();
+}
+
+bool Profiler::isMainThread()
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	return (std::this_thread::get_id() == g_profilerMainThreadId);
+
+#else
+
+	return true;
+
+#endif
+}
+
+void Profiler::registerMainThreadSlot()
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	// NOTE: g_profilerMutex must be held by the caller
+	// other threads (e.g. the resource loader) can start recording before the first frame, but index 0 always belongs to the main thread
+	g_profilerThreadIds.push_back(std::thread::id());
+	s_threadNames.push_back("main thread");
+
+#endif
+}
+
+int Profiler::getThreadIndex()
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	// NOTE: g_profilerMutex must be held by the caller
+	if (g_profilerThreadIds.size() < 1)
+		registerMainThreadSlot();
+
+	const std::thread::id id = std::this_thread::get_id();
+	for (size_t i=0; i<g_profilerThreadIds.size(); i++)
+	{
+		if (g_profilerThreadIds[i] == id)
+			return (int)i;
+	}
+
+	g_profilerThreadIds.push_back(id);
+	s_threadNames.push_back(UString::format("thread %i", (int)g_profilerThreadIds.size()-1).toUtf8());
+	return (int)g_profilerThreadIds.size()-1;
+
+#else
+
+	return 0;
+
+#endif
+}
+
+void Profiler::beginFrame()
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	if (!g_bProfilerHasMainThreadId)
+	{
+		std::lock_guard<std::mutex> lk(g_profilerMutex);
+
+		if (g_profilerThreadIds.size() < 1)
+			registerMainThreadSlot();
+
+		g_bProfilerHasMainThreadId = true;
+		g_profilerMainThreadId = std::this_thread::get_id();
+		g_profilerThreadIds[0] = g_profilerMainThreadId;
+	}
+
+#endif
+
+	// finish the previous frame
+	s_lastFrameZones.swap(s_currentFrameZones);
+	s_currentFrameZones.clear();
+
+	if (s_bEnabled.load() && s_lastFrameZones.size() > 0)
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_profilerMutex);
+
+#endif
+
+		for (size_t i=0; i<s_lastFrameZones.size(); i++)
+		{
+			pushTraceZone(s_lastFrameZones[i]);
+		}
+	}
+
+	// enabling/disabling only ever happens between frames, so that no main thread zone is open
+	if (vprof.getBool() != s_bEnabled.load())
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_profilerMutex);
+
+#endif
+
+		s_bEnabled = vprof.getBool();
+		s_iDepth = 0;
+		s_lastFrameZones.clear();
+
+		if (s_bEnabled.load())
+		{
+			s_traceZones = std::vector<ZONE>(std::max(vprof_trace_max_zones.getInt(), 1));
+			s_iTraceHead = 0;
+			s_bTraceWrapped = false;
+		}
+	}
+}
+
+void Profiler::setThreadName(const char *threadName)
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::lock_guard<std::mutex> lk(g_profilerMutex);
+
+#endif
+
+	const int threadIndex = getThreadIndex();
+	s_threadNames[threadIndex] = threadName;
+}
+
+int Profiler::enterZone()
+{
+	if (isMainThread())
+		return s_iDepth++;
+
+	return 0;
+}
+
+void Profiler::exitZone(const char *name, const char *detail, double start, int depth)
+{
+	ZONE zone;
+	zone.name = name;
+	if (detail != NULL)
+		zone.detail = detail;
+	zone.start = start;
+	zone.end = getTime();
+	zone.depth = depth;
+	zone.threadIndex = 0;
+
+	if (isMainThread())
+	{
+		s_iDepth = std::max(s_iDepth - 1, 0);
+		s_currentFrameZones.push_back(zone);
+	}
+	else
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_profilerMutex);
+
+#endif
+
+		if (!s_bEnabled.load()) return; // could have been disabled while this zone was running
+
+		zone.threadIndex = getThreadIndex();
+		pushTraceZone(zone);
+	}
+}
+
+void Profiler::pushTraceZone(const ZONE &zone)
+{
+	// NOTE: g_profilerMutex must be held by the caller
+	if (s_traceZones.size() < 1) return;
+
+	s_traceZones[s_iTraceHead] = zone;
+	s_iTraceHead++;
+	if (s_iTraceHead >= s_traceZones.size())
+	{
+		s_iTraceHead = 0;
+		s_bTraceWrapped = true;
+	}
+}
+
+static void _vprofAppendJsonString(std::string &json, const char *str)
+{
+	json.push_back('"');
+	for (const char *c=str; *c != '\0'; c++)
+	{
+		switch (*c)
+		{
+		case '"':
+			json.append("\\\"");
+			break;
+		case '\\':
+			json.append("\\\\");
+			break;
+		default:
+			if ((unsigned char)*c < 0x20)
+				json.push_back(' ');
+			else
+				json.push_back(*c);
+			break;
+		}
+	}
+	json.push_back('"');
+}
+
+bool Profiler::exportChromeTrace(UString filePath)
+{
+	// copy everything out first, so that other threads are not blocked while writing
+	std::vector<ZONE> zones;
+	std::vector<std::string> threadNames;
+	{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+		std::lock_guard<std::mutex> lk(g_profilerMutex);
+
+#endif
+
+		if (s_bTraceWrapped)
+			zones.insert(zones.end(), s_traceZones.begin() + s_iTraceHead, s_traceZones.end());
+		zones.insert(zones.end(), s_traceZones.begin(), s_traceZones.begin() + s_iTraceHead);
+
+		threadNames = s_threadNames;
+	}
+
+	if (zones.size() < 1)
+	{
+		debugLog("Profiler: Nothing to export, enable vprof first!\n");
+		return false;
+	}
+
+	// see https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+	std::string json;
+	json.reserve(zones.size() * 96);
+	json.append("{\"traceEvents\":[\n");
+
+	char buf[256];
+	for (size_t i=0; i<threadNames.size(); i++)
+	{
+		snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":", (int)i);
+		json.append(buf);
+		_vprofAppendJsonString(json, threadNames[i].c_str());
+		json.append("}},\n");
+	}
+
+	for (size_t i=0; i<zones.size(); i++)
+	{
+		const ZONE &zone = zones[i];
+
+		json.append("{\"name\":");
+		_vprofAppendJsonString(json, zone.name);
+		snprintf(buf, sizeof(buf), ",\"cat\":\"vprof\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%i", zone.start, zone.end - zone.start, zone.threadIndex);
+		json.append(buf);
+		if (zone.detail.length() > 0)
+		{
+			json.append(",\"args\":{\"detail\":");
+			_vprofAppendJsonString(json, zone.detail.c_str());
+			json.append("}");
+		}
+		json.append(i+1 < zones.size() ? "},\n" : "}\n");
+	}
+
+	json.append("],\"displayTimeUnit\":\"ms\"}\n");
+
+	File file(filePath, File::TYPE::WRITE);
+	if (!file.canWrite())
+	{
+		debugLog("Profiler: Couldn't write to file \"%s\"!\n", filePath.toUtf8());
+		return false;
+	}
+	file.write(json.c_str(), json.length());
+
+	debugLog("Profiler: Exported %i zones to \"%s\"\n", (int)zones.size(), filePath.toUtf8());
+	return true;
+}
+
+void _vprof_export(UString args)
+{
+	UString filePath = args.trim();
+	if (filePath.length() < 1)
+		filePath = "vprof.json";
+
+	Profiler::exportChromeTrace(filePath);
+}
+
+ConVar _vprof_export_("vprof_export", _vprof_export, ConVar::ARGS::ARGS_OPTIONAL);
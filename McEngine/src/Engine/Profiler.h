@@ -0,0 +1,114 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		hierarchical scoped zone cpu profiler (VPROF)
+//
+// $NoKeywords: $vprof
+//===============================================================================//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "cbase.h"
+
+// usage:
+// void Something::update()
+// {
+//     VPROF("Something::update");
+//     ...
+// }
+// the name must be a string literal (or otherwise outlive the profiler), only the pointer is stored
+
+#ifdef MCENGINE_FEATURE_PROFILER
+
+#define VPROF_CONCAT_INTERNAL(a, b) a##b
+#define VPROF_CONCAT(a, b) VPROF_CONCAT_INTERNAL(a, b)
+
+#define VPROF(name) ProfilerScope VPROF_CONCAT(_vprofScope, __LINE__)(name)
+#define VPROF_DETAIL(name, detail) ProfilerScope VPROF_CONCAT(_vprofScope, __LINE__)(name, detail)
+
+#else
+
+#define VPROF(name)
+#define VPROF_DETAIL(name, detail)
+
+#endif
+
+class Profiler
+{
+public:
+	struct ZONE
+	{
+		const char *name;
+		std::string detail; // optional, e.g. a resource name
+		double start;		// in microseconds since startup
+		double end;			// in microseconds since startup
+		int depth;			// nesting level, only tracked on the main thread
+		int threadIndex;	// 0 = main thread
+	};
+
+	static inline bool isEnabled() {return s_bEnabled.load(std::memory_order_relaxed);}
+
+	// main thread only
+	static void beginFrame();
+	static const std::vector<ZONE> &getLastFrameZones() {return s_lastFrameZones;}
+
+	// threads other than the main thread can be given a name for the trace export
+	static void setThreadName(const char *threadName);
+
+	static bool exportChromeTrace(UString filePath);
+
+	// internal, called by ProfilerScope
+	static double getTime();
+	static int enterZone();
+	static void exitZone(const char *name, const char *detail, double start, int depth);
+
+private:
+	static bool isMainThread();
+	static void registerMainThreadSlot();
+	static int getThreadIndex();
+	static void pushTraceZone(const ZONE &zone);
+
+	static std::atomic<bool> s_bEnabled; // written by the main thread, read by every thread which records zones
+	static int s_iDepth;
+
+	static std::vector<ZONE> s_currentFrameZones;
+	static std::vector<ZONE> s_lastFrameZones;
+
+	// ring buffer of the most recent zones of all threads
+	static std::vector<ZONE> s_traceZones;
+	static size_t s_iTraceHead;
+	static bool s_bTraceWrapped;
+
+	static std::vector<std::string> s_threadNames;
+};
+
+class ProfilerScope
+{
+public:
+	ProfilerScope(const char *name, const char *detail = NULL)
+	{
+		m_bActive = Profiler::isEnabled();
+		if (m_bActive)
+		{
+			m_name = name;
+			m_detail = detail;
+			m_iDepth = Profiler::enterZone();
+			m_dStart = Profiler::getTime();
+		}
+	}
+
+	~ProfilerScope()
+	{
+		if (m_bActive)
+			Profiler::exitZone(m_name, m_detail, m_dStart, m_iDepth);
+	}
+
+private:
+	bool m_bActive;
+	const char *m_name;
+	const char *m_detail;
+	double m_dStart;
+	int m_iDepth;
+};
+
+#endif
@@ -18,6 +18,8 @@ public:
 	RenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType = Graphics::MULTISAMPLE_TYPE::MULTISAMPLE_0X);
 	virtual ~RenderTarget() {;}
 
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_RENDERTARGET;}
+
 	virtual void draw(Graphics *g, int x, int y);
 	virtual void draw(Graphics *g, int x, int y, int width, int height);
 	virtual void drawRect(Graphics *g, int x, int y, int width, int height);
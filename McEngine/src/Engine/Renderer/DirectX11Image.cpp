@@ -183,6 +183,8 @@ void DirectX11Image::bind(unsigned int textureUnit)
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->countTextureBind();
+
 	m_iTextureUnitBackup = textureUnit;
 
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->PSGetShaderResources(textureUnit, 1, &m_prevShaderResourceView); // backup
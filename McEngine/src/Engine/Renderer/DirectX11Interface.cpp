@@ -301,6 +301,8 @@ void DirectX11Interface::init()
 
 void DirectX11Interface::beginScene()
 {
+	beginFrameStats();
+
 	Matrix4 defaultProjectionMatrix = Camera::buildMatrixOrtho2D(0, m_vResolution.x, m_vResolution.y, 0);
 
 	// push main transforms
@@ -321,6 +323,8 @@ void DirectX11Interface::beginScene()
 
 void DirectX11Interface::endScene()
 {
+	endFrameStats();
+
 	popTransform();
 
 	checkStackLeaks();
@@ -652,6 +656,7 @@ void DirectX11Interface::drawVAO(VertexArrayObject *vao)
 	m_deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
 	m_deviceContext->IASetPrimitiveTopology((D3D_PRIMITIVE_TOPOLOGY)primitiveToDirectX(primitive));
 	m_deviceContext->Draw(m_vertices.size(), 0);
+	countDrawCall(m_vertices.size());
 }
 
 void DirectX11Interface::setClipRect(McRect clipRect)
@@ -659,6 +664,8 @@ void DirectX11Interface::setClipRect(McRect clipRect)
 	if (r_debug_disable_cliprect->getBool()) return;
 	//if (m_bIs3DScene) return; // HACKHACK:TODO:
 
+	countClipChange();
+
 	setClipping(true);
 
 	D3D11_RECT rect;
@@ -240,6 +240,8 @@ void DirectX11RenderTarget::enable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->countRenderTargetChange();
+
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->OMGetRenderTargets(1, &m_prevRenderTargetView, &m_prevDepthStencilView); // backup
 
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
@@ -269,6 +271,8 @@ void DirectX11RenderTarget::bind(unsigned int textureUnit)
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->countTextureBind();
+
 	m_iTextureUnitBackup = textureUnit;
 
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->PSGetShaderResources(textureUnit, 1, &m_prevShaderResourceView); // backup
@@ -60,6 +60,8 @@ void DirectX11Shader::enable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->countShaderChange();
+
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->IAGetInputLayout(&m_prevInputLayout); // backup
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->VSGetShader(&m_prevVS, NULL, NULL); // backup
 	((DirectX11Interface*)engine->getGraphics())->getDeviceContext()->PSGetShader(&m_prevPS, NULL, NULL); // backup
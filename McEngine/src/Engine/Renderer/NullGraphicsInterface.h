@@ -17,8 +17,8 @@ public:
 	virtual ~NullGraphicsInterface() {;}
 
 	// scene
-	virtual void beginScene() {;}
-	virtual void endScene() {;}
+	virtual void beginScene() {beginFrameStats();}
+	virtual void endScene() {endFrameStats();}
 
 	// depth buffer
 	virtual void clearDepthBuffer() {;}
@@ -12,6 +12,7 @@
 #include "Engine.h"
 #include "ConVar.h"
 #include "Camera.h"
+#include "SpriteBatch.h"
 
 #include "Font.h"
 #include "OpenGLImage.h"
@@ -32,14 +33,18 @@ OpenGL3Interface::OpenGL3Interface() : Graphics()
 	m_iShaderTexturedGenericAttribPosition = 0;
 	m_iShaderTexturedGenericAttribUV = 1;
 	m_iShaderTexturedGenericAttribCol = 2;
-	m_bShaderTexturedGenericIsTextureEnabled = false;
+	m_iShaderTexturedGenericType = 0;
 	m_iVA = 0;
 	m_iVBOVertices = 0;
 	m_iVBOTexcoords = 0;
 	m_iVBOTexcolors = 0;
+	m_iVBOSize = 512;
 
 	// persistent vars
 	m_color = 0xffffffff;
+
+	// 2d batching
+	m_batch = new SpriteBatch();
 }
 
 OpenGL3Interface::~OpenGL3Interface()
@@ -106,6 +111,11 @@ void OpenGL3Interface::init()
 								"	{\n"
 								"		texcolor = vcolor;"
 								"	}\n"
+								"	else if (type == 3)\n"
+								"	{\n"
+								"		texcoords = uv;\n"
+								"		texcolor = vcolor;\n"
+								"	}\n"
 								"}\n"
 								"\n";
 
@@ -129,6 +139,10 @@ void OpenGL3Interface::init()
 								"	{\n"
 								"		color = texcolor;"
 								"	}\n"
+								"	else if (type == 3)\n"
+								"	{\n"
+								"		color = texture(tex, texcoords) * texcolor;\n"
+								"	}\n"
 								"}\n"
 								"\n";
 	m_shaderTexturedGeneric = (OpenGLShader*)createShaderFromSource(texturedGenericV, texturedGenericP);
@@ -145,27 +159,28 @@ void OpenGL3Interface::init()
 
 	glBindVertexArray(m_iVA);
 
-	// TODO: handle cases where more than 512 elements are in a vao
+	// NOTE: the buffers grow if a vao has more than m_iVBOSize vertices (see drawVAO())
 	glBindBuffer(GL_ARRAY_BUFFER, m_iVBOVertices);
 	glVertexAttribPointer(m_iShaderTexturedGenericAttribPosition, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
-	glBufferData(GL_ARRAY_BUFFER, 512*sizeof(Vector3), NULL, GL_STREAM_DRAW);
 	glEnableVertexAttribArray(m_iShaderTexturedGenericAttribPosition);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_iVBOTexcoords);
 	glVertexAttribPointer(m_iShaderTexturedGenericAttribUV, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (GLvoid*)0);
-	glBufferData(GL_ARRAY_BUFFER, 512*sizeof(Vector2), NULL, GL_STREAM_DRAW);
 	glEnableVertexAttribArray(m_iShaderTexturedGenericAttribUV);
 
 	glBindBuffer(GL_ARRAY_BUFFER, m_iVBOTexcolors);
 	glVertexAttribPointer(m_iShaderTexturedGenericAttribCol, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
-	glBufferData(GL_ARRAY_BUFFER, 512*sizeof(Vector4), NULL, GL_STREAM_DRAW);
 	glEnableVertexAttribArray(m_iShaderTexturedGenericAttribCol);
+
+	allocateVBOs(m_iVBOSize);
 }
 
 void OpenGL3Interface::beginScene()
 {
 	m_bInScene = true;
 
+	beginFrameStats();
+
 	Matrix4 defaultProjectionMatrix = Camera::buildMatrixOrtho2D(0, m_vResolution.x, m_vResolution.y, 0);
 
 	// push main transforms
@@ -191,6 +206,9 @@ void OpenGL3Interface::beginScene()
 
 void OpenGL3Interface::endScene()
 {
+	flushBatch();
+	endFrameStats();
+
 	popTransform();
 
 	checkStackLeaks();
@@ -206,6 +224,8 @@ void OpenGL3Interface::endScene()
 
 void OpenGL3Interface::clearDepthBuffer()
 {
+	flushBatch();
+
 	glClear(GL_DEPTH_BUFFER_BIT);
 }
 
@@ -258,6 +278,16 @@ void OpenGL3Interface::drawLine(Vector2 pos1, Vector2 pos2)
 
 void OpenGL3Interface::drawRect(int x, int y, int width, int height)
 {
+	if (isBatchingRect())
+	{
+		// same pixels as the lines below
+		batchRect(x, y, width, 1, m_color);
+		batchRect(x, y, 1, height, m_color);
+		batchRect(x, y+height, width+1, 1, m_color);
+		batchRect(x+width, y, 1, height, m_color);
+		return;
+	}
+
 	drawLine(x, y, x+width, y);
 	drawLine(x, y, x, y+height);
 	drawLine(x, y+height, x+width+1, y+height);
@@ -266,6 +296,16 @@ void OpenGL3Interface::drawRect(int x, int y, int width, int height)
 
 void OpenGL3Interface::drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left)
 {
+	if (isBatchingRect())
+	{
+		batchRect(x, y, width, 1, top);
+		batchRect(x, y, 1, height, left);
+		batchRect(x, y+height, width+1, 1, bottom);
+		batchRect(x+width, y, 1, height, right);
+		setColor(right); // (same state as below)
+		return;
+	}
+
 	setColor(top);
 	drawLine(x, y, x+width, y);
 	setColor(left);
@@ -278,6 +318,12 @@ void OpenGL3Interface::drawRect(int x, int y, int width, int height, Color top,
 
 void OpenGL3Interface::fillRect(int x, int y, int width, int height)
 {
+	if (isBatching())
+	{
+		batchRect(x, y, width, height, m_color);
+		return;
+	}
+
 	updateTransform();
 
 	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
@@ -332,6 +378,13 @@ void OpenGL3Interface::fillRoundedRect(int x, int y, int width, int height, int
 
 void OpenGL3Interface::fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor)
 {
+	if (isBatching())
+	{
+		const Color colors[4] = {topLeftColor, bottomLeftColor, bottomRightColor, topRightColor};
+		batchRect(x, y, width, height, colors);
+		return;
+	}
+
 	updateTransform();
 
 	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
@@ -348,6 +401,15 @@ void OpenGL3Interface::fillGradient(int x, int y, int width, int height, Color t
 
 void OpenGL3Interface::drawQuad(int x, int y, int width, int height)
 {
+	if (isBatching())
+	{
+		const Vector2 vertices[4] = {Vector2(x, y), Vector2(x, y + height), Vector2(x + width, y + height), Vector2(x + width, y)};
+		const Vector2 texcoords[4] = {Vector2(0, 0), Vector2(0, 1), Vector2(1, 1), Vector2(1, 0)};
+		const Color colors[4] = {m_color, m_color, m_color, m_color};
+		batchQuad(NULL, vertices, texcoords, colors);
+		return;
+	}
+
 	updateTransform();
 
 	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
@@ -364,6 +426,15 @@ void OpenGL3Interface::drawQuad(int x, int y, int width, int height)
 
 void OpenGL3Interface::drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor)
 {
+	if (isBatching())
+	{
+		// NOTE: untextured, vertex colors always replaced the texture here
+		const Vector2 vertices[4] = {topLeft, bottomLeft, bottomRight, topRight};
+		const Color colors[4] = {topLeftColor, bottomLeftColor, bottomRightColor, topRightColor};
+		batchQuad(NULL, vertices, NULL, colors);
+		return;
+	}
+
 	updateTransform();
 
 	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
@@ -392,27 +463,37 @@ void OpenGL3Interface::drawImage(Image *image)
 	if (!image->isReady())
 		return;
 
-	updateTransform();
-
 	float width = image->getWidth();
 	float height = image->getHeight();
 
 	float x = -width/2;
 	float y = -height/2;
 
-	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
-	vao.addVertex(x, y);
-	vao.addTexcoord(0, 0);
-	vao.addVertex(x, y + height);
-	vao.addTexcoord(0, 1);
-	vao.addVertex(x + width, y + height);
-	vao.addTexcoord(1, 1);
-	vao.addVertex(x + width, y);
-	vao.addTexcoord(1, 0);
-
-	image->bind();
-	drawVAO(&vao);
-	image->unbind();
+	if (isBatching())
+	{
+		const Vector2 vertices[4] = {Vector2(x, y), Vector2(x, y + height), Vector2(x + width, y + height), Vector2(x + width, y)};
+		const Vector2 texcoords[4] = {Vector2(0, 0), Vector2(0, 1), Vector2(1, 1), Vector2(1, 0)};
+		const Color colors[4] = {m_color, m_color, m_color, m_color};
+		batchQuad(image, vertices, texcoords, colors);
+	}
+	else
+	{
+		updateTransform();
+
+		VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
+		vao.addVertex(x, y);
+		vao.addTexcoord(0, 0);
+		vao.addVertex(x, y + height);
+		vao.addTexcoord(0, 1);
+		vao.addVertex(x + width, y + height);
+		vao.addTexcoord(1, 1);
+		vao.addVertex(x + width, y);
+		vao.addTexcoord(1, 0);
+
+		image->bind();
+		drawVAO(&vao);
+		image->unbind();
+	}
 
 	if (r_debug_drawimage->getBool())
 	{
@@ -426,15 +507,28 @@ void OpenGL3Interface::drawString(McFont *font, UString text)
 	if (font == NULL || text.length() < 1 || !font->isReady())
 		return;
 
+	flushBatch();
 	updateTransform();
 
 	font->drawString(this, text);
 }
 
+void OpenGL3Interface::drawStringCached(McFont *font, const UString &text)
+{
+	if (font == NULL || text.length() < 1 || !font->isReady())
+		return;
+
+	flushBatch();
+	updateTransform();
+
+	font->drawStringCached(this, text);
+}
+
 void OpenGL3Interface::drawVAO(VertexArrayObject *vao)
 {
 	if (vao == NULL) return;
 
+	flushBatch();
 	updateTransform();
 
 	// if baked, then we can directly draw the buffer
@@ -443,19 +537,7 @@ void OpenGL3Interface::drawVAO(VertexArrayObject *vao)
 		OpenGL3VertexArrayObject *glvao = (OpenGL3VertexArrayObject*)vao;
 
 		// configure shader
-		if (glvao->getNumTexcoords0() > 0)
-		{
-			if (!m_bShaderTexturedGenericIsTextureEnabled)
-			{
-				m_shaderTexturedGeneric->setUniform1i("type", 1);
-				m_bShaderTexturedGenericIsTextureEnabled = true;
-			}
-		}
-		else if (m_bShaderTexturedGenericIsTextureEnabled)
-		{
-			m_bShaderTexturedGenericIsTextureEnabled = false;
-			m_shaderTexturedGeneric->setUniform1i("type", 0);
-		}
+		setShaderTexturedGenericType(glvao->getNumTexcoords0() > 0 ? 1 : 0);
 
 		// draw
 		glvao->draw();
@@ -538,6 +620,17 @@ void OpenGL3Interface::drawVAO(VertexArrayObject *vao)
 		}
 	}
 
+	// grow buffers if necessary
+	if (finalVertices.size() > m_iVBOSize)
+	{
+		unsigned int newSize = m_iVBOSize;
+		while (newSize < finalVertices.size())
+		{
+			newSize *= 2;
+		}
+		allocateVBOs(newSize);
+	}
+
 	// upload vertices to gpu
 	if (finalVertices.size() > 0)
 	{
@@ -560,38 +653,23 @@ void OpenGL3Interface::drawVAO(VertexArrayObject *vao)
 	}
 
 	// TODO: multitexturing support
-	// TODO: textured vertexcolors
-	if (finalTexcoords.size() > 0 && finalTexcoords[0].size() > 0)
-	{
-		if (!m_bShaderTexturedGenericIsTextureEnabled)
-		{
-			m_bShaderTexturedGenericIsTextureEnabled = true;
-			//GLint currentlyBoundTextureUnit = 0;
-			//glGetIntegerv(GL_TEXTURE_BINDING_2D, &currentlyBoundTextureUnit);
-
-			m_shaderTexturedGeneric->setUniform1i("type", 1);
-			//m_shaderTexturedGeneric->setUniform1i("tex", currentlyBoundTextureUnit);
-		}
-	}
-	else if (m_bShaderTexturedGenericIsTextureEnabled)
-	{
-		m_bShaderTexturedGenericIsTextureEnabled = false;
-		m_shaderTexturedGeneric->setUniform1i("type", 0);
-	}
-
+	const bool isTextured = (finalTexcoords.size() > 0 && finalTexcoords[0].size() > 0);
 	if (finalColors.size() > 0)
-	{
-		m_bShaderTexturedGenericIsTextureEnabled = false;
-		m_shaderTexturedGeneric->setUniform1i("type", 2);
-	}
+		setShaderTexturedGenericType(isTextured ? 3 : 2);
+	else
+		setShaderTexturedGenericType(isTextured ? 1 : 0);
 
 	// draw it
 	glDrawArrays(primitiveToOpenGL(primitive), 0, finalVertices.size());
+	countDrawCall(finalVertices.size());
 }
 
 void OpenGL3Interface::setClipRect(McRect clipRect)
 {
 	if (r_debug_disable_cliprect->getBool()) return;
+
+	flushBatch();
+	countClipChange();
 	//if (m_bIs3DScene) return; // HACKHACK:TODO:
 
 	// HACKHACK: compensate for viewport changes caused by RenderTargets!
@@ -628,6 +706,8 @@ void OpenGL3Interface::popClipRect()
 
 void OpenGL3Interface::pushStencil()
 {
+	flushBatch();
+
 	// init and clear
 	glClearStencil(0);
 	glClear(GL_STENCIL_BUFFER_BIT);
@@ -641,6 +721,8 @@ void OpenGL3Interface::pushStencil()
 
 void OpenGL3Interface::fillStencil(bool inside)
 {
+	flushBatch();
+
 	glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
 	glStencilFunc( GL_NOTEQUAL, inside ? 0 : 1, 1 );
 	glStencilOp( GL_KEEP, GL_KEEP, GL_KEEP );
@@ -648,11 +730,15 @@ void OpenGL3Interface::fillStencil(bool inside)
 
 void OpenGL3Interface::popStencil()
 {
+	flushBatch();
+
 	glDisable(GL_STENCIL_TEST);
 }
 
 void OpenGL3Interface::setClipping(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 	{
 		if (m_clipRectStack.size() > 0)
@@ -664,6 +750,8 @@ void OpenGL3Interface::setClipping(bool enabled)
 
 void OpenGL3Interface::setBlending(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 		glEnable(GL_BLEND);
 	else
@@ -672,6 +760,8 @@ void OpenGL3Interface::setBlending(bool enabled)
 
 void OpenGL3Interface::setDepthBuffer(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 		glEnable(GL_DEPTH_TEST);
 	else
@@ -680,6 +770,8 @@ void OpenGL3Interface::setDepthBuffer(bool enabled)
 
 void OpenGL3Interface::setCulling(bool culling)
 {
+	flushBatch();
+
 	if (culling)
 		glEnable(GL_CULL_FACE);
 	else
@@ -688,6 +780,8 @@ void OpenGL3Interface::setCulling(bool culling)
 
 void OpenGL3Interface::setAntialiasing(bool aa)
 {
+	flushBatch();
+
 	if (aa)
 		glEnable(GL_MULTISAMPLE);
 	else
@@ -696,6 +790,8 @@ void OpenGL3Interface::setAntialiasing(bool aa)
 
 void OpenGL3Interface::setWireframe(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	else
@@ -704,6 +800,7 @@ void OpenGL3Interface::setWireframe(bool enabled)
 
 void OpenGL3Interface::flush()
 {
+	flushBatch();
 	glFlush();
 }
 
@@ -746,6 +843,8 @@ int OpenGL3Interface::getVRAMRemaining()
 
 void OpenGL3Interface::onResolutionChange(Vector2 newResolution)
 {
+	flushBatch();
+
 	// rebuild viewport
 	m_vResolution = newResolution;
 	glViewport(0, 0, m_vResolution.x, m_vResolution.y);
@@ -797,6 +896,28 @@ void OpenGL3Interface::onTransformUpdate(Matrix4 &projectionMatrix, Matrix4 &wor
 	m_shaderTexturedGeneric->setUniformMatrix4fv("mvp", m_MP);
 }
 
+void OpenGL3Interface::setShaderTexturedGenericType(int type)
+{
+	if (type == m_iShaderTexturedGenericType) return;
+
+	m_iShaderTexturedGenericType = type;
+	m_shaderTexturedGeneric->setUniform1i("type", type);
+}
+
+void OpenGL3Interface::allocateVBOs(unsigned int numVertices)
+{
+	m_iVBOSize = numVertices;
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_iVBOVertices);
+	glBufferData(GL_ARRAY_BUFFER, m_iVBOSize*sizeof(Vector3), NULL, GL_STREAM_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_iVBOTexcoords);
+	glBufferData(GL_ARRAY_BUFFER, m_iVBOSize*sizeof(Vector2), NULL, GL_STREAM_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_iVBOTexcolors);
+	glBufferData(GL_ARRAY_BUFFER, m_iVBOSize*sizeof(Vector4), NULL, GL_STREAM_DRAW);
+}
+
 void OpenGL3Interface::handleGLErrors()
 {
 	int error = glGetError();
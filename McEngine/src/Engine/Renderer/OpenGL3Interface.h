@@ -49,6 +49,7 @@ public:
 	// 2d resource drawing
 	virtual void drawImage(Image *image);
 	virtual void drawString(McFont *font, UString text);
+	virtual void drawStringCached(McFont *font, const UString &text);
 
 	// 3d type drawing
 	virtual void drawVAO(VertexArrayObject *vao);
@@ -105,6 +106,9 @@ protected:
 private:
 	void handleGLErrors();
 
+	void setShaderTexturedGenericType(int type); // 0 = color, 1 = texture * color, 2 = vertex colors, 3 = texture * vertex colors
+	void allocateVBOs(unsigned int numVertices);
+
 	static int primitiveToOpenGL(Graphics::PRIMITIVE primitive);
 
 	// renderer
@@ -118,12 +122,13 @@ private:
 	int m_iShaderTexturedGenericAttribPosition;
 	int m_iShaderTexturedGenericAttribUV;
 	int m_iShaderTexturedGenericAttribCol;
-	bool m_bShaderTexturedGenericIsTextureEnabled;
+	int m_iShaderTexturedGenericType;
 
 	unsigned int m_iVA;
 	unsigned int m_iVBOVertices;
 	unsigned int m_iVBOTexcoords;
 	unsigned int m_iVBOTexcolors;
+	unsigned int m_iVBOSize;
 
 	// persistent vars
 	Color m_color;
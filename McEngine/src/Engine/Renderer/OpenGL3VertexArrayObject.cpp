@@ -112,6 +112,7 @@ void OpenGL3VertexArrayObject::draw()
 	glBindVertexArray(m_iVAO);
 	{
 		glDrawArrays(primitiveToOpenGL(m_primitive), start, end-start);
+		engine->getGraphics()->countDrawCall(end-start);
 	}
 	glBindVertexArray(vaoBackup); // restore vao
 }
@@ -148,6 +148,8 @@ void OpenGLES2Interface::beginScene()
 {
 	m_bInScene = true;
 
+	beginFrameStats();
+
 	// enable default shader (must happen before any uniform calls)
 	m_shaderTexturedGeneric->enable();
 
@@ -173,6 +175,8 @@ void OpenGLES2Interface::beginScene()
 
 void OpenGLES2Interface::endScene()
 {
+	endFrameStats();
+
 	popTransform();
 
 	checkStackLeaks();
@@ -359,6 +363,15 @@ void OpenGLES2Interface::drawString(McFont *font, UString text)
 	font->drawString(this, text);
 }
 
+void OpenGLES2Interface::drawStringCached(McFont *font, const UString &text)
+{
+	if (font == NULL || text.length() < 1 || !font->isReady()) return;
+
+	updateTransform();
+
+	font->drawStringCached(this, text);
+}
+
 void OpenGLES2Interface::drawVAO(VertexArrayObject *vao)
 {
 	if (vao == NULL) return;
@@ -522,6 +535,7 @@ void OpenGLES2Interface::drawVAO(VertexArrayObject *vao)
 
 	// draw it
 	glDrawArrays(primitiveToOpenGL(primitive), 0, finalVertices.size());
+	countDrawCall(finalVertices.size());
 }
 
 void OpenGLES2Interface::setClipRect(McRect clipRect)
@@ -529,6 +543,8 @@ void OpenGLES2Interface::setClipRect(McRect clipRect)
 	if (r_debug_disable_cliprect->getBool()) return;
 	//if (m_bIs3DScene) return; // HACKHACK:TODO:
 
+	countClipChange();
+
 	// HACKHACK: compensate for viewport changes caused by RenderTargets!
 	int viewport[4];
 	glGetIntegerv(GL_VIEWPORT, viewport);
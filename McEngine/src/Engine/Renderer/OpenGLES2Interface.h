@@ -49,6 +49,7 @@ public:
 	// 2d resource drawing
 	virtual void drawImage(Image *image);
 	virtual void drawString(McFont *font, UString text);
+	virtual void drawStringCached(McFont *font, const UString &text);
 
 	// 3d type drawing
 	void drawVAO(VertexArrayObject *vao);
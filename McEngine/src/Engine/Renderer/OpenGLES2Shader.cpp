@@ -57,6 +57,8 @@ void OpenGLES2Shader::enable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->countShaderChange();
+
 	glGetIntegerv(GL_CURRENT_PROGRAM, &m_iProgramBackup); // backup
 	glUseProgram(m_iProgram);
 }
@@ -99,6 +99,7 @@ void OpenGLES2VertexArrayObject::draw()
 	// draw
 	{
 		glDrawArrays(primitiveToOpenGL(m_primitive), start, end-start);
+		engine->getGraphics()->countDrawCall(end-start);
 	}
 
 	// reset
@@ -125,6 +125,10 @@ void OpenGLImage::destroy()
 {
 	if (m_GLTexture != 0)
 	{
+		// queued 2d primitives might still use this texture
+		if (engine->getGraphics() != NULL)
+			engine->getGraphics()->flushBatch();
+
 		glDeleteTextures(1, &m_GLTexture);
 		m_GLTexture = 0;
 	}
@@ -136,6 +140,9 @@ void OpenGLImage::bind(unsigned int textureUnit)
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+	engine->getGraphics()->countTextureBind();
+
 	m_iTextureUnitBackup = textureUnit;
 
 	// switch texture units before enabling+binding
@@ -154,6 +161,8 @@ void OpenGLImage::unbind()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+
 	// restore texture unit (just in case) and set to no texture
 	glActiveTexture(GL_TEXTURE0 + m_iTextureUnitBackup);
 	glBindTexture(GL_TEXTURE_2D, 0);
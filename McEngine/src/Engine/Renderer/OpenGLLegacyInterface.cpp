@@ -12,6 +12,7 @@
 #include "Engine.h"
 #include "ConVar.h"
 #include "Camera.h"
+#include "SpriteBatch.h"
 
 #include "Font.h"
 #include "OpenGLImage.h"
@@ -44,6 +45,9 @@ OpenGLLegacyInterface::OpenGLLegacyInterface() : Graphics()
 	m_color = 0xffffffff;
 	m_fClearZ = 1;
 	m_fZ = 1;
+
+	// 2d batching
+	m_batch = new SpriteBatch();
 }
 
 void OpenGLLegacyInterface::init()
@@ -100,6 +104,8 @@ void OpenGLLegacyInterface::beginScene()
 {
 	m_bInScene = true;
 
+	beginFrameStats();
+
 	Matrix4 defaultProjectionMatrix = Camera::buildMatrixOrtho2D(0, m_vResolution.x, m_vResolution.y, 0);
 
 	// push main transforms
@@ -122,6 +128,9 @@ void OpenGLLegacyInterface::beginScene()
 
 void OpenGLLegacyInterface::endScene()
 {
+	flushBatch();
+	endFrameStats();
+
 	popTransform();
 
 	checkStackLeaks();
@@ -137,6 +146,8 @@ void OpenGLLegacyInterface::endScene()
 
 void OpenGLLegacyInterface::clearDepthBuffer()
 {
+	flushBatch();
+
 	glClear(GL_DEPTH_BUFFER_BIT);
 }
 
@@ -160,12 +171,16 @@ void OpenGLLegacyInterface::setAlpha(float alpha)
 
 void OpenGLLegacyInterface::drawPixels(int x, int y, int width, int height, Graphics::DRAWPIXELS_TYPE type, const void *pixels)
 {
+	flushBatch();
+
 	glRasterPos2i(x, y + height); // '+height' because of opengl bottom left origin, but engine top left origin
 	glDrawPixels(width, height, GL_RGBA, (type == Graphics::DRAWPIXELS_TYPE::DRAWPIXELS_UBYTE ? GL_UNSIGNED_BYTE : GL_FLOAT), pixels);
+	countDrawCall(0);
 }
 
 void OpenGLLegacyInterface::drawPixel(int x, int y)
 {
+	flushBatch();
 	updateTransform();
 
 	glDisable(GL_TEXTURE_2D);
@@ -175,10 +190,12 @@ void OpenGLLegacyInterface::drawPixel(int x, int y)
 		glVertex2i(x, y);
 	}
 	glEnd();
+	countDrawCall(1);
 }
 
 void OpenGLLegacyInterface::drawLine(int x1, int y1, int x2, int y2)
 {
+	flushBatch();
 	updateTransform();
 
 	glDisable(GL_TEXTURE_2D);
@@ -189,6 +206,7 @@ void OpenGLLegacyInterface::drawLine(int x1, int y1, int x2, int y2)
 		glVertex2f(x2 + 0.5f, y2 + 0.5f);
 	}
 	glEnd();
+	countDrawCall(2);
 }
 
 void OpenGLLegacyInterface::drawLine(Vector2 pos1, Vector2 pos2)
@@ -198,6 +216,16 @@ void OpenGLLegacyInterface::drawLine(Vector2 pos1, Vector2 pos2)
 
 void OpenGLLegacyInterface::drawRect(int x, int y, int width, int height)
 {
+	if (isBatchingRect())
+	{
+		// same pixels as the lines below
+		batchRect((x + 1), y, (width - 1), 1, m_color);
+		batchRect(x, y, 1, height, m_color);
+		batchRect(x, (y + height), (width + 1), 1, m_color);
+		batchRect((x + width), y, 1, height, m_color);
+		return;
+	}
+
 	drawLine((x + 1), y, (x + width), y);
 	drawLine(x, y, x, (y + height));
 	drawLine(x, (y + height), (x + width + 1), (y + height));
@@ -206,6 +234,16 @@ void OpenGLLegacyInterface::drawRect(int x, int y, int width, int height)
 
 void OpenGLLegacyInterface::drawRect(int x, int y, int width, int height, Color top, Color right, Color bottom, Color left)
 {
+	if (isBatchingRect())
+	{
+		batchRect((x + 1), y, (width - 1), 1, top);
+		batchRect(x, y, 1, height, left);
+		batchRect(x, (y + height), (width + 1), 1, bottom);
+		batchRect((x + width), y, 1, height, right);
+		setColor(right); // (same state as below)
+		return;
+	}
+
 	setColor(top);
 	drawLine((x + 1), y, (x + width), y);
 
@@ -221,6 +259,12 @@ void OpenGLLegacyInterface::drawRect(int x, int y, int width, int height, Color
 
 void OpenGLLegacyInterface::fillRect(int x, int y, int width, int height)
 {
+	if (isBatching())
+	{
+		batchRect(x, y, width, height, m_color);
+		return;
+	}
+
 	updateTransform();
 
 	glDisable(GL_TEXTURE_2D);
@@ -233,6 +277,7 @@ void OpenGLLegacyInterface::fillRect(int x, int y, int width, int height)
 		glVertex2i((x + width), y);
 	}
 	glEnd();
+	countDrawCall(4);
 }
 
 void OpenGLLegacyInterface::fillRoundedRect(int x, int y, int width, int height, int radius)
@@ -243,40 +288,54 @@ void OpenGLLegacyInterface::fillRoundedRect(int x, int y, int width, int height,
 	double i = 0;
 	double factor = 0.05;
 
+	flushBatch();
 	updateTransform();
 
 	glDisable(GL_TEXTURE_2D);
 
+	int numVertices = 0;
 	glBegin(GL_POLYGON);
 	{
 		for(i=PI; i<=(1.5*PI); i+=factor)
 		{
 			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // top left
+			numVertices++;
 		}
 
 		xOffset = x + width - radius;
 		for(i=(1.5*PI); i<=(2*PI); i+=factor)
 		{
 			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // top right
+			numVertices++;
 		}
 
 		yOffset = y + height - radius;
 		for(i=0; i<=(0.5*PI); i+=factor)
 		{
 			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // bottom right
+			numVertices++;
 		}
 
 		xOffset = x + radius;
 		for(i=(0.5*PI); i<=PI; i+=factor)
 		{
 			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // bottom left
+			numVertices++;
 		}
 	}
 	glEnd();
+	countDrawCall(numVertices);
 }
 
 void OpenGLLegacyInterface::fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor)
 {
+	if (isBatching())
+	{
+		const Color colors[4] = {topLeftColor, bottomLeftColor, bottomRightColor, topRightColor};
+		batchRect(x, y, width, height, colors);
+		return;
+	}
+
 	updateTransform();
 
 	glDisable(GL_TEXTURE_2D);
@@ -296,10 +355,20 @@ void OpenGLLegacyInterface::fillGradient(int x, int y, int width, int height, Co
 		glVertex2i(x, (y + height));
 	}
 	glEnd();
+	countDrawCall(4);
 }
 
 void OpenGLLegacyInterface::drawQuad(int x, int y, int width, int height)
 {
+	if (isBatching())
+	{
+		const Vector2 vertices[4] = {Vector2(x, y), Vector2(x, (y + height)), Vector2((x + width), (y + height)), Vector2((x + width), y)};
+		const Vector2 texcoords[4] = {Vector2(0, 0), Vector2(0, 1), Vector2(1, 1), Vector2(1, 0)};
+		const Color colors[4] = {m_color, m_color, m_color, m_color};
+		batchQuad(NULL, vertices, texcoords, colors);
+		return;
+	}
+
 	updateTransform();
 
 	glBegin(GL_QUADS);
@@ -321,10 +390,20 @@ void OpenGLLegacyInterface::drawQuad(int x, int y, int width, int height)
 		glVertex2f((x + width), y);
 	}
 	glEnd();
+	countDrawCall(4);
 }
 
 void OpenGLLegacyInterface::drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor)
 {
+	if (isBatching())
+	{
+		const Vector2 vertices[4] = {topLeft, bottomLeft, bottomRight, topRight};
+		const Vector2 texcoords[4] = {Vector2(0, 0), Vector2(0, 1), Vector2(1, 1), Vector2(1, 0)};
+		const Color colors[4] = {topLeftColor, bottomLeftColor, bottomRightColor, topRightColor};
+		batchQuad(NULL, vertices, texcoords, colors);
+		return;
+	}
+
 	updateTransform();
 
 	glBegin(GL_QUADS);
@@ -346,6 +425,7 @@ void OpenGLLegacyInterface::drawQuad(Vector2 topLeft, Vector2 topRight, Vector2
 		glVertex2f(topRight.x, topRight.y);
 	}
 	glEnd();
+	countDrawCall(4);
 }
 
 void OpenGLLegacyInterface::drawImage(Image *image)
@@ -357,34 +437,45 @@ void OpenGLLegacyInterface::drawImage(Image *image)
 	}
 	if (!image->isReady()) return;
 
-	updateTransform();
-
 	const float width = image->getWidth();
 	const float height = image->getHeight();
 
 	const float x = -width/2;
 	const float y = -height/2;
 
-	image->bind();
+	if (isBatching())
 	{
-		glBegin(GL_QUADS);
-		{
-			glTexCoord2f(0, 0);
-			glVertex2f(x, y);
-
-			glTexCoord2f(0, 1);
-			glVertex2f(x, (y + height));
-
-			glTexCoord2f(1, 1);
-			glVertex2f((x + width), (y + height));
+		const Vector2 vertices[4] = {Vector2(x, y), Vector2(x, (y + height)), Vector2((x + width), (y + height)), Vector2((x + width), y)};
+		const Vector2 texcoords[4] = {Vector2(0, 0), Vector2(0, 1), Vector2(1, 1), Vector2(1, 0)};
+		const Color colors[4] = {m_color, m_color, m_color, m_color};
+		batchQuad(image, vertices, texcoords, colors);
+	}
+	else
+	{
+		updateTransform();
 
-			glTexCoord2f(1, 0);
-			glVertex2f((x + width), y);
+		image->bind();
+		{
+			glBegin(GL_QUADS);
+			{
+				glTexCoord2f(0, 0);
+				glVertex2f(x, y);
+
+				glTexCoord2f(0, 1);
+				glVertex2f(x, (y + height));
+
+				glTexCoord2f(1, 1);
+				glVertex2f((x + width), (y + height));
+
+				glTexCoord2f(1, 0);
+				glVertex2f((x + width), y);
+			}
+			glEnd();
+			countDrawCall(4);
 		}
-		glEnd();
+		if (r_image_unbind_after_drawimage.getBool())
+			image->unbind();
 	}
-	if (r_image_unbind_after_drawimage.getBool())
-		image->unbind();
 
 	if (r_debug_drawimage->getBool())
 	{
@@ -397,6 +488,7 @@ void OpenGLLegacyInterface::drawString(McFont *font, UString text)
 {
 	if (font == NULL || text.length() < 1 || !font->isReady()) return;
 
+	flushBatch();
 	updateTransform();
 
 	if (r_debug_flush_drawstring->getBool())
@@ -410,10 +502,29 @@ void OpenGLLegacyInterface::drawString(McFont *font, UString text)
 	font->drawString(this, text);
 }
 
+void OpenGLLegacyInterface::drawStringCached(McFont *font, const UString &text)
+{
+	if (font == NULL || text.length() < 1 || !font->isReady()) return;
+
+	flushBatch();
+	updateTransform();
+
+	if (r_debug_flush_drawstring->getBool())
+	{
+		glFinish();
+		glFlush();
+		glFinish();
+		glFlush();
+	}
+
+	font->drawStringCached(this, text);
+}
+
 void OpenGLLegacyInterface::drawVAO(VertexArrayObject *vao)
 {
 	if (vao == NULL) return;
 
+	flushBatch();
 	updateTransform();
 
 	// if baked, then we can directly draw the buffer
@@ -428,6 +539,8 @@ void OpenGLLegacyInterface::drawVAO(VertexArrayObject *vao)
 	const std::vector<std::vector<Vector2>> &texcoords = vao->getTexcoords();
 	const std::vector<Color> &colors = vao->getColors();
 
+	const Color prevColor = m_color;
+
 	glBegin(primitiveToOpenGL(vao->getPrimitive()));
 	for (int i=0; i<vertices.size(); i++)
 	{
@@ -446,11 +559,19 @@ void OpenGLLegacyInterface::drawVAO(VertexArrayObject *vao)
 		glVertex3f(vertices[i].x, vertices[i].y, vertices[i].z);
 	}
 	glEnd();
+	countDrawCall(vertices.size());
+
+	// vertex colors must not leak into the following draws
+	if (colors.size() > 0)
+		setColor(prevColor);
 }
 
 void OpenGLLegacyInterface::setClipRect(McRect clipRect)
 {
 	if (r_debug_disable_cliprect->getBool()) return;
+
+	flushBatch();
+	countClipChange();
 	//if (m_bIs3DScene) return; // HACKHACK:TODO:
 
 	// HACKHACK: compensate for viewport changes caused by RenderTargets!
@@ -487,6 +608,8 @@ void OpenGLLegacyInterface::popClipRect()
 
 void OpenGLLegacyInterface::pushStencil()
 {
+	flushBatch();
+
 	// init and clear
 	glClearStencil(0);
 	glClear(GL_STENCIL_BUFFER_BIT);
@@ -500,6 +623,8 @@ void OpenGLLegacyInterface::pushStencil()
 
 void OpenGLLegacyInterface::fillStencil(bool inside)
 {
+	flushBatch();
+
 	glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
 	glStencilFunc( GL_NOTEQUAL, inside ? 0 : 1, 1 );
 	glStencilOp( GL_KEEP, GL_KEEP, GL_KEEP );
@@ -507,11 +632,15 @@ void OpenGLLegacyInterface::fillStencil(bool inside)
 
 void OpenGLLegacyInterface::popStencil()
 {
+	flushBatch();
+
 	glDisable(GL_STENCIL_TEST);
 }
 
 void OpenGLLegacyInterface::setClipping(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 	{
 		if (m_clipRectStack.size() > 0)
@@ -523,6 +652,8 @@ void OpenGLLegacyInterface::setClipping(bool enabled)
 
 void OpenGLLegacyInterface::setBlending(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 		glEnable(GL_BLEND);
 	else
@@ -531,6 +662,8 @@ void OpenGLLegacyInterface::setBlending(bool enabled)
 
 void OpenGLLegacyInterface::setDepthBuffer(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 		glEnable(GL_DEPTH_TEST);
 	else
@@ -539,6 +672,8 @@ void OpenGLLegacyInterface::setDepthBuffer(bool enabled)
 
 void OpenGLLegacyInterface::setCulling(bool culling)
 {
+	flushBatch();
+
 	if (culling)
 		glEnable(GL_CULL_FACE);
 	else
@@ -547,6 +682,8 @@ void OpenGLLegacyInterface::setCulling(bool culling)
 
 void OpenGLLegacyInterface::setAntialiasing(bool aa)
 {
+	flushBatch();
+
 	m_bAntiAliasing = aa;
 	if (aa)
 		glEnable(GL_MULTISAMPLE);
@@ -556,6 +693,8 @@ void OpenGLLegacyInterface::setAntialiasing(bool aa)
 
 void OpenGLLegacyInterface::setWireframe(bool enabled)
 {
+	flushBatch();
+
 	if (enabled)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 	else
@@ -564,6 +703,7 @@ void OpenGLLegacyInterface::setWireframe(bool enabled)
 
 void OpenGLLegacyInterface::flush()
 {
+	flushBatch();
 	glFlush();
 }
 
@@ -582,6 +722,8 @@ std::vector<unsigned char> OpenGLLegacyInterface::getScreenshot()
 
 	unsigned int numElements = width*height*3;
 
+	flushBatch();
+
 	// take screenshot
 	unsigned char *pixels = new unsigned char[numElements];
 	glFinish();
@@ -650,6 +792,8 @@ int OpenGLLegacyInterface::getVRAMRemaining()
 
 void OpenGLLegacyInterface::onResolutionChange(Vector2 newResolution)
 {
+	flushBatch();
+
 	// rebuild viewport
 	m_vResolution = newResolution;
 	glViewport(0, 0, m_vResolution.x, m_vResolution.y);
@@ -701,6 +845,19 @@ void OpenGLLegacyInterface::onTransformUpdate(Matrix4 &projectionMatrix, Matrix4
 	glLoadMatrixf(worldMatrix.get());
 }
 
+void OpenGLLegacyInterface::drawBatch(VertexArrayObject *vao, Image *image)
+{
+	if (image != NULL)
+		image->bind();
+	else if (vao->getTexcoords().size() < 1)
+		glDisable(GL_TEXTURE_2D); // same as fillRect()
+
+	drawVAO(vao);
+
+	if (image != NULL && r_image_unbind_after_drawimage.getBool())
+		image->unbind();
+}
+
 int OpenGLLegacyInterface::primitiveToOpenGL(Graphics::PRIMITIVE primitive)
 {
 	switch (primitive)
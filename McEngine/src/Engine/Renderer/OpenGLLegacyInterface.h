@@ -49,6 +49,7 @@ public:
 	// 2d resource drawing
 	virtual void drawImage(Image *image);
 	virtual void drawString(McFont *font, UString text);
+	virtual void drawStringCached(McFont *font, const UString &text);
 
 	// 3d type drawing
 	virtual void drawVAO(VertexArrayObject *vao);
@@ -82,6 +83,7 @@ public:
 	virtual UString getVersion();
 	virtual int getVRAMTotal();
 	virtual int getVRAMRemaining();
+	virtual bool supportsCustomShaders() const {return true;}
 
 	// callbacks
 	virtual void onResolutionChange(Vector2 newResolution);
@@ -97,6 +99,7 @@ public:
 protected:
 	virtual void init();
 	virtual void onTransformUpdate(Matrix4 &projectionMatrix, Matrix4 &worldMatrix);
+	virtual void drawBatch(VertexArrayObject *vao, Image *image);
 
 private:
 	static int primitiveToOpenGL(Graphics::PRIMITIVE primitive);
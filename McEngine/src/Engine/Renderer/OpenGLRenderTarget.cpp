@@ -234,6 +234,9 @@ void OpenGLRenderTarget::enable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+	engine->getGraphics()->countRenderTargetChange();
+
 	// bind framebuffer
 	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_iFrameBufferBackup); // backup
 	glBindFramebuffer(GL_FRAMEBUFFER, m_iFrameBuffer);
@@ -256,6 +259,8 @@ void OpenGLRenderTarget::disable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+
 	// if multisampled, blit content for multisampling into resolve texture
 #ifdef MCENGINE_FEATURE_OPENGL
 
@@ -287,6 +292,9 @@ void OpenGLRenderTarget::bind(unsigned int textureUnit)
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+	engine->getGraphics()->countTextureBind();
+
 	m_iTextureUnitBackup = textureUnit;
 
 	// switch texture units before enabling+binding
@@ -305,6 +313,8 @@ void OpenGLRenderTarget::unbind()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+
 	// restore texture unit (just in case) and set to no texture
 	glActiveTexture(GL_TEXTURE0 + m_iTextureUnitBackup);
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -57,6 +57,9 @@ void OpenGLShader::enable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+	engine->getGraphics()->countShaderChange();
+
 	glGetIntegerv(GL_CURRENT_PROGRAM, &m_iProgramBackup); // backup
 	glUseProgramObjectARB(m_iProgram);
 }
@@ -65,6 +68,8 @@ void OpenGLShader::disable()
 {
 	if (!m_bReady) return;
 
+	engine->getGraphics()->flushBatch();
+
 	glUseProgramObjectARB(m_iProgramBackup); // restore
 }
 
@@ -96,6 +96,7 @@ void OpenGLVertexArrayObject::draw()
 
 	// render it
 	glDrawArrays(primitiveToOpenGL(m_primitive), start, end-start);
+	engine->getGraphics()->countDrawCall(end-start);
 
 	// disable everything
 	if (m_iNumTexcoords > 0)
@@ -16,6 +16,21 @@
 #include "SWImage.h"
 #include "SWRenderTarget.h"
 #include "SWShader.h"
+#include "SWSpanKernels.h"
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+#include <thread>
+
+#endif
+
+ConVar r_sw_tiled("r_sw_tiled", true, "queue software rasterizer primitives until the end of the frame, binned into screen tiles, which are then rasterized in parallel by the job system (only if there are job_workers, otherwise primitives are always rasterized immediately)");
+ConVar r_sw_tile_size("r_sw_tile_size", 64, "size in pixels of the screen tiles for r_sw_tiled");
+
+static const size_t SW_MAX_QUEUED_PRIMITIVES = 65536;
 
 
 SWGraphicsInterface::SWGraphicsInterface() : Graphics()
@@ -23,12 +38,41 @@ SWGraphicsInterface::SWGraphicsInterface() : Graphics()
 	// renderer
 	m_vResolution = engine->getScreenSize(); // initial viewport size = window size
 	m_backBuffer = new PIXEL[(int)(m_vResolution.x*m_vResolution.y)];
+	m_backBufferDepth = new float[(int)(m_vResolution.x*m_vResolution.y)];
+	m_backBufferStencil = new unsigned char[(int)(m_vResolution.x*m_vResolution.y)];
+
+	m_renderTarget = NULL;
+	setTarget(m_backBuffer, m_backBufferDepth, m_backBufferStencil, (int)m_vResolution.x, (int)m_vResolution.y, 0, 0);
 
 	// persistent vars
 	m_bAntiAliasing = true;
+	m_bBlending = true;
+	m_bDepthBuffer = false;
+	m_bCulling = false;
 	m_color = 0xffffffff;
 	m_fClearZ = 1;
 	m_fZ = 1;
+	m_texture.texels = NULL;
+	m_texture.width = 0;
+	m_texture.height = 0;
+	m_texture.flipped = false;
+	m_texture.bilinear = false;
+	m_texture.repeat = false;
+
+	// clipping
+	m_bClipping = false;
+	m_iClipMinX = 0;
+	m_iClipMinY = 0;
+	m_iClipMaxX = 0;
+	m_iClipMaxY = 0;
+
+	// stencil
+	m_stencilMode = STENCIL_MODE::STENCIL_MODE_DISABLED;
+
+	// tiled rasterization
+	m_iTileSize = 64;
+	m_iNumTilesX = 0;
+	m_iNumTilesY = 0;
 }
 
 void SWGraphicsInterface::init()
@@ -39,10 +83,16 @@ SWGraphicsInterface::~SWGraphicsInterface()
 {
 	if (m_backBuffer != NULL)
 		delete[] m_backBuffer;
+	if (m_backBufferDepth != NULL)
+		delete[] m_backBufferDepth;
+	if (m_backBufferStencil != NULL)
+		delete[] m_backBufferStencil;
 }
 
 void SWGraphicsInterface::beginScene()
 {
+	beginFrameStats();
+
 	Matrix4 defaultProjectionMatrix = Camera::buildMatrixOrtho2D(0, m_vResolution.x, m_vResolution.y, 0);
 
 	// push main transforms
@@ -55,10 +105,16 @@ void SWGraphicsInterface::beginScene()
 
 	// clear backbuffer
 	memset(m_backBuffer, 0, sizeof(PIXEL) * (int)(m_vResolution.x*m_vResolution.y));
+	std::fill(m_backBufferDepth, m_backBufferDepth + (int)(m_vResolution.x*m_vResolution.y), m_fClearZ);
+	memset(m_backBufferStencil, 0, (int)(m_vResolution.x*m_vResolution.y));
 }
 
 void SWGraphicsInterface::endScene()
 {
+	flush();
+
+	endFrameStats();
+
 	popTransform();
 
 	checkStackLeaks();
@@ -72,7 +128,9 @@ void SWGraphicsInterface::endScene()
 
 void SWGraphicsInterface::clearDepthBuffer()
 {
-	// TODO:
+	flush();
+
+	std::fill(m_depthBuffer, m_depthBuffer + m_iTargetWidth*m_iTargetHeight, m_fClearZ);
 }
 
 void SWGraphicsInterface::setColor(Color color)
@@ -99,63 +157,47 @@ void SWGraphicsInterface::drawPixels(int x, int y, int width, int height, Graphi
 void SWGraphicsInterface::drawPixel(int x, int y)
 {
 	updateTransform();
+	countDrawCall(1);
 
-	if (x < 0 || x > m_vResolution.x-1 || y < 0 || y > m_vResolution.y-1)
+	x -= m_iTargetOffsetX;
+	y -= m_iTargetOffsetY;
+	if (x < 0 || x > m_iTargetWidth-1 || y < 0 || y > m_iTargetHeight-1)
 		return;
 
-	const int index = x + (int)(y*m_vResolution.x);
-
-	PIXEL ssrcPixel = getColorPixel(m_color);
-	PIXEL sdstPixel = m_backBuffer[index];
-	Color srcPixel = COLOR(ssrcPixel.a, ssrcPixel.r, ssrcPixel.g, ssrcPixel.b);
-	Color dstPixel = COLOR(sdstPixel.a, sdstPixel.r, sdstPixel.g, sdstPixel.b);
-	Color finalColor = COLORf((COLOR_GET_Af(srcPixel)*COLOR_GET_Af(srcPixel) + COLOR_GET_Af(dstPixel)*(1.0f - COLOR_GET_Af(srcPixel))),
-							  (COLOR_GET_Rf(srcPixel)*COLOR_GET_Af(srcPixel) + COLOR_GET_Rf(dstPixel)*(1.0f - COLOR_GET_Af(srcPixel))),
-							  (COLOR_GET_Gf(srcPixel)*COLOR_GET_Af(srcPixel) + COLOR_GET_Gf(dstPixel)*(1.0f - COLOR_GET_Af(srcPixel))),
-							  (COLOR_GET_Bf(srcPixel)*COLOR_GET_Af(srcPixel) + COLOR_GET_Bf(dstPixel)*(1.0f - COLOR_GET_Af(srcPixel))));
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_RECT;
+	primitive.minX = primitive.maxX = x;
+	primitive.minY = primitive.maxY = y;
+	primitive.color = getColorPixel(m_color);
 
-	m_backBuffer[index] = getColorPixel(finalColor);
+	addPrimitive(primitive);
 }
 
 void SWGraphicsInterface::drawLine(int x1, int y1, int x2, int y2)
 {
-	// Bresenham's line algorithm
-	const bool steep = (std::abs(y2 - y1) > std::abs(x2 - x1));
-	if (steep)
-	{
-		std::swap(x1, y1);
-		std::swap(x2, y2);
-	}
-
-	if (x1 > x2)
-	{
-		std::swap(x1, x2);
-		std::swap(y1, y2);
-	}
-
-	const float dx = x2 - x1;
-	const float dy = std::abs(y2 - y1);
-
-	float error = dx / 2.0f;
-	const int ystep = (y1 < y2) ? 1 : -1;
-	int y = y1;
-
-	const int maxX = x2;
-
-	for (int x=x1; x<maxX; x++)
-	{
-		if (steep)
-			drawPixel(y, x); // implicitly calls updateTransform()
-		else
-			drawPixel(x, y);
-
-		error -= dy;
-		if (error < 0)
-		{
-			y += ystep;
-			error += dx;
-		}
-	}
+	updateTransform();
+	countDrawCall(2);
+
+	x1 -= m_iTargetOffsetX;
+	y1 -= m_iTargetOffsetY;
+	x2 -= m_iTargetOffsetX;
+	y2 -= m_iTargetOffsetY;
+
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_PIXEL_LINE;
+	primitive.x1 = x1;
+	primitive.y1 = y1;
+	primitive.x2 = x2;
+	primitive.y2 = y2;
+	primitive.minX = std::max(std::min(x1, x2), 0);
+	primitive.maxX = std::min(std::max(x1, x2), m_iTargetWidth - 1);
+	primitive.minY = std::max(std::min(y1, y2), 0);
+	primitive.maxY = std::min(std::max(y1, y2), m_iTargetHeight - 1);
+	if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+
+	primitive.color = getColorPixel(m_color);
+
+	addPrimitive(primitive);
 }
 
 void SWGraphicsInterface::drawLine(Vector2 pos1, Vector2 pos2)
@@ -186,77 +228,128 @@ void SWGraphicsInterface::drawRect(int x, int y, int width, int height, Color to
 void SWGraphicsInterface::fillRect(int x, int y, int width, int height)
 {
 	updateTransform();
+	countDrawCall(4);
 
-	// TODO: make this faster
-	for (int xx=0; xx<width; xx++)
-	{
-		for (int yy=0; yy<height; yy++)
-		{
-			drawPixel(x + xx, y + yy);
-		}
-	}
+	x -= m_iTargetOffsetX;
+	y -= m_iTargetOffsetY;
+
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_RECT;
+	primitive.minX = std::max(x, 0);
+	primitive.minY = std::max(y, 0);
+	primitive.maxX = std::min(x + width, m_iTargetWidth) - 1;
+	primitive.maxY = std::min(y + height, m_iTargetHeight) - 1;
+	if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+
+	primitive.color = getColorPixel(m_color);
+
+	addPrimitive(primitive);
 }
 
 void SWGraphicsInterface::fillRoundedRect(int x, int y, int width, int height, int radius)
 {
-	/*
-	float xOffset= x + radius;
+	float xOffset = x + radius;
 	float yOffset = y + radius;
 
 	double i = 0;
 	double factor = 0.05;
-	*/
 
 	updateTransform();
 
-	// TODO:
-	/*
-	glDisable(GL_TEXTURE_2D);
-	glBegin(GL_POLYGON);
-
-		for(i=PI; i<=(1.5*PI); i+=factor)
+	// convex, so a fan of the same polygon as in the opengl renderer (untextured, since the vao has no texcoords)
+	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_TRIANGLE_FAN);
+	{
+		for (i=PI; i<=(1.5*PI); i+=factor)
 		{
-			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // top left
+			vao.addVertex(radius*std::cos(i) + xOffset, radius*std::sin(i) + yOffset); // top left
 		}
 
 		xOffset = x + width - radius;
-		for(i=(1.5*PI); i<=(2*PI); i+=factor)
+		for (i=(1.5*PI); i<=(2*PI); i+=factor)
 		{
-			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // top right
+			vao.addVertex(radius*std::cos(i) + xOffset, radius*std::sin(i) + yOffset); // top right
 		}
 
 		yOffset = y + height - radius;
-		for(i=0; i<=(0.5*PI); i+=factor)
+		for (i=0; i<=(0.5*PI); i+=factor)
 		{
-			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // bottom right
+			vao.addVertex(radius*std::cos(i) + xOffset, radius*std::sin(i) + yOffset); // bottom right
 		}
 
 		xOffset = x + radius;
-		for(i=(0.5*PI); i<=PI; i+=factor)
+		for (i=(0.5*PI); i<=PI; i+=factor)
 		{
-			glVertex2d(radius* std::cos(i) + xOffset, radius * std::sin(i) + yOffset); // bottom left
+			vao.addVertex(radius*std::cos(i) + xOffset, radius*std::sin(i) + yOffset); // bottom left
 		}
-
-	glEnd();
-	*/
+	}
+	drawVAO(&vao);
 }
 
 void SWGraphicsInterface::fillGradient(int x, int y, int width, int height, Color topLeftColor, Color topRightColor, Color bottomLeftColor, Color bottomRightColor)
 {
 	updateTransform();
-	// TODO:
+	countDrawCall(4);
+
+	if (width < 1 || height < 1) return;
+
+	x -= m_iTargetOffsetX;
+	y -= m_iTargetOffsetY;
+
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_GRADIENT;
+	primitive.x1 = x;
+	primitive.y1 = y;
+	primitive.x2 = x + width;
+	primitive.y2 = y + height;
+	primitive.minX = std::max(x, 0);
+	primitive.minY = std::max(y, 0);
+	primitive.maxX = std::min(x + width, m_iTargetWidth) - 1;
+	primitive.maxY = std::min(y + height, m_iTargetHeight) - 1;
+	if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+
+	primitive.gradient[0] = getColorPixel(topLeftColor);
+	primitive.gradient[1] = getColorPixel(topRightColor);
+	primitive.gradient[2] = getColorPixel(bottomLeftColor);
+	primitive.gradient[3] = getColorPixel(bottomRightColor);
+
+	addPrimitive(primitive);
 }
 
 void SWGraphicsInterface::drawQuad(int x, int y, int width, int height)
 {
 	updateTransform();
-	// TODO:
+
+	// NOTE: drawVAO() splits quads into two triangles
+	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
+	vao.addVertex(x, y);
+	vao.addTexcoord(0, 0);
+	vao.addVertex(x, y + height);
+	vao.addTexcoord(0, 1);
+	vao.addVertex(x + width, y + height);
+	vao.addTexcoord(1, 1);
+	vao.addVertex(x + width, y);
+	vao.addTexcoord(1, 0);
+	drawVAO(&vao);
 }
 
 void SWGraphicsInterface::drawQuad(Vector2 topLeft, Vector2 topRight, Vector2 bottomRight, Vector2 bottomLeft, Color topLeftColor, Color topRightColor, Color bottomRightColor, Color bottomLeftColor)
 {
 	updateTransform();
-	// TODO:
+
+	VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_QUADS);
+	vao.addVertex(topLeft.x, topLeft.y);
+	vao.addColor(topLeftColor);
+	vao.addTexcoord(0, 0);
+	vao.addVertex(bottomLeft.x, bottomLeft.y);
+	vao.addColor(bottomLeftColor);
+	vao.addTexcoord(0, 1);
+	vao.addVertex(bottomRight.x, bottomRight.y);
+	vao.addColor(bottomRightColor);
+	vao.addTexcoord(1, 1);
+	vao.addVertex(topRight.x, topRight.y);
+	vao.addColor(topRightColor);
+	vao.addTexcoord(1, 0);
+	drawVAO(&vao);
 }
 
 void SWGraphicsInterface::drawImage(Image *image)
@@ -269,30 +362,32 @@ void SWGraphicsInterface::drawImage(Image *image)
 	if (!image->isReady())
 		return;
 
+	const float width = image->getWidth();
+	const float height = image->getHeight();
+
 	updateTransform();
 
 	image->bind();
-
-	float width = image->getWidth();
-	float height = image->getHeight();
-
-	float x = -width/2;
-	float y = -height/2;
-
-	// TODO:
-	Vector4 start = m_worldMatrix * Vector4(x,y,0,1);
-	Vector4 size = (m_worldMatrix * Vector4(x+width,y+height,0,1)) - start;
-	drawRect(start.x, start.y, size.x, size.y);
-
+	{
+		addImage(width, height);
+		countDrawCall(4);
+	}
 	image->unbind();
 
-	/*
-	if (r_debug_drawimage.getBool())
+	if (r_debug_drawimage->getBool())
 	{
+		// NOTE: drawLine() does not apply the world matrix
+		const Vector4 topLeft = m_worldMatrix * Vector4(-width/2, -height/2, 0, 1);
+		const Vector4 topRight = m_worldMatrix * Vector4(width/2, -height/2, 0, 1);
+		const Vector4 bottomRight = m_worldMatrix * Vector4(width/2, height/2, 0, 1);
+		const Vector4 bottomLeft = m_worldMatrix * Vector4(-width/2, height/2, 0, 1);
+
 		setColor(0xbbff00ff);
-		drawRect(x, y, width, height);
+		drawLine(topLeft.x, topLeft.y, topRight.x, topRight.y);
+		drawLine(topRight.x, topRight.y, bottomRight.x, bottomRight.y);
+		drawLine(bottomRight.x, bottomRight.y, bottomLeft.x, bottomLeft.y);
+		drawLine(bottomLeft.x, bottomLeft.y, topLeft.x, topLeft.y);
 	}
-	*/
 }
 
 void SWGraphicsInterface::drawString(McFont *font, UString text)
@@ -305,63 +400,121 @@ void SWGraphicsInterface::drawString(McFont *font, UString text)
 	font->drawString(this, text);
 }
 
+void SWGraphicsInterface::drawStringCached(McFont *font, const UString &text)
+{
+	if (font == NULL || text.length() < 1 || !font->isReady())
+		return;
+
+	updateTransform();
+
+	font->drawStringCached(this, text);
+}
+
 void SWGraphicsInterface::drawVAO(VertexArrayObject *vao)
 {
-	/*
+	if (vao == NULL) return;
+
+	updateTransform();
+
 	const std::vector<Vector3> &vertices = vao->getVertices();
-	const std::vector<Vector3> &normals = vao->getNormals();
 	const std::vector<std::vector<Vector2>> &texcoords = vao->getTexcoords();
 	const std::vector<Color> &colors = vao->getColors();
-	*/
 
-	updateTransform();
+	if (vertices.size() < 2) return;
 
-	// TODO:
-	/*
-	GLenum type = GL_TRIANGLES;
-	if (vao->getPrimitive() == Graphics::PRIMITIVE::PRIMITIVE_TRIANGLE_FAN)
-		type = GL_TRIANGLE_FAN;
-	else if (vao->getPrimitive() == Graphics::PRIMITIVE::PRIMITIVE_QUADS)
-		type = GL_QUADS;
+	countDrawCall(vertices.size());
 
-	glBegin(type);
-	for (int i=0; i<vertices.size(); i++)
+	// only the first texture unit is supported, and only if the mesh has texcoords for it
+	const bool textured = (m_texture.texels != NULL && texcoords.size() > 0 && texcoords[0].size() > 0);
+
+	// vertex stage
+	const Matrix4 mvp = m_projectionMatrix * m_worldMatrix;
+	std::vector<VERTEX> clipVertices(vertices.size());
+	for (size_t i=0; i<vertices.size(); i++)
 	{
-		if (i < colors.size())
-			setColor(colors[i]);
+		VERTEX &vertex = clipVertices[i];
+		vertex.pos = mvp * Vector4(vertices[i].x, vertices[i].y, vertices[i].z, 1.0f);
+
+		const Color color = (i < colors.size() ? colors[i] : m_color);
+		vertex.r = COLOR_GET_Rf(color);
+		vertex.g = COLOR_GET_Gf(color);
+		vertex.b = COLOR_GET_Bf(color);
+		vertex.a = COLOR_GET_Af(color);
 
-		for (int t=0; t<texcoords.size(); t++)
+		if (textured && i < texcoords[0].size())
 		{
-			if (i < texcoords[t].size())
-				glMultiTexCoord2f(GL_TEXTURE0 + t, texcoords[t][i].x, texcoords[t][i].y);
+			vertex.u = texcoords[0][i].x;
+			vertex.v = texcoords[0][i].y;
 		}
+		else
+		{
+			vertex.u = 0.0f;
+			vertex.v = 0.0f;
+		}
+	}
 
-		if (i < normals.size())
-			glNormal3f(normals[i].x, normals[i].y, normals[i].z);
-
-		glVertex3f(vertices[i].x, vertices[i].y, vertices[i].z);
+	// primitive assembly
+	const int numVertices = (int)clipVertices.size();
+	switch (vao->getPrimitive())
+	{
+	case Graphics::PRIMITIVE::PRIMITIVE_LINES:
+		for (int i=0; i+1<numVertices; i+=2)
+		{
+			drawLine(clipVertices[i], clipVertices[i+1], textured);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_LINE_STRIP:
+		for (int i=0; i+1<numVertices; i++)
+		{
+			drawLine(clipVertices[i], clipVertices[i+1], textured);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES:
+		for (int i=0; i+2<numVertices; i+=3)
+		{
+			drawTriangle(clipVertices[i], clipVertices[i+1], clipVertices[i+2], textured);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_TRIANGLE_FAN:
+		for (int i=1; i+1<numVertices; i++)
+		{
+			drawTriangle(clipVertices[0], clipVertices[i], clipVertices[i+1], textured);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_TRIANGLE_STRIP:
+		for (int i=0; i+2<numVertices; i++)
+		{
+			// every other triangle is flipped, to keep the winding order (for culling)
+			if (i % 2 == 0)
+				drawTriangle(clipVertices[i], clipVertices[i+1], clipVertices[i+2], textured);
+			else
+				drawTriangle(clipVertices[i+1], clipVertices[i], clipVertices[i+2], textured);
+		}
+		break;
+	case Graphics::PRIMITIVE::PRIMITIVE_QUADS:
+		for (int i=0; i+3<numVertices; i+=4)
+		{
+			drawTriangle(clipVertices[i], clipVertices[i+1], clipVertices[i+2], textured);
+			drawTriangle(clipVertices[i], clipVertices[i+2], clipVertices[i+3], textured);
+		}
+		break;
 	}
-	glEnd();
-	*/
 }
 
 void SWGraphicsInterface::setClipRect(McRect clipRect)
 {
-	///if (r_debug_disable_cliprect.getBool()) return;
-	//if (m_bIs3DScene) return;
-
-	// TODO:
-	/*
-	int viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
-	//debugLog("viewport = %i, %i, %i, %i\n", viewport[0], viewport[1], viewport[2], viewport[3]);
-
-	glEnable(GL_SCISSOR_TEST);
-	glScissor((int)clipRect.getX()+viewport[0], viewport[3]-((int)clipRect.getY()-viewport[1]-1+(int)clipRect.getHeight()), (int)clipRect.getWidth(), (int)clipRect.getHeight());
-
-	//debugLog("scissor = %i, %i, %i, %i\n", (int)clipRect.getX()+viewport[0], viewport[3]-((int)clipRect.getY()-viewport[1]-1+(int)clipRect.getHeight()), (int)clipRect.getWidth(), (int)clipRect.getHeight());
-	*/
+	if (r_debug_disable_cliprect->getBool()) return;
+	//if (m_bIs3DScene) return; // HACKHACK:TODO:
+
+	countClipChange();
+
+	// NOTE: the clip rect is applied per primitive (see addPrimitive()), so changing it does not need a flush()
+	// same pixels as the scissor rects of the opengl/dx11 renderers, which are shifted up by one pixel
+	m_bClipping = true;
+	m_iClipMinX = (int)clipRect.getX();
+	m_iClipMinY = (int)clipRect.getY() - 1;
+	m_iClipMaxX = m_iClipMinX + (int)clipRect.getWidth() - 1;
+	m_iClipMaxY = m_iClipMinY + (int)clipRect.getHeight() - 1;
 }
 
 void SWGraphicsInterface::pushClipRect(McRect clipRect)
@@ -386,46 +539,45 @@ void SWGraphicsInterface::popClipRect()
 
 void SWGraphicsInterface::pushStencil()
 {
-	// TODO:
+	// queued primitives still see the previous stencil buffer
+	flush();
+
+	// init and clear
+	if (m_stencilBuffer != NULL)
+		memset(m_stencilBuffer, 0, m_iTargetWidth*m_iTargetHeight);
+
+	// set mask
+	m_stencilMode = STENCIL_MODE::STENCIL_MODE_WRITE;
 }
 
 void SWGraphicsInterface::fillStencil(bool inside)
 {
-	// TODO:
+	m_stencilMode = (inside ? STENCIL_MODE::STENCIL_MODE_INSIDE : STENCIL_MODE::STENCIL_MODE_OUTSIDE);
 }
 
 void SWGraphicsInterface::popStencil()
 {
-	// TODO:
+	m_stencilMode = STENCIL_MODE::STENCIL_MODE_DISABLED;
 }
 
 void SWGraphicsInterface::setClipping(bool enabled)
 {
-	// TODO:
-	/*
-	if (enabled)
-	{
-		if (m_clipRectStack.size() > 0)
-			glEnable(GL_SCISSOR_TEST);
-	}
-	else
-		glDisable(GL_SCISSOR_TEST);
-	*/
+	m_bClipping = (enabled && m_clipRectStack.size() > 0);
 }
 
 void SWGraphicsInterface::setBlending(bool enabled)
 {
-	// TODO:
+	m_bBlending = enabled;
 }
 
 void SWGraphicsInterface::setDepthBuffer(bool enabled)
 {
-	// TODO:
+	m_bDepthBuffer = enabled;
 }
 
 void SWGraphicsInterface::setCulling(bool culling)
 {
-	// TODO:
+	m_bCulling = culling;
 }
 
 void SWGraphicsInterface::setAntialiasing(bool aa)
@@ -440,7 +592,63 @@ void SWGraphicsInterface::setWireframe(bool enabled)
 
 void SWGraphicsInterface::flush()
 {
-	// TODO:
+	if (m_primitives.size() < 1) return;
+
+	VPROF("SWGraphicsInterface::flush");
+
+	const int numTiles = m_iNumTilesX*m_iNumTilesY;
+	JobSystem *jobSystem = engine->getJobSystem();
+	const int numWorkers = (jobSystem != NULL ? std::min(jobSystem->getNumWorkers(), numTiles - 1) : 0);
+
+	if (numWorkers < 1)
+	{
+		for (int i=0; i<numTiles; i++)
+		{
+			rasterizeTile(i);
+		}
+	}
+	else
+	{
+		// tiles are handed out one at a time, because their costs are very uneven (e.g. text vs. empty background)
+		// the queue is shared, so that workers which only start after everything is done can still safely look at it
+		struct TILE_QUEUE
+		{
+			std::atomic<int> nextTile;
+			std::atomic<int> numFinishedTiles;
+		};
+		std::shared_ptr<TILE_QUEUE> queue = std::make_shared<TILE_QUEUE>();
+		queue->nextTile = 0;
+		queue->numFinishedTiles = 0;
+
+		auto rasterizeTiles = [this, queue, numTiles]
+		{
+			int tile;
+			while ((tile = queue->nextTile++) < numTiles)
+			{
+				rasterizeTile(tile);
+				queue->numFinishedTiles++;
+			}
+		};
+
+		for (int i=0; i<numWorkers; i++)
+		{
+			jobSystem->add(rasterizeTiles);
+		}
+
+		// the main thread helps, and then waits for the tiles which are still being rasterized
+		// NOTE: not JobSystem::wait(), since that could run main thread jobs (e.g. texture uploads) while the tiles are still reading textures
+		rasterizeTiles();
+		while (queue->numFinishedTiles.load() < numTiles)
+		{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+			std::this_thread::yield();
+
+#endif
+		}
+	}
+
+	m_primitives.clear();
 }
 
 std::vector<unsigned char> SWGraphicsInterface::getScreenshot()
@@ -458,10 +666,16 @@ std::vector<unsigned char> SWGraphicsInterface::getScreenshot()
 
 	unsigned int numElements = width*height*3;
 
+	flush();
+
 	// take screenshot
 	unsigned char *pixels = new unsigned char[numElements];
-
-	// TODO:
+	for (unsigned int i=0; i<width*height; i++)
+	{
+		pixels[i*3 + 0] = m_backBuffer[i].r;
+		pixels[i*3 + 1] = m_backBuffer[i].g;
+		pixels[i*3 + 2] = m_backBuffer[i].b;
+	}
 
 	// copy to vector
 	result.reserve(numElements);
@@ -498,12 +712,25 @@ int SWGraphicsInterface::getVRAMRemaining()
 
 void SWGraphicsInterface::onResolutionChange(Vector2 newResolution)
 {
+	flush();
+
 	m_vResolution = newResolution;
 
 	// rebuild viewport
 	if (m_backBuffer != NULL)
 		delete[] m_backBuffer;
+	if (m_backBufferDepth != NULL)
+		delete[] m_backBufferDepth;
+	if (m_backBufferStencil != NULL)
+		delete[] m_backBufferStencil;
 	m_backBuffer = new PIXEL[(int)(m_vResolution.x*m_vResolution.y)];
+	m_backBufferDepth = new float[(int)(m_vResolution.x*m_vResolution.y)];
+	m_backBufferStencil = new unsigned char[(int)(m_vResolution.x*m_vResolution.y)];
+	std::fill(m_backBufferDepth, m_backBufferDepth + (int)(m_vResolution.x*m_vResolution.y), m_fClearZ);
+	memset(m_backBufferStencil, 0, (int)(m_vResolution.x*m_vResolution.y));
+
+	if (m_renderTarget == NULL)
+		setTarget(m_backBuffer, m_backBufferDepth, m_backBufferStencil, (int)m_vResolution.x, (int)m_vResolution.y, 0, 0);
 }
 
 Image *SWGraphicsInterface::createImage(UString filePath, bool mipmapped, bool keepInSystemMemory)
@@ -542,6 +769,887 @@ void SWGraphicsInterface::onTransformUpdate(Matrix4 &projectionMatrix, Matrix4 &
 	m_worldMatrix = worldMatrix;
 }
 
+void SWGraphicsInterface::setTexture(const PIXEL *texels, int width, int height, bool flipped, Graphics::FILTER_MODE filterMode, Graphics::WRAP_MODE wrapMode)
+{
+	m_texture.texels = (width > 0 && height > 0 ? texels : NULL);
+	m_texture.width = width;
+	m_texture.height = height;
+	m_texture.flipped = flipped;
+	m_texture.bilinear = (filterMode != Graphics::FILTER_MODE::FILTER_MODE_NONE);
+	m_texture.repeat = (wrapMode == Graphics::WRAP_MODE::WRAP_MODE_REPEAT);
+}
+
+void SWGraphicsInterface::setRenderTarget(SWRenderTarget *renderTarget)
+{
+	// everything queued so far belongs to the previous target
+	flush();
+
+	m_renderTarget = renderTarget;
+
+	// NOTE: rendertargets use the same projection as the screen, everything is just shifted by their position (same as the viewport of OpenGLRenderTarget)
+	if (m_renderTarget != NULL)
+		setTarget(m_renderTarget->getColorBuffer(), m_renderTarget->getDepthBuffer(), m_renderTarget->getStencilBuffer(), (int)m_renderTarget->getWidth(), (int)m_renderTarget->getHeight(), (int)m_renderTarget->getPos().x, (int)m_renderTarget->getPos().y);
+	else
+		setTarget(m_backBuffer, m_backBufferDepth, m_backBufferStencil, (int)m_vResolution.x, (int)m_vResolution.y, 0, 0);
+}
+
+void SWGraphicsInterface::setTarget(PIXEL *colorBuffer, float *depthBuffer, unsigned char *stencilBuffer, int width, int height, int offsetX, int offsetY)
+{
+	m_colorBuffer = colorBuffer;
+	m_depthBuffer = depthBuffer;
+	m_stencilBuffer = stencilBuffer;
+	m_iTargetWidth = width;
+	m_iTargetHeight = height;
+	m_iTargetOffsetX = offsetX;
+	m_iTargetOffsetY = offsetY;
+}
+
+// clip space planes (dot(plane, pos) >= 0 is inside): near, far, and a guard band around the viewport (keeps the fixed point window coordinates small)
+static const float SW_GUARD_BAND = 4.0f;
+static const Vector4 SW_CLIP_PLANES[6] =
+{
+	Vector4(0.0f, 0.0f, 1.0f, 1.0f),
+	Vector4(0.0f, 0.0f, -1.0f, 1.0f),
+	Vector4(1.0f, 0.0f, 0.0f, SW_GUARD_BAND),
+	Vector4(-1.0f, 0.0f, 0.0f, SW_GUARD_BAND),
+	Vector4(0.0f, 1.0f, 0.0f, SW_GUARD_BAND),
+	Vector4(0.0f, -1.0f, 0.0f, SW_GUARD_BAND)
+};
+
+// 24.8 fixed point, so that edge functions are exact and no pixel is ever drawn twice along shared edges
+static const int SW_SUBPIXEL_BITS = 8;
+static const int64_t SW_SUBPIXELS = (1 << SW_SUBPIXEL_BITS);
+static const int64_t SW_HALF_PIXEL = SW_SUBPIXELS / 2;
+
+static inline int64_t swToFixed(float value)
+{
+	return (int64_t)std::floor(value*SW_SUBPIXELS + 0.5f);
+}
+
+static inline float swClipDistance(const Vector4 &plane, const Vector4 &pos, int planeIndex)
+{
+	// the near plane also rejects w = 0
+	return plane.x*pos.x + plane.y*pos.y + plane.z*pos.z + plane.w*pos.w - (planeIndex == 0 ? 1e-6f : 0.0f);
+}
+
+static inline SWSpanKernels::TEXTURE swGetSpanTexture(const SWGraphicsInterface::PIXEL *texels, int width, int height, bool bilinear, bool repeat)
+{
+	SWSpanKernels::TEXTURE texture;
+	texture.texels = (const unsigned char*)texels;
+	texture.width = width;
+	texture.height = height;
+	texture.bilinear = bilinear;
+	texture.repeat = repeat;
+	return texture;
+}
+
+// narrows [first, last] down to the i for which 0 <= start + i*step < limit
+static inline void swClipSpan(int64_t start, int64_t step, int64_t limit, int &first, int &last)
+{
+	int64_t lo = first;
+	int64_t hi = last;
+	if (step == 0)
+	{
+		if (start < 0 || start >= limit)
+			hi = lo - 1;
+	}
+	else
+	{
+		// floor division (the remainders of / are truncated towards zero)
+		const int64_t absStep = (step > 0 ? step : -step);
+		const int64_t a = (step > 0 ? -start : start - limit); // i*|step| >= a (step > 0), or > a (step < 0)
+		const int64_t b = (step > 0 ? limit - start : start); // i*|step| < b (step > 0), or <= b (step < 0)
+		const int64_t aFloor = (a >= 0 ? a / absStep : -((-a + absStep - 1) / absStep));
+		const int64_t bFloor = (b >= 0 ? b / absStep : -((-b + absStep - 1) / absStep));
+		if (step > 0)
+		{
+			lo = std::max(lo, aFloor + (aFloor*absStep < a ? 1 : 0));
+			hi = std::min(hi, bFloor - (bFloor*absStep == b ? 1 : 0));
+		}
+		else
+		{
+			lo = std::max(lo, aFloor + 1);
+			hi = std::min(hi, bFloor);
+		}
+	}
+
+	first = (int)lo;
+	last = (int)std::max(hi, lo - 1);
+}
+
+template <typename T>
+static inline T swLerp(const T &a, const T &b, float t)
+{
+	T result = a;
+	result.pos = Vector4(a.pos.x + (b.pos.x - a.pos.x)*t, a.pos.y + (b.pos.y - a.pos.y)*t, a.pos.z + (b.pos.z - a.pos.z)*t, a.pos.w + (b.pos.w - a.pos.w)*t);
+	result.r = a.r + (b.r - a.r)*t;
+	result.g = a.g + (b.g - a.g)*t;
+	result.b = a.b + (b.b - a.b)*t;
+	result.a = a.a + (b.a - a.a)*t;
+	result.u = a.u + (b.u - a.u)*t;
+	result.v = a.v + (b.v - a.v)*t;
+	return result;
+}
+
+void SWGraphicsInterface::drawTriangle(const VERTEX &v0, const VERTEX &v1, const VERTEX &v2, bool textured)
+{
+	// trivial accept/reject
+	int outsideMask = 0;
+	for (int p=0; p<6; p++)
+	{
+		const int outside = (swClipDistance(SW_CLIP_PLANES[p], v0.pos, p) < 0.0f ? 1 : 0) + (swClipDistance(SW_CLIP_PLANES[p], v1.pos, p) < 0.0f ? 1 : 0) + (swClipDistance(SW_CLIP_PLANES[p], v2.pos, p) < 0.0f ? 1 : 0);
+		if (outside == 3) return;
+		if (outside > 0)
+			outsideMask |= (1 << p);
+	}
+
+	// clip (Sutherland-Hodgman), each plane adds at most one vertex
+	VERTEX polygons[2][3 + 6];
+	int numVertices = 3;
+	polygons[0][0] = v0;
+	polygons[0][1] = v1;
+	polygons[0][2] = v2;
+
+	int current = 0;
+	for (int p=0; p<6; p++)
+	{
+		if (!(outsideMask & (1 << p))) continue;
+
+		const VERTEX *in = polygons[current];
+		VERTEX *out = polygons[1 - current];
+		int numOut = 0;
+		for (int i=0; i<numVertices; i++)
+		{
+			const VERTEX &a = in[i];
+			const VERTEX &b = in[(i + 1) % numVertices];
+			const float da = swClipDistance(SW_CLIP_PLANES[p], a.pos, p);
+			const float db = swClipDistance(SW_CLIP_PLANES[p], b.pos, p);
+
+			if (da >= 0.0f)
+				out[numOut++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f))
+				out[numOut++] = swLerp(a, b, da / (da - db));
+		}
+
+		numVertices = numOut;
+		current = 1 - current;
+		if (numVertices < 3) return;
+	}
+
+	// project and triangulate (fan)
+	VERTEX *polygon = polygons[current];
+	for (int i=0; i<numVertices; i++)
+	{
+		projectVertex(polygon[i]);
+	}
+	for (int i=1; i+1<numVertices; i++)
+	{
+		addTriangle(polygon[0], polygon[i], polygon[i+1], textured);
+	}
+}
+
+void SWGraphicsInterface::drawLine(const VERTEX &v0, const VERTEX &v1, bool textured)
+{
+	// clip (parametric)
+	float t0 = 0.0f;
+	float t1 = 1.0f;
+	for (int p=0; p<6; p++)
+	{
+		const float d0 = swClipDistance(SW_CLIP_PLANES[p], v0.pos, p);
+		const float d1 = swClipDistance(SW_CLIP_PLANES[p], v1.pos, p);
+		if (d0 < 0.0f && d1 < 0.0f) return;
+
+		if (d0 < 0.0f)
+			t0 = std::max(t0, d0 / (d0 - d1));
+		else if (d1 < 0.0f)
+			t1 = std::min(t1, d0 / (d0 - d1));
+	}
+	if (t0 > t1) return;
+
+	VERTEX a = (t0 > 0.0f ? swLerp(v0, v1, t0) : v0);
+	VERTEX b = (t1 < 1.0f ? swLerp(v0, v1, t1) : v1);
+	projectVertex(a);
+	projectVertex(b);
+
+	addLine(a, b, textured);
+}
+
+void SWGraphicsInterface::projectVertex(VERTEX &vertex)
+{
+	const float invW = 1.0f / vertex.pos.w;
+
+	// ndc to window (top left origin, same as the engine)
+	vertex.pos.x = (vertex.pos.x*invW*0.5f + 0.5f)*m_vResolution.x - m_iTargetOffsetX;
+	vertex.pos.y = (0.5f - vertex.pos.y*invW*0.5f)*m_vResolution.y - m_iTargetOffsetY;
+	vertex.pos.z = vertex.pos.z*invW*0.5f + 0.5f;
+	vertex.pos.w = invW;
+
+	vertex.r *= invW;
+	vertex.g *= invW;
+	vertex.b *= invW;
+	vertex.a *= invW;
+	vertex.u *= invW;
+	vertex.v *= invW;
+}
+
+void SWGraphicsInterface::addTriangle(const VERTEX &v0, const VERTEX &v1, const VERTEX &v2, bool textured)
+{
+	const int64_t x0 = swToFixed(v0.pos.x);
+	const int64_t y0 = swToFixed(v0.pos.y);
+	const int64_t x1 = swToFixed(v1.pos.x);
+	const int64_t y1 = swToFixed(v1.pos.y);
+	const int64_t x2 = swToFixed(v2.pos.x);
+	const int64_t y2 = swToFixed(v2.pos.y);
+
+	const int64_t area = (x1 - x0)*(y2 - y0) - (y1 - y0)*(x2 - x0);
+	if (area == 0) return;
+
+	// front faces are counterclockwise in opengl window space (y up), which is a negative area here (y down)
+	if (m_bCulling && area > 0) return;
+
+	// bounding box of all covered pixel centers
+	const int64_t minX = std::min(x0, std::min(x1, x2));
+	const int64_t maxX = std::max(x0, std::max(x1, x2));
+	const int64_t minY = std::min(y0, std::min(y1, y2));
+	const int64_t maxY = std::max(y0, std::max(y1, y2));
+
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_TRIANGLE;
+	primitive.minX = (int)std::max<int64_t>((minX - SW_HALF_PIXEL + SW_SUBPIXELS - 1) >> SW_SUBPIXEL_BITS, 0);
+	primitive.maxX = (int)std::min<int64_t>((maxX - SW_HALF_PIXEL) >> SW_SUBPIXEL_BITS, m_iTargetWidth - 1);
+	primitive.minY = (int)std::max<int64_t>((minY - SW_HALF_PIXEL + SW_SUBPIXELS - 1) >> SW_SUBPIXEL_BITS, 0);
+	primitive.maxY = (int)std::min<int64_t>((maxY - SW_HALF_PIXEL) >> SW_SUBPIXEL_BITS, m_iTargetHeight - 1);
+	if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+
+	// always rasterize with a positive area
+	primitive.vertices[0] = v0;
+	primitive.vertices[1] = (area > 0 ? v1 : v2);
+	primitive.vertices[2] = (area > 0 ? v2 : v1);
+	primitive.textured = textured;
+
+	addPrimitive(primitive);
+}
+
+void SWGraphicsInterface::addLine(const VERTEX &v0, const VERTEX &v1, bool textured)
+{
+	if (v0.pos.x == v1.pos.x && v0.pos.y == v1.pos.y) return;
+
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_LINE;
+	primitive.minX = std::max((int)std::floor(std::min(v0.pos.x, v1.pos.x)) - 1, 0);
+	primitive.maxX = std::min((int)std::floor(std::max(v0.pos.x, v1.pos.x)) + 1, m_iTargetWidth - 1);
+	primitive.minY = std::max((int)std::floor(std::min(v0.pos.y, v1.pos.y)) - 1, 0);
+	primitive.maxY = std::min((int)std::floor(std::max(v0.pos.y, v1.pos.y)) + 1, m_iTargetHeight - 1);
+	if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+
+	primitive.vertices[0] = v0;
+	primitive.vertices[1] = v1;
+	primitive.textured = textured;
+
+	addPrimitive(primitive);
+}
+
+void SWGraphicsInterface::addImage(float width, float height)
+{
+	if (m_texture.texels == NULL || width <= 0.0f || height <= 0.0f) return;
+
+	// same quad as the opengl renderers
+	const float x = -width/2;
+	const float y = -height/2;
+	const Vector2 positions[4] = {Vector2(x, y), Vector2(x, y + height), Vector2(x + width, y + height), Vector2(x + width, y)};
+	const Vector2 texcoords[4] = {Vector2(0, 0), Vector2(0, 1), Vector2(1, 1), Vector2(1, 0)};
+
+	const Matrix4 mvp = m_projectionMatrix * m_worldMatrix;
+	VERTEX corners[4];
+	bool affine = (!m_bDepthBuffer && !m_bCulling);
+	for (int i=0; i<4; i++)
+	{
+		VERTEX &corner = corners[i];
+		corner.pos = mvp * Vector4(positions[i].x, positions[i].y, 0.0f, 1.0f);
+		corner.r = COLOR_GET_Rf(m_color);
+		corner.g = COLOR_GET_Gf(m_color);
+		corner.b = COLOR_GET_Bf(m_color);
+		corner.a = COLOR_GET_Af(m_color);
+		corner.u = texcoords[i].x;
+		corner.v = texcoords[i].y;
+
+		// anything which isn't a flat 2d blit goes through the triangle rasterizer (perspective, near/far clipping, depth, culling)
+		if (corner.pos.w != 1.0f || corner.pos.z < -1.0f || corner.pos.z > 1.0f)
+			affine = false;
+	}
+
+	if (!affine)
+	{
+		drawTriangle(corners[0], corners[1], corners[2], true);
+		drawTriangle(corners[0], corners[2], corners[3], true);
+		return;
+	}
+
+	// window space, snapped to the subpixel grid of the triangle rasterizer (so that unscaled images at integer positions map exactly onto texel centers)
+	double windowX[4];
+	double windowY[4];
+	for (int i=0; i<4; i++)
+	{
+		projectVertex(corners[i]);
+		windowX[i] = (double)swToFixed(corners[i].pos.x) / SW_SUBPIXELS;
+		windowY[i] = (double)swToFixed(corners[i].pos.y) / SW_SUBPIXELS;
+	}
+
+	// one texel along the texture axes, in pixels
+	const double ux = (windowX[3] - windowX[0]) / m_texture.width;
+	const double uy = (windowY[3] - windowY[0]) / m_texture.width;
+	const double vx = (windowX[1] - windowX[0]) / m_texture.height;
+	const double vy = (windowY[1] - windowY[0]) / m_texture.height;
+	const double det = ux*vy - uy*vx;
+	if (std::abs(det) < 1e-6) return; // degenerate, or texels far below one pixel
+
+	PRIMITIVE primitive;
+	primitive.type = PRIMITIVE::TYPE::TYPE_IMAGE;
+
+	// inverse mapping, from the center of pixel (0, 0) to texel coordinates
+	const double dx = 0.5 - windowX[0];
+	const double dy = 0.5 - windowY[0];
+	primitive.s = (vy*dx - vx*dy) / det;
+	primitive.t = (ux*dy - uy*dx) / det;
+	primitive.dsdx = vy / det;
+	primitive.dtdx = -uy / det;
+	primitive.dsdy = -vx / det;
+	primitive.dtdy = ux / det;
+	if (m_texture.flipped)
+	{
+		primitive.t = m_texture.height - primitive.t;
+		primitive.dtdx = -primitive.dtdx;
+		primitive.dtdy = -primitive.dtdy;
+	}
+
+	// bounding box (with one pixel of slack, the exact coverage is determined per row)
+	const double minX = std::min(std::min(windowX[0], windowX[1]), std::min(windowX[2], windowX[3]));
+	const double maxX = std::max(std::max(windowX[0], windowX[1]), std::max(windowX[2], windowX[3]));
+	const double minY = std::min(std::min(windowY[0], windowY[1]), std::min(windowY[2], windowY[3]));
+	const double maxY = std::max(std::max(windowY[0], windowY[1]), std::max(windowY[2], windowY[3]));
+	primitive.minX = (int)std::max(std::ceil(minX - 0.5) - 1.0, 0.0);
+	primitive.maxX = (int)std::min(std::floor(maxX - 0.5) + 1.0, (double)(m_iTargetWidth - 1));
+	primitive.minY = (int)std::max(std::ceil(minY - 0.5) - 1.0, 0.0);
+	primitive.maxY = (int)std::min(std::floor(maxY - 0.5) + 1.0, (double)(m_iTargetHeight - 1));
+	if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+
+	primitive.color = getColorPixel(m_color);
+	primitive.textured = true;
+
+	addPrimitive(primitive);
+}
+
+void SWGraphicsInterface::addPrimitive(PRIMITIVE &primitive)
+{
+	// clip rect, applied to the covered region itself: clipped pixels are never visited, and fully clipped primitives are never queued
+	if (m_bClipping)
+	{
+		primitive.minX = std::max(primitive.minX, m_iClipMinX - m_iTargetOffsetX);
+		primitive.minY = std::max(primitive.minY, m_iClipMinY - m_iTargetOffsetY);
+		primitive.maxX = std::min(primitive.maxX, m_iClipMaxX - m_iTargetOffsetX);
+		primitive.maxY = std::min(primitive.maxY, m_iClipMaxY - m_iTargetOffsetY);
+		if (primitive.minX > primitive.maxX || primitive.minY > primitive.maxY) return;
+	}
+
+	// snapshot of the state at the time of the draw call
+	primitive.texture = m_texture;
+	primitive.blending = m_bBlending;
+	primitive.depthTest = m_bDepthBuffer;
+	primitive.stencilMode = (m_stencilBuffer != NULL ? m_stencilMode : STENCIL_MODE::STENCIL_MODE_DISABLED);
+
+	// binning only pays off if the tiles are rasterized in parallel
+	const JobSystem *jobSystem = engine->getJobSystem();
+	if (!r_sw_tiled.getBool() || jobSystem == NULL || jobSystem->getNumWorkers() < 1)
+	{
+		// primitives which were queued before r_sw_tiled/job_workers changed have to be drawn first
+		if (m_primitives.size() > 0)
+			flush();
+
+		rasterizePrimitive(primitive, 0, 0, m_iTargetWidth - 1, m_iTargetHeight - 1);
+		return;
+	}
+
+	// the tile grid is fixed until the next flush()
+	if (m_primitives.size() < 1)
+	{
+		m_iTileSize = clamp<int>(r_sw_tile_size.getInt(), 8, 1024);
+		m_iNumTilesX = (m_iTargetWidth + m_iTileSize - 1) / m_iTileSize;
+		m_iNumTilesY = (m_iTargetHeight + m_iTileSize - 1) / m_iTileSize;
+
+		if ((int)m_tiles.size() < m_iNumTilesX*m_iNumTilesY)
+			m_tiles.resize(m_iNumTilesX*m_iNumTilesY);
+	}
+
+	// bin into all overlapped tiles
+	const unsigned int index = (unsigned int)m_primitives.size();
+	m_primitives.push_back(primitive);
+
+	const int startTileX = primitive.minX / m_iTileSize;
+	const int endTileX = primitive.maxX / m_iTileSize;
+	const int startTileY = primitive.minY / m_iTileSize;
+	const int endTileY = primitive.maxY / m_iTileSize;
+	for (int ty=startTileY; ty<=endTileY; ty++)
+	{
+		for (int tx=startTileX; tx<=endTileX; tx++)
+		{
+			m_tiles[tx + ty*m_iNumTilesX].push_back(index);
+		}
+	}
+
+	// limit memory usage, in case there is no endScene() for a while (e.g. when drawing into a rendertarget during loading)
+	if (m_primitives.size() >= SW_MAX_QUEUED_PRIMITIVES)
+		flush();
+}
+
+void SWGraphicsInterface::rasterizeTile(int tile)
+{
+	std::vector<unsigned int> &primitives = m_tiles[tile];
+	if (primitives.size() < 1) return;
+
+	const int tileX = (tile % m_iNumTilesX) * m_iTileSize;
+	const int tileY = (tile / m_iNumTilesX) * m_iTileSize;
+	const int minX = tileX;
+	const int minY = tileY;
+	const int maxX = std::min(tileX + m_iTileSize, m_iTargetWidth) - 1;
+	const int maxY = std::min(tileY + m_iTileSize, m_iTargetHeight) - 1;
+
+	// in submission order, so that blending and depth testing give exactly the same result as drawing everything at once
+	for (size_t i=0; i<primitives.size(); i++)
+	{
+		rasterizePrimitive(m_primitives[primitives[i]], minX, minY, maxX, maxY);
+	}
+
+	primitives.clear();
+}
+
+void SWGraphicsInterface::rasterizePrimitive(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	minX = std::max(minX, primitive.minX);
+	minY = std::max(minY, primitive.minY);
+	maxX = std::min(maxX, primitive.maxX);
+	maxY = std::min(maxY, primitive.maxY);
+	if (minX > maxX || minY > maxY) return;
+
+	switch (primitive.type)
+	{
+	case PRIMITIVE::TYPE::TYPE_TRIANGLE:
+		rasterizeTriangle(primitive, minX, minY, maxX, maxY);
+		break;
+	case PRIMITIVE::TYPE::TYPE_LINE:
+		rasterizeLine(primitive, minX, minY, maxX, maxY);
+		break;
+	case PRIMITIVE::TYPE::TYPE_RECT:
+		rasterizeRect(primitive, minX, minY, maxX, maxY);
+		break;
+	case PRIMITIVE::TYPE::TYPE_GRADIENT:
+		rasterizeGradient(primitive, minX, minY, maxX, maxY);
+		break;
+	case PRIMITIVE::TYPE::TYPE_PIXEL_LINE:
+		rasterizePixelLine(primitive, minX, minY, maxX, maxY);
+		break;
+	case PRIMITIVE::TYPE::TYPE_IMAGE:
+		rasterizeImage(primitive, minX, minY, maxX, maxY);
+		break;
+	}
+}
+
+void SWGraphicsInterface::rasterizeTriangle(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	const VERTEX *vertex[3] = {&primitive.vertices[0], &primitive.vertices[1], &primitive.vertices[2]};
+	int64_t x[3];
+	int64_t y[3];
+	for (int i=0; i<3; i++)
+	{
+		x[i] = swToFixed(vertex[i]->pos.x);
+		y[i] = swToFixed(vertex[i]->pos.y);
+	}
+	const int64_t area = (x[1] - x[0])*(y[2] - y[0]) - (y[1] - y[0])*(x[2] - x[0]);
+
+	// edge functions (edge i is opposite of vertex i), with the top-left fill rule as a bias
+	// NOTE: everything is exact integer math relative to the vertices, so the result for a pixel does not depend on where the rasterized region starts (tiles)
+	int64_t stepX[3];
+	int64_t stepY[3];
+	int64_t rowStart[3];
+	for (int i=0; i<3; i++)
+	{
+		const int a = (i + 1) % 3;
+		const int b = (i + 2) % 3;
+		const int64_t dx = x[b] - x[a];
+		const int64_t dy = y[b] - y[a];
+
+		const bool topLeft = ((dy == 0 && dx > 0) || dy < 0);
+		const int64_t bias = (topLeft ? 0 : -1);
+
+		const int64_t px = ((int64_t)minX << SW_SUBPIXEL_BITS) + SW_HALF_PIXEL;
+		const int64_t py = ((int64_t)minY << SW_SUBPIXEL_BITS) + SW_HALF_PIXEL;
+
+		stepX[i] = -dy*SW_SUBPIXELS;
+		stepY[i] = dx*SW_SUBPIXELS;
+		rowStart[i] = dx*(py - y[a]) - dy*(px - x[a]) + bias;
+	}
+
+	// interpolation
+	const float invArea = 1.0f / (float)area;
+	const bool perspective = (vertex[0]->pos.w != vertex[1]->pos.w || vertex[1]->pos.w != vertex[2]->pos.w);
+	const float constantW = 1.0f / vertex[0]->pos.w;
+
+	for (int py=minY; py<=maxY; py++)
+	{
+		int64_t w0 = rowStart[0];
+		int64_t w1 = rowStart[1];
+		int64_t w2 = rowStart[2];
+
+		for (int px=minX; px<=maxX; px++)
+		{
+			if ((w0 | w1 | w2) >= 0)
+			{
+				const float l0 = (float)w0 * invArea;
+				const float l1 = (float)w1 * invArea;
+				const float l2 = (float)w2 * invArea;
+
+				const float z = l0*vertex[0]->pos.z + l1*vertex[1]->pos.z + l2*vertex[2]->pos.z;
+				const float w = (perspective ? 1.0f / (l0*vertex[0]->pos.w + l1*vertex[1]->pos.w + l2*vertex[2]->pos.w) : constantW);
+
+				writeFragment(primitive, px, py, z,
+						(l0*vertex[0]->r + l1*vertex[1]->r + l2*vertex[2]->r)*w,
+						(l0*vertex[0]->g + l1*vertex[1]->g + l2*vertex[2]->g)*w,
+						(l0*vertex[0]->b + l1*vertex[1]->b + l2*vertex[2]->b)*w,
+						(l0*vertex[0]->a + l1*vertex[1]->a + l2*vertex[2]->a)*w,
+						(l0*vertex[0]->u + l1*vertex[1]->u + l2*vertex[2]->u)*w,
+						(l0*vertex[0]->v + l1*vertex[1]->v + l2*vertex[2]->v)*w);
+			}
+
+			w0 += stepX[0];
+			w1 += stepX[1];
+			w2 += stepX[2];
+		}
+
+		rowStart[0] += stepY[0];
+		rowStart[1] += stepY[1];
+		rowStart[2] += stepY[2];
+	}
+}
+
+void SWGraphicsInterface::rasterizeLine(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	const VERTEX &v0 = primitive.vertices[0];
+	const VERTEX &v1 = primitive.vertices[1];
+	const float dx = v1.pos.x - v0.pos.x;
+	const float dy = v1.pos.y - v0.pos.y;
+
+	// one pixel per column (or row), the last pixel is not drawn (so that line strips don't overlap)
+	const bool xMajor = (std::abs(dx) >= std::abs(dy));
+	const float start = (xMajor ? v0.pos.x : v0.pos.y);
+	const float end = (xMajor ? v1.pos.x : v1.pos.y);
+	const float delta = end - start;
+
+	// pixel centers in [start, end) (or (end, start] if going backwards)
+	int first = (delta > 0.0f ? (int)std::ceil(start - 0.5f) : (int)std::floor(start - 0.5f));
+	int last = (delta > 0.0f ? (int)std::ceil(end - 0.5f) - 1 : (int)std::floor(end - 0.5f) + 1);
+	const int step = (delta > 0.0f ? 1 : -1);
+	if ((last - first)*step < 0) return;
+
+	// clamp to the rasterized region
+	const int majorMin = (xMajor ? minX : minY);
+	const int majorMax = (xMajor ? maxX : maxY);
+	if (step > 0)
+	{
+		first = std::max(first, majorMin);
+		last = std::min(last, majorMax);
+	}
+	else
+	{
+		first = std::min(first, majorMax);
+		last = std::max(last, majorMin);
+	}
+
+	const bool perspective = (v0.pos.w != v1.pos.w);
+	for (int i=first; (last - i)*step >= 0; i+=step)
+	{
+		const float t = ((float)i + 0.5f - start) / delta;
+
+		const float minor = (xMajor ? v0.pos.y + dy*t : v0.pos.x + dx*t);
+		const int px = (xMajor ? i : (int)std::floor(minor));
+		const int py = (xMajor ? (int)std::floor(minor) : i);
+		if (px < minX || px > maxX || py < minY || py > maxY) continue;
+
+		const float w = 1.0f / (perspective ? v0.pos.w + (v1.pos.w - v0.pos.w)*t : v0.pos.w);
+		writeFragment(primitive, px, py, v0.pos.z + (v1.pos.z - v0.pos.z)*t,
+				(v0.r + (v1.r - v0.r)*t)*w,
+				(v0.g + (v1.g - v0.g)*t)*w,
+				(v0.b + (v1.b - v0.b)*t)*w,
+				(v0.a + (v1.a - v0.a)*t)*w,
+				(v0.u + (v1.u - v0.u)*t)*w,
+				(v0.v + (v1.v - v0.v)*t)*w);
+	}
+}
+
+template <typename T>
+void SWGraphicsInterface::rasterizeSpan(const PRIMITIVE &primitive, int y, int first, int last, T drawSpan)
+{
+	if (primitive.stencilMode == STENCIL_MODE::STENCIL_MODE_DISABLED)
+	{
+		drawSpan(first, last);
+		return;
+	}
+
+	unsigned char *stencil = &m_stencilBuffer[y*m_iTargetWidth];
+	if (primitive.stencilMode == STENCIL_MODE::STENCIL_MODE_WRITE)
+	{
+		memset(stencil + first, 1, last - first + 1);
+		return;
+	}
+
+	// the runs of pixels which pass the stencil test
+	const unsigned char pass = (primitive.stencilMode == STENCIL_MODE::STENCIL_MODE_INSIDE ? 1 : 0);
+	int x = first;
+	while (x <= last)
+	{
+		while (x <= last && (stencil[x] & 1) != pass)
+		{
+			x++;
+		}
+
+		const int start = x;
+		while (x <= last && (stencil[x] & 1) == pass)
+		{
+			x++;
+		}
+
+		if (x > start)
+			drawSpan(start, x - 1);
+	}
+}
+
+void SWGraphicsInterface::rasterizeRect(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	const unsigned char *color = (const unsigned char*)&primitive.color;
+	if (color[3] == 0 && primitive.blending && primitive.stencilMode != STENCIL_MODE::STENCIL_MODE_WRITE) return; // blending would not change anything
+
+	for (int y=minY; y<=maxY; y++)
+	{
+		rasterizeSpan(primitive, y, minX, maxX, [&](int first, int last)
+		{
+			// NOTE: blending with alpha 255 is an exact copy
+			unsigned char *span = (unsigned char*)&m_colorBuffer[first + y*m_iTargetWidth];
+			if (color[3] == 255 || !primitive.blending)
+				SWSpanKernels::fill(span, last - first + 1, color);
+			else
+				SWSpanKernels::blend(span, last - first + 1, color);
+		});
+	}
+}
+
+void SWGraphicsInterface::rasterizeGradient(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	// the full rect (unclipped), colors are interpolated at pixel centers
+	const int64_t width = primitive.x2 - primitive.x1;
+	const int64_t height = primitive.y2 - primitive.y1;
+
+	const unsigned char *topLeft = (const unsigned char*)&primitive.gradient[0];
+	const unsigned char *topRight = (const unsigned char*)&primitive.gradient[1];
+	const unsigned char *bottomLeft = (const unsigned char*)&primitive.gradient[2];
+	const unsigned char *bottomRight = (const unsigned char*)&primitive.gradient[3];
+
+	for (int y=minY; y<=maxY; y++)
+	{
+		// 16.16 fixed point, relative to the rect (and not to minX/minY), so that every tile computes the same colors
+		const int64_t fy = ((((int64_t)(y - primitive.y1))*2 + 1) << 16) / (2*height);
+
+		int64_t left[4];
+		int step[4];
+		for (int c=0; c<4; c++)
+		{
+			left[c] = ((int64_t)topLeft[c] << 16) + (bottomLeft[c] - topLeft[c])*fy;
+			const int64_t right = ((int64_t)topRight[c] << 16) + (bottomRight[c] - topRight[c])*fy;
+
+			step[c] = (int)((right - left[c]) / width);
+		}
+
+		rasterizeSpan(primitive, y, minX, maxX, [&](int first, int last)
+		{
+			int start[4];
+			for (int c=0; c<4; c++)
+			{
+				start[c] = (int)(left[c] + (int64_t)step[c]*(first - primitive.x1) + step[c]/2);
+			}
+
+			SWSpanKernels::blendGradient((unsigned char*)&m_colorBuffer[first + y*m_iTargetWidth], last - first + 1, start, step);
+		});
+	}
+}
+
+void SWGraphicsInterface::rasterizePixelLine(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	int x1 = primitive.x1;
+	int y1 = primitive.y1;
+	int x2 = primitive.x2;
+	int y2 = primitive.y2;
+
+	// Bresenham's line algorithm
+	const bool steep = (std::abs(y2 - y1) > std::abs(x2 - x1));
+	if (steep)
+	{
+		std::swap(x1, y1);
+		std::swap(x2, y2);
+	}
+
+	if (x1 > x2)
+	{
+		std::swap(x1, x2);
+		std::swap(y1, y2);
+	}
+
+	const float dx = x2 - x1;
+	const float dy = std::abs(y2 - y1);
+
+	float error = dx / 2.0f;
+	const int ystep = (y1 < y2) ? 1 : -1;
+	int y = y1;
+
+	// NOTE: always walks the whole line, so that the error term is the same for every region
+	for (int x=x1; x<x2; x++)
+	{
+		const int px = (steep ? y : x);
+		const int py = (steep ? x : y);
+		if (px >= minX && px <= maxX && py >= minY && py <= maxY && stencilTest(primitive, px + py*m_iTargetWidth))
+			blendPixel(px + py*m_iTargetWidth, primitive.color);
+
+		error -= dy;
+		if (error < 0)
+		{
+			y += ystep;
+			error += dx;
+		}
+	}
+}
+
+void SWGraphicsInterface::rasterizeImage(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY)
+{
+	const TEXTURE &texture = primitive.texture;
+
+	SWSpanKernels::TEXTURE_SPAN span;
+	span.texture = swGetSpanTexture(texture.texels, texture.width, texture.height, texture.bilinear, texture.repeat);
+	memcpy(span.color, &primitive.color, 4);
+	span.blending = primitive.blending;
+
+	// 16.16 fixed point, per row relative to pixel 0 (and not to minX/minY), so that every tile samples exactly the same texels
+	const int64_t ds = std::llround(primitive.dsdx*65536.0);
+	const int64_t dt = std::llround(primitive.dtdx*65536.0);
+	const int64_t sLimit = (int64_t)texture.width << 16;
+	const int64_t tLimit = (int64_t)texture.height << 16;
+	span.ds = (int)ds;
+	span.dt = (int)dt;
+
+	for (int y=minY; y<=maxY; y++)
+	{
+		const int64_t s = std::llround((primitive.s + primitive.dsdy*y)*65536.0);
+		const int64_t t = std::llround((primitive.t + primitive.dtdy*y)*65536.0);
+
+		// only pixels whose center maps into the texture are covered (independent of the wrap mode, same as the quad in opengl)
+		int covered = minX;
+		int lastCovered = maxX;
+		swClipSpan(s, ds, sLimit, covered, lastCovered);
+		swClipSpan(t, dt, tLimit, covered, lastCovered);
+		if (covered > lastCovered) continue;
+
+		rasterizeSpan(primitive, y, covered, lastCovered, [&](int first, int last)
+		{
+			span.s = (int)(s + ds*first);
+			span.t = (int)(t + dt*first);
+
+			unsigned char *dst = (unsigned char*)&m_colorBuffer[first + y*m_iTargetWidth];
+			const int count = last - first + 1;
+
+			// unscaled, and exactly on the texel centers: just a row of the texture (for both nearest and bilinear)
+			if (ds == 65536 && dt == 0 && (span.s & 0xffff) == 0x8000 && (span.t & 0xffff) == 0x8000)
+				SWSpanKernels::blendTexels(dst, count, span.texture.texels + ((span.s >> 16) + (span.t >> 16)*texture.width)*4, span.color, span.blending);
+			else
+				SWSpanKernels::blendTextured(dst, count, span);
+		});
+	}
+}
+
+void SWGraphicsInterface::writeFragment(const PRIMITIVE &primitive, int x, int y, float z, float r, float g, float b, float a, float u, float v)
+{
+	const int index = x + y*m_iTargetWidth;
+
+	// stencil test (before the depth test, same as opengl)
+	const bool colorWrite = stencilTest(primitive, index);
+	if (!colorWrite && primitive.stencilMode != STENCIL_MODE::STENCIL_MODE_WRITE) return;
+
+	// depth test (GL_LESS)
+	if (primitive.depthTest)
+	{
+		if (!(z < m_depthBuffer[index])) return;
+		m_depthBuffer[index] = z;
+	}
+
+	if (!colorWrite) return; // pushStencil() disables color writes
+
+	// texture, modulated by the vertex color
+	if (primitive.textured)
+	{
+		const TEXTURE &texture = primitive.texture;
+		if (texture.flipped)
+			v = 1.0f - v;
+
+		// 16.16 texel coordinates
+		const float maxCoordinate = (float)(1 << 30);
+		const int s = (int)std::floor(clamp<float>(u*texture.width*65536.0f, -maxCoordinate, maxCoordinate));
+		const int t = (int)std::floor(clamp<float>(v*texture.height*65536.0f, -maxCoordinate, maxCoordinate));
+
+		PIXEL texel;
+		SWSpanKernels::sample(swGetSpanTexture(texture.texels, texture.width, texture.height, texture.bilinear, texture.repeat), s, t, (unsigned char*)&texel);
+		r *= texel.r / 255.0f;
+		g *= texel.g / 255.0f;
+		b *= texel.b / 255.0f;
+		a *= texel.a / 255.0f;
+	}
+
+	r = clamp<float>(r, 0.0f, 1.0f);
+	g = clamp<float>(g, 0.0f, 1.0f);
+	b = clamp<float>(b, 0.0f, 1.0f);
+	a = clamp<float>(a, 0.0f, 1.0f);
+
+	// blend (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, for all channels, same as drawPixel())
+	PIXEL &dst = m_colorBuffer[index];
+	if (primitive.blending)
+	{
+		const float invA = 1.0f - a;
+		r = r*a + (dst.r / 255.0f)*invA;
+		g = g*a + (dst.g / 255.0f)*invA;
+		b = b*a + (dst.b / 255.0f)*invA;
+		a = a*a + (dst.a / 255.0f)*invA;
+	}
+
+	dst.r = (unsigned char)(r*255.0f + 0.5f);
+	dst.g = (unsigned char)(g*255.0f + 0.5f);
+	dst.b = (unsigned char)(b*255.0f + 0.5f);
+	dst.a = (unsigned char)(a*255.0f + 0.5f);
+}
+
+bool SWGraphicsInterface::stencilTest(const PRIMITIVE &primitive, int index)
+{
+	switch (primitive.stencilMode)
+	{
+	case STENCIL_MODE::STENCIL_MODE_WRITE:
+		m_stencilBuffer[index] = 1;
+		return false;
+	case STENCIL_MODE::STENCIL_MODE_INSIDE:
+		return ((m_stencilBuffer[index] & 1) != 0);
+	case STENCIL_MODE::STENCIL_MODE_OUTSIDE:
+		return ((m_stencilBuffer[index] & 1) == 0);
+	default:
+		return true;
+	}
+}
+
+void SWGraphicsInterface::blendPixel(int index, const PIXEL &src)
+{
+	SWSpanKernels::blend((unsigned char*)&m_colorBuffer[index], 1, (const unsigned char*)&src);
+}
+
 SWGraphicsInterface::PIXEL SWGraphicsInterface::getColorPixel(const Color &color)
 {
 	PIXEL p;
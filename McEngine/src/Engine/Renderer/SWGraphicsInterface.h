@@ -10,6 +10,8 @@
 
 #include "Graphics.h"
 
+class SWRenderTarget;
+
 class SWGraphicsInterface : public Graphics
 {
 public:
@@ -51,6 +53,7 @@ public:
 	// 2d resource drawing
 	virtual void drawImage(Image *image);
 	virtual void drawString(McFont *font, UString text);
+	virtual void drawStringCached(McFont *font, const UString &text);
 
 	// 3d type drawing
 	virtual void drawVAO(VertexArrayObject *vao);
@@ -88,6 +91,11 @@ public:
 	// callbacks
 	virtual void onResolutionChange(Vector2 newResolution);
 
+	// resources (called by SWImage and SWRenderTarget)
+	void setTexture(const PIXEL *texels, int width, int height, bool flipped, Graphics::FILTER_MODE filterMode = Graphics::FILTER_MODE::FILTER_MODE_LINEAR, Graphics::WRAP_MODE wrapMode = Graphics::WRAP_MODE::WRAP_MODE_CLAMP); // texels NULL = no texture, flipped = bottom row first (rendertargets, like opengl)
+	void setRenderTarget(SWRenderTarget *renderTarget); // NULL = backbuffer
+	inline SWRenderTarget *getRenderTarget() const {return m_renderTarget;}
+
 	// factory
 	virtual Image *createImage(UString filePath, bool mipmapped, bool keepInSystemMemory);
 	virtual Image *createImage(int width, int height, bool mipmapped, bool keepInSystemMemory);
@@ -104,20 +112,131 @@ protected:
 	inline PIXEL *getBackBuffer() const {return m_backBuffer;}
 
 private:
+	struct VERTEX
+	{
+		Vector4 pos;	// clip space, window space after projection (x, y, z, 1/w)
+		float r, g, b, a;
+		float u, v;		// all attributes are multiplied by 1/w after projection, for perspective correct interpolation
+	};
+
+	enum class STENCIL_MODE
+	{
+		STENCIL_MODE_DISABLED,
+		STENCIL_MODE_WRITE,		// pushStencil(): marks covered pixels, without drawing anything
+		STENCIL_MODE_INSIDE,	// fillStencil(true): only draws marked pixels
+		STENCIL_MODE_OUTSIDE	// fillStencil(false): only draws unmarked pixels
+	};
+
+	struct TEXTURE
+	{
+		const PIXEL *texels;
+		int width;
+		int height;
+		bool flipped;
+		bool bilinear;	// FILTER_MODE_LINEAR and FILTER_MODE_MIPMAP (no mipmaps), otherwise nearest
+		bool repeat;	// WRAP_MODE_REPEAT, otherwise clamped
+	};
+
+	// everything which ends up in the color buffer, recorded with all state it depends on
+	struct PRIMITIVE
+	{
+		enum class TYPE
+		{
+			TYPE_TRIANGLE,		// vertices[0..2], projected, positive area
+			TYPE_LINE,			// vertices[0..1], projected
+			TYPE_RECT,			// min/max, solid color
+			TYPE_GRADIENT,		// x1/y1/x2/y2 (full rect, exclusive), gradient
+			TYPE_PIXEL_LINE,	// x1/y1/x2/y2, solid color
+			TYPE_IMAGE			// s/t, textured, modulated by color (affine, covers exactly the texture)
+		};
+
+		TYPE type;
+		int minX, minY, maxX, maxY; // covered pixels (inclusive, within the target)
+
+		VERTEX vertices[3];
+		int x1, y1, x2, y2;
+		PIXEL color;
+		PIXEL gradient[4]; // top left, top right, bottom left, bottom right
+		double s, t, dsdx, dtdx, dsdy, dtdy; // texel coordinates at the center of pixel (0, 0), and their derivatives
+
+		TEXTURE texture;
+		bool textured;
+		bool blending;
+		bool depthTest;
+		STENCIL_MODE stencilMode;
+	};
+
 	PIXEL getColorPixel(const Color &color);
 
+	// rasterizer
+	void drawTriangle(const VERTEX &v0, const VERTEX &v1, const VERTEX &v2, bool textured);
+	void drawLine(const VERTEX &v0, const VERTEX &v1, bool textured);
+	void projectVertex(VERTEX &vertex);
+
+	void addTriangle(const VERTEX &v0, const VERTEX &v1, const VERTEX &v2, bool textured);
+	void addLine(const VERTEX &v0, const VERTEX &v1, bool textured);
+	void addImage(float width, float height); // the currently bound texture, centered at the origin
+	void addPrimitive(PRIMITIVE &primitive); // either rasterizes immediately, or queues and bins it (r_sw_tiled)
+
+	void rasterizeTile(int tile);
+	void rasterizePrimitive(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY); // only touches pixels within min/max (inclusive)
+	void rasterizeTriangle(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY);
+	void rasterizeLine(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY);
+	void rasterizeRect(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY);
+	void rasterizeGradient(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY);
+	void rasterizePixelLine(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY);
+	void rasterizeImage(const PRIMITIVE &primitive, int minX, int minY, int maxX, int maxY);
+	template <typename T>
+	void rasterizeSpan(const PRIMITIVE &primitive, int y, int first, int last, T drawSpan); // stencil, calls drawSpan(first, last) for every visible part of the row
+	void writeFragment(const PRIMITIVE &primitive, int x, int y, float z, float r, float g, float b, float a, float u, float v);
+	bool stencilTest(const PRIMITIVE &primitive, int index); // true if the color may be written (marks the pixel for STENCIL_MODE_WRITE, and returns false)
+	void blendPixel(int index, const PIXEL &src);
+
+	void setTarget(PIXEL *colorBuffer, float *depthBuffer, unsigned char *stencilBuffer, int width, int height, int offsetX, int offsetY);
+
 	// renderer
 	Vector2 m_vResolution;
 	PIXEL *m_backBuffer;
+	float *m_backBufferDepth;
+	unsigned char *m_backBufferStencil;
+
+	// current target (backbuffer or rendertarget)
+	SWRenderTarget *m_renderTarget;
+	PIXEL *m_colorBuffer;
+	float *m_depthBuffer;
+	unsigned char *m_stencilBuffer;
+	int m_iTargetWidth;
+	int m_iTargetHeight;
+	int m_iTargetOffsetX;
+	int m_iTargetOffsetY;
 
 	// persistent vars
 	bool m_bAntiAliasing;
+	bool m_bBlending;
+	bool m_bDepthBuffer;
+	bool m_bCulling;
 	Color m_color;
 	float m_fZ;
 	float m_fClearZ;
+	TEXTURE m_texture;
 
 	// clipping
 	std::stack<McRect> m_clipRectStack;
+	bool m_bClipping;
+	int m_iClipMinX; // in pixels (inclusive, screen space)
+	int m_iClipMinY;
+	int m_iClipMaxX;
+	int m_iClipMaxY;
+
+	// stencil
+	STENCIL_MODE m_stencilMode;
+
+	// tiled rasterization (r_sw_tiled), queued until flush()
+	std::vector<PRIMITIVE> m_primitives;
+	std::vector<std::vector<unsigned int>> m_tiles; // indices into m_primitives per tile, in submission order
+	int m_iTileSize;
+	int m_iNumTilesX;
+	int m_iNumTilesY;
 
 	// matrices
 	Matrix4 m_worldMatrix;
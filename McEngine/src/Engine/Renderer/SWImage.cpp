@@ -13,19 +13,57 @@
 
 SWImage::SWImage(UString filepath, bool mipmapped, bool keepInSystemMemory) : Image(filepath, mipmapped, keepInSystemMemory)
 {
-	// TODO:
+	// same defaults as OpenGLImage
+	m_filterMode = Graphics::FILTER_MODE::FILTER_MODE_LINEAR;
+	m_wrapMode = Graphics::WRAP_MODE::WRAP_MODE_CLAMP;
 }
 
 SWImage::SWImage(int width, int height, bool mipmapped, bool keepInSystemMemory) : Image(width, height, mipmapped, keepInSystemMemory)
 {
-	// TODO:
+	m_filterMode = Graphics::FILTER_MODE::FILTER_MODE_LINEAR;
+	m_wrapMode = Graphics::WRAP_MODE::WRAP_MODE_CLAMP;
 }
 
 void SWImage::init()
 {
-	// TODO:
-	if (m_bAsyncReady)
-		m_bReady = true;
+	if (!m_bAsyncReady) return;
+
+	// convert to the pixel format of the rasterizer
+	const int numPixels = m_iWidth*m_iHeight;
+	if (numPixels < 1 || (int)m_rawImage.size() < numPixels*m_iNumChannels)
+	{
+		debugLog("SW Image Error: Invalid image data on file %s!\n", m_sFilePath.toUtf8());
+		return;
+	}
+
+	// queued primitives might still use the previous texels
+	if (engine->getGraphics() != NULL)
+		engine->getGraphics()->flush();
+
+	m_texels.resize(numPixels);
+	for (int i=0; i<numPixels; i++)
+	{
+		SWGraphicsInterface::PIXEL &texel = m_texels[i];
+		const unsigned char *src = &m_rawImage[i*m_iNumChannels];
+		if (m_iNumChannels >= 3)
+		{
+			texel.r = src[0];
+			texel.g = src[1];
+			texel.b = src[2];
+			texel.a = (m_iNumChannels == 4 ? src[3] : 255);
+		}
+		else // luminance
+		{
+			texel.r = texel.g = texel.b = src[0];
+			texel.a = 255;
+		}
+	}
+
+	// free memory
+	if (!m_bKeepInSystemMemory)
+		m_rawImage = std::vector<unsigned char>();
+
+	m_bReady = true;
 }
 
 void SWImage::initAsync()
@@ -38,25 +76,37 @@ void SWImage::initAsync()
 
 void SWImage::destroy()
 {
-	// TODO:
+	// queued primitives might still use this texture
+	if (m_texels.size() > 0 && engine->getGraphics() != NULL)
+		engine->getGraphics()->flush();
+
+	m_texels = std::vector<SWGraphicsInterface::PIXEL>();
+	m_rawImage = std::vector<unsigned char>();
 }
 
 void SWImage::bind(unsigned int textureUnit)
 {
-	// TODO:
+	if (!m_bReady || textureUnit != 0) return; // only one texture unit
+
+	engine->getGraphics()->countTextureBind();
+	((SWGraphicsInterface*)engine->getGraphics())->setTexture(&m_texels[0], m_iWidth, m_iHeight, false, m_filterMode, m_wrapMode);
 }
 
 void SWImage::unbind()
 {
-	// TODO:
+	if (!m_bReady) return;
+
+	((SWGraphicsInterface*)engine->getGraphics())->setTexture(NULL, 0, 0, false);
 }
 
 void SWImage::setFilterMode(Graphics::FILTER_MODE filterMode)
 {
-	// TODO:
+	// NOTE: there are no mipmaps, FILTER_MODE_MIPMAP is bilinear
+	// applies to the next bind() (every draw call binds anyway)
+	m_filterMode = filterMode;
 }
 
 void SWImage::setWrapMode(Graphics::WRAP_MODE wrapMode)
 {
-	// TODO:
+	m_wrapMode = wrapMode;
 }
@@ -9,6 +9,7 @@
 #define SWIMAGE_H
 
 #include "Image.h"
+#include "SWGraphicsInterface.h"
 
 class SWImage : public Image
 {
@@ -27,6 +28,10 @@ private:
 	void init();
 	void initAsync();
 	void destroy();
+
+	std::vector<SWGraphicsInterface::PIXEL> m_texels;
+	Graphics::FILTER_MODE m_filterMode;
+	Graphics::WRAP_MODE m_wrapMode;
 };
 
 #endif
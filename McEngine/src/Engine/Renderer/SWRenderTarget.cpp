@@ -7,42 +7,96 @@
 
 #include "SWRenderTarget.h"
 
+#include "Engine.h"
+#include "ConVar.h"
+
 SWRenderTarget::SWRenderTarget(int x, int y, int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType) : RenderTarget(x, y, width, height, multiSampleType)
 {
-	// TODO:
+	m_prevRenderTarget = NULL;
 }
 
 void SWRenderTarget::init()
 {
-	// TODO:
+	debugLog("Building RenderTarget (%ix%i) ...\n", (int)m_vSize.x, (int)m_vSize.y);
+
+	// NOTE: multisampling is not supported, always renders at 1x
+	const int numPixels = (int)m_vSize.x * (int)m_vSize.y;
+	if (numPixels < 1) return;
+
+	SWGraphicsInterface::PIXEL transparentBlack;
+	transparentBlack.r = transparentBlack.g = transparentBlack.b = transparentBlack.a = 0;
+
+	m_colorBuffer.assign(numPixels, transparentBlack);
+	m_depthBuffer.assign(numPixels, 1.0f);
+	m_stencilBuffer.assign(numPixels, 0);
+
+	m_bReady = true;
 }
 
 void SWRenderTarget::initAsync()
 {
-	// TODO:
+	m_bAsyncReady = true;
 }
 
 void SWRenderTarget::destroy()
 {
-	// TODO:
+	// queued primitives might still use this rendertarget (as a texture)
+	if (m_colorBuffer.size() > 0 && engine->getGraphics() != NULL)
+		engine->getGraphics()->flush();
+
+	m_colorBuffer = std::vector<SWGraphicsInterface::PIXEL>();
+	m_depthBuffer = std::vector<float>();
+	m_stencilBuffer = std::vector<unsigned char>();
 }
 
 void SWRenderTarget::enable()
 {
-	// TODO:
+	if (!m_bReady) return;
+
+	SWGraphicsInterface *g = (SWGraphicsInterface*)engine->getGraphics();
+	g->countRenderTargetChange();
+
+	m_prevRenderTarget = g->getRenderTarget();
+	g->setRenderTarget(this);
+
+	// clear
+	if (m_bClearColorOnDraw)
+	{
+		const Color clearColor = (debug_rt->getBool() ? COLORf(0.5f, 0.0f, 0.5f, 0.0f) : m_clearColor);
+
+		SWGraphicsInterface::PIXEL pixel;
+		pixel.r = COLOR_GET_Ri(clearColor);
+		pixel.g = COLOR_GET_Gi(clearColor);
+		pixel.b = COLOR_GET_Bi(clearColor);
+		pixel.a = COLOR_GET_Ai(clearColor);
+		std::fill(m_colorBuffer.begin(), m_colorBuffer.end(), pixel);
+	}
+
+	if (m_bClearDepthOnDraw)
+		g->clearDepthBuffer();
 }
 
 void SWRenderTarget::disable()
 {
-	// TODO:
+	if (!m_bReady) return;
+
+	((SWGraphicsInterface*)engine->getGraphics())->setRenderTarget(m_prevRenderTarget);
+	m_prevRenderTarget = NULL;
 }
 
 void SWRenderTarget::bind(unsigned int textureUnit)
 {
-	// TODO:
+	if (!m_bReady || textureUnit != 0) return; // only one texture unit
+
+	engine->getGraphics()->countTextureBind();
+
+	// NOTE: flipped, because RenderTarget::draw() uses opengl texture coordinates for rendertargets
+	((SWGraphicsInterface*)engine->getGraphics())->setTexture(&m_colorBuffer[0], (int)m_vSize.x, (int)m_vSize.y, true); // linear, clamped (same as OpenGLRenderTarget)
 }
 
 void SWRenderTarget::unbind()
 {
-	// TODO:
+	if (!m_bReady) return;
+
+	((SWGraphicsInterface*)engine->getGraphics())->setTexture(NULL, 0, 0, false);
 }
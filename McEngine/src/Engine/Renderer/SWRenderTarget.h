@@ -9,6 +9,7 @@
 #define SWRENDERTARGET_H
 
 #include "RenderTarget.h"
+#include "SWGraphicsInterface.h"
 
 class SWRenderTarget : public RenderTarget
 {
@@ -22,10 +23,21 @@ public:
 	virtual void bind(unsigned int textureUnit = 0);
 	virtual void unbind();
 
+	// ILLEGAL:
+	inline SWGraphicsInterface::PIXEL *getColorBuffer() {return (m_colorBuffer.size() > 0 ? &m_colorBuffer[0] : NULL);}
+	inline float *getDepthBuffer() {return (m_depthBuffer.size() > 0 ? &m_depthBuffer[0] : NULL);}
+	inline unsigned char *getStencilBuffer() {return (m_stencilBuffer.size() > 0 ? &m_stencilBuffer[0] : NULL);}
+
 private:
 	virtual void init();
 	virtual void initAsync();
 	virtual void destroy();
+
+	std::vector<SWGraphicsInterface::PIXEL> m_colorBuffer;
+	std::vector<float> m_depthBuffer;
+	std::vector<unsigned char> m_stencilBuffer;
+
+	SWRenderTarget *m_prevRenderTarget;
 };
 
 #endif
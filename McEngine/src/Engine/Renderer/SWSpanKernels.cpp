@@ -0,0 +1,1081 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		row span kernels of the software rasterizer (fill, blend, gradient, textured)
+//
+// $NoKeywords: $swspan
+//===============================================================================//
+
+#include "SWSpanKernels.h"
+
+#include "Engine.h"
+#include "ConVar.h"
+#include "Timer.h"
+
+#include <string.h>
+
+// SSE2 is part of x86-64, on 32 bit x86 it has to be enabled at compile time
+// AVX2 is compiled for every x86 target, and only used if the cpu supports it
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+
+#define MCENGINE_SW_SSE2
+#include <emmintrin.h>
+
+#if defined(__GNUC__) || defined(_MSC_VER)
+
+#define MCENGINE_SW_AVX2
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#endif
+
+#endif
+
+#if defined(MCENGINE_SW_AVX2) && defined(__GNUC__)
+#define SW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SW_TARGET_AVX2
+#endif
+
+void _r_sw_simd_(UString oldValue, UString newValue);
+ConVar r_sw_simd("r_sw_simd", 2, "highest instruction set which the software rasterizer span kernels may use (0 = scalar, 1 = SSE2, 2 = AVX2), limited to what the cpu supports", _r_sw_simd_);
+
+static int s_iSWSpanISA = -1; // cached min(r_sw_simd, supported), -1 = not yet determined
+
+void _r_sw_simd_(UString oldValue, UString newValue)
+{
+	s_iSWSpanISA = -1;
+}
+
+
+
+//***********//
+//	Scalar	 //
+//***********//
+
+// exact round(x / 255) for x in [0, 255*255]
+static inline unsigned int swDiv255(unsigned int x)
+{
+	x += 128;
+	return ((x + (x >> 8)) >> 8);
+}
+
+static void swFillScalar(unsigned char *dst, int count, const unsigned char *color)
+{
+	for (int i=0; i<count; i++)
+	{
+		memcpy(dst + i*4, color, 4);
+	}
+}
+
+static void swBlendScalar(unsigned char *dst, int count, const unsigned char *color)
+{
+	const unsigned int alpha = color[3];
+	const unsigned int invAlpha = 255 - alpha;
+	const unsigned int src[4] = {color[0]*alpha, color[1]*alpha, color[2]*alpha, alpha*alpha};
+
+	for (int i=0; i<count; i++)
+	{
+		unsigned char *pixel = dst + i*4;
+		pixel[0] = (unsigned char)swDiv255(src[0] + pixel[0]*invAlpha);
+		pixel[1] = (unsigned char)swDiv255(src[1] + pixel[1]*invAlpha);
+		pixel[2] = (unsigned char)swDiv255(src[2] + pixel[2]*invAlpha);
+		pixel[3] = (unsigned char)swDiv255(src[3] + pixel[3]*invAlpha);
+	}
+}
+
+static void swBlendGradientScalar(unsigned char *dst, int count, const int *start, const int *step)
+{
+	int color[4] = {start[0], start[1], start[2], start[3]};
+
+	for (int i=0; i<count; i++)
+	{
+		unsigned char *pixel = dst + i*4;
+		const unsigned int alpha = (unsigned int)(color[3] >> 16);
+		const unsigned int invAlpha = 255 - alpha;
+		pixel[0] = (unsigned char)swDiv255((unsigned int)(color[0] >> 16)*alpha + pixel[0]*invAlpha);
+		pixel[1] = (unsigned char)swDiv255((unsigned int)(color[1] >> 16)*alpha + pixel[1]*invAlpha);
+		pixel[2] = (unsigned char)swDiv255((unsigned int)(color[2] >> 16)*alpha + pixel[2]*invAlpha);
+		pixel[3] = (unsigned char)swDiv255(alpha*alpha + pixel[3]*invAlpha);
+
+		color[0] += step[0];
+		color[1] += step[1];
+		color[2] += step[2];
+		color[3] += step[3];
+	}
+}
+
+static inline int swWrapTexel(int x, int size, bool repeat)
+{
+	if ((unsigned int)x < (unsigned int)size) return x;
+
+	if (repeat)
+	{
+		x %= size;
+		return (x < 0 ? x + size : x);
+	}
+
+	return (x < 0 ? 0 : (x > size-1 ? size-1 : x));
+}
+
+static inline int swNearestOffset(const SWSpanKernels::TEXTURE &texture, int s, int t)
+{
+	return (swWrapTexel(s >> 16, texture.width, texture.repeat) + swWrapTexel(t >> 16, texture.height, texture.repeat)*texture.width)*4;
+}
+
+// the four texels (00, 10, 01, 11) and 8 bit weights of a bilinear sample
+static inline void swBilinearFootprint(const SWSpanKernels::TEXTURE &texture, int s, int t, int *offsets, int &fx, int &fy)
+{
+	// relative to the texel centers
+	s -= 32768;
+	t -= 32768;
+
+	const int x0 = swWrapTexel(s >> 16, texture.width, texture.repeat);
+	const int x1 = swWrapTexel((s >> 16) + 1, texture.width, texture.repeat);
+	const int y0 = swWrapTexel(t >> 16, texture.height, texture.repeat)*texture.width;
+	const int y1 = swWrapTexel((t >> 16) + 1, texture.height, texture.repeat)*texture.width;
+
+	offsets[0] = (x0 + y0)*4;
+	offsets[1] = (x1 + y0)*4;
+	offsets[2] = (x0 + y1)*4;
+	offsets[3] = (x1 + y1)*4;
+
+	fx = (s >> 8) & 0xff;
+	fy = (t >> 8) & 0xff;
+}
+
+static inline void swSampleScalar(const SWSpanKernels::TEXTURE &texture, int s, int t, unsigned int *texel)
+{
+	if (!texture.bilinear)
+	{
+		const unsigned char *nearest = texture.texels + swNearestOffset(texture, s, t);
+		texel[0] = nearest[0];
+		texel[1] = nearest[1];
+		texel[2] = nearest[2];
+		texel[3] = nearest[3];
+		return;
+	}
+
+	int offsets[4];
+	int fx, fy;
+	swBilinearFootprint(texture, s, t, offsets, fx, fy);
+
+	const unsigned char *t00 = texture.texels + offsets[0];
+	const unsigned char *t10 = texture.texels + offsets[1];
+	const unsigned char *t01 = texture.texels + offsets[2];
+	const unsigned char *t11 = texture.texels + offsets[3];
+	for (int c=0; c<4; c++)
+	{
+		const unsigned int top = (t00[c]*(256 - fx) + t10[c]*fx + 128) >> 8;
+		const unsigned int bottom = (t01[c]*(256 - fx) + t11[c]*fx + 128) >> 8;
+		texel[c] = (top*(256 - fy) + bottom*fy + 128) >> 8;
+	}
+}
+
+static inline void swModulateBlendScalar(unsigned char *pixel, const unsigned int *texel, const unsigned char *color, bool blending)
+{
+	const unsigned int src[4] = {swDiv255(texel[0]*color[0]), swDiv255(texel[1]*color[1]), swDiv255(texel[2]*color[2]), swDiv255(texel[3]*color[3])};
+
+	if (!blending)
+	{
+		pixel[0] = (unsigned char)src[0];
+		pixel[1] = (unsigned char)src[1];
+		pixel[2] = (unsigned char)src[2];
+		pixel[3] = (unsigned char)src[3];
+		return;
+	}
+
+	const unsigned int invAlpha = 255 - src[3];
+	pixel[0] = (unsigned char)swDiv255(src[0]*src[3] + pixel[0]*invAlpha);
+	pixel[1] = (unsigned char)swDiv255(src[1]*src[3] + pixel[1]*invAlpha);
+	pixel[2] = (unsigned char)swDiv255(src[2]*src[3] + pixel[2]*invAlpha);
+	pixel[3] = (unsigned char)swDiv255(src[3]*src[3] + pixel[3]*invAlpha);
+}
+
+static void swBlendTexturedScalar(unsigned char *dst, int count, const SWSpanKernels::TEXTURE_SPAN &span, int s, int t)
+{
+	for (int i=0; i<count; i++)
+	{
+		unsigned int texel[4];
+		swSampleScalar(span.texture, s, t, texel);
+		swModulateBlendScalar(dst + i*4, texel, span.color, span.blending);
+
+		s += span.ds;
+		t += span.dt;
+	}
+}
+
+static void swBlendTexelsScalar(unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending)
+{
+	for (int i=0; i<count; i++)
+	{
+		const unsigned int texel[4] = {texels[i*4 + 0], texels[i*4 + 1], texels[i*4 + 2], texels[i*4 + 3]};
+		swModulateBlendScalar(dst + i*4, texel, color, blending);
+	}
+}
+
+
+
+//*********//
+//	SSE2   //
+//*********//
+
+#ifdef MCENGINE_SW_SSE2
+
+// 8 channels (16 bit) at once, same as swDiv255()
+static inline __m128i swDiv255SSE2(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static void swFillSSE2(unsigned char *dst, int count, const unsigned char *color)
+{
+	int packedColor;
+	memcpy(&packedColor, color, 4);
+	const __m128i fill = _mm_set1_epi32(packedColor);
+
+	int i = 0;
+	for (; i+4<=count; i+=4)
+	{
+		_mm_storeu_si128((__m128i*)(dst + i*4), fill);
+	}
+
+	swFillScalar(dst + i*4, count - i, color);
+}
+
+static void swBlendSSE2(unsigned char *dst, int count, const unsigned char *color)
+{
+	const short alpha = color[3];
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i invAlpha = _mm_set1_epi16(255 - alpha);
+	const __m128i src = _mm_setr_epi16((short)(color[0]*alpha), (short)(color[1]*alpha), (short)(color[2]*alpha), (short)(alpha*alpha),
+									   (short)(color[0]*alpha), (short)(color[1]*alpha), (short)(color[2]*alpha), (short)(alpha*alpha));
+
+	int i = 0;
+	for (; i+4<=count; i+=4)
+	{
+		const __m128i pixels = _mm_loadu_si128((const __m128i*)(dst + i*4));
+		const __m128i lo = swDiv255SSE2(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), invAlpha), src));
+		const __m128i hi = swDiv255SSE2(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), invAlpha), src));
+		_mm_storeu_si128((__m128i*)(dst + i*4), _mm_packus_epi16(lo, hi));
+	}
+
+	swBlendScalar(dst + i*4, count - i, color);
+}
+
+// blends two pixels (8 channels, 16 bit) of src with their own alpha onto two pixels (8 channels, 16 bit) of dst
+static inline __m128i swBlendPixelsSSE2(__m128i src, __m128i dst)
+{
+	const __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	const __m128i invAlpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+	return swDiv255SSE2(_mm_add_epi16(_mm_mullo_epi16(src, alpha), _mm_mullo_epi16(dst, invAlpha)));
+}
+
+static void swBlendGradientSSE2(unsigned char *dst, int count, const int *start, const int *step)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i colorStep = _mm_setr_epi32(step[0], step[1], step[2], step[3]);
+	__m128i color = _mm_setr_epi32(start[0], start[1], start[2], start[3]);
+
+	int i = 0;
+	for (; i+4<=count; i+=4)
+	{
+		// one pixel per register (b, g, r, a as 32 bit), packed down to two pixels per register
+		const __m128i c0 = color;
+		const __m128i c1 = _mm_add_epi32(c0, colorStep);
+		const __m128i c2 = _mm_add_epi32(c1, colorStep);
+		const __m128i c3 = _mm_add_epi32(c2, colorStep);
+		color = _mm_add_epi32(c3, colorStep);
+
+		const __m128i src01 = _mm_packs_epi32(_mm_srai_epi32(c0, 16), _mm_srai_epi32(c1, 16));
+		const __m128i src23 = _mm_packs_epi32(_mm_srai_epi32(c2, 16), _mm_srai_epi32(c3, 16));
+
+		const __m128i pixels = _mm_loadu_si128((const __m128i*)(dst + i*4));
+		const __m128i lo = swBlendPixelsSSE2(src01, _mm_unpacklo_epi8(pixels, zero));
+		const __m128i hi = swBlendPixelsSSE2(src23, _mm_unpackhi_epi8(pixels, zero));
+		_mm_storeu_si128((__m128i*)(dst + i*4), _mm_packus_epi16(lo, hi));
+	}
+
+	int rest[4];
+	_mm_storeu_si128((__m128i*)rest, color);
+	swBlendGradientScalar(dst + i*4, count - i, rest, step);
+}
+
+static inline int swLoadTexel(const unsigned char *texel)
+{
+	int packedTexel;
+	memcpy(&packedTexel, texel, 4);
+	return packedTexel;
+}
+
+// one filtered texel, 4 channels (16 bit) in the low half
+static inline __m128i swSampleSSE2(const SWSpanKernels::TEXTURE &texture, int s, int t)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	if (!texture.bilinear)
+		return _mm_unpacklo_epi8(_mm_cvtsi32_si128(swLoadTexel(texture.texels + swNearestOffset(texture, s, t))), zero);
+
+	int offsets[4];
+	int fx, fy;
+	swBilinearFootprint(texture, s, t, offsets, fx, fy);
+
+	const __m128i round = _mm_set1_epi16(128);
+	const __m128i weightX = _mm_setr_epi16(256 - fx, 256 - fx, 256 - fx, 256 - fx, fx, fx, fx, fx);
+	const __m128i weightY = _mm_setr_epi16(256 - fy, 256 - fy, 256 - fy, 256 - fy, fy, fy, fy, fy);
+
+	// (00 | 10) and (01 | 11), weighted horizontally and summed up into (top | bottom), then the same vertically
+	const __m128i top = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(swLoadTexel(texture.texels + offsets[0])), _mm_cvtsi32_si128(swLoadTexel(texture.texels + offsets[1]))), zero);
+	const __m128i bottom = _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(swLoadTexel(texture.texels + offsets[2])), _mm_cvtsi32_si128(swLoadTexel(texture.texels + offsets[3]))), zero);
+	const __m128i weightedTop = _mm_mullo_epi16(top, weightX);
+	const __m128i weightedBottom = _mm_mullo_epi16(bottom, weightX);
+
+	__m128i rows = _mm_add_epi16(_mm_unpacklo_epi64(weightedTop, weightedBottom), _mm_unpackhi_epi64(weightedTop, weightedBottom));
+	rows = _mm_mullo_epi16(_mm_srli_epi16(_mm_add_epi16(rows, round), 8), weightY);
+
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(rows, _mm_unpackhi_epi64(rows, rows)), round), 8);
+}
+
+// modulates two texels (8 channels, 16 bit) with color, and blends the result onto two pixels (8 channels, 16 bit) of dst
+static inline __m128i swModulateBlendSSE2(__m128i texels, __m128i dst, __m128i color, bool blending)
+{
+	const __m128i src = swDiv255SSE2(_mm_mullo_epi16(texels, color));
+	return (blending ? swBlendPixelsSSE2(src, dst) : src);
+}
+
+static void swBlendTexturedSSE2(unsigned char *dst, int count, const SWSpanKernels::TEXTURE_SPAN &span)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i color = _mm_setr_epi16(span.color[0], span.color[1], span.color[2], span.color[3], span.color[0], span.color[1], span.color[2], span.color[3]);
+
+	int s = span.s;
+	int t = span.t;
+
+	int i = 0;
+	for (; i+2<=count; i+=2)
+	{
+		const __m128i texel0 = swSampleSSE2(span.texture, s, t);
+		const __m128i texel1 = swSampleSSE2(span.texture, s + span.ds, t + span.dt);
+		s += 2*span.ds;
+		t += 2*span.dt;
+
+		const __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(dst + i*4)), zero);
+		const __m128i result = swModulateBlendSSE2(_mm_unpacklo_epi64(texel0, texel1), pixels, color, span.blending);
+		_mm_storel_epi64((__m128i*)(dst + i*4), _mm_packus_epi16(result, result));
+	}
+
+	swBlendTexturedScalar(dst + i*4, count - i, span, s, t);
+}
+
+static void swBlendTexelsSSE2(unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i modulation = _mm_setr_epi16(color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3]);
+
+	int i = 0;
+	for (; i+4<=count; i+=4)
+	{
+		const __m128i src = _mm_loadu_si128((const __m128i*)(texels + i*4));
+		const __m128i pixels = _mm_loadu_si128((const __m128i*)(dst + i*4));
+		const __m128i lo = swModulateBlendSSE2(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(pixels, zero), modulation, blending);
+		const __m128i hi = swModulateBlendSSE2(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(pixels, zero), modulation, blending);
+		_mm_storeu_si128((__m128i*)(dst + i*4), _mm_packus_epi16(lo, hi));
+	}
+
+	swBlendTexelsScalar(dst + i*4, count - i, texels + i*4, color, blending);
+}
+
+#endif
+
+
+
+//*********//
+//	AVX2   //
+//*********//
+
+#ifdef MCENGINE_SW_AVX2
+
+SW_TARGET_AVX2 static inline __m256i swDiv255AVX2(__m256i x)
+{
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+SW_TARGET_AVX2 static void swFillAVX2(unsigned char *dst, int count, const unsigned char *color)
+{
+	int packedColor;
+	memcpy(&packedColor, color, 4);
+	const __m256i fill = _mm256_set1_epi32(packedColor);
+
+	int i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		_mm256_storeu_si256((__m256i*)(dst + i*4), fill);
+	}
+
+	swFillScalar(dst + i*4, count - i, color);
+}
+
+SW_TARGET_AVX2 static void swBlendAVX2(unsigned char *dst, int count, const unsigned char *color)
+{
+	const short alpha = color[3];
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i invAlpha = _mm256_set1_epi16(255 - alpha);
+	const __m256i src = _mm256_setr_epi16((short)(color[0]*alpha), (short)(color[1]*alpha), (short)(color[2]*alpha), (short)(alpha*alpha),
+										  (short)(color[0]*alpha), (short)(color[1]*alpha), (short)(color[2]*alpha), (short)(alpha*alpha),
+										  (short)(color[0]*alpha), (short)(color[1]*alpha), (short)(color[2]*alpha), (short)(alpha*alpha),
+										  (short)(color[0]*alpha), (short)(color[1]*alpha), (short)(color[2]*alpha), (short)(alpha*alpha));
+
+	// NOTE: unpack and pack both work within the two 128 bit halves, so the pixel order is preserved
+	int i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		const __m256i pixels = _mm256_loadu_si256((const __m256i*)(dst + i*4));
+		const __m256i lo = swDiv255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pixels, zero), invAlpha), src));
+		const __m256i hi = swDiv255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pixels, zero), invAlpha), src));
+		_mm256_storeu_si256((__m256i*)(dst + i*4), _mm256_packus_epi16(lo, hi));
+	}
+
+	swBlendScalar(dst + i*4, count - i, color);
+}
+
+SW_TARGET_AVX2 static inline __m256i swBlendPixelsAVX2(__m256i src, __m256i dst)
+{
+	const __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	const __m256i invAlpha = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+	return swDiv255AVX2(_mm256_add_epi16(_mm256_mullo_epi16(src, alpha), _mm256_mullo_epi16(dst, invAlpha)));
+}
+
+SW_TARGET_AVX2 static void swBlendGradientAVX2(unsigned char *dst, int count, const int *start, const int *step)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i colorStep = _mm256_setr_epi32(step[0], step[1], step[2], step[3], step[0], step[1], step[2], step[3]);
+	const __m256i colorStep8 = _mm256_slli_epi32(colorStep, 3);
+
+	// pixel i in the low half and pixel i + 4 in the high half, because that's the order which unpacklo/unpackhi (per half) produce:
+	// unpacklo = (0, 1 | 4, 5), unpackhi = (2, 3 | 6, 7)
+	__m256i color = _mm256_setr_epi32(start[0], start[1], start[2], start[3], start[0] + 4*step[0], start[1] + 4*step[1], start[2] + 4*step[2], start[3] + 4*step[3]);
+
+	int i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		const __m256i c0 = color;
+		const __m256i c1 = _mm256_add_epi32(c0, colorStep);
+		const __m256i c2 = _mm256_add_epi32(c1, colorStep);
+		const __m256i c3 = _mm256_add_epi32(c2, colorStep);
+		color = _mm256_add_epi32(color, colorStep8);
+
+		const __m256i src01 = _mm256_packs_epi32(_mm256_srai_epi32(c0, 16), _mm256_srai_epi32(c1, 16));
+		const __m256i src23 = _mm256_packs_epi32(_mm256_srai_epi32(c2, 16), _mm256_srai_epi32(c3, 16));
+
+		const __m256i pixels = _mm256_loadu_si256((const __m256i*)(dst + i*4));
+		const __m256i lo = swBlendPixelsAVX2(src01, _mm256_unpacklo_epi8(pixels, zero));
+		const __m256i hi = swBlendPixelsAVX2(src23, _mm256_unpackhi_epi8(pixels, zero));
+		_mm256_storeu_si256((__m256i*)(dst + i*4), _mm256_packus_epi16(lo, hi));
+	}
+
+	int rest[8];
+	_mm256_storeu_si256((__m256i*)rest, color);
+	swBlendGradientScalar(dst + i*4, count - i, rest, step);
+}
+
+// bilinear filter of two texels, a in the low half and b in the high half: top = (00, 10 | 00, 10), bottom = (01, 11 | 01, 11) (16 bit),
+// weights = (256 - f, f | 256 - f, f), the results end up in the low quarter of each half (same as swSampleSSE2(), per half)
+SW_TARGET_AVX2 static inline __m256i swBilinearAVX2(__m256i top, __m256i bottom, __m256i weightX, __m256i weightY)
+{
+	const __m256i round = _mm256_set1_epi16(128);
+	const __m256i weightedTop = _mm256_mullo_epi16(top, weightX);
+	const __m256i weightedBottom = _mm256_mullo_epi16(bottom, weightX);
+
+	__m256i rows = _mm256_add_epi16(_mm256_unpacklo_epi64(weightedTop, weightedBottom), _mm256_unpackhi_epi64(weightedTop, weightedBottom));
+	rows = _mm256_mullo_epi16(_mm256_srli_epi16(_mm256_add_epi16(rows, round), 8), weightY);
+
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(rows, _mm256_unpackhi_epi64(rows, rows)), round), 8);
+}
+
+// (256 - f, f | 256 - f, f) for two of the four 32 bit weights in f (in both halves), selected by the byte shuffle
+SW_TARGET_AVX2 static inline __m256i swBilinearWeightsAVX2(__m256i f, __m256i select)
+{
+	const __m256i negate = _mm256_setr_epi16(-1, -1, -1, -1, 0, 0, 0, 0, -1, -1, -1, -1, 0, 0, 0, 0);
+	const __m256i offset = _mm256_setr_epi16(256, 256, 256, 256, 0, 0, 0, 0, 256, 256, 256, 256, 0, 0, 0, 0);
+	const __m256i weights = _mm256_shuffle_epi8(f, select);
+	return _mm256_add_epi16(_mm256_sub_epi16(_mm256_xor_si256(weights, negate), negate), offset);
+}
+
+// two filtered texels from scalar footprints (any wrap mode), a in the low half and b in the high half
+SW_TARGET_AVX2 static inline __m256i swSampleBilinearAVX2(const SWSpanKernels::TEXTURE &texture, int sA, int tA, int sB, int tB)
+{
+	int offsetsA[4];
+	int offsetsB[4];
+	int fxA, fyA, fxB, fyB;
+	swBilinearFootprint(texture, sA, tA, offsetsA, fxA, fyA);
+	swBilinearFootprint(texture, sB, tB, offsetsB, fxB, fyB);
+
+	const __m256i top = _mm256_cvtepu8_epi16(_mm_setr_epi32(swLoadTexel(texture.texels + offsetsA[0]), swLoadTexel(texture.texels + offsetsA[1]), swLoadTexel(texture.texels + offsetsB[0]), swLoadTexel(texture.texels + offsetsB[1])));
+	const __m256i bottom = _mm256_cvtepu8_epi16(_mm_setr_epi32(swLoadTexel(texture.texels + offsetsA[2]), swLoadTexel(texture.texels + offsetsA[3]), swLoadTexel(texture.texels + offsetsB[2]), swLoadTexel(texture.texels + offsetsB[3])));
+	const __m256i weightX = _mm256_setr_epi16(256 - fxA, 256 - fxA, 256 - fxA, 256 - fxA, fxA, fxA, fxA, fxA, 256 - fxB, 256 - fxB, 256 - fxB, 256 - fxB, fxB, fxB, fxB, fxB);
+	const __m256i weightY = _mm256_setr_epi16(256 - fyA, 256 - fyA, 256 - fyA, 256 - fyA, fyA, fyA, fyA, fyA, 256 - fyB, 256 - fyB, 256 - fyB, 256 - fyB, fyB, fyB, fyB, fyB);
+
+	return swBilinearAVX2(top, bottom, weightX, weightY);
+}
+
+// four samples at the 16.16 coordinates in s/t, with the coordinates, weights and (clamped) texel indices computed in vectors, and gathered texels
+// the result is 16 bit, pixels 0, 1 in the low half and 2, 3 in the high half
+// returns false if a repeating texture would have to wrap around, which is left to the scalar footprints
+SW_TARGET_AVX2 static inline bool swSample4AVX2(const SWSpanKernels::TEXTURE &texture, __m128i s, __m128i t, __m256i &texels)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i maxX = _mm_set1_epi32(texture.width - 1);
+	const __m128i maxY = _mm_set1_epi32(texture.height - 1);
+	const __m128i width = _mm_set1_epi32(texture.width);
+	const int *base = (const int*)texture.texels;
+
+	if (!texture.bilinear)
+	{
+		const __m128i x = _mm_srai_epi32(s, 16);
+		const __m128i y = _mm_srai_epi32(t, 16);
+		const __m128i clampedX = _mm_min_epi32(_mm_max_epi32(x, zero), maxX);
+		const __m128i clampedY = _mm_min_epi32(_mm_max_epi32(y, zero), maxY);
+		if (texture.repeat && _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi32(x, clampedX), _mm_cmpeq_epi32(y, clampedY))) != 0xffff)
+			return false;
+
+		texels = _mm256_cvtepu8_epi16(_mm_i32gather_epi32(base, _mm_add_epi32(clampedX, _mm_mullo_epi32(clampedY, width)), 4));
+		return true;
+	}
+
+	// relative to the texel centers
+	s = _mm_sub_epi32(s, _mm_set1_epi32(32768));
+	t = _mm_sub_epi32(t, _mm_set1_epi32(32768));
+
+	const __m128i x0 = _mm_srai_epi32(s, 16);
+	const __m128i y0 = _mm_srai_epi32(t, 16);
+	const __m128i x1 = _mm_add_epi32(x0, one);
+	const __m128i y1 = _mm_add_epi32(y0, one);
+	const __m128i clampedX0 = _mm_min_epi32(_mm_max_epi32(x0, zero), maxX);
+	const __m128i clampedY0 = _mm_min_epi32(_mm_max_epi32(y0, zero), maxY);
+	const __m128i clampedX1 = _mm_min_epi32(_mm_max_epi32(x1, zero), maxX);
+	const __m128i clampedY1 = _mm_min_epi32(_mm_max_epi32(y1, zero), maxY);
+	if (texture.repeat)
+	{
+		const __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi32(x0, clampedX0), _mm_cmpeq_epi32(x1, clampedX1)), _mm_and_si128(_mm_cmpeq_epi32(y0, clampedY0), _mm_cmpeq_epi32(y1, clampedY1)));
+		if (_mm_movemask_epi8(inside) != 0xffff)
+			return false;
+	}
+
+	const __m128i row0 = _mm_mullo_epi32(clampedY0, width);
+	const __m128i row1 = _mm_mullo_epi32(clampedY1, width);
+	const __m128i t00 = _mm_i32gather_epi32(base, _mm_add_epi32(clampedX0, row0), 4);
+	const __m128i t10 = _mm_i32gather_epi32(base, _mm_add_epi32(clampedX1, row0), 4);
+	const __m128i t01 = _mm_i32gather_epi32(base, _mm_add_epi32(clampedX0, row1), 4);
+	const __m128i t11 = _mm_i32gather_epi32(base, _mm_add_epi32(clampedX1, row1), 4);
+
+	// (00, 10) and (01, 11) per pixel, split into the pixel pairs (0 | 2) and (1 | 3)
+	const __m128i top01 = _mm_unpacklo_epi32(t00, t10);
+	const __m128i top23 = _mm_unpackhi_epi32(t00, t10);
+	const __m128i bottom01 = _mm_unpacklo_epi32(t01, t11);
+	const __m128i bottom23 = _mm_unpackhi_epi32(t01, t11);
+
+	const __m128i mask = _mm_set1_epi32(0xff);
+	const __m256i fx = _mm256_broadcastsi128_si256(_mm_and_si128(_mm_srli_epi32(s, 8), mask));
+	const __m256i fy = _mm256_broadcastsi128_si256(_mm_and_si128(_mm_srli_epi32(t, 8), mask));
+	const __m256i select02 = _mm256_setr_epi8(0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 8, 9, 8, 9, 8, 9, 8, 9, 8, 9, 8, 9, 8, 9, 8, 9);
+	const __m256i select13 = _mm256_setr_epi8(4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 4, 5, 12, 13, 12, 13, 12, 13, 12, 13, 12, 13, 12, 13, 12, 13, 12, 13);
+
+	const __m256i texels02 = swBilinearAVX2(_mm256_cvtepu8_epi16(_mm_unpacklo_epi64(top01, top23)), _mm256_cvtepu8_epi16(_mm_unpacklo_epi64(bottom01, bottom23)),
+											swBilinearWeightsAVX2(fx, select02), swBilinearWeightsAVX2(fy, select02));
+	const __m256i texels13 = swBilinearAVX2(_mm256_cvtepu8_epi16(_mm_unpackhi_epi64(top01, top23)), _mm256_cvtepu8_epi16(_mm_unpackhi_epi64(bottom01, bottom23)),
+											swBilinearWeightsAVX2(fx, select13), swBilinearWeightsAVX2(fy, select13));
+
+	texels = _mm256_unpacklo_epi64(texels02, texels13);
+	return true;
+}
+
+SW_TARGET_AVX2 static inline __m256i swModulateBlendAVX2(__m256i texels, __m256i dst, __m256i color, bool blending)
+{
+	const __m256i src = swDiv255AVX2(_mm256_mullo_epi16(texels, color));
+	return (blending ? swBlendPixelsAVX2(src, dst) : src);
+}
+
+SW_TARGET_AVX2 static void swBlendTexturedAVX2(unsigned char *dst, int count, const SWSpanKernels::TEXTURE_SPAN &span)
+{
+	const __m256i color = _mm256_setr_epi16(span.color[0], span.color[1], span.color[2], span.color[3], span.color[0], span.color[1], span.color[2], span.color[3],
+											span.color[0], span.color[1], span.color[2], span.color[3], span.color[0], span.color[1], span.color[2], span.color[3]);
+	const int ds = span.ds;
+	const int dt = span.dt;
+	const __m128i stepS = _mm_setr_epi32(0, ds, 2*ds, 3*ds);
+	const __m128i stepT = _mm_setr_epi32(0, dt, 2*dt, 3*dt);
+
+	int s = span.s;
+	int t = span.t;
+
+	// pixels 0, 1 in the low half and 2, 3 in the high half (zero extended from 128 bit)
+	int i = 0;
+	for (; i+4<=count; i+=4)
+	{
+		__m256i texels;
+		if (!swSample4AVX2(span.texture, _mm_add_epi32(_mm_set1_epi32(s), stepS), _mm_add_epi32(_mm_set1_epi32(t), stepT), texels))
+		{
+			if (span.texture.bilinear)
+			{
+				const __m256i texels02 = swSampleBilinearAVX2(span.texture, s, t, s + 2*ds, t + 2*dt);
+				const __m256i texels13 = swSampleBilinearAVX2(span.texture, s + ds, t + dt, s + 3*ds, t + 3*dt);
+				texels = _mm256_unpacklo_epi64(texels02, texels13);
+			}
+			else
+			{
+				texels = _mm256_cvtepu8_epi16(_mm_setr_epi32(swLoadTexel(span.texture.texels + swNearestOffset(span.texture, s, t)),
+															 swLoadTexel(span.texture.texels + swNearestOffset(span.texture, s + ds, t + dt)),
+															 swLoadTexel(span.texture.texels + swNearestOffset(span.texture, s + 2*ds, t + 2*dt)),
+															 swLoadTexel(span.texture.texels + swNearestOffset(span.texture, s + 3*ds, t + 3*dt))));
+			}
+		}
+		s += 4*ds;
+		t += 4*dt;
+
+		const __m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(dst + i*4)));
+		const __m256i result = swModulateBlendAVX2(texels, pixels, color, span.blending);
+
+		// packus works per half (0, 1, 0, 1 | 2, 3, 2, 3), so gather the first quarter of each half
+		_mm_storeu_si128((__m128i*)(dst + i*4), _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(result, result), _MM_SHUFFLE(3, 1, 2, 0))));
+	}
+
+	swBlendTexturedScalar(dst + i*4, count - i, span, s, t);
+}
+
+SW_TARGET_AVX2 static void swBlendTexelsAVX2(unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i modulation = _mm256_setr_epi16(color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3],
+												 color[0], color[1], color[2], color[3], color[0], color[1], color[2], color[3]);
+
+	int i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		const __m256i src = _mm256_loadu_si256((const __m256i*)(texels + i*4));
+		const __m256i pixels = _mm256_loadu_si256((const __m256i*)(dst + i*4));
+		const __m256i lo = swModulateBlendAVX2(_mm256_unpacklo_epi8(src, zero), _mm256_unpacklo_epi8(pixels, zero), modulation, blending);
+		const __m256i hi = swModulateBlendAVX2(_mm256_unpackhi_epi8(src, zero), _mm256_unpackhi_epi8(pixels, zero), modulation, blending);
+		_mm256_storeu_si256((__m256i*)(dst + i*4), _mm256_packus_epi16(lo, hi));
+	}
+
+	swBlendTexelsScalar(dst + i*4, count - i, texels + i*4, color, blending);
+}
+
+#endif
+
+
+
+//**************//
+//	Dispatching	//
+//**************//
+
+SWSpanKernels::ISA SWSpanKernels::getSupportedISA()
+{
+	static int supportedISA = -1;
+	if (supportedISA < 0)
+	{
+		supportedISA = (int)ISA::ISA_SCALAR;
+
+#ifdef MCENGINE_SW_SSE2
+
+		supportedISA = (int)ISA::ISA_SSE2;
+
+#endif
+
+#ifdef MCENGINE_SW_AVX2
+
+#if defined(__GNUC__)
+
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			supportedISA = (int)ISA::ISA_AVX2;
+
+#elif defined(_MSC_VER)
+
+		// cpu support (leaf 7), and os support for saving the ymm registers (osxsave + xgetbv)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			const bool osxsave = ((info[2] & (1 << 27)) != 0);
+
+			__cpuidex(info, 7, 0);
+			const bool avx2 = ((info[1] & (1 << 5)) != 0);
+
+			if (osxsave && avx2 && (_xgetbv(0) & 0x6) == 0x6)
+				supportedISA = (int)ISA::ISA_AVX2;
+		}
+
+#endif
+
+#endif
+	}
+
+	return (ISA)supportedISA;
+}
+
+SWSpanKernels::ISA SWSpanKernels::getISA()
+{
+	if (s_iSWSpanISA < 0)
+		s_iSWSpanISA = clamp<int>(r_sw_simd.getInt(), (int)ISA::ISA_SCALAR, (int)getSupportedISA());
+
+	return (ISA)s_iSWSpanISA;
+}
+
+const char *SWSpanKernels::getISAName(ISA isa)
+{
+	switch (isa)
+	{
+	case ISA::ISA_SCALAR:
+		return "scalar";
+	case ISA::ISA_SSE2:
+		return "SSE2";
+	case ISA::ISA_AVX2:
+		return "AVX2";
+	}
+
+	return "unknown";
+}
+
+void SWSpanKernels::fill(unsigned char *dst, int count, const unsigned char *color)
+{
+	fill(getISA(), dst, count, color);
+}
+
+void SWSpanKernels::blend(unsigned char *dst, int count, const unsigned char *color)
+{
+	blend(getISA(), dst, count, color);
+}
+
+void SWSpanKernels::blendGradient(unsigned char *dst, int count, const int *start, const int *step)
+{
+	blendGradient(getISA(), dst, count, start, step);
+}
+
+void SWSpanKernels::blendTextured(unsigned char *dst, int count, const TEXTURE_SPAN &span)
+{
+	blendTextured(getISA(), dst, count, span);
+}
+
+void SWSpanKernels::blendTexels(unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending)
+{
+	blendTexels(getISA(), dst, count, texels, color, blending);
+}
+
+void SWSpanKernels::sample(const TEXTURE &texture, int s, int t, unsigned char *texel)
+{
+	unsigned int filtered[4];
+	swSampleScalar(texture, s, t, filtered);
+
+	texel[0] = (unsigned char)filtered[0];
+	texel[1] = (unsigned char)filtered[1];
+	texel[2] = (unsigned char)filtered[2];
+	texel[3] = (unsigned char)filtered[3];
+}
+
+void SWSpanKernels::fill(ISA isa, unsigned char *dst, int count, const unsigned char *color)
+{
+	switch (isa)
+	{
+#ifdef MCENGINE_SW_AVX2
+	case ISA::ISA_AVX2:
+		swFillAVX2(dst, count, color);
+		break;
+#endif
+#ifdef MCENGINE_SW_SSE2
+	case ISA::ISA_SSE2:
+		swFillSSE2(dst, count, color);
+		break;
+#endif
+	default:
+		swFillScalar(dst, count, color);
+		break;
+	}
+}
+
+void SWSpanKernels::blend(ISA isa, unsigned char *dst, int count, const unsigned char *color)
+{
+	switch (isa)
+	{
+#ifdef MCENGINE_SW_AVX2
+	case ISA::ISA_AVX2:
+		swBlendAVX2(dst, count, color);
+		break;
+#endif
+#ifdef MCENGINE_SW_SSE2
+	case ISA::ISA_SSE2:
+		swBlendSSE2(dst, count, color);
+		break;
+#endif
+	default:
+		swBlendScalar(dst, count, color);
+		break;
+	}
+}
+
+void SWSpanKernels::blendGradient(ISA isa, unsigned char *dst, int count, const int *start, const int *step)
+{
+	switch (isa)
+	{
+#ifdef MCENGINE_SW_AVX2
+	case ISA::ISA_AVX2:
+		swBlendGradientAVX2(dst, count, start, step);
+		break;
+#endif
+#ifdef MCENGINE_SW_SSE2
+	case ISA::ISA_SSE2:
+		swBlendGradientSSE2(dst, count, start, step);
+		break;
+#endif
+	default:
+		swBlendGradientScalar(dst, count, start, step);
+		break;
+	}
+}
+
+void SWSpanKernels::blendTextured(ISA isa, unsigned char *dst, int count, const TEXTURE_SPAN &span)
+{
+	switch (isa)
+	{
+#ifdef MCENGINE_SW_AVX2
+	case ISA::ISA_AVX2:
+		swBlendTexturedAVX2(dst, count, span);
+		break;
+#endif
+#ifdef MCENGINE_SW_SSE2
+	case ISA::ISA_SSE2:
+		swBlendTexturedSSE2(dst, count, span);
+		break;
+#endif
+	default:
+		swBlendTexturedScalar(dst, count, span, span.s, span.t);
+		break;
+	}
+}
+
+void SWSpanKernels::blendTexels(ISA isa, unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending)
+{
+	// unmodulated copy (multiplying by 255 is exact)
+	if (!blending && color[0] == 255 && color[1] == 255 && color[2] == 255 && color[3] == 255)
+	{
+		if (count > 0)
+			memcpy(dst, texels, count*4);
+		return;
+	}
+
+	switch (isa)
+	{
+#ifdef MCENGINE_SW_AVX2
+	case ISA::ISA_AVX2:
+		swBlendTexelsAVX2(dst, count, texels, color, blending);
+		break;
+#endif
+#ifdef MCENGINE_SW_SSE2
+	case ISA::ISA_SSE2:
+		swBlendTexelsSSE2(dst, count, texels, color, blending);
+		break;
+#endif
+	default:
+		swBlendTexelsScalar(dst, count, texels, color, blending);
+		break;
+	}
+}
+
+
+
+//**********************************//
+//	SWSpanKernels ConCommands		//
+//**********************************//
+
+// the previous SWGraphicsInterface::fillRect(), as the baseline: column major, drawPixel() per pixel (bounds check, float blending, color conversion)
+static void swBlendRectPerPixel(unsigned char *buffer, int width, int height, Color color)
+{
+	for (int x=0; x<width; x++)
+	{
+		for (int y=0; y<height; y++)
+		{
+			if (x < 0 || x > width-1 || y < 0 || y > height-1)
+				continue;
+
+			unsigned char *pixel = &buffer[(x + y*width)*4];
+			Color dstPixel = COLOR(pixel[3], pixel[2], pixel[1], pixel[0]);
+			Color finalColor = COLORf((COLOR_GET_Af(color)*COLOR_GET_Af(color) + COLOR_GET_Af(dstPixel)*(1.0f - COLOR_GET_Af(color))),
+									  (COLOR_GET_Rf(color)*COLOR_GET_Af(color) + COLOR_GET_Rf(dstPixel)*(1.0f - COLOR_GET_Af(color))),
+									  (COLOR_GET_Gf(color)*COLOR_GET_Af(color) + COLOR_GET_Gf(dstPixel)*(1.0f - COLOR_GET_Af(color))),
+									  (COLOR_GET_Bf(color)*COLOR_GET_Af(color) + COLOR_GET_Bf(dstPixel)*(1.0f - COLOR_GET_Af(color))));
+
+			pixel[0] = COLOR_GET_Bi(finalColor);
+			pixel[1] = COLOR_GET_Gi(finalColor);
+			pixel[2] = COLOR_GET_Ri(finalColor);
+			pixel[3] = COLOR_GET_Ai(finalColor);
+		}
+	}
+}
+
+static unsigned long long swHashBuffer(const std::vector<unsigned char> &buffer)
+{
+	unsigned long long hash = 1469598103934665603ULL; // FNV-1a
+	for (size_t i=0; i<buffer.size(); i++)
+	{
+		hash ^= buffer[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void _r_sw_benchmark_spans(UString args)
+{
+	int width = 1920;
+	int height = 1080;
+	std::vector<UString> tokens = args.trim().split(" ");
+	if (tokens.size() > 1)
+	{
+		width = std::max(tokens[0].toInt(), 1);
+		height = std::max(tokens[1].toInt(), 1);
+	}
+
+	const int numIterations = 20;
+	const double megaPixels = (double)width * height * numIterations / 1000000.0;
+
+	const unsigned char solidColor[4] = {0x40, 0x80, 0xc0, 0xff}; // b, g, r, a
+	const unsigned char blendColor[4] = {0x40, 0x80, 0xc0, 0x80};
+	const int gradientStart[4] = {0 << 16, 64 << 16, 255 << 16, 32 << 16};
+	const int gradientStep[4] = {(255 << 16) / width, (128 << 16) / width, -(255 << 16) / width, (192 << 16) / width};
+
+	// texture with one row per screen row for the texel copies, and noise with varying alpha
+	const int textureHeight = 256;
+	std::vector<unsigned char> texels(width*textureHeight*4);
+	unsigned int random = 0x12345678;
+	for (size_t i=0; i<texels.size(); i++)
+	{
+		random = random*1664525 + 1013904223; // LCG
+		texels[i] = (unsigned char)(random >> 24);
+	}
+
+	SWSpanKernels::TEXTURE_SPAN texturedSpan;
+	texturedSpan.texture.texels = &texels[0];
+	texturedSpan.texture.width = width;
+	texturedSpan.texture.height = textureHeight;
+	texturedSpan.texture.repeat = true;
+	texturedSpan.ds = (int)(0.8f*65536.0f); // scaled and rotated, but within the texture (same as drawImage())
+	texturedSpan.dt = (int)(0.1f*65536.0f);
+	memcpy(texturedSpan.color, blendColor, 4);
+	texturedSpan.blending = true;
+
+	std::vector<unsigned char> buffer(width*height*4, 0x7f);
+	Timer timer;
+	timer.start();
+
+	debugLog("Software rasterizer span benchmark (%ix%i, %i iterations, cpu supports %s):\n", width, height, numIterations, SWSpanKernels::getISAName(SWSpanKernels::getSupportedISA()));
+
+	timer.update();
+	for (int n=0; n<numIterations; n++)
+	{
+		swBlendRectPerPixel(&buffer[0], width, height, COLOR(blendColor[3], blendColor[2], blendColor[1], blendColor[0]));
+	}
+	timer.update();
+	debugLog("%-10s blend %9.1f Mpx/s (previous fillRect())\n", "per pixel", megaPixels / timer.getDelta());
+
+	unsigned long long referenceHash = 0;
+	for (int isa=(int)SWSpanKernels::ISA::ISA_SCALAR; isa<=(int)SWSpanKernels::getSupportedISA(); isa++)
+	{
+		double seconds[6];
+
+		timer.update();
+		for (int n=0; n<numIterations; n++)
+		{
+			for (int y=0; y<height; y++)
+			{
+				SWSpanKernels::fill((SWSpanKernels::ISA)isa, &buffer[y*width*4], width, solidColor);
+			}
+		}
+		timer.update();
+		seconds[0] = timer.getDelta();
+
+		timer.update();
+		for (int n=0; n<numIterations; n++)
+		{
+			for (int y=0; y<height; y++)
+			{
+				SWSpanKernels::blend((SWSpanKernels::ISA)isa, &buffer[y*width*4], width, blendColor);
+			}
+		}
+		timer.update();
+		seconds[1] = timer.getDelta();
+
+		timer.update();
+		for (int n=0; n<numIterations; n++)
+		{
+			for (int y=0; y<height; y++)
+			{
+				SWSpanKernels::blendGradient((SWSpanKernels::ISA)isa, &buffer[y*width*4], width, gradientStart, gradientStep);
+			}
+		}
+		timer.update();
+		seconds[2] = timer.getDelta();
+
+		timer.update();
+		for (int n=0; n<numIterations; n++)
+		{
+			for (int y=0; y<height; y++)
+			{
+				SWSpanKernels::blendTexels((SWSpanKernels::ISA)isa, &buffer[y*width*4], width, &texels[(y % textureHeight)*width*4], blendColor, true);
+			}
+		}
+		timer.update();
+		seconds[3] = timer.getDelta();
+
+		for (int f=0; f<2; f++)
+		{
+			texturedSpan.texture.bilinear = (f > 0);
+
+			timer.update();
+			for (int n=0; n<numIterations; n++)
+			{
+				for (int y=0; y<height; y++)
+				{
+					texturedSpan.s = (y % 256)*65536 + 0x8000;
+					texturedSpan.t = (y % 48)*65536 + 0x8000;
+					SWSpanKernels::blendTextured((SWSpanKernels::ISA)isa, &buffer[y*width*4], width, texturedSpan);
+				}
+			}
+			timer.update();
+			seconds[4 + f] = timer.getDelta();
+		}
+
+		// every instruction set must produce exactly the same pixels
+		std::fill(buffer.begin(), buffer.end(), 0x7f);
+		for (int y=0; y<height; y++)
+		{
+			SWSpanKernels::blend((SWSpanKernels::ISA)isa, &buffer[y*width*4], width - (y % 7), blendColor);
+			SWSpanKernels::blendGradient((SWSpanKernels::ISA)isa, &buffer[y*width*4 + (y % 5)*4], width - (y % 5), gradientStart, gradientStep);
+			SWSpanKernels::blendTexels((SWSpanKernels::ISA)isa, &buffer[y*width*4 + (y % 3)*4], width - (y % 3) - (y % 11), &texels[(y % textureHeight)*width*4], (y % 2 == 0 ? blendColor : solidColor), (y % 4 != 0));
+
+			// all filter/wrap combinations, including mirrored spans and coordinates outside of the texture
+			texturedSpan.texture.bilinear = (y % 2 == 0);
+			texturedSpan.texture.repeat = (y % 4 < 2);
+			texturedSpan.blending = (y % 8 < 4);
+			texturedSpan.s = (y - height/2)*(int)(0.3f*65536.0f) + 12345;
+			texturedSpan.t = (y - height/2)*(int)(-0.2f*65536.0f) + 54321;
+			texturedSpan.ds = (y % 3 == 0 ? -1 : 1)*(int)((0.25f + (y % 13)*0.2f)*65536.0f);
+			SWSpanKernels::blendTextured((SWSpanKernels::ISA)isa, &buffer[y*width*4 + (y % 9)*4], width - (y % 9), texturedSpan);
+		}
+		texturedSpan.texture.repeat = true;
+		texturedSpan.blending = true;
+		texturedSpan.ds = (int)(0.8f*65536.0f);
+		texturedSpan.dt = (int)(0.1f*65536.0f);
+		const unsigned long long hash = swHashBuffer(buffer);
+		if (isa == (int)SWSpanKernels::ISA::ISA_SCALAR)
+			referenceHash = hash;
+
+		debugLog("%-10s fill %7.1f, blend %7.1f, gradient %7.1f, texels %7.1f, nearest %7.1f, bilinear %7.1f Mpx/s%s\n", SWSpanKernels::getISAName((SWSpanKernels::ISA)isa),
+				 megaPixels / seconds[0], megaPixels / seconds[1], megaPixels / seconds[2], megaPixels / seconds[3], megaPixels / seconds[4], megaPixels / seconds[5], (hash == referenceHash ? "" : " (MISMATCH!)"));
+	}
+}
+
+ConVar _r_sw_benchmark_spans_("r_sw_benchmark_spans", _r_sw_benchmark_spans, ConVar::ARGS::ARGS_OPTIONAL);
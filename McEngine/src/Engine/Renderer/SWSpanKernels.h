@@ -0,0 +1,76 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		row span kernels of the software rasterizer (fill, blend, gradient, textured)
+//
+// $NoKeywords: $swspan
+//===============================================================================//
+
+#ifndef SWSPANKERNELS_H
+#define SWSPANKERNELS_H
+
+#include "cbase.h"
+
+// all kernels work on count consecutive pixels in the memory layout of SWGraphicsInterface::PIXEL (b, g, r, a bytes)
+// textures are sampled like opengl (texel centers at +0.5, bilinear weights with 8 bit precision)
+// blending is GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA for all four channels, in exact integer math,
+// so every instruction set produces exactly the same pixels (the scalar kernels are the reference)
+
+class SWSpanKernels
+{
+public:
+	enum class ISA
+	{
+		ISA_SCALAR,
+		ISA_SSE2,
+		ISA_AVX2
+	};
+
+	struct TEXTURE
+	{
+		const unsigned char *texels; // b, g, r, a, top row first
+		int width;
+		int height;
+		bool bilinear;	// false = nearest
+		bool repeat;	// false = clamp
+	};
+
+	struct TEXTURE_SPAN
+	{
+		TEXTURE texture;
+		int s, t;		// 16.16 texel coordinates of the first pixel center
+		int ds, dt;		// per pixel
+		unsigned char color[4]; // modulates the texels (b, g, r, a)
+		bool blending;	// false = overwrite
+	};
+
+	static ISA getSupportedISA(); // runtime cpu detection (cached)
+	static ISA getISA(); // the one which is actually used, see r_sw_simd
+	static const char *getISAName(ISA isa);
+
+	// dst = color
+	static void fill(unsigned char *dst, int count, const unsigned char *color);
+
+	// dst = color*a + dst*(1 - a)
+	static void blend(unsigned char *dst, int count, const unsigned char *color);
+
+	// dst = c*a + dst*(1 - a), where c = (start + i*step) >> 16 per channel (16.16 fixed point, must stay within [0, 255])
+	static void blendGradient(unsigned char *dst, int count, const int *start, const int *step);
+
+	// dst = t*a + dst*(1 - a), where t = sampled texel * span.color
+	static void blendTextured(unsigned char *dst, int count, const TEXTURE_SPAN &span);
+
+	// same as blendTextured(), but for an unscaled and aligned span, i.e. texels is just the matching row of the texture
+	static void blendTexels(unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending);
+
+	// single texel (filtered), s/t in 16.16 texel coordinates
+	static void sample(const TEXTURE &texture, int s, int t, unsigned char *texel);
+
+	// same as above, but with an explicit instruction set (which must be supported), for the benchmark
+	static void fill(ISA isa, unsigned char *dst, int count, const unsigned char *color);
+	static void blend(ISA isa, unsigned char *dst, int count, const unsigned char *color);
+	static void blendGradient(ISA isa, unsigned char *dst, int count, const int *start, const int *step);
+	static void blendTextured(ISA isa, unsigned char *dst, int count, const TEXTURE_SPAN &span);
+	static void blendTexels(ISA isa, unsigned char *dst, int count, const unsigned char *texels, const unsigned char *color, bool blending);
+};
+
+#endif
@@ -100,10 +100,13 @@ VulkanGraphicsInterface::~VulkanGraphicsInterface()
 
 void VulkanGraphicsInterface::beginScene()
 {
+	beginFrameStats();
 }
 
 void VulkanGraphicsInterface::endScene()
 {
+	endFrameStats();
+
 	// TODO: swapchain present
 
 	vkQueueWaitIdle(m_queue);
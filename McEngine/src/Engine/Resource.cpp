@@ -8,6 +8,7 @@
 #include "Resource.h"
 #include "Engine.h"
 #include "Environment.h"
+#include "ResourceManager.h"
 
 Resource::Resource(UString filepath)
 {
@@ -124,3 +125,15 @@ void Resource::interruptLoad()
 {
 	m_bInterrupted = true;
 }
+
+void Resource::setName(UString name)
+{
+	if (name == m_sName) return;
+
+	const UString oldName = m_sName;
+	m_sName = name;
+
+	// keep the name index in sync
+	if (engine != NULL && engine->getResourceManager() != NULL)
+		engine->getResourceManager()->onResourceRenamed(this, oldName);
+}
@@ -14,6 +14,18 @@ class ResourceManager;
 
 class Resource
 {
+public:
+	enum class TYPE
+	{
+		TYPE_IMAGE,
+		TYPE_FONT,
+		TYPE_SOUND,
+		TYPE_SHADER,
+		TYPE_RENDERTARGET,
+		TYPE_TEXTUREATLAS,
+		TYPE_VAO
+	};
+
 public:
 	Resource();
 	Resource(UString filepath);
@@ -26,8 +38,9 @@ public:
 
 	void interruptLoad();
 
-	void setName(UString name){m_sName = name;}
+	void setName(UString name);
 
+	virtual TYPE getResType() const = 0;
 	inline UString getName() const {return m_sName;}
 	inline UString getFilePath() const {return m_sFilePath;}
 
@@ -9,6 +9,11 @@
 #include "Engine.h"
 #include "ConVar.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "Logger.h"
+
+#include <chrono>
 
 
 
@@ -32,23 +37,52 @@
 ConVar rm_warnings("rm_warnings", false);
 ConVar rm_async_rand_delay("rm_async_rand_delay", 0.0f);
 ConVar rm_interrupt_on_destroy("rm_interrupt_on_destroy", true);
+ConVar rm_sync_budget_ms("rm_sync_budget_ms", 2.0f, "maximum time per frame in milliseconds which is spent finishing async loaded resources on the main thread (at least one resource is always finished per frame)");
+void _rm_loader_threads_(UString oldValue, UString newValue);
+ConVar rm_loader_threads("rm_loader_threads", -1, "number of async resource loader threads (-1 = number of cores - 1)", _rm_loader_threads_);
 ConVar debug_rm("debug_rm", false);
+ConVar debug_rm_timing("debug_rm_timing", false, "prints the load time of every resource, and a summary once all queued async loads have finished");
+
+void _rm_loader_threads_(UString oldValue, UString newValue)
+{
+	if (engine != NULL && engine->getResourceManager() != NULL)
+		engine->getResourceManager()->setNumLoaderThreads(newValue.toInt());
+}
+
+template<typename T>
+static inline T *_rmCastResource(Resource *rs, Resource::TYPE type)
+{
+	// NOTE: cheaper than a dynamic_cast, and subclasses (e.g. OpenGLImage) report the type of their base
+	return (rs != NULL && rs->getResType() == type ? static_cast<T*>(rs) : NULL);
+}
 
-// TODO: rewrite this garbage. support any number of parallel resource loading threads (default to 2)
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
 extern bool g_bRunning;
 
-std::mutex g_resourceManagerMutex;
-std::mutex g_resourceManagerLoadingMutex;
-std::mutex g_resourceManagerLoadingWorkMutex;
+std::mutex g_resourceManagerLoadingMutex; // closed (locked by the main thread) while there is no queued work, the loader threads wait here
+std::mutex g_resourceManagerLoadingWorkMutex; // protects m_loadingWork
 
-//void *_resourceLoadThread(void *data);
 void *_resourceLoaderThread(void *data);
 void _resourceLoaderThreadVoid(void *data);
 
 #endif
 
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+pthread_mutex_t g_resourceManagerLoaderSleepMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_resourceManagerLoaderSleepCond = PTHREAD_COND_INITIALIZER; // loader threads which found nothing to claim wait here
+
+#endif
+
+static const std::chrono::steady_clock::time_point g_resourceManagerStartTime = std::chrono::steady_clock::now();
+
+static double _rmGetTime()
+{
+	// NOTE: engine->getTimeReal() is not thread safe
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - g_resourceManagerStartTime).count();
+}
+
 
 
 // HACKHACK: do this with env->getOS() or something
@@ -74,166 +108,114 @@ const char *ResourceManager::PATH_DEFAULT_SHADERS = "shaders/";
 ResourceManager::ResourceManager()
 {
 	m_bNextLoadAsync = false;
+	m_nextLoadPriority = LOAD_PRIORITY::LOAD_PRIORITY_NORMAL;
+
+	m_bStopLoaderThreads = false;
+	m_bLoadingGateOpen = false;
+	m_iLoadingWorkOrder = 0;
+
+	m_iNumAsyncLoads = 0;
+	m_iNumCancelledLoads = 0;
+	m_dAsyncLoadTime = 0.0;
+	m_dSyncLoadTime = 0.0;
+	m_dBatchStartTime = 0.0;
+	m_iBatchNumLoads = 0;
 
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
-	// stop loading thread, wait for work
+	// stop loading threads, wait for work
 	g_resourceManagerLoadingMutex.lock();
 
 #endif
 
-	// build loading thread
-#ifdef MCENGINE_FEATURE_PTHREADS
-
-	int ret = pthread_create(&m_loadingThread, NULL, _resourceLoaderThread, (void*)&m_loadingWork);
-	if (ret)
-		engine->showMessageError("ResourceManager Error", UString::format("pthread_create() returned %i!", ret));
-
-#elif defined(__SWITCH__)
-
-	Result rc = threadCreate((Thread*)&m_loadingThread, _resourceLoaderThreadVoid, (void*)&m_loadingWork, 0x1000000, 0x2B, 2);
-	if (R_FAILED(rc))
-		engine->showMessageError("ResourceManager Error", UString::format("threadCreate() returned %i!", (int)rc));
-	else
-		threadStart((Thread*)&m_loadingThread);
-
-#endif
+	setNumLoaderThreads(rm_loader_threads.getInt());
 }
 
 ResourceManager::~ResourceManager()
 {
-	// release all resources
+	// release all resources (queued loads are cancelled, running ones are flagged)
 	destroyResources();
 
+	// NOTE: blocks until the currently running loadAsync()s have returned
+	stopLoaderThreads();
+
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
-	if (m_loadingWork.size() < 1)
-		g_resourceManagerLoadingMutex.unlock(); // let it exit
+	if (!m_bLoadingGateOpen)
+		g_resourceManagerLoadingMutex.unlock();
 
 #endif
 
-#ifdef MCENGINE_FEATURE_PTHREADS
-
-	pthread_join(m_loadingThread, NULL); // TODO: not the best solution. will block shutdown until all loading work is done
-
-#elif defined(__SWITCH__)
-
-	threadWaitForExit((Thread*)&m_loadingThread);
-	threadClose((Thread*)&m_loadingThread);
+	// whatever is left over was either cancelled while loading, or is unmanaged (and therefore owned by someone else)
+	for (size_t i=0; i<m_loadingWork.size(); i++)
+	{
+		if (m_loadingWork[i]->cancelled)
+		{
+			m_loadingWork[i]->resource->load(); // see finishLoadingWork()
+			delete m_loadingWork[i]->resource;
+		}
 
-#endif
+		delete m_loadingWork[i];
+	}
+	m_loadingWork.clear();
 }
 
 void ResourceManager::update()
 {
-#ifdef MCENGINE_FEATURE_MULTITHREADING
+	VPROF("ResourceManager::update");
 
-	if (debug_rm.getBool())
-	{
-		if (m_threads.size() > 0)
-			debugLog("Resource Manager: %i active worker thread(s)\n", m_threads.size());
-	}
-
-#endif
-
-	bool reLock = false;
+	if (debug_rm.getBool() && getNumLoadingWork() > 0)
+		logInfo(RESOURCES, "Resource Manager: %i work item(s), %i loader thread(s)\n", getNumLoadingWork(), (int)m_loaderThreads.size());
 
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-	g_resourceManagerMutex.lock();
-
-#endif
+	// handle load finish (and synchronous init()), most important first
+	const double budget = (double)std::max(rm_sync_budget_ms.getFloat(), 0.0f) / 1000.0;
+	const double startTime = _rmGetTime();
+	while (true)
 	{
-		// handle load finish (and synchronous init())
-		for (int i=0; i<m_loadingWork.size(); i++)
+		LOADING_WORK *work = NULL;
 		{
-			if (m_loadingWork[i].second.atomic)
-			{
-				if (debug_rm.getBool())
-					debugLog("Resource Manager: Worker thread #%i finished.\n", i);
-
-				// copy pointer, so we can stop everything before finishing
-				Resource *rs = m_loadingWork[i].first;
-
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
-				g_resourceManagerLoadingWorkMutex.lock();
+			std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
 
 #endif
 
-				{
-					m_loadingWork.erase(m_loadingWork.begin()+i);
-				}
-
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-				g_resourceManagerLoadingWorkMutex.unlock();
-
-#endif
-
-				i--;
-
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-				// stop the worker thread if everything has been loaded
-				if (m_loadingWork.size() < 1)
-					g_resourceManagerLoadingMutex.lock();
-
-				// unlock. this allows resources to trigger "recursive" loads within init()
-				g_resourceManagerMutex.unlock();
-
-#endif
-
-				reLock = true;
+			int bestIndex = -1;
+			for (int i=0; i<(int)m_loadingWork.size(); i++)
+			{
+				const LOADING_WORK *candidate = m_loadingWork[i];
+				if (candidate->state != LOADING_STATE::LOADING_STATE_ASYNC_READY) continue;
 
-				// finish (synchronous init())
-				rs->load();
+				if (bestIndex < 0 || candidate->priority > m_loadingWork[bestIndex]->priority || (candidate->priority == m_loadingWork[bestIndex]->priority && candidate->order < m_loadingWork[bestIndex]->order))
+					bestIndex = i;
+			}
 
-				break; // only allow 1 work item to finish per tick
+			if (bestIndex >= 0)
+			{
+				work = m_loadingWork[bestIndex];
+				m_loadingWork.erase(m_loadingWork.begin() + bestIndex);
 			}
 		}
 
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-	if (reLock)
-	{
-		g_resourceManagerMutex.lock();
-	}
+		if (work == NULL) break;
 
-#endif
+		// NOTE: the lock is not held here, this allows resources to trigger "recursive" loads within init()
+		finishLoadingWork(work);
 
-		// handle async destroy
-		for (int i=0; i<m_loadingWorkAsyncDestroy.size(); i++)
-		{
-			bool canBeDestroyed = true;
-			for (int w=0; w<m_loadingWork.size(); w++)
-			{
-				if (m_loadingWork[w].first == m_loadingWorkAsyncDestroy[i])
-				{
-					if (debug_rm.getBool())
-						debugLog("Resource Manager: Waiting for async destroy of #%i ...\n", i);
+		if (_rmGetTime() - startTime >= budget)
+			break;
+	}
 
-					canBeDestroyed = false;
-					break;
-				}
-			}
+	updateLoadingGate();
 
-			if (canBeDestroyed)
-			{
-				if (debug_rm.getBool())
-					debugLog("Resource Manager: Async destroy of #%i\n", i);
+	// summary of the current batch
+	if (m_iBatchNumLoads > 0 && getNumLoadingWork() < 1)
+	{
+		if (debug_rm_timing.getBool())
+			logInfo(RESOURCES, "Resource Manager: Finished %i async load(s) in %.3f ms with %i loader thread(s)\n", m_iBatchNumLoads, (_rmGetTime() - m_dBatchStartTime)*1000.0, (int)m_loaderThreads.size());
 
-				delete m_loadingWorkAsyncDestroy[i]; // implicitly calls release() through the Resource destructor
-				m_loadingWorkAsyncDestroy.erase(m_loadingWorkAsyncDestroy.begin()+i);
-				i--;
-			}
-		}
+		m_iBatchNumLoads = 0;
 	}
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-	g_resourceManagerMutex.unlock();
-
-#endif
 }
 
 void ResourceManager::destroyResources()
@@ -243,6 +225,8 @@ void ResourceManager::destroyResources()
 		destroyResource(m_vResources[0]);
 	}
 	m_vResources.clear();
+	m_managedResources.clear();
+	m_nameIndex.clear();
 }
 
 void ResourceManager::destroyResource(Resource *rs)
@@ -250,66 +234,63 @@ void ResourceManager::destroyResource(Resource *rs)
 	if (rs == NULL)
 	{
 		if (rm_warnings.getBool())
-			debugLog("RESOURCE MANAGER Warning: destroyResource(NULL)!\n");
+			logWarning(RESOURCES, "Resource Manager: destroyResource(NULL)!\n");
 		return;
 	}
 
 	if (debug_rm.getBool())
-		debugLog("ResourceManager: Destroying %s\n", rs->getName().toUtf8());
+		logInfo(RESOURCES, "ResourceManager: Destroying %s\n", rs->getName().toUtf8());
+
+	for (int i=0; i<m_vResources.size(); i++)
+	{
+		if (m_vResources[i] == rs)
+		{
+			m_vResources.erase(m_vResources.begin()+i);
+			m_managedResources.erase(rs);
+			removeFromNameIndex(rs, rs->getName());
+			break;
+		}
+	}
 
+	// handle async loads
+	{
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
-	g_resourceManagerMutex.lock();
+		std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
 
 #endif
-	{
-		bool isManagedResource = false;
-		int managedResourceIndex = -1;
-		for (int i=0; i<m_vResources.size(); i++)
-		{
-			if (m_vResources[i] == rs)
-			{
-				isManagedResource = true;
-				managedResourceIndex = i;
-				break;
-			}
-		}
 
-		// handle async destroy
 		for (int w=0; w<m_loadingWork.size(); w++)
 		{
-			if (m_loadingWork[w].first == rs)
+			LOADING_WORK *work = m_loadingWork[w];
+			if (work->resource != rs) continue;
+
+			if (work->state == LOADING_STATE::LOADING_STATE_QUEUED)
 			{
+				// nothing has been done yet, so just drop it
 				if (debug_rm.getBool())
-					debugLog("Resource Manager: Scheduled async destroy of %s\n", rs->getName().toUtf8());
+					logInfo(RESOURCES, "Resource Manager: Cancelled queued load of %s\n", rs->getName().toUtf8());
 
-				if (rm_interrupt_on_destroy.getBool())
-					rs->interruptLoad();
-
-				m_loadingWorkAsyncDestroy.push_back(rs);
-				if (isManagedResource)
-					m_vResources.erase(m_vResources.begin()+managedResourceIndex);
+				m_loadingWork.erase(m_loadingWork.begin()+w);
+				delete work;
+				m_iNumCancelledLoads++;
+				break; // standard destroy
+			}
 
-				// HACKHACK: ugly
-#ifdef MCENGINE_FEATURE_MULTITHREADING
+			// loadAsync() is running (or has already run), so it has to be finished by the main thread before it can be destroyed
+			if (debug_rm.getBool())
+				logInfo(RESOURCES, "Resource Manager: Scheduled async destroy of %s\n", rs->getName().toUtf8());
 
-				g_resourceManagerMutex.unlock();
+			if (rm_interrupt_on_destroy.getBool())
+				rs->interruptLoad();
 
-#endif
-				return; // we're done here
-			}
+			work->cancelled = true;
+			return; // we're done here
 		}
-
-		// standard destroy
-		SAFE_DELETE(rs); // implicitly calls release() through the Resource destructor
-		if (isManagedResource)
-			m_vResources.erase(m_vResources.begin()+managedResourceIndex);
 	}
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-	g_resourceManagerMutex.unlock();
 
-#endif
+	// standard destroy
+	SAFE_DELETE(rs); // implicitly calls release() through the Resource destructor
 }
 
 void ResourceManager::reloadResources()
@@ -330,6 +311,63 @@ void ResourceManager::requestNextLoadUnmanaged()
 	m_nextLoadUnmanagedStack.push(true);
 }
 
+void ResourceManager::requestNextLoadPriority(LOAD_PRIORITY priority)
+{
+	m_nextLoadPriority = priority;
+}
+
+void ResourceManager::requestNextLoadCallback(LOAD_CALLBACK callback)
+{
+	m_nextLoadCallback = callback;
+}
+
+void ResourceManager::setLoadPriority(Resource *rs, LOAD_PRIORITY priority)
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
+
+#endif
+
+	for (size_t i=0; i<m_loadingWork.size(); i++)
+	{
+		if (m_loadingWork[i]->resource == rs)
+		{
+			m_loadingWork[i]->priority = priority;
+			break;
+		}
+	}
+}
+
+void ResourceManager::setNumLoaderThreads(int numLoaderThreads)
+{
+	if (numLoaderThreads < 0)
+		numLoaderThreads = JobSystem::getDefaultNumWorkers();
+
+	numLoaderThreads = std::max(numLoaderThreads, 1);
+
+#if !defined(MCENGINE_FEATURE_PTHREADS) && !defined(__SWITCH__)
+
+	numLoaderThreads = 0;
+
+#endif
+
+	if (numLoaderThreads == (int)m_loaderThreads.size()) return;
+
+	stopLoaderThreads();
+	startLoaderThreads(numLoaderThreads);
+
+	logInfo(RESOURCES, "Resource Manager: Using %i loader thread(s)\n", (int)m_loaderThreads.size());
+}
+
+void ResourceManager::printLoaderStats()
+{
+	logInfo(RESOURCES, "Resource Manager: %i loader thread(s), %i work item(s)\n", (int)m_loaderThreads.size(), getNumLoadingWork());
+	logInfo(RESOURCES, "Resource Manager: %lu async load(s) (%lu cancelled), loadAsync() total = %.3f ms, load() total = %.3f ms\n", m_iNumAsyncLoads, m_iNumCancelledLoads, m_dAsyncLoadTime*1000.0, m_dSyncLoadTime*1000.0);
+	if (m_iNumAsyncLoads > 0)
+		logInfo(RESOURCES, "Resource Manager: avg loadAsync() = %.3f ms, avg load() = %.3f ms\n", (m_dAsyncLoadTime / (double)m_iNumAsyncLoads)*1000.0, (m_dSyncLoadTime / (double)m_iNumAsyncLoads)*1000.0);
+}
+
 Image *ResourceManager::loadImage(UString filepath, UString resourceName, bool mipmapped, bool keepInSystemMemory)
 {
 	// check if it already exists
@@ -337,7 +375,7 @@ Image *ResourceManager::loadImage(UString filepath, UString resourceName, bool m
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<Image*>(temp);
+			return _rmCastResource<Image>(temp, Resource::TYPE::TYPE_IMAGE);
 	}
 
 	// create instance and load it
@@ -368,7 +406,7 @@ Image *ResourceManager::loadImageAbs(UString absoluteFilepath, UString resourceN
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<Image*>(temp);
+			return _rmCastResource<Image>(temp, Resource::TYPE::TYPE_IMAGE);
 	}
 
 	// create instance and load it
@@ -414,7 +452,7 @@ McFont *ResourceManager::loadFont(UString filepath, UString resourceName, int fo
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<McFont*>(temp);
+			return _rmCastResource<McFont>(temp, Resource::TYPE::TYPE_FONT);
 	}
 
 	// create instance and load it
@@ -434,7 +472,7 @@ McFont *ResourceManager::loadFont(UString filepath, UString resourceName, std::v
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<McFont*>(temp);
+			return _rmCastResource<McFont>(temp, Resource::TYPE::TYPE_FONT);
 	}
 
 	// create instance and load it
@@ -447,6 +485,26 @@ McFont *ResourceManager::loadFont(UString filepath, UString resourceName, std::v
 	return fnt;
 }
 
+McFont *ResourceManager::loadFontSDF(UString filepath, UString resourceName, int fontSize, int fontDPI)
+{
+	// check if it already exists
+	if (resourceName.length() > 0)
+	{
+		Resource *temp = existsAndHandle(resourceName);
+		if (temp != NULL)
+			return _rmCastResource<McFont>(temp, Resource::TYPE::TYPE_FONT);
+	}
+
+	// create instance and load it
+	filepath.insert(0, PATH_DEFAULT_FONTS);
+	McFont *fnt = new McFont(filepath, fontSize, true, fontDPI, true);
+	fnt->setName(resourceName);
+
+	loadResource(fnt, true);
+
+	return fnt;
+}
+
 Sound *ResourceManager::loadSound(UString filepath, UString resourceName, bool stream, bool threeD, bool loop, bool prescan)
 {
 	// check if it already exists
@@ -454,7 +512,7 @@ Sound *ResourceManager::loadSound(UString filepath, UString resourceName, bool s
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<Sound*>(temp);
+			return _rmCastResource<Sound>(temp, Resource::TYPE::TYPE_SOUND);
 	}
 
 	// create instance and load it
@@ -474,7 +532,7 @@ Sound *ResourceManager::loadSoundAbs(UString filepath, UString resourceName, boo
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<Sound*>(temp);
+			return _rmCastResource<Sound>(temp, Resource::TYPE::TYPE_SOUND);
 	}
 
 	// create instance and load it
@@ -493,7 +551,7 @@ Shader *ResourceManager::loadShader(UString vertexShaderFilePath, UString fragme
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<Shader*>(temp);
+			return _rmCastResource<Shader>(temp, Resource::TYPE::TYPE_SHADER);
 	}
 
 	// create instance and load it
@@ -526,7 +584,7 @@ Shader *ResourceManager::createShader(UString vertexShader, UString fragmentShad
 	{
 		Resource *temp = existsAndHandle(resourceName);
 		if (temp != NULL)
-			return dynamic_cast<Shader*>(temp);
+			return _rmCastResource<Shader>(temp, Resource::TYPE::TYPE_SHADER);
 	}
 
 	// create instance and load it
@@ -564,10 +622,10 @@ RenderTarget *ResourceManager::createRenderTarget(int width, int height, Graphic
 	return createRenderTarget(0, 0, width, height, multiSampleType);
 }
 
-TextureAtlas *ResourceManager::createTextureAtlas(int width, int height)
+TextureAtlas *ResourceManager::createTextureAtlas(int width, int height, int maxPages, bool keepInSystemMemory)
 {
 	// create instance and load it
-	TextureAtlas *ta = new TextureAtlas(width, height);
+	TextureAtlas *ta = new TextureAtlas(width, height, maxPages, keepInSystemMemory);
 	ta->setName(UString::format("<TA_(%ix%i)>", width, height));
 
 	loadResource(ta, false);
@@ -585,49 +643,31 @@ VertexArrayObject *ResourceManager::createVertexArrayObject(Graphics::PRIMITIVE
 	return vao;
 }
 
-Image *ResourceManager::getImage(UString resourceName)
+Image *ResourceManager::getImage(const UString &resourceName) const
 {
-	for (int i=0; i<m_vResources.size(); i++)
-	{
-		if (m_vResources[i]->getName() == resourceName)
-			return dynamic_cast<Image*>(m_vResources[i]);
-	}
-
-	doesntExistWarning(resourceName);
-	return NULL;
+	return _rmCastResource<Image>(getResource(resourceName), Resource::TYPE::TYPE_IMAGE);
 }
 
-McFont *ResourceManager::getFont(UString resourceName)
+McFont *ResourceManager::getFont(const UString &resourceName) const
 {
-	for (int i=0; i<m_vResources.size(); i++)
-	{
-		if (m_vResources[i]->getName() == resourceName)
-			return dynamic_cast<McFont*>(m_vResources[i]);
-	}
-
-	doesntExistWarning(resourceName);
-	return NULL;
+	return _rmCastResource<McFont>(getResource(resourceName), Resource::TYPE::TYPE_FONT);
 }
 
-Sound *ResourceManager::getSound(UString resourceName)
+Sound *ResourceManager::getSound(const UString &resourceName) const
 {
-	for (int i=0; i<m_vResources.size(); i++)
-	{
-		if (m_vResources[i]->getName() == resourceName)
-			return dynamic_cast<Sound*>(m_vResources[i]);
-	}
+	return _rmCastResource<Sound>(getResource(resourceName), Resource::TYPE::TYPE_SOUND);
+}
 
-	doesntExistWarning(resourceName);
-	return NULL;
+Shader *ResourceManager::getShader(const UString &resourceName) const
+{
+	return _rmCastResource<Shader>(getResource(resourceName), Resource::TYPE::TYPE_SHADER);
 }
 
-Shader *ResourceManager::getShader(UString resourceName)
+Resource *ResourceManager::getResource(const UString &resourceName) const
 {
-	for (int i=0; i<m_vResources.size(); i++)
-	{
-		if (m_vResources[i]->getName() == resourceName)
-			return dynamic_cast<Shader*>(m_vResources[i]);
-	}
+	const auto it = m_nameIndex.find(resourceName);
+	if (it != m_nameIndex.end())
+		return it->second.front();
 
 	doesntExistWarning(resourceName);
 	return NULL;
@@ -635,67 +675,101 @@ Shader *ResourceManager::getShader(UString resourceName)
 
 bool ResourceManager::isLoadingResource(Resource *rs) const
 {
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
+
+#endif
+
 	for (int i=0; i<m_loadingWork.size(); i++)
 	{
-		if (m_loadingWork[i].first == rs)
+		if (m_loadingWork[i]->resource == rs)
 			return true;
 	}
 
 	return false;
 }
 
+int ResourceManager::getNumLoadingWork() const
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
+
+#endif
+
+	return (int)m_loadingWork.size();
+}
+
 void ResourceManager::loadResource(Resource *res, bool load)
 {
 	// handle flags
 	if (m_nextLoadUnmanagedStack.size() < 1 || !m_nextLoadUnmanagedStack.top())
+	{
 		m_vResources.push_back(res); // add managed resource
+		m_managedResources.insert(res);
+		addToNameIndex(res);
+	}
 
 	const bool isNextLoadAsync = m_bNextLoadAsync;
+	const LOAD_PRIORITY priority = m_nextLoadPriority;
+	LOAD_CALLBACK callback;
+	callback.swap(m_nextLoadCallback);
 
 	// flags must be reset on every load, to not carry over
 	resetFlags();
 
 	if (!load) return;
 
-	if (!isNextLoadAsync)
+	if (!isNextLoadAsync || m_loaderThreads.size() < 1)
 	{
-		// load normally
-		res->loadAsync();
-		res->load();
+		// load normally (also on platforms which don't support multithreading)
+		const double startTime = _rmGetTime();
+		{
+			res->loadAsync();
+			res->load();
+		}
+		if (debug_rm_timing.getBool())
+			logInfo(RESOURCES, "Resource Manager: Loaded \"%s\" in %.3f ms (sync)\n", res->getName().toUtf8(), (_rmGetTime() - startTime)*1000.0);
+
+		if (callback)
+			callback(res);
 	}
 	else
 	{
-#if defined(MCENGINE_FEATURE_MULTITHREADING)
+		LOADING_WORK *work = new LOADING_WORK();
+		work->resource = res;
+		work->callback.swap(callback);
+		work->priority = priority;
+		work->state = LOADING_STATE::LOADING_STATE_QUEUED;
+		work->order = m_iLoadingWorkOrder++;
+		work->cancelled = false;
+		work->loaderThreadIndex = -1;
+		work->queueTime = _rmGetTime();
+		work->asyncStartTime = 0.0;
+		work->asyncEndTime = 0.0;
+
+		if (m_iBatchNumLoads < 1)
+			m_dBatchStartTime = work->queueTime;
+		m_iBatchNumLoads++;
 
-		g_resourceManagerMutex.lock();
 		{
-			// add work to loading thread
-			std::pair<Resource*, MobileAtomicBool> work;
-			work.first = res;
-			work.second = MobileAtomic<bool>(false);
+#ifdef MCENGINE_FEATURE_MULTITHREADING
 
-			g_resourceManagerLoadingWorkMutex.lock();
-			m_loadingWork.push_back(work);
+			std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
 
-			// let the loading thread run
-			if (m_loadingWork.size() == 1)
-				g_resourceManagerLoadingMutex.unlock();
+#endif
 
-			g_resourceManagerLoadingWorkMutex.unlock();
+			m_loadingWork.push_back(work);
 		}
-		g_resourceManagerMutex.unlock();
 
-#else
-
-		// load normally (on platforms which don't support multithreading)
-		res->loadAsync();
-		res->load();
-
-#endif
+		// let the loading threads run
+		updateLoadingGate();
+		wakeLoaderThreads();
 	}
 }
 
-void ResourceManager::doesntExistWarning(UString resourceName)
+void ResourceManager::doesntExistWarning(const UString &resourceName) const
 {
 	if (rm_warnings.getBool())
 	{
@@ -706,23 +780,89 @@ void ResourceManager::doesntExistWarning(UString resourceName)
 	}
 }
 
-Resource *ResourceManager::existsAndHandle(UString resourceName)
+Resource *ResourceManager::existsAndHandle(const UString &resourceName)
 {
-	for (int i=0; i<m_vResources.size(); i++)
+	const auto it = m_nameIndex.find(resourceName);
+	if (it == m_nameIndex.end())
+		return NULL;
+
+	Resource *rs = it->second.front();
+
+	if (rm_warnings.getBool())
+		logWarning(RESOURCES, "Resource Manager: Resource \"%s\" already loaded!\n", resourceName.toUtf8());
+
+	// the callback still has to happen, either now or once the pending load has finished
+	if (m_nextLoadCallback)
 	{
-		if (m_vResources[i]->getName() == resourceName)
+		bool isLoading = false;
 		{
-			if (rm_warnings.getBool())
-				debugLog("RESOURCE MANAGER: Resource \"%s\" already loaded!\n", resourceName.toUtf8());
+#ifdef MCENGINE_FEATURE_MULTITHREADING
 
-			// handle flags (reset them)
-			resetFlags();
+			std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
 
-			return m_vResources[i];
+#endif
+
+			for (size_t i=0; i<m_loadingWork.size(); i++)
+			{
+				if (m_loadingWork[i]->resource == rs)
+				{
+					isLoading = true;
+
+					LOAD_CALLBACK first = m_loadingWork[i]->callback;
+					LOAD_CALLBACK second = m_nextLoadCallback;
+					m_loadingWork[i]->callback = [first, second](Resource *res) {if (first) first(res); second(res);};
+					break;
+				}
+			}
 		}
+
+		if (!isLoading)
+			m_nextLoadCallback(rs);
 	}
 
-	return NULL;
+	// handle flags (reset them)
+	resetFlags();
+
+	return rs;
+}
+
+void ResourceManager::addToNameIndex(Resource *rs)
+{
+	if (rs->getName().length() < 1) return;
+
+	// NOTE: appended, the oldest resource stays reachable (same as a linear search would)
+	m_nameIndex[rs->getName()].push_back(rs);
+}
+
+void ResourceManager::removeFromNameIndex(Resource *rs, const UString &name)
+{
+	if (name.length() < 1) return;
+
+	const auto it = m_nameIndex.find(name);
+	if (it == m_nameIndex.end()) return;
+
+	// if there is another resource with the same name, then that one takes over
+	std::vector<Resource*> &resources = it->second;
+	for (size_t i=0; i<resources.size(); i++)
+	{
+		if (resources[i] == rs)
+		{
+			resources.erase(resources.begin()+i);
+			break;
+		}
+	}
+
+	if (resources.size() < 1)
+		m_nameIndex.erase(it);
+}
+
+void ResourceManager::onResourceRenamed(Resource *rs, UString oldName)
+{
+	// NOTE: unmanaged resources are not indexed
+	if (m_managedResources.find(rs) == m_managedResources.end()) return;
+
+	removeFromNameIndex(rs, oldName);
+	addToNameIndex(rs);
 }
 
 void ResourceManager::resetFlags()
@@ -731,85 +871,279 @@ void ResourceManager::resetFlags()
 		m_nextLoadUnmanagedStack.pop();
 
 	m_bNextLoadAsync = false;
+	m_nextLoadPriority = LOAD_PRIORITY::LOAD_PRIORITY_NORMAL;
+	m_nextLoadCallback = nullptr;
 }
 
+ResourceManager::LOADING_WORK *ResourceManager::claimLoadingWork(int loaderThreadIndex)
+{
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
 
+#endif
 
+	// highest priority first, and oldest first within the same priority
+	LOADING_WORK *work = NULL;
+	for (size_t i=0; i<m_loadingWork.size(); i++)
+	{
+		LOADING_WORK *candidate = m_loadingWork[i];
+		if (candidate->state != LOADING_STATE::LOADING_STATE_QUEUED) continue;
+
+		if (work == NULL || candidate->priority > work->priority || (candidate->priority == work->priority && candidate->order < work->order))
+			work = candidate;
+	}
+
+	if (work != NULL)
+	{
+		work->state = LOADING_STATE::LOADING_STATE_LOADING;
+		work->loaderThreadIndex = loaderThreadIndex;
+		work->asyncStartTime = _rmGetTime();
+	}
+
+	return work;
+}
+
+void ResourceManager::finishLoadingWork(LOADING_WORK *work)
+{
+	Resource *rs = work->resource;
+
+	if (debug_rm.getBool())
+		logInfo(RESOURCES, "Resource Manager: Loader thread #%i finished %s\n", work->loaderThreadIndex, rs->getName().toUtf8());
+
+	// finish (synchronous init())
+	// NOTE: cancelled resources are also finished, since e.g. sounds only release what loadAsync() created if they are ready
+	const double syncStartTime = _rmGetTime();
+	{
+		rs->load();
+	}
+	const double syncEndTime = _rmGetTime();
+
+	m_iNumAsyncLoads++;
+	m_dAsyncLoadTime += work->asyncEndTime - work->asyncStartTime;
+	m_dSyncLoadTime += syncEndTime - syncStartTime;
+
+	if (work->cancelled)
+	{
+		if (debug_rm.getBool())
+			logInfo(RESOURCES, "Resource Manager: Async destroy of %s\n", rs->getName().toUtf8());
+
+		m_iNumCancelledLoads++;
+		delete rs; // implicitly calls release() through the Resource destructor
+	}
+	else
+	{
+		if (debug_rm_timing.getBool())
+		{
+			logInfo(RESOURCES, "Resource Manager: Loaded \"%s\" in %.3f ms (queued %.3f ms, loadAsync() %.3f ms on loader thread #%i, waited %.3f ms, load() %.3f ms)\n",
+					rs->getName().toUtf8(),
+					(syncEndTime - work->queueTime)*1000.0,
+					(work->asyncStartTime - work->queueTime)*1000.0,
+					(work->asyncEndTime - work->asyncStartTime)*1000.0,
+					work->loaderThreadIndex,
+					(syncStartTime - work->asyncEndTime)*1000.0,
+					(syncEndTime - syncStartTime)*1000.0);
+		}
+
+		if (work->callback)
+			work->callback(rs);
+	}
+
+	delete work;
+}
+
+bool ResourceManager::hasQueuedLoadingWork() const
+{
 #ifdef MCENGINE_FEATURE_MULTITHREADING
 
-/*
-void *_resourceLoadThread(void *data)
+	std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
+
+#endif
+
+	for (size_t i=0; i<m_loadingWork.size(); i++)
+	{
+		if (m_loadingWork[i]->state == LOADING_STATE::LOADING_STATE_QUEUED)
+			return true;
+	}
+
+	return false;
+}
+
+void ResourceManager::wakeLoaderThreads()
+{
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+	pthread_mutex_lock(&g_resourceManagerLoaderSleepMutex);
+	pthread_cond_broadcast(&g_resourceManagerLoaderSleepCond);
+	pthread_mutex_unlock(&g_resourceManagerLoaderSleepMutex);
+
+#endif
+}
+
+void ResourceManager::updateLoadingGate()
 {
-	// debugging
-	if (rm_async_rand_delay.getInt() > 0)
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	// NOTE: main thread only, since the mutex must be unlocked by the same thread which locked it
+	const bool open = (hasQueuedLoadingWork() || m_bStopLoaderThreads.load());
+	if (open != m_bLoadingGateOpen)
 	{
-		Timer sleepTimer;
-		sleepTimer.start();
-		double randSleepSecs = rand() % rm_async_rand_delay.getInt();
-		while (sleepTimer.getElapsedTime() < randSleepSecs)
+		m_bLoadingGateOpen = open;
+		if (open)
+			g_resourceManagerLoadingMutex.unlock();
+		else
+			g_resourceManagerLoadingMutex.lock();
+	}
+
+#endif
+}
+
+void ResourceManager::startLoaderThreads(int numLoaderThreads)
+{
+	m_bStopLoaderThreads = false;
+
+	for (int i=0; i<numLoaderThreads; i++)
+	{
+		LOADER_THREAD *loaderThread = new LOADER_THREAD();
+		loaderThread->resourceManager = this;
+		loaderThread->index = i;
+
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+		int ret = pthread_create(&loaderThread->thread, NULL, _resourceLoaderThread, (void*)loaderThread);
+		if (ret)
 		{
-			sleepTimer.update();
+			engine->showMessageError("ResourceManager Error", UString::format("pthread_create() returned %i!", ret));
+			delete loaderThread;
+			break;
 		}
+
+#elif defined(__SWITCH__)
+
+		Result rc = threadCreate((Thread*)&loaderThread->thread, _resourceLoaderThreadVoid, (void*)loaderThread, 0x1000000, 0x2B, 2);
+		if (R_FAILED(rc))
+		{
+			engine->showMessageError("ResourceManager Error", UString::format("threadCreate() returned %i!", (int)rc));
+			delete loaderThread;
+			break;
+		}
+		else
+			threadStart((Thread*)&loaderThread->thread);
+
+#endif
+
+		m_loaderThreads.push_back(loaderThread);
 	}
+}
 
-	ResourceManager::LOAD_THREAD *loader = (ResourceManager::LOAD_THREAD*)data;
-	loader->resource->loadAsync();
-	loader->finished = ResourceManager::MobileAtomic<bool>(true);
-	return NULL;
+void ResourceManager::stopLoaderThreads()
+{
+	if (m_loaderThreads.size() < 1) return;
+
+	// let them all run into the stop flag
+	m_bStopLoaderThreads = true;
+	updateLoadingGate();
+	wakeLoaderThreads();
+
+	for (size_t i=0; i<m_loaderThreads.size(); i++)
+	{
+#ifdef MCENGINE_FEATURE_PTHREADS
+
+		pthread_join(m_loaderThreads[i]->thread, NULL); // NOTE: blocks until the current loadAsync() of this thread has returned
+
+#elif defined(__SWITCH__)
+
+		threadWaitForExit((Thread*)&m_loaderThreads[i]->thread);
+		threadClose((Thread*)&m_loaderThreads[i]->thread);
+
+#endif
+
+		delete m_loaderThreads[i];
+	}
+	m_loaderThreads.clear();
+
+	m_bStopLoaderThreads = false;
+	updateLoadingGate();
 }
-*/
 
-void *_resourceLoaderThread(void *data)
+void ResourceManager::runLoaderThread(LOADER_THREAD *loaderThread)
 {
-	std::vector<std::pair<Resource*, ResourceManager::MobileAtomicBool>> *todo = (std::vector<std::pair<Resource*, ResourceManager::MobileAtomicBool>>*)data;
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+	Profiler::setThreadName(UString::format("resource loader %i", loaderThread->index).toUtf8());
 
-	while (g_bRunning)
+	while (!m_bStopLoaderThreads.load())
 	{
 		// wait for work
 		g_resourceManagerLoadingMutex.lock(); // thread will wait here
 		g_resourceManagerLoadingMutex.unlock();
 
-		int size = 0;
-		std::pair<Resource*, ResourceManager::MobileAtomicBool> work;
+		if (m_bStopLoaderThreads.load()) break;
 
-		// quickly check if there is work to do (this can potentially cause engine lag!)
-		g_resourceManagerLoadingWorkMutex.lock();
+		LOADING_WORK *work = claimLoadingWork(loaderThread->index);
+		if (work == NULL)
 		{
-			size = todo->size();
-			if (size > 0)
-				work = (*todo)[0];
-		}
-		g_resourceManagerLoadingWorkMutex.unlock();
+			// everything queued has already been claimed by other threads (the main thread closes the gate during its next update())
+#ifdef MCENGINE_FEATURE_PTHREADS
 
-		// if we have work
-		if (size > 0)
-		{
-			if (!(work.second.atomic)) // if we need to get loaded
+			// sleep until new work is queued, or until the loader threads are stopped
+			pthread_mutex_lock(&g_resourceManagerLoaderSleepMutex);
 			{
-				// debugging
-				if (rm_async_rand_delay.getInt() > 0)
+				while (!hasQueuedLoadingWork() && !m_bStopLoaderThreads.load())
 				{
-					Timer sleepTimer;
-					sleepTimer.start();
-					double randSleepSecs = rand() % rm_async_rand_delay.getInt();
-					while (sleepTimer.getElapsedTime() < randSleepSecs)
-					{
-						sleepTimer.update();
-					}
+					pthread_cond_wait(&g_resourceManagerLoaderSleepCond, &g_resourceManagerLoaderSleepMutex);
 				}
+			}
+			pthread_mutex_unlock(&g_resourceManagerLoaderSleepMutex);
 
-				work.first->loadAsync();
+#else
 
-				// very quickly signal that we are done
-				g_resourceManagerLoadingWorkMutex.lock();
-				{
-					(*todo)[0].second = ResourceManager::MobileAtomic<bool>(true);
-				}
-				g_resourceManagerLoadingWorkMutex.unlock();
+			env->sleep(1000);
+
+#endif
+			continue;
+		}
+
+		// debugging
+		if (rm_async_rand_delay.getInt() > 0)
+		{
+			Timer sleepTimer;
+			sleepTimer.start();
+			double randSleepSecs = rand() % rm_async_rand_delay.getInt();
+			while (sleepTimer.getElapsedTime() < randSleepSecs)
+			{
+				sleepTimer.update();
 			}
 		}
+
+		// NOTE: the work item can't be deleted while it is in the loading state, destroyResource() only flags it as cancelled
+		{
+			const UString resourceName = work->resource->getName();
+			VPROF_DETAIL("Resource::loadAsync", resourceName.toUtf8());
+
+			work->resource->loadAsync();
+		}
+
+		// signal that we are done
+		{
+			std::lock_guard<std::mutex> lk(g_resourceManagerLoadingWorkMutex);
+
+			work->asyncEndTime = _rmGetTime();
+			work->state = LOADING_STATE::LOADING_STATE_ASYNC_READY;
+		}
 	}
 
+#endif
+}
+
+
+
+#ifdef MCENGINE_FEATURE_MULTITHREADING
+
+void *_resourceLoaderThread(void *data)
+{
+	ResourceManager::LOADER_THREAD *loaderThread = (ResourceManager::LOADER_THREAD*)data;
+	loaderThread->resourceManager->runLoaderThread(loaderThread);
 	return NULL;
 }
 
@@ -819,3 +1153,85 @@ void _resourceLoaderThreadVoid(void *data)
 }
 
 #endif
+
+
+
+//**************************************//
+//	ResourceManager ConCommands	//
+//**************************************//
+
+void _rm_loader_stats(void)
+{
+	if (engine->getResourceManager() != NULL)
+		engine->getResourceManager()->printLoaderStats();
+}
+
+void _rm_lookup_benchmark(UString args)
+{
+	ResourceManager *rm = engine->getResourceManager();
+	if (rm == NULL) return;
+
+	int maxNumResources = args.toInt();
+	if (maxNumResources < 1)
+		maxNumResources = 10000;
+
+	const int numLookups = 100000;
+
+	logInfo(RESOURCES, "Resource Manager: Lookup benchmark, %i lookups per step (%i existing resources)\n", numLookups, rm->getNumResources());
+
+	std::vector<Image*> images;
+	std::vector<UString> names;
+	volatile uintptr_t sink = 0;
+
+	for (int numResources=10; numResources<=maxNumResources; numResources*=10)
+	{
+		// fill up with dummy images
+		while ((int)images.size() < numResources)
+		{
+			Image *img = rm->createImage(1, 1);
+			names.push_back(UString::format("rm_lookup_benchmark_%i", (int)images.size()));
+			img->setName(names.back());
+			images.push_back(img);
+		}
+
+		// hashed
+		unsigned int index = 0;
+		const double hashedStartTime = _rmGetTime();
+		for (int i=0; i<numLookups; i++)
+		{
+			index = index * 1103515245 + 12345;
+			sink += (uintptr_t)rm->getImage(names[(index >> 8) % names.size()]);
+		}
+		const double hashedDuration = _rmGetTime() - hashedStartTime;
+
+		// reference: linear search + dynamic_cast, like it used to be
+		const std::vector<Resource*> resources = rm->getResources();
+		const int numLinearLookups = std::max(numLookups / numResources, 100);
+		index = 0;
+		const double linearStartTime = _rmGetTime();
+		for (int i=0; i<numLinearLookups; i++)
+		{
+			index = index * 1103515245 + 12345;
+			const UString &name = names[(index >> 8) % names.size()];
+			for (size_t r=0; r<resources.size(); r++)
+			{
+				if (resources[r]->getName() == name)
+				{
+					sink += (uintptr_t)dynamic_cast<Image*>(resources[r]);
+					break;
+				}
+			}
+		}
+		const double linearDuration = _rmGetTime() - linearStartTime;
+
+		logInfo(RESOURCES, "Resource Manager: %6i resources: hashed = %8.1f ns/lookup, linear = %10.1f ns/lookup\n", numResources, (hashedDuration / (double)numLookups)*1000000000.0, (linearDuration / (double)numLinearLookups)*1000000000.0);
+	}
+
+	for (size_t i=0; i<images.size(); i++)
+	{
+		rm->destroyResource(images[i]);
+	}
+}
+
+ConVar _rm_loader_stats_("rm_loader_stats", _rm_loader_stats);
+ConVar _rm_lookup_benchmark_("rm_lookup_benchmark", _rm_lookup_benchmark, ConVar::ARGS::ARGS_OPTIONAL);
@@ -18,6 +18,9 @@
 #include "TextureAtlas.h"
 #include "VertexArrayObject.h"
 
+#include <functional>
+#include <unordered_set>
+
 #ifdef MCENGINE_FEATURE_PTHREADS
 
 #include <pthread.h>
@@ -48,6 +51,16 @@ public:
 	static const char *PATH_DEFAULT_SOUNDS;
 	static const char *PATH_DEFAULT_SHADERS;
 
+	enum class LOAD_PRIORITY
+	{
+		LOAD_PRIORITY_PREFETCH,	// whenever there is nothing else to do
+		LOAD_PRIORITY_NORMAL,
+		LOAD_PRIORITY_VISIBLE	// needed right now, jumps the queue
+	};
+
+	// called on the main thread after the resource has been fully loaded (never called if the load was cancelled by destroyResource())
+	typedef std::function<void(Resource*)> LOAD_CALLBACK;
+
 public:
 	ResourceManager();
 	~ResourceManager();
@@ -55,12 +68,19 @@ public:
 	void update();
 
 	void loadResource(Resource *rs) {requestNextLoadUnmanaged(); loadResource(rs, true);}
-	void destroyResource(Resource *rs);
+	void destroyResource(Resource *rs); // also cancels queued async loads
 	void destroyResources();
 	void reloadResources();
 
 	void requestNextLoadAsync();
 	void requestNextLoadUnmanaged();
+	void requestNextLoadPriority(LOAD_PRIORITY priority); // async loads only
+	void requestNextLoadCallback(LOAD_CALLBACK callback);
+
+	// async loading
+	void setLoadPriority(Resource *rs, LOAD_PRIORITY priority); // e.g. if a prefetched resource is suddenly needed right now
+	void setNumLoaderThreads(int numLoaderThreads);
+	void printLoaderStats();
 
 	// images
 	Image *loadImage(UString filepath, UString resourceName, bool mipmapped = false, bool keepInSystemMemory = false);
@@ -72,6 +92,7 @@ public:
 	// fonts
 	McFont *loadFont(UString filepath, UString resourceName, int fontSize = 16, bool antialiasing = true, int fontDPI = 96);
 	McFont *loadFont(UString filepath, UString resourceName, std::vector<wchar_t> characters, int fontSize = 16, bool antialiasing = true, int fontDPI = 96);
+	McFont *loadFontSDF(UString filepath, UString resourceName, int fontSize = 32, int fontDPI = 96); // one instance for all sizes, see McFont::SDF_SUPERSAMPLING
 
 	// sounds
 	Sound *loadSound(UString filepath, UString resourceName, bool stream = false, bool threeD = false, bool loop = false, bool prescan = false);
@@ -88,21 +109,24 @@ public:
 	RenderTarget *createRenderTarget(int width, int height, Graphics::MULTISAMPLE_TYPE multiSampleType = Graphics::MULTISAMPLE_TYPE::MULTISAMPLE_0X);
 
 	// texture atlas
-	TextureAtlas *createTextureAtlas(int width, int height);
+	TextureAtlas *createTextureAtlas(int width, int height, int maxPages = 1, bool keepInSystemMemory = false);
 
 	// models/meshes
 	VertexArrayObject *createVertexArrayObject(Graphics::PRIMITIVE primitive = Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE usage = Graphics::USAGE_TYPE::USAGE_STATIC, bool keepInSystemMemory = false);
 
-	// resource access by name // TODO: should probably use generics for this
-	Image *getImage(UString resourceName);
-	McFont *getFont(UString resourceName);
-	Sound *getSound(UString resourceName);
-	Shader *getShader(UString resourceName);
+	// resource access by name (hashed, NULL if the name doesn't exist or belongs to a different type of resource)
+	Image *getImage(const UString &resourceName) const;
+	McFont *getFont(const UString &resourceName) const;
+	Sound *getSound(const UString &resourceName) const;
+	Shader *getShader(const UString &resourceName) const;
+	Resource *getResource(const UString &resourceName) const;
 
 	int getNumResources() const {return m_vResources.size();}
 	inline std::vector<Resource*> getResources() const {return m_vResources;}
 
 	bool isLoadingResource(Resource *rs) const;
+	int getNumLoadingWork() const;
+	inline int getNumLoaderThreads() const {return (int)m_loaderThreads.size();}
 
 	template<typename T>
 	struct MobileAtomic
@@ -124,10 +148,11 @@ public:
 	};
 	typedef MobileAtomic<bool> MobileAtomicBool;
 
-#ifdef MCENGINE_FEATURE_MULTITHREADING
-
-	struct LOAD_THREAD
+	struct LOADER_THREAD
 	{
+		ResourceManager *resourceManager;
+		int index;
+
 #ifdef MCENGINE_FEATURE_PTHREADS
 
 		pthread_t thread;
@@ -137,43 +162,77 @@ public:
 		HorizonThread thread;
 
 #endif
-
-		Resource *resource;
-		MobileAtomicBool finished;
 	};
 
-#endif
+	// internal
+	void runLoaderThread(LOADER_THREAD *loaderThread);
+	void onResourceRenamed(Resource *rs, UString oldName);
 
 private:
+	enum class LOADING_STATE
+	{
+		LOADING_STATE_QUEUED,
+		LOADING_STATE_LOADING,		// loadAsync() is running on a loader thread
+		LOADING_STATE_ASYNC_READY	// waiting for load() on the main thread
+	};
+
+	struct LOADING_WORK
+	{
+		Resource *resource;
+		LOAD_CALLBACK callback;
+		LOAD_PRIORITY priority;
+		LOADING_STATE state;
+		unsigned long order;	// FIFO within the same priority
+		bool cancelled;			// destroyed while loading, delete instead of finishing
+
+		// timing
+		int loaderThreadIndex;
+		double queueTime;
+		double asyncStartTime;
+		double asyncEndTime;
+	};
+
 	void loadResource(Resource *res, bool load);
-	void doesntExistWarning(UString resourceName);
-	Resource *existsAndHandle(UString resourceName);
+	void doesntExistWarning(const UString &resourceName) const;
+	Resource *existsAndHandle(const UString &resourceName);
 	void resetFlags();
 
-	std::vector<Resource*> m_vResources;
-	std::vector<Resource*> m_vAsyncDestroy;
+	void addToNameIndex(Resource *rs);
+	void removeFromNameIndex(Resource *rs, const UString &name);
 
-#ifdef MCENGINE_FEATURE_MULTITHREADING
+	LOADING_WORK *claimLoadingWork(int loaderThreadIndex);
+	void finishLoadingWork(LOADING_WORK *work);
+	void updateLoadingGate();
+	bool hasQueuedLoadingWork() const;
+	void wakeLoaderThreads(); // loader threads which found nothing to claim sleep until there is new work
 
-	std::vector<LOAD_THREAD*> m_threads;
+	void startLoaderThreads(int numLoaderThreads);
+	void stopLoaderThreads();
 
-#endif
+	std::vector<Resource*> m_vResources;
+	std::unordered_set<Resource*> m_managedResources; // same as m_vResources, for the lookup in onResourceRenamed()
+	std::unordered_map<UString, std::vector<Resource*>> m_nameIndex; // managed resources only, oldest first (the first one wins if names are not unique)
 
+	// flags
 	bool m_bNextLoadAsync;
 	std::stack<bool> m_nextLoadUnmanagedStack;
-
-	std::vector<std::pair<Resource*, MobileAtomicBool>> m_loadingWork;
-	std::vector<Resource*> m_loadingWorkAsyncDestroy;
-
-#ifdef MCENGINE_FEATURE_PTHREADS
-
-	pthread_t m_loadingThread;
-
-#elif defined(__SWITCH__)
-
-	HorizonThread m_loadingThread;
-
-#endif
+	LOAD_PRIORITY m_nextLoadPriority;
+	LOAD_CALLBACK m_nextLoadCallback;
+
+	// async loading
+	std::vector<LOADING_WORK*> m_loadingWork;
+	std::vector<LOADER_THREAD*> m_loaderThreads;
+	std::atomic<bool> m_bStopLoaderThreads;
+	bool m_bLoadingGateOpen;
+	unsigned long m_iLoadingWorkOrder;
+
+	// timing stats
+	unsigned long m_iNumAsyncLoads;
+	unsigned long m_iNumCancelledLoads;
+	double m_dAsyncLoadTime;
+	double m_dSyncLoadTime;
+	double m_dBatchStartTime;
+	int m_iBatchNumLoads;
 };
 
 #endif
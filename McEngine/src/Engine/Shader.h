@@ -18,6 +18,8 @@ public:
 	Shader() : Resource() {;}
 	virtual ~Shader() {;}
 
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_SHADER;}
+
 	virtual void enable() = 0;
 	virtual void disable() = 0;
 
@@ -18,6 +18,8 @@ public:
 	Sound(UString filepath, bool stream, bool threeD, bool loop, bool prescan);
 	virtual ~Sound() {destroy();}
 
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_SOUND;}
+
 	void setPosition(double percent);
 	void setPositionMS(unsigned long ms) {setPositionMS(ms, false);}
 	void setVolume(float volume);
@@ -9,6 +9,7 @@
 
 #include "Engine.h"
 #include "ConVar.h"
+#include "Profiler.h"
 #include "Environment.h"
 #include "WinEnvironment.h"
 #include "HorizonSDLEnvironment.h"
@@ -453,6 +454,8 @@ SoundEngine::~SoundEngine()
 
 void SoundEngine::update()
 {
+	VPROF("SoundEngine::update");
+
 	if (snd_change_check_interval.getFloat() > 0.0f)
 	{
 		if (engine->getTime() > m_fPrevOutputDeviceChangeCheckTime)
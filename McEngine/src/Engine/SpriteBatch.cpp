@@ -0,0 +1,76 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		accumulates 2d quads into one vertex stream, for fewer draw calls
+//
+// $NoKeywords: $sprbatch
+//===============================================================================//
+
+#include "SpriteBatch.h"
+
+#include "Engine.h"
+#include "VertexArrayObject.h"
+
+SpriteBatch::SpriteBatch(int maxQuads)
+{
+	// NOTE: triangles instead of quads, because not every renderer can draw quads directly (and they would have to be converted on every flush)
+	m_vao = new VertexArrayObject(Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE::USAGE_STREAM);
+	m_iMaxQuads = std::max(maxQuads, 1);
+	m_iNumQuads = 0;
+
+	m_image = NULL;
+	m_bTextured = false;
+}
+
+SpriteBatch::~SpriteBatch()
+{
+	SAFE_DELETE(m_vao);
+}
+
+bool SpriteBatch::isCompatible(Image *image, bool textured, const Matrix4 &projectionMatrix) const
+{
+	if (isEmpty()) return true;
+
+	return (image == m_image && textured == m_bTextured && projectionMatrix == m_projectionMatrix);
+}
+
+void SpriteBatch::begin(Image *image, bool textured, const Matrix4 &projectionMatrix)
+{
+	m_image = image;
+	m_bTextured = textured;
+	m_projectionMatrix = projectionMatrix;
+}
+
+void SpriteBatch::addQuad(const Matrix4 &worldMatrix, const Vector2 *vertices, const Vector2 *texcoords, const Color *colors)
+{
+	static const int triangleIndices[6] = {0, 1, 2, 0, 2, 3};
+
+	// transform into world space (2d vertices, so z = 0 and w = 1)
+	Vector3 worldVertices[4];
+	for (int i=0; i<4; i++)
+	{
+		const float x = vertices[i].x;
+		const float y = vertices[i].y;
+		worldVertices[i] = Vector3(worldMatrix[0]*x + worldMatrix[4]*y + worldMatrix[12],
+								   worldMatrix[1]*x + worldMatrix[5]*y + worldMatrix[13],
+								   worldMatrix[2]*x + worldMatrix[6]*y + worldMatrix[14]);
+	}
+
+	for (int i=0; i<6; i++)
+	{
+		const int index = triangleIndices[i];
+
+		m_vao->addVertex(worldVertices[index]);
+		if (texcoords != NULL)
+			m_vao->addTexcoord(texcoords[index]);
+		m_vao->addColor(colors[index]);
+	}
+
+	m_iNumQuads++;
+}
+
+void SpriteBatch::clear()
+{
+	m_vao->empty();
+	m_iNumQuads = 0;
+	m_image = NULL;
+}
@@ -0,0 +1,47 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		accumulates 2d quads into one vertex stream, for fewer draw calls
+//
+// $NoKeywords: $sprbatch
+//===============================================================================//
+
+#ifndef SPRITEBATCH_H
+#define SPRITEBATCH_H
+
+#include "cbase.h"
+
+// all quads of a batch share the same texture and projection matrix, and are pre-transformed by the world matrix which was active when they were added
+// every quad carries its own vertex colors, so setColor() never breaks a batch
+// NOTE: the batch itself does not know when to flush, that's up to Graphics (see Graphics::flushBatch())
+
+class SpriteBatch
+{
+public:
+	SpriteBatch(int maxQuads = 4096);
+	~SpriteBatch();
+
+	// returns false if the quad would need a different texture or projection matrix than the pending quads
+	bool isCompatible(Image *image, bool textured, const Matrix4 &projectionMatrix) const;
+
+	void begin(Image *image, bool textured, const Matrix4 &projectionMatrix);
+	void addQuad(const Matrix4 &worldMatrix, const Vector2 *vertices, const Vector2 *texcoords, const Color *colors); // vertices in quad order: top left, bottom left, bottom right, top right
+	void clear();
+
+	inline bool isEmpty() const {return m_iNumQuads < 1;}
+	inline bool isFull() const {return m_iNumQuads >= m_iMaxQuads;}
+	inline bool isTextured() const {return m_bTextured;}
+	inline Image *getImage() const {return m_image;}
+	inline Matrix4 &getProjectionMatrix() {return m_projectionMatrix;}
+	inline VertexArrayObject *getVAO() const {return m_vao;}
+
+private:
+	VertexArrayObject *m_vao;
+	int m_iMaxQuads;
+	int m_iNumQuads;
+
+	Image *m_image;
+	bool m_bTextured;
+	Matrix4 m_projectionMatrix;
+};
+
+#endif
@@ -8,26 +8,37 @@
 #include "TextureAtlas.h"
 
 #include "Engine.h"
+#include "ConVar.h"
 #include "ResourceManager.h"
 
-TextureAtlas::TextureAtlas(int width, int height) : Resource()
+#include <algorithm>
+
+TextureAtlas::TextureAtlas(int width, int height, int maxPages, bool keepInSystemMemory) : Resource()
 {
 	m_iWidth = width;
 	m_iHeight = height;
+	m_iMaxPages = std::max(maxPages, 1);
+	m_bKeepInSystemMemory = keepInSystemMemory;
 
 	m_iPadding = 1;
 
-	engine->getResourceManager()->requestNextLoadUnmanaged();
-	m_atlasImage = engine->getResourceManager()->createImage(m_iWidth, m_iHeight);
+	m_iNumEntries = 0;
 
-	m_iCurX = m_iPadding;
-	m_iCurY = m_iPadding;
-	m_iMaxHeight = 0;
+	addPage(); // page 0 always exists
 }
 
 void TextureAtlas::init()
 {
-	engine->getResourceManager()->loadResource(m_atlasImage);
+	// upload new and modified pages
+	for (size_t i=0; i<m_pages.size(); i++)
+	{
+		if (!m_pages[i].image->isReady())
+			engine->getResourceManager()->loadResource(m_pages[i].image);
+		else if (m_pages[i].dirty)
+			m_pages[i].image->load();
+
+		m_pages[i].dirty = false;
+	}
 
 	m_bReady = true;
 }
@@ -39,105 +50,568 @@ void TextureAtlas::initAsync()
 
 void TextureAtlas::destroy()
 {
-	SAFE_DELETE(m_atlasImage);
+	for (size_t i=0; i<m_pages.size(); i++)
+	{
+		delete m_pages[i].image;
+	}
+	m_pages.clear();
+
+	m_entries.clear();
+	m_freeEntryIds.clear();
+	m_iNumEntries = 0;
 }
 
-Vector2 TextureAtlas::put(int width, int height, bool flipHorizontal, bool flipVertical, Color *pixels)
+int TextureAtlas::add(int width, int height, bool flipHorizontal, bool flipVertical, Color *pixels)
 {
 	if (width < 1 || height < 1)
-		return Vector2();
+		return -1;
 
-	if (width > (m_iWidth - m_iPadding*2) || height > (m_iHeight - m_iCurY - m_iPadding))
+	if (width > (m_iWidth - m_iPadding*2) || height > (m_iHeight - m_iPadding*2))
 	{
-		debugLog("TextureAtlas::put( %i, %i ) WARNING: Out of bounds / impossible fit!\n", width, height);
-		return Vector2();
+		debugLog("TextureAtlas::add( %i, %i ) WARNING: Out of bounds / impossible fit!\n", width, height);
+		return -1;
 	}
-	if (m_atlasImage == NULL)
+	if (pixels == NULL)
 	{
-		debugLog("TextureAtlas::put() ERROR: m_atlasImage == NULL!\n");
-		return Vector2();
+		debugLog("TextureAtlas::add() ERROR: pixels == NULL!\n");
+		return -1;
 	}
-	if (pixels == NULL)
+	if (!canModify())
+		return -1;
+
+	int page = 0;
+	int x = 0;
+	int y = 0;
+	if (!allocate(width + m_iPadding, height + m_iPadding, &page, &x, &y))
 	{
-		debugLog("TextureAtlas::put() ERROR: pixels == NULL!\n");
-		return Vector2();
+		debugLog("TextureAtlas::add( %i, %i ) WARNING: Out of space (%i page(s))!\n", width, height, (int)m_pages.size());
+		return -1;
 	}
 
-	// very simple packing logic: overflow down individual lines/rows, highest element in line determines max
-	if (m_iCurX + width + m_iPadding > m_iWidth)
+	writePixels(m_pages[page].image, x, y, width, height, flipHorizontal, flipVertical, pixels);
+	m_pages[page].usedArea += (width + m_iPadding)*(height + m_iPadding);
+	m_pages[page].dirty = true;
+
+	// get an id
+	int id = -1;
+	if (m_freeEntryIds.size() > 0)
 	{
-		m_iCurX = m_iPadding;
-		m_iCurY += m_iMaxHeight + m_iPadding;
-		m_iMaxHeight = 0;
+		id = m_freeEntryIds.back();
+		m_freeEntryIds.pop_back();
 	}
-	if (height > m_iMaxHeight)
-		m_iMaxHeight = height;
+	else
+	{
+		id = (int)m_entries.size();
+		m_entries.push_back(ENTRY_INTERNAL());
+	}
+
+	ENTRY_INTERNAL &entry = m_entries[id];
+	entry.entry.page = page;
+	entry.entry.x = x;
+	entry.entry.y = y;
+	entry.entry.width = width;
+	entry.entry.height = height;
+	entry.used = true;
+
+	m_iNumEntries++;
 
-	if (m_iCurY + height + m_iPadding > m_iHeight)
+	return id;
+}
+
+void TextureAtlas::remove(int id)
+{
+	if (id < 0 || id >= (int)m_entries.size() || !m_entries[id].used) return;
+	if (!canModify()) return;
+
+	const ENTRY &entry = m_entries[id].entry;
+	PAGE &page = m_pages[entry.page];
+
+	// clear pixels (incl. mirrored border), so that nothing can bleed into the next entry
+	const int border = (m_iPadding > 1 ? 1 : 0);
+	for (int y=entry.y-border; y<entry.y+entry.height+border; y++)
 	{
-		debugLog("TextureAtlas::put( %i, %i ) WARNING: Out of bounds / impossible fit!\n", width, height);
-		return Vector2();
+		for (int x=entry.x-border; x<entry.x+entry.width+border; x++)
+		{
+			page.image->setPixel(x, y, 0x00000000);
+		}
 	}
 
-	// insert pixels
+	RECT freeRect;
+	freeRect.x = entry.x;
+	freeRect.y = entry.y;
+	freeRect.width = entry.width + m_iPadding;
+	freeRect.height = entry.height + m_iPadding;
+	page.freeRects.push_back(freeRect);
+
+	page.usedArea -= freeRect.width*freeRect.height;
+	page.dirty = true;
+
+	m_entries[id].used = false;
+	m_freeEntryIds.push_back(id);
+	m_iNumEntries--;
+}
+
+void TextureAtlas::repack()
+{
+	if (!canModify()) return;
+
+	// grab the pixels of all entries
+	std::vector<int> ids;
+	std::vector<std::vector<Color>> pixels(m_entries.size());
+	for (size_t i=0; i<m_entries.size(); i++)
 	{
-		for (int y=0; y<height; y++)
+		if (!m_entries[i].used) continue;
+
+		const ENTRY &entry = m_entries[i].entry;
+		Image *image = m_pages[entry.page].image;
+
+		pixels[i].resize(entry.width*entry.height);
+		for (int y=0; y<entry.height; y++)
 		{
-			for (int x=0; x<width; x++)
+			for (int x=0; x<entry.width; x++)
 			{
-				int actualX = (flipHorizontal ? width - x - 1 : x);
-				int actualY = (flipVertical ? height - y - 1 : y);
-
-				m_atlasImage->setPixel(m_iCurX + x, m_iCurY + y, pixels[actualY*width + actualX]);
+				pixels[i][y*entry.width + x] = image->getPixel(entry.x + x, entry.y + y);
 			}
 		}
 
-		// TODO: make this into an API
-		// mirror border pixels
-		if (m_iPadding > 1)
+		ids.push_back((int)i);
+	}
+
+	// tallest first packs best for skylines (ties are broken by id, to stay deterministic)
+	std::sort(ids.begin(), ids.end(), [this](int a, int b) {
+		const ENTRY &entryA = m_entries[a].entry;
+		const ENTRY &entryB = m_entries[b].entry;
+		if (entryA.height != entryB.height)
+			return entryA.height > entryB.height;
+		if (entryA.width != entryB.width)
+			return entryA.width > entryB.width;
+		return a < b;
+	});
+
+	for (size_t i=0; i<m_pages.size(); i++)
+	{
+		resetPage(m_pages[i]);
+	}
+
+	// and put them back
+	for (size_t i=0; i<ids.size(); i++)
+	{
+		ENTRY &entry = m_entries[ids[i]].entry;
+
+		int page = 0;
+		int x = 0;
+		int y = 0;
+		if (!allocate(entry.width + m_iPadding, entry.height + m_iPadding, &page, &x, &y))
 		{
-			// left
-			for (int y=-1; y<height+1; y++)
-			{
-				const int x = 0;
-				int actualX = (flipHorizontal ? width - x - 1 : x);
-				int actualY = clamp<int>((flipVertical ? height - y - 1 : y), 0, height-1);
+			debugLog("TextureAtlas::repack() WARNING: Entry %i (%ix%i) doesn't fit anymore, removing it!\n", ids[i], entry.width, entry.height);
+			m_entries[ids[i]].used = false;
+			m_freeEntryIds.push_back(ids[i]);
+			m_iNumEntries--;
+			continue;
+		}
 
-				m_atlasImage->setPixel(m_iCurX + x - 1, m_iCurY + y, pixels[actualY*width + actualX]);
-			}
-			// right
-			for (int y=-1; y<height+1; y++)
-			{
-				const int x = width - 1;
-				int actualX = (flipHorizontal ? width - x - 1 : x);
-				int actualY = clamp<int>((flipVertical ? height - y - 1 : y), 0, height-1);
+		writePixels(m_pages[page].image, x, y, entry.width, entry.height, false, false, &pixels[ids[i]][0]);
+		m_pages[page].usedArea += (entry.width + m_iPadding)*(entry.height + m_iPadding);
 
-				m_atlasImage->setPixel(m_iCurX + x + 1, m_iCurY + y, pixels[actualY*width + actualX]);
-			}
-			// top
-			for (int x=-1; x<width+1; x++)
-			{
-				const int y = 0;
-				int actualX = clamp<int>((flipHorizontal ? width - x - 1 : x), 0, width-1);
-				int actualY = (flipVertical ? height - y - 1 : y);
+		entry.page = page;
+		entry.x = x;
+		entry.y = y;
+	}
 
-				m_atlasImage->setPixel(m_iCurX + x, m_iCurY + y - 1, pixels[actualY*width + actualX]);
-			}
-			// bottom
-			for (int x=-1; x<width+1; x++)
-			{
-				const int y = height - 1;
-				int actualX = clamp<int>((flipHorizontal ? width - x - 1 : x), 0, width-1);
-				int actualY = (flipVertical ? height - y - 1 : y);
+	// drop pages which are empty now (except for page 0)
+	while (m_pages.size() > 1 && m_pages.back().usedArea < 1)
+	{
+		delete m_pages.back().image;
+		m_pages.pop_back();
+	}
+}
 
-				m_atlasImage->setPixel(m_iCurX + x, m_iCurY + y + 1, pixels[actualY*width + actualX]);
-			}
+Vector2 TextureAtlas::put(int width, int height, bool flipHorizontal, bool flipVertical, Color *pixels)
+{
+	const int id = add(width, height, flipHorizontal, flipVertical, pixels);
+	if (id < 0)
+		return Vector2();
+
+	return Vector2(m_entries[id].entry.x, m_entries[id].entry.y);
+}
+
+void TextureAtlas::printStats()
+{
+	int numFreeRects = 0;
+	for (size_t i=0; i<m_pages.size(); i++)
+	{
+		numFreeRects += (int)m_pages[i].freeRects.size();
+	}
+
+	debugLog("TextureAtlas: %s: %i entries on %i/%i page(s) of %ix%i, %.1f %% occupancy, %i free rect(s)\n", m_sName.toUtf8(), m_iNumEntries, (int)m_pages.size(), m_iMaxPages, m_iWidth, m_iHeight, getOccupancy()*100.0f, numFreeRects);
+}
+
+float TextureAtlas::getOccupancy() const
+{
+	if (m_pages.size() < 1) return 0.0f;
+
+	double usedArea = 0.0;
+	for (size_t i=0; i<m_pages.size(); i++)
+	{
+		usedArea += m_pages[i].usedArea;
+	}
+
+	return (float)(usedArea / ((double)m_iWidth*(double)m_iHeight*(double)m_pages.size()));
+}
+
+bool TextureAtlas::canModify()
+{
+	if (m_bReady && !m_bKeepInSystemMemory)
+	{
+		debugLog("TextureAtlas ERROR: Can't modify %s after it has been loaded (keepInSystemMemory = false)!\n", m_sName.toUtf8());
+		return false;
+	}
+
+	return true;
+}
+
+int TextureAtlas::addPage()
+{
+	PAGE page;
+	{
+		engine->getResourceManager()->requestNextLoadUnmanaged();
+		page.image = engine->getResourceManager()->createImage(m_iWidth, m_iHeight, false, m_bKeepInSystemMemory);
+
+		resetPage(page);
+	}
+	m_pages.push_back(page);
+
+	return (int)m_pages.size() - 1;
+}
+
+void TextureAtlas::resetPage(PAGE &page)
+{
+	SKYLINE_NODE node;
+	node.x = m_iPadding;
+	node.y = m_iPadding;
+	node.width = m_iWidth - m_iPadding;
+
+	page.skyline.clear();
+	page.skyline.push_back(node);
+	page.freeRects.clear();
+	page.usedArea = 0;
+	page.dirty = true;
+
+	std::vector<unsigned char> *rawImage = page.image->getRawImage();
+	std::fill(rawImage->begin(), rawImage->end(), 0);
+}
+
+bool TextureAtlas::allocate(int width, int height, int *page, int *x, int *y)
+{
+	for (size_t i=0; i<m_pages.size(); i++)
+	{
+		if (allocateFromFreeRects(m_pages[i], width, height, x, y) || allocateFromSkyline(m_pages[i], width, height, x, y))
+		{
+			*page = (int)i;
+			return true;
+		}
+	}
+
+	if ((int)m_pages.size() < m_iMaxPages)
+	{
+		const int newPage = addPage();
+		if (allocateFromSkyline(m_pages[newPage], width, height, x, y))
+		{
+			*page = newPage;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool TextureAtlas::allocateFromFreeRects(PAGE &page, int width, int height, int *x, int *y)
+{
+	// best area fit
+	int bestIndex = -1;
+	int bestArea = 0;
+	for (size_t i=0; i<page.freeRects.size(); i++)
+	{
+		const RECT &rect = page.freeRects[i];
+		if (width > rect.width || height > rect.height) continue;
+
+		const int area = rect.width*rect.height;
+		if (bestIndex < 0 || area < bestArea)
+		{
+			bestIndex = (int)i;
+			bestArea = area;
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	const RECT rect = page.freeRects[bestIndex];
+	page.freeRects.erase(page.freeRects.begin() + bestIndex);
+
+	*x = rect.x;
+	*y = rect.y;
+
+	// guillotine split of the remaining space
+	RECT right;
+	right.x = rect.x + width;
+	right.y = rect.y;
+	right.width = rect.width - width;
+	right.height = height;
+	if (right.width > 0)
+		page.freeRects.push_back(right);
+
+	RECT bottom;
+	bottom.x = rect.x;
+	bottom.y = rect.y + height;
+	bottom.width = rect.width;
+	bottom.height = rect.height - height;
+	if (bottom.height > 0)
+		page.freeRects.push_back(bottom);
+
+	return true;
+}
+
+bool TextureAtlas::allocateFromSkyline(PAGE &page, int width, int height, int *x, int *y)
+{
+	// bottom left: lowest resulting top edge wins, ties go to the narrowest node
+	int bestIndex = -1;
+	int bestTop = 0;
+	int bestWidth = 0;
+	for (size_t i=0; i<page.skyline.size(); i++)
+	{
+		const int fitY = fitSkyline(page, i, width, height);
+		if (fitY < 0) continue;
+
+		const int top = fitY + height;
+		if (bestIndex < 0 || top < bestTop || (top == bestTop && page.skyline[i].width < bestWidth))
+		{
+			bestIndex = (int)i;
+			bestTop = top;
+			bestWidth = page.skyline[i].width;
+		}
+	}
+
+	if (bestIndex < 0)
+		return false;
+
+	SKYLINE_NODE newNode;
+	newNode.x = page.skyline[bestIndex].x;
+	newNode.y = bestTop;
+	newNode.width = width;
+
+	*x = newNode.x;
+	*y = bestTop - height;
+
+	page.skyline.insert(page.skyline.begin() + bestIndex, newNode);
+
+	// shrink/remove everything which is now covered by the new node
+	for (size_t i=bestIndex+1; i<page.skyline.size(); )
+	{
+		const SKYLINE_NODE &prev = page.skyline[i-1];
+		SKYLINE_NODE &cur = page.skyline[i];
+
+		if (cur.x >= prev.x + prev.width)
+			break;
+
+		const int shrink = prev.x + prev.width - cur.x;
+		cur.x += shrink;
+		cur.width -= shrink;
+
+		if (cur.width > 0)
+			break;
+
+		page.skyline.erase(page.skyline.begin() + i);
+	}
+
+	// merge neighbours on the same level
+	for (size_t i=0; i+1<page.skyline.size(); )
+	{
+		if (page.skyline[i].y == page.skyline[i+1].y)
+		{
+			page.skyline[i].width += page.skyline[i+1].width;
+			page.skyline.erase(page.skyline.begin() + i + 1);
+		}
+		else
+			i++;
+	}
+
+	return true;
+}
+
+int TextureAtlas::fitSkyline(const PAGE &page, size_t nodeIndex, int width, int height) const
+{
+	const int x = page.skyline[nodeIndex].x;
+	if (x + width > m_iWidth)
+		return -1;
+
+	int y = page.skyline[nodeIndex].y;
+	int widthLeft = width;
+	for (size_t i=nodeIndex; widthLeft > 0; i++)
+	{
+		if (i >= page.skyline.size())
+			return -1;
+
+		y = std::max(y, page.skyline[i].y);
+		if (y + height > m_iHeight)
+			return -1;
+
+		widthLeft -= page.skyline[i].width;
+	}
+
+	return y;
+}
+
+void TextureAtlas::writePixels(Image *image, int posX, int posY, int width, int height, bool flipHorizontal, bool flipVertical, const Color *pixels)
+{
+	for (int y=0; y<height; y++)
+	{
+		for (int x=0; x<width; x++)
+		{
+			int actualX = (flipHorizontal ? width - x - 1 : x);
+			int actualY = (flipVertical ? height - y - 1 : y);
+
+			image->setPixel(posX + x, posY + y, pixels[actualY*width + actualX]);
+		}
+	}
+
+	// TODO: make this into an API
+	// mirror border pixels
+	if (m_iPadding > 1)
+	{
+		// left
+		for (int y=-1; y<height+1; y++)
+		{
+			const int x = 0;
+			int actualX = (flipHorizontal ? width - x - 1 : x);
+			int actualY = clamp<int>((flipVertical ? height - y - 1 : y), 0, height-1);
+
+			image->setPixel(posX + x - 1, posY + y, pixels[actualY*width + actualX]);
+		}
+		// right
+		for (int y=-1; y<height+1; y++)
+		{
+			const int x = width - 1;
+			int actualX = (flipHorizontal ? width - x - 1 : x);
+			int actualY = clamp<int>((flipVertical ? height - y - 1 : y), 0, height-1);
+
+			image->setPixel(posX + x + 1, posY + y, pixels[actualY*width + actualX]);
+		}
+		// top
+		for (int x=-1; x<width+1; x++)
+		{
+			const int y = 0;
+			int actualX = clamp<int>((flipHorizontal ? width - x - 1 : x), 0, width-1);
+			int actualY = (flipVertical ? height - y - 1 : y);
+
+			image->setPixel(posX + x, posY + y - 1, pixels[actualY*width + actualX]);
+		}
+		// bottom
+		for (int x=-1; x<width+1; x++)
+		{
+			const int y = height - 1;
+			int actualX = clamp<int>((flipHorizontal ? width - x - 1 : x), 0, width-1);
+			int actualY = (flipVertical ? height - y - 1 : y);
+
+			image->setPixel(posX + x, posY + y + 1, pixels[actualY*width + actualX]);
+		}
+	}
+}
+
+
+
+//**********************************//
+//	TextureAtlas ConCommands	//
+//**********************************//
+
+// the old row packer, only for comparison
+static int _atlasRowPackerNumPages(const std::vector<int> &widths, const std::vector<int> &heights, int atlasWidth, int atlasHeight, int padding)
+{
+	int numPages = 1;
+	int curX = padding;
+	int curY = padding;
+	int maxHeight = 0;
+	for (size_t i=0; i<widths.size(); i++)
+	{
+		if (curX + widths[i] + padding > atlasWidth)
+		{
+			curX = padding;
+			curY += maxHeight + padding;
+			maxHeight = 0;
+		}
+		if (curY + heights[i] + padding > atlasHeight)
+		{
+			numPages++;
+			curX = padding;
+			curY = padding;
+			maxHeight = 0;
+		}
+		maxHeight = std::max(maxHeight, heights[i]);
+		curX += widths[i] + padding;
+	}
+	return numPages;
+}
+
+void _atlas_benchmark(UString args)
+{
+	int numEntries = args.toInt();
+	if (numEntries < 1)
+		numEntries = 4000;
+	numEntries = std::min(numEntries, 100000);
+	const int atlasSize = 512;
+
+	// mostly glyph sized, sometimes small ui images
+	std::vector<int> widths;
+	std::vector<int> heights;
+	unsigned int seed = 12345;
+	for (int i=0; i<numEntries; i++)
+	{
+		seed = seed*1103515245 + 12345;
+		const bool isImage = ((seed >> 16) % 16 == 0);
+		seed = seed*1103515245 + 12345;
+		const int width = (isImage ? 32 + (seed >> 16) % 97 : 4 + (seed >> 16) % 29);
+		seed = seed*1103515245 + 12345;
+		const int height = (isImage ? 32 + (seed >> 16) % 97 : 8 + (seed >> 16) % 29);
+		widths.push_back(width);
+		heights.push_back(height);
+	}
+	std::vector<Color> pixels(128*128, 0xffffffff);
+
+	debugLog("atlas_benchmark: %i entries into %ix%i pages\n", numEntries, atlasSize, atlasSize);
+	debugLog("row packer:  %i page(s)\n", _atlasRowPackerNumPages(widths, heights, atlasSize, atlasSize, 1));
+
+	TextureAtlas *atlas = new TextureAtlas(atlasSize, atlasSize, 1024, true);
+	atlas->setName("atlas_benchmark");
+	std::vector<int> ids;
+	{
+		const double startTime = engine->getTimeReal();
+		for (int i=0; i<numEntries; i++)
+		{
+			ids.push_back(atlas->add(widths[i], heights[i], &pixels[0]));
 		}
+		debugLog("skyline:     %i page(s), %.1f %% occupancy, %.3f ms\n", atlas->getNumPages(), atlas->getOccupancy()*100.0f, (engine->getTimeReal() - startTime)*1000.0);
 	}
-	Vector2 pos = Vector2(m_iCurX, m_iCurY);
 
-	// move offset for next element
-	m_iCurX += width + m_iPadding;
+	// free every other entry, and fill the holes with half as many new ones
+	{
+		const double startTime = engine->getTimeReal();
+		for (int i=0; i<numEntries; i+=2)
+		{
+			atlas->remove(ids[i]);
+		}
+		for (int i=0; i<numEntries/2; i+=2)
+		{
+			atlas->add(widths[i], heights[i], &pixels[0]);
+		}
+		debugLog("remove/add:  %i page(s), %.1f %% occupancy, %.3f ms\n", atlas->getNumPages(), atlas->getOccupancy()*100.0f, (engine->getTimeReal() - startTime)*1000.0);
+	}
+	{
+		const double startTime = engine->getTimeReal();
+		atlas->repack();
+		debugLog("repacked:    %i page(s), %.1f %% occupancy, %.3f ms\n", atlas->getNumPages(), atlas->getOccupancy()*100.0f, (engine->getTimeReal() - startTime)*1000.0);
+	}
 
-	return pos;
+	delete atlas;
 }
+
+ConVar _atlas_benchmark_("atlas_benchmark", _atlas_benchmark, ConVar::ARGS::ARGS_OPTIONAL);
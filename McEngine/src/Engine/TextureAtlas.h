@@ -12,36 +12,110 @@
 
 class Image;
 
+// skyline bottom-left packer (no rotation), entries go onto the first page which fits them, new pages are created on demand up to maxPages
+// removed entries leave a free rect behind which is reused by later entries, repack() gets rid of the fragmentation
+// NOTE: changes after the first load() need keepInSystemMemory, and are only uploaded on the next load()
+
 class TextureAtlas : public Resource
 {
 public:
-	TextureAtlas(int width = 512, int height = 512);
+	struct ENTRY
+	{
+		int page;
+		int x; // top left corner of the pixels (without padding)
+		int y;
+		int width;
+		int height;
+	};
+
+public:
+	TextureAtlas(int width = 512, int height = 512, int maxPages = 1, bool keepInSystemMemory = false);
 	virtual ~TextureAtlas() {destroy();}
 
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_TEXTUREATLAS;}
+
+	// returns the entry id, or -1 if it doesn't fit anymore
+	int add(int width, int height, Color *pixels) {return add(width, height, false, false, pixels);}
+	int add(int width, int height, bool flipHorizontal, bool flipVertical, Color *pixels);
+	void remove(int id);
+
+	// packs all remaining entries again from scratch (sorted by height), entry ids stay the same but their positions change
+	void repack();
+
+	// legacy, only returns the position (entries which don't fit return (0, 0))
 	Vector2 put(int width, int height, Color *pixels) {return put(width, height, false, false, pixels);}
 	Vector2 put(int width, int height, bool flipHorizontal, bool flipVertical, Color *pixels);
 
 	void setPadding(int padding) {m_iPadding = padding;}
 
+	void printStats();
+
 	inline int getWidth() const {return m_iWidth;}
 	inline int getHeight() const {return m_iHeight;}
-	inline Image *getAtlasImage() const {return m_atlasImage;}
+	inline int getNumPages() const {return (int)m_pages.size();}
+	inline Image *getAtlasImage(int page = 0) const {return (page >= 0 && page < (int)m_pages.size() ? m_pages[page].image : NULL);}
+	inline const ENTRY &getEntry(int id) const {return m_entries[id].entry;}
+	inline int getNumEntries() const {return m_iNumEntries;}
+	float getOccupancy() const; // used area (incl. padding) / total area of all pages
 
 private:
+	struct SKYLINE_NODE
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	struct RECT
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	struct PAGE
+	{
+		Image *image;
+		std::vector<SKYLINE_NODE> skyline;
+		std::vector<RECT> freeRects;
+		int usedArea;
+		bool dirty;
+	};
+
+	struct ENTRY_INTERNAL
+	{
+		ENTRY entry;
+		bool used;
+	};
+
 	virtual void init();
 	virtual void initAsync();
 	virtual void destroy();
 
+	bool canModify();
+
+	int addPage();
+	void resetPage(PAGE &page);
+	bool allocate(int width, int height, int *page, int *x, int *y); // width/height incl. padding
+	bool allocateFromFreeRects(PAGE &page, int width, int height, int *x, int *y);
+	bool allocateFromSkyline(PAGE &page, int width, int height, int *x, int *y);
+	int fitSkyline(const PAGE &page, size_t nodeIndex, int width, int height) const;
+
+	void writePixels(Image *image, int x, int y, int width, int height, bool flipHorizontal, bool flipVertical, const Color *pixels);
+
 	int m_iPadding;
 
 	int m_iWidth;
 	int m_iHeight;
+	int m_iMaxPages;
+	bool m_bKeepInSystemMemory;
 
-	Image *m_atlasImage;
+	std::vector<PAGE> m_pages;
 
-	int m_iCurX;
-	int m_iCurY;
-	int m_iMaxHeight;
+	std::vector<ENTRY_INTERNAL> m_entries;
+	std::vector<int> m_freeEntryIds;
+	int m_iNumEntries;
 };
 
 #endif
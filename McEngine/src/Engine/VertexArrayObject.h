@@ -16,6 +16,8 @@ public:
 	VertexArrayObject(Graphics::PRIMITIVE primitive = Graphics::PRIMITIVE::PRIMITIVE_TRIANGLES, Graphics::USAGE_TYPE usage = Graphics::USAGE_TYPE::USAGE_STATIC, bool keepInSystemMemory = false);
 	virtual ~VertexArrayObject();
 
+	virtual Resource::TYPE getResType() const {return Resource::TYPE::TYPE_VAO;}
+
 	// TODO: fix the naming schema. clear = empty = just empty the containers, but not necessarily release memory
 	void clear();
 	void empty();
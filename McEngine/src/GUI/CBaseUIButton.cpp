@@ -85,7 +85,7 @@ void CBaseUIButton::drawText(Graphics *g)
 				else
 					g->setColor(COLOR_INVERT(m_textColor));
 			}
-			g->drawString(m_font, m_sText);
+			g->drawStringCached(m_font, m_sText);
 
 			// top
 			g->translate(-shadowOffset, -shadowOffset);
@@ -95,7 +95,7 @@ void CBaseUIButton::drawText(Graphics *g)
 				else
 					g->setColor(m_textColor);
 			}
-			g->drawString(m_font, m_sText);
+			g->drawStringCached(m_font, m_sText);
 		}
 		g->popTransform();
 	}
@@ -133,7 +133,7 @@ void CBaseUIButton::updateStringMetrics()
 		if (m_bTextLeft)
 			m_fStringWidth = m_vSize.x - 4;
 		else
-			m_fStringWidth = m_font->getStringWidth(m_sText);
+			m_fStringWidth = m_font->getStringWidthCached(m_sText);
 	}
 }
 
@@ -7,6 +7,7 @@
 
 #include "CBaseUIContainer.h"
 #include "Engine.h"
+#include "Profiler.h"
 
 CBaseUIContainer::CBaseUIContainer(float Xpos, float Ypos, float Xsize, float Ysize, UString name) : CBaseUIElement(Xpos, Ypos, Xsize, Ysize, name)
 {
@@ -162,6 +163,8 @@ CBaseUIElement *CBaseUIContainer::getBaseUIElement(UString name)
 
 void CBaseUIContainer::draw(Graphics *g)
 {
+	VPROF("CBaseUIContainer::draw");
+
 	if (!m_bVisible) return;
 
 	for (int i=0; i<m_vElements.size(); i++)
@@ -182,6 +185,8 @@ void CBaseUIContainer::draw_debug(Graphics *g)
 
 void CBaseUIContainer::update()
 {
+	VPROF("CBaseUIContainer::update");
+
 	CBaseUIElement::update();
 	if (!m_bVisible) return;
 
@@ -72,7 +72,7 @@ void CBaseUILabel::drawText(Graphics *g)
 			g->pushTransform();
 			{
 				g->translate((int)(m_vPos.x + (m_bCenterText ? + m_vSize.x/2.0f - m_fStringWidth/2.0f : xPosAdd)), (int)(m_vPos.y + m_vSize.y/2.0f + m_fStringHeight/2.0f));
-				g->drawString(m_font, m_sText);
+				g->drawStringCached(m_font, m_sText);
 			}
 			g->popTransform();
 
@@ -89,7 +89,7 @@ void CBaseUILabel::updateStringMetrics()
 {
 	if (m_font != NULL)
 	{
-		m_fStringWidth = m_font->getStringWidth(m_sText);
+		m_fStringWidth = m_font->getStringWidthCached(m_sText);
 		m_fStringHeight = m_font->getHeight();
 	}
 }
@@ -162,8 +162,14 @@ void Console::processCommand(UString command)
 	if (commandValue.length() > 0)
 		var->setValue(commandValue);
 	else
+	{
 		var->exec();
 
+		// commands whose arguments are optional (see ConVar::hasOptionalArgs())
+		if (var->hasOptionalArgs())
+			var->execArgs("");
+	}
+
 	// log
 	if (console_logging.getBool())
 	{
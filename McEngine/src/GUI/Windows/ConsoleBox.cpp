@@ -126,7 +126,7 @@ void ConsoleBox::draw(Graphics *g)
 				for (int i=0; i<m_log.size(); i++)
 				{
 					g->translate(0, (int)((m_logFont->getHeight() + (i == 0 ? 0 : 2) + 1) * logScale));
-					g->drawString(m_logFont, m_log[i]);
+					g->drawStringCached(m_logFont, m_log[i]);
 				}
 			}
 			g->popTransform();
@@ -142,7 +142,7 @@ void ConsoleBox::draw(Graphics *g)
 				for (int i=0; i<m_log.size(); i++)
 				{
 					g->translate(0, (int)((m_logFont->getHeight() + (i == 0 ? 0 : 2) + 1) * logScale));
-					g->drawString(m_logFont, m_log[i]);
+					g->drawStringCached(m_logFont, m_log[i]);
 				}
 			}
 			g->popTransform();
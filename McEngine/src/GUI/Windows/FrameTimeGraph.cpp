@@ -0,0 +1,122 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		frame time graph overlay (update/paint/total per frame)
+//
+// $NoKeywords: $frametime
+//===============================================================================//
+
+#include "FrameTimeGraph.h"
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "VertexArrayObject.h"
+#include "FrameTimeHistory.h"
+#include "Profiler.h"
+#include "ConVar.h"
+
+ConVar frametime_graph("frametime_graph", false, "draw a graph of the most recent frame times (green = update, blue = paint, grey = total)");
+ConVar frametime_graph_width("frametime_graph_width", 400, "width of the graph in pixels, one pixel per frame");
+ConVar frametime_graph_height("frametime_graph_height", 150, "height of the graph in pixels");
+ConVar frametime_graph_max_ms("frametime_graph_max_ms", 33.333f, "frame time in milliseconds at the top of the graph");
+
+FrameTimeGraph::FrameTimeGraph() : CBaseUIElement(0, 0, 0, 0, "")
+{
+	m_font = engine->getResourceManager()->getFont("FONT_CONSOLE");
+	m_fNextStatsUpdateTime = 0.0f;
+}
+
+void FrameTimeGraph::draw(Graphics *g)
+{
+	if (!frametime_graph.getBool()) return;
+
+	VPROF("FrameTimeGraph::draw");
+
+	const FrameTimeHistory *history = engine->getFrameTimeHistory();
+
+	const int margin = 5;
+	const int width = std::max(frametime_graph_width.getInt(), 2);
+	const int height = std::max(frametime_graph_height.getInt(), 2);
+	const int x = margin;
+	const int y = engine->getScreenHeight() - height - margin;
+	const float pixelsPerSecond = (float)height / (std::max(frametime_graph_max_ms.getFloat(), 0.1f) / 1000.0f);
+
+	// background
+	g->setColor(0xaa000000);
+	g->fillRect(x, y, width, height);
+
+	// one column per frame, newest on the right, all in one draw
+	{
+		VertexArrayObject vao(Graphics::PRIMITIVE::PRIMITIVE_LINES);
+
+		const int numFrames = std::min(history->getNumFrames(), width);
+		for (int i=0; i<numFrames; i++)
+		{
+			const FrameTimeHistory::FRAME &frame = history->getFrame(i);
+
+			const float columnX = (float)(x + width - 1 - i) + 0.5f;
+			const float bottom = (float)(y + height);
+			const float updateTop = bottom - std::min(frame.update * pixelsPerSecond, (float)height);
+			const float paintTop = updateTop - std::min(frame.paint * pixelsPerSecond, updateTop - (float)y);
+			const float totalTop = bottom - std::min(frame.total * pixelsPerSecond, (float)height);
+
+			// total (only the part which is neither update nor paint, e.g. the frame limiter or swapping)
+			if (totalTop < paintTop)
+			{
+				vao.addVertex(columnX, paintTop);
+				vao.addColor(0xff808080);
+				vao.addVertex(columnX, totalTop);
+				vao.addColor(0xff808080);
+			}
+
+			// paint
+			vao.addVertex(columnX, updateTop);
+			vao.addColor(0xff3f7fff);
+			vao.addVertex(columnX, paintTop);
+			vao.addColor(0xff3f7fff);
+
+			// update
+			vao.addVertex(columnX, bottom);
+			vao.addColor(0xff00ff00);
+			vao.addVertex(columnX, updateTop);
+			vao.addColor(0xff00ff00);
+		}
+
+		if (vao.getVertices().size() > 0)
+		{
+			g->setColor(0xffffffff);
+			g->drawVAO(&vao);
+		}
+	}
+
+	// reference lines at 60 and 30 fps
+	const float referenceFrameTimes[] = {1.0f / 60.0f, 1.0f / 30.0f};
+	for (int i=0; i<2; i++)
+	{
+		const int lineY = y + height - (int)(referenceFrameTimes[i] * pixelsPerSecond);
+		if (lineY > y)
+		{
+			g->setColor(0x66ffffff);
+			g->drawLine(x, lineY, x + width, lineY);
+		}
+	}
+
+	// percentiles
+	g->setColor(0xffffffff);
+	g->pushTransform();
+	{
+		g->translate(x, y - m_font->getHeight()*0.5f);
+		g->drawString(m_font, m_sStats);
+	}
+	g->popTransform();
+}
+
+void FrameTimeGraph::update()
+{
+	if (!frametime_graph.getBool()) return;
+
+	// sorting the whole history every frame would show up in the graph itself
+	if (engine->getTimeReal() < m_fNextStatsUpdateTime) return;
+	m_fNextStatsUpdateTime = engine->getTimeReal() + 0.5f;
+
+	const FrameTimeHistory::PERCENTILES total = engine->getFrameTimeHistory()->getPercentiles(FrameTimeHistory::TYPE::TOTAL);
+	m_sStats = UString::format("frame (%i): p50 = %.2f ms, p95 = %.2f ms, p99 = %.2f ms, max = %.2f ms", engine->getFrameTimeHistory()->getNumFrames(), total.p50*1000.0f, total.p95*1000.0f, total.p99*1000.0f, total.max*1000.0f);
+}
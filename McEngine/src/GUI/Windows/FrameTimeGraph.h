@@ -0,0 +1,30 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		frame time graph overlay (update/paint/total per frame)
+//
+// $NoKeywords: $frametime
+//===============================================================================//
+
+#ifndef FRAMETIMEGRAPH_H
+#define FRAMETIMEGRAPH_H
+
+#include "cbase.h"
+#include "CBaseUIElement.h"
+
+class FrameTimeGraph : public CBaseUIElement
+{
+public:
+	FrameTimeGraph();
+	virtual ~FrameTimeGraph() {;}
+
+	void draw(Graphics *g);
+	void update();
+
+private:
+	McFont *m_font;
+
+	UString m_sStats;
+	float m_fNextStatsUpdateTime;
+};
+
+#endif
@@ -0,0 +1,82 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		renderer statistics overlay (draw calls, binds, state changes per frame)
+//
+// $NoKeywords: $rstats
+//===============================================================================//
+
+#include "RenderStatsOverlay.h"
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "Profiler.h"
+#include "ConVar.h"
+
+ConVar r_stats_overlay("r_stats_overlay", false, "draw the renderer statistics of the most recent frames (last/avg/max per frame), see r_stats. NOTE: the numbers include the overlay itself (one background rect and one string per line)");
+ConVar r_stats_overlay_frames("r_stats_overlay_frames", 120, "number of frames which the averages and maxima of r_stats_overlay are computed over");
+
+RenderStatsOverlay::RenderStatsOverlay() : CBaseUIElement(0, 0, 0, 0, "")
+{
+	m_font = engine->getResourceManager()->getFont("FONT_CONSOLE");
+	m_fNextStatsUpdateTime = 0.0f;
+}
+
+void RenderStatsOverlay::draw(Graphics *g)
+{
+	if (!r_stats_overlay.getBool() || m_lines.size() < 1) return;
+
+	VPROF("RenderStatsOverlay::draw");
+
+	const int margin = 5;
+	const int padding = 4;
+	const int lineHeight = (int)(m_font->getHeight() * 1.5f);
+
+	float maxLineWidth = 0.0f;
+	for (size_t i=0; i<m_lines.size(); i++)
+	{
+		maxLineWidth = std::max(maxLineWidth, m_font->getStringWidth(m_lines[i]));
+	}
+
+	const int width = (int)maxLineWidth + 2*padding;
+	const int height = (int)m_lines.size()*lineHeight + 2*padding;
+	const int x = engine->getScreenWidth() - width - margin;
+	const int y = margin;
+
+	// background
+	g->setColor(0xaa000000);
+	g->fillRect(x, y, width, height);
+
+	// one line per counter
+	g->setColor(0xffffffff);
+	for (size_t i=0; i<m_lines.size(); i++)
+	{
+		g->pushTransform();
+		{
+			g->translate(x + padding, y + padding + (int)(i+1)*lineHeight - (lineHeight - m_font->getHeight())/2);
+			g->drawString(m_font, m_lines[i]);
+		}
+		g->popTransform();
+	}
+}
+
+void RenderStatsOverlay::update()
+{
+	if (!r_stats_overlay.getBool()) return;
+
+	// the numbers would be unreadable if they changed every frame
+	if (engine->getTimeReal() < m_fNextStatsUpdateTime) return;
+	m_fNextStatsUpdateTime = engine->getTimeReal() + 0.5f;
+
+	Graphics::FRAME_STATS last;
+	double avg[Graphics::FRAME_STATS::NUM_COUNTERS];
+	int max[Graphics::FRAME_STATS::NUM_COUNTERS];
+	const int numFrames = engine->getGraphics()->getFrameStatsSummary(std::max(r_stats_overlay_frames.getInt(), 1), last, avg, max);
+
+	m_lines.clear();
+	if (numFrames < 1) return;
+
+	m_lines.push_back(UString::format("%-20s %7s %9s %7s", UString::format("frames (%i)", numFrames).toUtf8(), "last", "avg", "max"));
+	for (int c=0; c<Graphics::FRAME_STATS::NUM_COUNTERS; c++)
+	{
+		m_lines.push_back(UString::format("%-20s %7i %9.1f %7i", Graphics::FRAME_STATS::getCounterName(c), last.getCounter(c), avg[c], max[c]));
+	}
+}
@@ -0,0 +1,30 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		renderer statistics overlay (draw calls, binds, state changes per frame)
+//
+// $NoKeywords: $rstats
+//===============================================================================//
+
+#ifndef RENDERSTATSOVERLAY_H
+#define RENDERSTATSOVERLAY_H
+
+#include "cbase.h"
+#include "CBaseUIElement.h"
+
+class RenderStatsOverlay : public CBaseUIElement
+{
+public:
+	RenderStatsOverlay();
+	virtual ~RenderStatsOverlay() {;}
+
+	void draw(Graphics *g);
+	void update();
+
+private:
+	McFont *m_font;
+
+	std::vector<UString> m_lines;
+	float m_fNextStatsUpdateTime;
+};
+
+#endif
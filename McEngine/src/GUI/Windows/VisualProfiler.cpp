@@ -0,0 +1,107 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		VPROF zone overlay
+//
+// $NoKeywords: $vprof
+//===============================================================================//
+
+#include "VisualProfiler.h"
+#include "Engine.h"
+#include "ResourceManager.h"
+#include "Profiler.h"
+#include "ConVar.h"
+
+ConVar vprof_overlay("vprof_overlay", true, "draw the zones of the last frame while vprof is enabled");
+ConVar vprof_overlay_refresh("vprof_overlay_refresh", 0.25f, "how often the overlay picks up a new frame, in seconds (every frame is unreadable)");
+ConVar vprof_overlay_max_lines("vprof_overlay_max_lines", 48);
+
+VisualProfiler::VisualProfiler() : CBaseUIElement(0, 0, 0, 0, "")
+{
+	m_font = engine->getResourceManager()->getFont("FONT_CONSOLE");
+	m_fNextRefreshTime = 0.0f;
+}
+
+VisualProfiler::~VisualProfiler()
+{
+}
+
+void VisualProfiler::draw(Graphics *g)
+{
+	VPROF("VisualProfiler::draw");
+
+	if (!Profiler::isEnabled() || !vprof_overlay.getBool() || m_lines.size() < 1) return;
+
+	const int margin = 5;
+	const int indent = (int)m_font->getHeight();
+	const int lineHeight = (int)(m_font->getHeight() * 1.5f);
+
+	// measure
+	float maxTextWidth = 0.0f;
+	float maxTimeWidth = 0.0f;
+	for (size_t i=0; i<m_lines.size(); i++)
+	{
+		maxTextWidth = std::max(maxTextWidth, m_lines[i].depth*indent + m_font->getStringWidth(m_lines[i].text));
+		maxTimeWidth = std::max(maxTimeWidth, m_font->getStringWidth(m_lines[i].time));
+	}
+
+	const int width = (int)(maxTextWidth + maxTimeWidth) + 4*margin;
+	const int height = (int)m_lines.size()*lineHeight + 2*margin;
+	const int x = engine->getScreenWidth() - width - margin;
+	const int y = margin;
+
+	// background
+	g->setColor(0xaa000000);
+	g->fillRect(x, y, width, height);
+
+	// zones
+	g->setColor(0xffffffff);
+	for (size_t i=0; i<m_lines.size(); i++)
+	{
+		const int lineY = y + margin + (int)(i+1)*lineHeight - (lineHeight - (int)m_font->getHeight())/2;
+
+		g->pushTransform();
+		{
+			g->translate(x + margin + m_lines[i].depth*indent, lineY);
+			g->drawString(m_font, m_lines[i].text);
+		}
+		g->popTransform();
+
+		g->pushTransform();
+		{
+			g->translate(x + width - margin - (int)m_font->getStringWidth(m_lines[i].time), lineY);
+			g->drawString(m_font, m_lines[i].time);
+		}
+		g->popTransform();
+	}
+}
+
+void VisualProfiler::update()
+{
+	if (!Profiler::isEnabled() || !vprof_overlay.getBool())
+	{
+		m_lines.clear();
+		return;
+	}
+
+	if (engine->getTimeReal() < m_fNextRefreshTime) return;
+	m_fNextRefreshTime = engine->getTimeReal() + vprof_overlay_refresh.getFloat();
+
+	// zones are stored in the order in which they ended (children first), sort by start time to get back to the call hierarchy
+	std::vector<Profiler::ZONE> zones = Profiler::getLastFrameZones();
+	std::sort(zones.begin(), zones.end(), [](const Profiler::ZONE &a, const Profiler::ZONE &b) {
+		return (a.start < b.start || (a.start == b.start && a.depth < b.depth));
+	});
+
+	m_lines.clear();
+	for (size_t i=0; i<zones.size() && (int)i<vprof_overlay_max_lines.getInt(); i++)
+	{
+		LINE line;
+		line.text = UString(zones[i].name);
+		if (zones[i].detail.length() > 0)
+			line.text.append(UString::format(" (%s)", zones[i].detail.c_str()));
+		line.time = UString::format("%.3f ms", (zones[i].end - zones[i].start) / 1000.0);
+		line.depth = zones[i].depth;
+
+		m_lines.push_back(line);
+	}
+}
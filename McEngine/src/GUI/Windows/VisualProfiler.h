@@ -0,0 +1,37 @@
+//================ Copyright (c) 2019, PG, All rights reserved. =================//
+//
+// Purpose:		VPROF zone overlay
+//
+// $NoKeywords: $vprof
+//===============================================================================//
+
+#ifndef VISUALPROFILER_H
+#define VISUALPROFILER_H
+
+#include "cbase.h"
+#include "CBaseUIElement.h"
+
+class VisualProfiler : public CBaseUIElement
+{
+public:
+	VisualProfiler();
+	virtual ~VisualProfiler();
+
+	void draw(Graphics *g);
+	void update();
+
+private:
+	struct LINE
+	{
+		UString text;
+		UString time;
+		int depth;
+	};
+
+	McFont *m_font;
+
+	std::vector<LINE> m_lines;
+	float m_fNextRefreshTime;
+};
+
+#endif
@@ -517,6 +517,19 @@ UString UString::trim() const
 	return substr(startPos, endPos - startPos + 1);
 }
 
+size_t UString::hash() const
+{
+	// FNV-1a over the code units
+	size_t hash = (sizeof(size_t) > 4 ? (size_t)14695981039346656037ULL : (size_t)2166136261U);
+	const size_t prime = (sizeof(size_t) > 4 ? (size_t)1099511628211ULL : (size_t)16777619U);
+	for (int i=0; i<mLength; i++)
+	{
+		hash ^= (size_t)mUnicode[i];
+		hash *= prime;
+	}
+	return hash;
+}
+
 float UString::toFloat() const
 {
 	return !isUtf8Null() ? std::strtof(mUtf8, NULL) : 0.0f;
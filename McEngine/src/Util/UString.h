@@ -53,6 +53,7 @@ public:
 	UString substr(int offset, int charCount = -1) const;
 	std::vector<UString> split(UString delim) const;
 	UString trim() const;
+	size_t hash() const;
 
 	// conversions
 	float toFloat() const;
@@ -116,4 +117,14 @@ private:
 	char *mUtf8;
 };
 
+// allows UStrings as keys in std::unordered_map/std::unordered_set
+namespace std
+{
+	template<>
+	struct hash<UString>
+	{
+		size_t operator () (const UString &str) const {return str.hash();}
+	};
+}
+
 #endif